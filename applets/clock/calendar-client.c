@@ -32,6 +32,7 @@
 #ifdef HAVE_EDS
 
 #include <libecal/libecal.h>
+#include "calendar-day-index.h"
 #include "calendar-sources.h"
 #include "system-timezone.h"
 #endif
@@ -49,13 +50,23 @@
 
 #ifdef HAVE_EDS
 
+/* Months kept around the selected one, and how far from it prefetching
+ * goes. A month is the index year * 12 + month. */
+#define CALENDAR_CLIENT_CACHE_MONTHS    2
+#define CALENDAR_CLIENT_PREFETCH_MONTHS 1
+
 typedef struct _CalendarClientQuery  CalendarClientQuery;
 typedef struct _CalendarClientSource CalendarClientSource;
+typedef struct _CalendarClientMonth  CalendarClientMonth;
 
+/* What a query found: the events by uid, and the appointments by the days
+ * of the month the query ran over */
 struct _CalendarClientQuery
 {
-  ECalClientView *view;
-  GHashTable     *events;
+  int               ref_count;
+
+  GHashTable       *events;
+  CalendarDayIndex *days;
 };
 
 struct _CalendarClientSource
@@ -63,13 +74,25 @@ struct _CalendarClientSource
   CalendarClient      *client;
   ECalClient          *source;
 
-  CalendarClientQuery  completed_query;
-  CalendarClientQuery  in_progress_query;
+  CalendarClientQuery *completed_query;
 
   guint                changed_signal_id;
 
-  guint                query_completed : 1;
-  guint                query_in_progress : 1;
+  /* query and month -> CalendarClientMonth */
+  GHashTable          *months;
+  char                *current_key;
+};
+
+/* A query of a source over one month. The query runs in a thread, until
+ * it completes @query is NULL and @cancellable is set. */
+struct _CalendarClientMonth
+{
+  CalendarClientSource *source;
+  char                 *key;
+  int                   index;
+
+  CalendarClientQuery  *query;
+  GCancellable         *cancellable;
 };
 
 struct _CalendarClientPrivate
@@ -106,15 +129,12 @@ static GSList *calendar_client_update_sources_list         (CalendarClient
 static void    calendar_client_appointment_sources_changed (CalendarClient       *client);
 static void    calendar_client_task_sources_changed        (CalendarClient       *client);
 
-static void calendar_client_stop_query  (CalendarClient       *client,
-					 CalendarClientSource *source,
-					 CalendarClientQuery  *query);
 static void calendar_client_start_query (CalendarClient       *client,
 					 CalendarClientSource *source,
 					 const char           *query);
 
 static void calendar_client_source_finalize (CalendarClientSource *source);
-static void calendar_client_query_finalize  (CalendarClientQuery  *query);
+static void calendar_client_query_unref     (CalendarClientQuery  *query);
 
 enum
 {
@@ -266,34 +286,29 @@ calendar_client_timezone_changed_cb (GSettings      *calendar_settings,
                                      CalendarClient *client)
 {
   calendar_client_set_timezone (client);
+
+  /* Event times depend on the zone, query again */
+  calendar_client_update_appointments (client);
+  calendar_client_update_tasks (client);
 }
 
 static void
 load_calendars (CalendarClient    *client,
                 CalendarEventType  type)
 {
-  GSList *l, *clients;
-
+  /* One query per source, the updates walk all of them already */
   switch (type)
     {
       case CALENDAR_EVENT_APPOINTMENT:
-        clients = client->priv->appointment_sources;
+        calendar_client_update_appointments (client);
         break;
       case CALENDAR_EVENT_TASK:
-        clients = client->priv->task_sources;
+        calendar_client_update_tasks (client);
         break;
       case CALENDAR_EVENT_ALL:
       default:
         g_assert_not_reached ();
     }
-
-  for (l = clients; l != NULL; l = l->next)
-    {
-      if (type == CALENDAR_EVENT_APPOINTMENT)
-        calendar_client_update_appointments (client);
-      else if (type == CALENDAR_EVENT_TASK)
-        calendar_client_update_tasks (client);
-    }
 }
 
 static void
@@ -897,15 +912,15 @@ calendar_appointment_finalize (CalendarAppointment *appointment)
 static void
 calendar_appointment_init (CalendarAppointment  *appointment,
                            ICalComponent        *component,
-                           CalendarClientSource *source,
+                           ECalClient           *source,
                            ICalTimezone         *default_zone)
 {
   appointment->uid = get_component_uid (component);
   appointment->rid = get_component_rid (component);
-  appointment->backend_name = get_source_backend_name (source->source);
+  appointment->backend_name = get_source_backend_name (source);
   appointment->summary = get_component_summary (component);
   appointment->description = get_component_description (component);
-  appointment->color_string = get_source_color (source->source);
+  appointment->color_string = get_source_color (source);
   appointment->start_time = get_component_start_time (component, default_zone);
   appointment->end_time = get_component_end_time (component, default_zone);
   appointment->is_all_day = get_component_is_all_day (component,
@@ -968,13 +983,13 @@ calendar_task_finalize (CalendarTask *task)
 static void
 calendar_task_init (CalendarTask         *task,
                     ICalComponent        *component,
-                    CalendarClientSource *source,
+                    ECalClient           *source,
                     ICalTimezone         *default_zone)
 {
   task->uid = get_component_uid (component);
   task->summary = get_component_summary (component);
   task->description = get_component_description (component);
-  task->color_string = get_source_color (source->source);
+  task->color_string = get_source_color (source);
   task->start_time = get_component_start_time (component, default_zone);
   task->due_time = get_component_due_time (component, default_zone);
   task->percent_complete = get_component_percent_complete (component);
@@ -1004,7 +1019,7 @@ calendar_event_free (CalendarEvent *event)
 
 static CalendarEvent *
 calendar_event_new (ICalComponent        *component,
-                    CalendarClientSource *source,
+                    ECalClient           *source,
                     ICalTimezone         *default_zone)
 {
   CalendarEvent *event;
@@ -1183,72 +1198,130 @@ calendar_event_debug_dump (CalendarEvent *event)
 #endif
 }
 
-static inline CalendarClientQuery *
-goddamn_this_is_crack (CalendarClientSource *source,
-                       ECalClientView       *view,
-                       gboolean             *emit_signal)
+static CalendarClientQuery *
+calendar_client_query_new (void)
 {
-  g_assert (view != NULL);
+  CalendarClientQuery *query;
 
-  if (source->completed_query.view == view)
-    {
-      if (emit_signal)
-	*emit_signal = TRUE;
-      return &source->completed_query;
-    }
-  else if (source->in_progress_query.view == view)
-    {
-      if (emit_signal)
-	*emit_signal = FALSE;
-      return &source->in_progress_query;
-    }
+  query = g_new0 (CalendarClientQuery, 1);
+  query->ref_count = 1;
+  query->events = g_hash_table_new_full (g_str_hash,
+					 g_str_equal,
+					 g_free,
+					 (GDestroyNotify) calendar_event_free);
 
-  g_assert_not_reached ();
+  return query;
+}
 
-  return NULL;
+static CalendarClientQuery *
+calendar_client_query_ref (CalendarClientQuery *query)
+{
+  query->ref_count++;
+
+  return query;
 }
 
 static void
-calendar_client_query_finalize (CalendarClientQuery *query)
+calendar_client_query_unref (CalendarClientQuery *query)
 {
-  if (query->view)
-    g_object_unref (query->view);
-  query->view = NULL;
+  if (!query || --query->ref_count > 0)
+    return;
 
-  if (query->events)
-    g_hash_table_destroy (query->events);
-  query->events = NULL;
+  calendar_day_index_free (query->days);
+  g_hash_table_destroy (query->events);
+  g_free (query);
 }
 
+/* Indexes the appointments by the days of @month they occur on */
 static void
-calendar_client_stop_query (CalendarClient       *client,
-			    CalendarClientSource *source,
-			    CalendarClientQuery  *query)
+calendar_client_query_index (CalendarClientQuery *query,
+			     guint                month,
+			     guint                year)
 {
-  if (query == &source->in_progress_query)
+  GHashTableIter iter;
+  gpointer       value;
+
+  query->days = calendar_day_index_new (month, year);
+
+  g_hash_table_iter_init (&iter, query->events);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
     {
-      g_assert (source->query_in_progress != FALSE);
+      CalendarEvent *event = value;
+      GSList        *l;
+
+      if (event->type != CALENDAR_EVENT_APPOINTMENT)
+	continue;
+
+      for (l = CALENDAR_APPOINTMENT (event)->occurrences; l; l = l->next)
+	{
+	  CalendarOccurrence *occurrence = l->data;
 
-      source->query_in_progress = FALSE;
+	  calendar_day_index_add (query->days, event,
+				  occurrence->start_time,
+				  occurrence->end_time);
+	}
     }
-  else if (query == &source->completed_query)
-    {
-      g_assert (source->query_completed != FALSE);
+}
+
+static gboolean
+calendar_client_events_equal (GHashTable *a,
+			      GHashTable *b)
+{
+  GHashTableIter iter;
+  gpointer       uid, event;
+
+  if ((a ? g_hash_table_size (a) : 0) != (b ? g_hash_table_size (b) : 0))
+    return FALSE;
+
+  if (!a || !b)
+    return TRUE;
+
+  g_hash_table_iter_init (&iter, a);
+  while (g_hash_table_iter_next (&iter, &uid, &event))
+    if (!calendar_event_equal (event, g_hash_table_lookup (b, uid)))
+      return FALSE;
+
+  return TRUE;
+}
 
-      source->query_completed = FALSE;
+static void
+calendar_client_month_free (CalendarClientMonth *month)
+{
+  if (month->cancellable)
+    {
+      g_cancellable_cancel (month->cancellable);
+      g_object_unref (month->cancellable);
     }
-  else
-    g_assert_not_reached ();
 
-  calendar_client_query_finalize (query);
+  calendar_client_query_unref (month->query);
+
+  g_free (month->key);
+  g_free (month);
 }
 
+/* What a query thread works on, none of it is shared with the main thread */
 typedef struct {
-  CalendarClient *client;
-  CalendarClientSource *source;
+  ECalClient *source;
+  char *query;
+  int index;
   time_t start_time;
   time_t end_time;
-  gboolean events_changed;
+  ICalTimezone *default_zone;
+  ICalTimezone *system_timezone;
+} CalendarClientJob;
+
+static void
+calendar_client_job_free (CalendarClientJob *job)
+{
+  g_object_unref (job->source);
+  g_free (job->query);
+  g_free (job);
+}
+
+typedef struct {
+  ECalClient *source;
+  GHashTable *events;
+  ICalTimezone *default_zone;
   ICalTimezone *system_timezone;
 } InstanceGenerationData;
 
@@ -1285,7 +1358,7 @@ calendar_client_instance_cb (ICalComponent *icomp,
   g_object_unref(local_end);
 
   /* Create event from the component */
-  event = calendar_event_new (icomp, data->source, data->client->priv->zone);
+  event = calendar_event_new (icomp, data->source, data->default_zone);
   if (!event)
     return TRUE;
 
@@ -1302,12 +1375,11 @@ calendar_client_instance_cb (ICalComponent *icomp,
   }
 
   uid = calendar_event_get_uid (event);
-  old_event = g_hash_table_lookup (data->source->in_progress_query.events, uid);
+  old_event = g_hash_table_lookup (data->events, uid);
 
   if (!calendar_event_equal (event, old_event)) {
     calendar_event_debug_dump (event);
-    g_hash_table_replace (data->source->in_progress_query.events, uid, event);
-    data->events_changed = TRUE;
+    g_hash_table_replace (data->events, uid, event);
   } else {
     calendar_event_free (event);
     g_free (uid);
@@ -1316,127 +1388,325 @@ calendar_client_instance_cb (ICalComponent *icomp,
   return TRUE;
 }
 
+/* Runs in a worker thread: fetches the objects of the month and expands
+ * their recurrences, so that neither blocks the panel */
 static void
-calendar_client_start_query (CalendarClient       *client,
-			     CalendarClientSource *source,
-			     const char           *query)
+calendar_client_query_thread (GTask        *task,
+			      gpointer      source_object,
+			      gpointer      task_data,
+			      GCancellable *cancellable)
+{
+  CalendarClientJob      *job = task_data;
+  CalendarClientQuery    *result;
+  InstanceGenerationData  instance_data;
+  GSList                 *objects = NULL;
+  GSList                 *l;
+  GError                 *error = NULL;
+
+  /* Get all objects for the month using query */
+  if (!e_cal_client_get_object_list_sync (job->source, job->query, &objects,
+					  cancellable, &error))
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  result = calendar_client_query_new ();
+
+  instance_data.source = job->source;
+  instance_data.events = result->events;
+  instance_data.default_zone = job->default_zone;
+  instance_data.system_timezone = job->system_timezone;
+
+  /* Generate instances for each object with automatic timezone conversion */
+  for (l = objects; l && !g_cancellable_is_cancelled (cancellable); l = l->next)
+    e_cal_client_generate_instances_for_object_sync (job->source,
+						     l->data,
+						     job->start_time,
+						     job->end_time,
+						     cancellable,
+						     calendar_client_instance_cb,
+						     &instance_data);
+
+  g_slist_free_full (objects, g_object_unref);
+
+  if (g_task_return_error_if_cancelled (task))
+    {
+      calendar_client_query_unref (result);
+      return;
+    }
+
+  calendar_client_query_index (result, job->index % 12, job->index / 12);
+
+  g_task_return_pointer (task, result,
+			 (GDestroyNotify) calendar_client_query_unref);
+}
+
+static ICalTimezone *
+calendar_client_get_system_timezone (void)
 {
-  time_t month_begin, month_end;
-  GSList *objects = NULL;
-  GError *error = NULL;
-  InstanceGenerationData instance_data;
+  SystemTimezone *systz;
+  ICalTimezone   *zone;
 
-  /* Validate that client is properly initialized */
-  if (client->priv->month == G_MAXUINT || client->priv->year == G_MAXUINT) {
-    return;
-  }
+  systz = system_timezone_new ();
+  zone = i_cal_timezone_get_builtin_timezone (system_timezone_get (systz));
+  g_object_unref (systz);
 
-  /* Calculate time range */
-  month_begin = make_time_for_day_begin (1, client->priv->month, client->priv->year);
+  return zone;
+}
 
-  /* Handle year rollover when month is December (11) */
-  if (client->priv->month == 11) {  /* December */
-    month_end = make_time_for_day_begin (1, 0, client->priv->year + 1);  /* January next year */
-  } else {
-    month_end = make_time_for_day_begin (1, client->priv->month + 1, client->priv->year);
-  }
+static void calendar_client_source_load (CalendarClientSource *source,
+					 const char           *query,
+					 int                   index,
+					 gboolean              current);
 
-  /* Validate time range */
-  if (month_begin == -1 || month_end == -1) {
-    g_warning ("Invalid time range: month_begin=%ld, month_end=%ld", (long)month_begin, (long)month_end);
-    calendar_client_stop_query (client, source, &source->in_progress_query);
-    return;
-  }
+static char *
+make_appointments_query (int month,
+			 int year)
+{
+  char *query;
+  char *month_begin;
+  char *month_end;
 
-  if (source->query_in_progress)
-    calendar_client_stop_query (client, source, &source->in_progress_query);
+  month_begin = make_isodate_for_day_begin (1, month, year);
+  month_end = make_isodate_for_day_begin (1, month + 1, year);
 
-  source->query_in_progress        = TRUE;
-  source->in_progress_query.view = NULL; /* No view needed for instance generation */
-  source->in_progress_query.events = g_hash_table_new_full (g_str_hash,
-							    g_str_equal,
-							    g_free,
-							    (GDestroyNotify) calendar_event_free);
+  query = g_strdup_printf ("occur-in-time-range? (make-time \"%s\") "
+			                        "(make-time \"%s\")",
+			   month_begin, month_end);
 
-  /* Get all objects for the month using query */
-  if (!e_cal_client_get_object_list_sync (source->source, query, &objects, NULL, &error)) {
-    g_warning ("Error getting calendar objects: %s", error->message);
-    g_error_free (error);
-    calendar_client_stop_query (client, source, &source->in_progress_query);
-    return;
-  }
+  g_free (month_begin);
+  g_free (month_end);
 
-  /* Get system timezone once for all instances */
-  SystemTimezone *systz = system_timezone_new();
-  const char *system_tz_name = system_timezone_get(systz);
-  ICalTimezone *system_timezone = i_cal_timezone_get_builtin_timezone(system_tz_name);
-  g_object_unref(systz);
+  return query;
+}
 
-  /* Set up instance generation data */
-  instance_data.client = client;
-  instance_data.source = source;
-  instance_data.start_time = month_begin;
-  instance_data.end_time = month_end;
-  instance_data.events_changed = FALSE;
-  instance_data.system_timezone = system_timezone;
+/* The query of the month @index for the prefetching of @source, or NULL
+ * if the query does not depend on the month alone */
+static char *
+calendar_client_source_make_query (CalendarClientSource *source,
+				   int                   index)
+{
+  if (source->changed_signal_id == signals [APPOINTMENTS_CHANGED])
+    return make_appointments_query (index % 12, index / 12);
 
-  /* Generate instances for each object with automatic timezone conversion */
-  for (GSList *l = objects; l; l = l->next) {
-    ICalComponent *component = l->data;
+#ifdef FIX_BROKEN_TASKS_QUERY
+  return NULL;
+#else
+  return g_strdup ("#t");
+#endif
+}
 
-    /* Some instances of recurring events may yield negative months - I think these are safe to skip */
-    if (month_begin < 0 || month_end < 0) {
-      continue;
+static void
+calendar_client_source_prefetch (CalendarClientSource *source,
+				 int                   index)
+{
+  int i;
+
+  for (i = index - CALENDAR_CLIENT_PREFETCH_MONTHS;
+       i <= index + CALENDAR_CLIENT_PREFETCH_MONTHS;
+       i++)
+    {
+      char *query;
+
+      if (i == index)
+	continue;
+
+      query = calendar_client_source_make_query (source, i);
+      if (query)
+	calendar_client_source_load (source, query, i, FALSE);
+      g_free (query);
     }
+}
 
-    e_cal_client_generate_instances_for_object_sync (source->source,
-                                                     component,
-                                                     month_begin,
-                                                     month_end,
-                                                     NULL, /* cancellable */
-                                                     calendar_client_instance_cb,
-                                                     &instance_data);
-  }
+/* Makes the completed @month the one the source shows, and starts
+ * fetching the months around it */
+static void
+calendar_client_source_show (CalendarClientSource *source,
+			     CalendarClientMonth  *month)
+{
+  gboolean events_changed;
 
-  g_slist_free_full (objects, g_object_unref);
+  events_changed = !calendar_client_events_equal (source->completed_query ?
+						  source->completed_query->events : NULL,
+						  month->query->events);
 
-  /* Query is now completed */
-  calendar_client_query_finalize (&source->completed_query);
-  source->completed_query = source->in_progress_query;
-  source->query_completed = TRUE;
+  calendar_client_query_unref (source->completed_query);
+  source->completed_query = calendar_client_query_ref (month->query);
 
-  source->query_in_progress = FALSE;
-  source->in_progress_query.view = NULL;
-  source->in_progress_query.events = NULL;
+  /* Before emitting, the handlers may select another month */
+  calendar_client_source_prefetch (source, month->index);
 
   /* Emit signal to capture changed events */
-  if (instance_data.events_changed) {
+  if (events_changed)
     g_signal_emit (source->client, source->changed_signal_id, 0);
-  }
 }
 
-void
-calendar_client_update_appointments (CalendarClient *client)
+static void
+calendar_client_query_done (GObject      *object,
+			    GAsyncResult *result,
+			    gpointer      user_data)
 {
-  GSList *l;
-  char   *query;
-  char   *month_begin;
-  char   *month_end;
+  CalendarClientMonth  *month = user_data;
+  CalendarClientSource *source;
+  CalendarClientQuery  *query;
+  GError               *error = NULL;
+
+  query = g_task_propagate_pointer (G_TASK (result), &error);
+
+  /* Only freeing the month cancels its query */
+  if (g_cancellable_is_cancelled (g_task_get_cancellable (G_TASK (result))))
+    {
+      g_clear_error (&error);
+      return;
+    }
+
+  source = month->source;
+  g_clear_object (&month->cancellable);
+
+  if (!query)
+    {
+      g_warning ("Error getting calendar objects: %s", error->message);
+      g_error_free (error);
+
+      /* Query again the next time the month is selected */
+      g_hash_table_remove (source->months, month->key);
+      return;
+    }
+
+  month->query = query;
+
+  if (g_strcmp0 (month->key, source->current_key) == 0)
+    calendar_client_source_show (source, month);
+}
+
+/* Forgets the months too far from the selected one, cancelling their
+ * queries if they are still running */
+static void
+calendar_client_source_trim (CalendarClientSource *source,
+			     int                   index)
+{
+  GHashTableIter       iter;
+  CalendarClientMonth *month;
+
+  g_hash_table_iter_init (&iter, source->months);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &month))
+    if (ABS (month->index - index) > CALENDAR_CLIENT_CACHE_MONTHS)
+      g_hash_table_iter_remove (&iter);
+}
+
+/* Runs @query over the month @index, unless it ran already. When @current
+ * is set, the source shows the result as soon as it is there. */
+static void
+calendar_client_source_load (CalendarClientSource *source,
+			     const char           *query,
+			     int                   index,
+			     gboolean              current)
+{
+  CalendarClientMonth *month;
+  CalendarClientJob   *job;
+  GTask               *task;
+  time_t               month_begin, month_end;
+  char                *key;
+
+  key = g_strdup_printf ("%d:%s", index, query);
+
+  if (current)
+    {
+      g_free (source->current_key);
+      source->current_key = g_strdup (key);
+
+      calendar_client_source_trim (source, index);
+    }
+
+  month = g_hash_table_lookup (source->months, key);
+  if (month)
+    {
+      g_free (key);
+
+      /* If it is still running, it is shown when it completes */
+      if (current && month->query)
+	calendar_client_source_show (source, month);
+      return;
+    }
+
+  month        = g_new0 (CalendarClientMonth, 1);
+  month->source = source;
+  month->key   = key;
+  month->index = index;
+  g_hash_table_insert (source->months, month->key, month);
+
+  /* mktime() normalizes December + 1 into January */
+  month_begin = make_time_for_day_begin (1, index % 12, index / 12);
+  month_end = make_time_for_day_begin (1, index % 12 + 1, index / 12);
+
+  /* Some instances of recurring events may yield negative months - I think these are safe to skip */
+  if (month_begin < 0 || month_end < 0)
+    {
+      month->query = calendar_client_query_new ();
+      if (current)
+	calendar_client_source_show (source, month);
+      return;
+    }
+
+  job = g_new0 (CalendarClientJob, 1);
+  job->source = g_object_ref (source->source);
+  job->query = g_strdup (query);
+  job->index = index;
+  job->start_time = month_begin;
+  job->end_time = month_end;
+  job->default_zone = source->client->priv->zone;
+  job->system_timezone = calendar_client_get_system_timezone ();
+
+  month->cancellable = g_cancellable_new ();
 
+  task = g_task_new (NULL, month->cancellable, calendar_client_query_done, month);
+  g_task_set_task_data (task, job, (GDestroyNotify) calendar_client_job_free);
+  if (!current)
+    g_task_set_priority (task, G_PRIORITY_LOW);
+  g_task_run_in_thread (task, calendar_client_query_thread);
+  g_object_unref (task);
+}
+
+static void
+calendar_client_start_query (CalendarClient       *client,
+			     CalendarClientSource *source,
+			     const char           *query)
+{
+  /* Validate that client is properly initialized */
   if (client->priv->month == G_MAXUINT || client->priv->year == G_MAXUINT)
     return;
 
-  month_begin = make_isodate_for_day_begin (1,
-					    client->priv->month,
-					    client->priv->year);
+  calendar_client_source_load (source, query,
+			       client->priv->year * 12 + client->priv->month,
+			       TRUE);
+}
 
-  month_end = make_isodate_for_day_begin (1,
-					  client->priv->month + 1,
-					  client->priv->year);
+/* Drops what the sources have fetched, the month they show stays until
+ * it is queried again */
+static void
+calendar_client_invalidate_sources (GSList *sources)
+{
+  GSList *l;
 
-  query = g_strdup_printf ("occur-in-time-range? (make-time \"%s\") "
-			                        "(make-time \"%s\")",
-			   month_begin, month_end);
+  for (l = sources; l; l = l->next)
+    {
+      CalendarClientSource *source = l->data;
+
+      g_hash_table_remove_all (source->months);
+    }
+}
+
+static void
+calendar_client_load_appointments (CalendarClient *client)
+{
+  GSList *l;
+  char   *query;
+
+  if (client->priv->month == G_MAXUINT || client->priv->year == G_MAXUINT)
+    return;
+
+  query = make_appointments_query (client->priv->month, client->priv->year);
 
   for (l = client->priv->appointment_sources; l; l = l->next)
     {
@@ -1445,16 +1715,21 @@ calendar_client_update_appointments (CalendarClient *client)
       calendar_client_start_query (client, cs, query);
     }
 
-  g_free (month_begin);
-  g_free (month_end);
   g_free (query);
 }
 
+void
+calendar_client_update_appointments (CalendarClient *client)
+{
+  calendar_client_invalidate_sources (client->priv->appointment_sources);
+  calendar_client_load_appointments (client);
+}
+
 /* FIXME:
  * perhaps we should use evo's "hide_completed_tasks" pref?
  */
-void
-calendar_client_update_tasks (CalendarClient *client)
+static void
+calendar_client_load_tasks (CalendarClient *client)
 {
   GSList *l;
   char   *query;
@@ -1516,6 +1791,13 @@ calendar_client_update_tasks (CalendarClient *client)
   g_free (query);
 }
 
+void
+calendar_client_update_tasks (CalendarClient *client)
+{
+  calendar_client_invalidate_sources (client->priv->task_sources);
+  calendar_client_load_tasks (client);
+}
+
 static void
 calendar_client_source_finalize (CalendarClientSource *source)
 {
@@ -1526,11 +1808,15 @@ calendar_client_source_finalize (CalendarClientSource *source)
   }
   source->source = NULL;
 
-  calendar_client_query_finalize (&source->completed_query);
-  calendar_client_query_finalize (&source->in_progress_query);
+  calendar_client_query_unref (source->completed_query);
+  source->completed_query = NULL;
+
+  if (source->months)
+    g_hash_table_destroy (source->months);
+  source->months = NULL;
 
-  source->query_completed   = FALSE;
-  source->query_in_progress = FALSE;
+  g_free (source->current_key);
+  source->current_key = NULL;
 }
 
 static int
@@ -1573,6 +1859,10 @@ calendar_client_update_sources_list (CalendarClient *client,
 	  new_source->client            = client;
 	  new_source->source            = g_object_ref (esource);
 	  new_source->changed_signal_id = changed_signal_id;
+	  new_source->months            = g_hash_table_new_full (g_str_hash,
+								 g_str_equal,
+								 NULL,
+								 (GDestroyNotify) calendar_client_month_free);
 	}
 
       retval = g_slist_prepend (retval, new_source);
@@ -1603,7 +1893,6 @@ calendar_client_appointment_sources_changed (CalendarClient  *client)
 									   signals [APPOINTMENTS_CHANGED]);
 
   load_calendars (client, CALENDAR_EVENT_APPOINTMENT);
-  calendar_client_update_appointments (client);
 
   g_list_free (list);
 }
@@ -1621,7 +1910,6 @@ calendar_client_task_sources_changed (CalendarClient  *client)
 								    signals [TASKS_CHANGED]);
 
   load_calendars (client, CALENDAR_EVENT_TASK);
-  calendar_client_update_tasks (client);
 
   g_list_free (list);
 }
@@ -1657,8 +1945,8 @@ calendar_client_select_month (CalendarClient *client,
       client->priv->month = month;
       client->priv->year  = year;
 
-      calendar_client_update_appointments (client);
-      calendar_client_update_tasks (client);
+      calendar_client_load_appointments (client);
+      calendar_client_load_tasks (client);
 
       g_object_freeze_notify (G_OBJECT (client));
       g_object_notify (G_OBJECT (client), "month");
@@ -1682,7 +1970,7 @@ calendar_client_select_day (CalendarClient *client,
        * the selected month changes
        */
 #ifdef FIX_BROKEN_TASKS_QUERY
-      calendar_client_update_tasks (client);
+      calendar_client_load_tasks (client);
 #endif
 
       g_object_notify (G_OBJECT (client), "day");
@@ -1717,13 +2005,11 @@ filter_appointment (const char    *uid,
   for (l = occurrences; l; l = l->next)
     {
       CalendarOccurrence *occurrence = l->data;
-      time_t start_time = occurrence->start_time;
-      time_t end_time   = occurrence->end_time;
 
-      if ((start_time >= filter_data->start_time &&
-           start_time < filter_data->end_time) ||
-          (start_time <= filter_data->start_time &&
-           (end_time - 1) > filter_data->start_time))
+      if (calendar_day_index_occurs (occurrence->start_time,
+				     occurrence->end_time,
+				     filter_data->start_time,
+				     filter_data->end_time))
 	{
 	  CalendarEvent *new_event;
 
@@ -1768,40 +2054,113 @@ filter_task (const char    *uid,
 }
 
 static GSList *
-calendar_client_filter_events (CalendarClient          *client,
-			       GSList                  *sources,
+calendar_client_filter_source (CalendarClient          *client,
+			       CalendarClientSource    *source,
 			       CalendarEventFilterFunc  filter_func,
 			       time_t                   start_time,
 			       time_t                   end_time)
 {
-  FilterData  filter_data;
-  GSList     *l;
-  GSList     *retval;
-
-  if (!sources)
-    return NULL;
+  FilterData filter_data;
 
   filter_data.client     = client;
   filter_data.events     = NULL;
   filter_data.start_time = start_time;
   filter_data.end_time   = end_time;
 
+  g_hash_table_foreach (source->completed_query->events,
+			(GHFunc) filter_func,
+			&filter_data);
+
+  return g_slist_reverse (filter_data.events);
+}
+
+static GSList *
+calendar_client_filter_events (CalendarClient          *client,
+			       GSList                  *sources,
+			       CalendarEventFilterFunc  filter_func,
+			       time_t                   start_time,
+			       time_t                   end_time)
+{
+  GSList *l;
+  GSList *retval;
+
   retval = NULL;
   for (l = sources; l; l = l->next)
     {
       CalendarClientSource *source = l->data;
 
-      if (source->query_completed)
+      if (source->completed_query)
+	retval = g_slist_concat (retval,
+				 calendar_client_filter_source (client,
+								source,
+								filter_func,
+								start_time,
+								end_time));
+    }
+
+  return retval;
+}
+
+/* The appointments of the selected day, from the day index of the sources
+ * showing the selected month */
+static GSList *
+calendar_client_get_day_appointments (CalendarClient *client,
+				      time_t          day_begin,
+				      time_t          day_end)
+{
+  GSList *l;
+  GSList *retval;
+
+  retval = NULL;
+  for (l = client->priv->appointment_sources; l; l = l->next)
+    {
+      CalendarClientSource        *source = l->data;
+      CalendarClientQuery         *query = source->completed_query;
+      const CalendarDayIndexEntry *entries;
+      GSList                      *events;
+      guint                        n_entries, i;
+
+      if (!query)
+	continue;
+
+      if (!query->days ||
+	  !calendar_day_index_is_month (query->days,
+					client->priv->month,
+					client->priv->year))
+	{
+	  retval = g_slist_concat (retval,
+				   calendar_client_filter_source (client,
+								  source,
+								  filter_appointment,
+								  day_begin,
+								  day_end));
+	  continue;
+	}
+
+      entries = calendar_day_index_get_day (query->days,
+					    client->priv->day,
+					    &n_entries);
+
+      events = NULL;
+      for (i = 0; i < n_entries; i++)
 	{
-	  filter_data.events = NULL;
-	  g_hash_table_foreach (source->completed_query.events,
-				(GHFunc) filter_func,
-				&filter_data);
+	  CalendarAppointment *appointment = entries [i].data;
+	  CalendarEvent       *new_event;
+	  GSList              *occurrences;
+
+	  /* The copy is of a single occurrence */
+	  occurrences = appointment->occurrences;
+	  appointment->occurrences = NULL;
+	  new_event = calendar_event_copy (CALENDAR_EVENT (appointment));
+	  appointment->occurrences = occurrences;
 
-	  filter_data.events = g_slist_reverse (filter_data.events);
+	  CALENDAR_APPOINTMENT (new_event)->start_time = entries [i].start_time;
+	  CALENDAR_APPOINTMENT (new_event)->end_time   = entries [i].end_time;
 
-	  retval = g_slist_concat (retval, filter_data.events);
+	  events = g_slist_prepend (events, new_event);
 	}
+
+      retval = g_slist_concat (retval, g_slist_reverse (events));
     }
 
   return retval;
@@ -1831,11 +2190,9 @@ calendar_client_get_events (CalendarClient    *client,
   appointments = NULL;
   if (event_mask & CALENDAR_EVENT_APPOINTMENT)
     {
-      appointments = calendar_client_filter_events (client,
-						    client->priv->appointment_sources,
-						    filter_appointment,
-						    day_begin,
-						    day_end);
+      appointments = calendar_client_get_day_appointments (client,
+							   day_begin,
+							   day_end);
     }
 
   tasks = NULL;
@@ -1861,31 +2218,19 @@ day_from_time_t (time_t t)
   return tm ? tm->tm_mday : 0;
 }
 
-void
-calendar_client_foreach_appointment_day (CalendarClient  *client,
-					 CalendarDayIter  iter_func,
-					 gpointer         user_data)
+/* What calendar_client_foreach_appointment_day() marks for a source whose
+ * query did not run over the selected month */
+static void
+calendar_client_mark_days (CalendarClient       *client,
+			   CalendarClientSource *source,
+			   time_t                month_begin,
+			   time_t                month_end,
+			   gboolean             *marked_days)
 {
-  GSList   *appointments, *l;
-  gboolean  marked_days [32] = { FALSE, };
-  time_t    month_begin;
-  time_t    month_end;
-  int       i;
-
-  g_return_if_fail (CALENDAR_IS_CLIENT (client));
-  g_return_if_fail (iter_func != NULL);
-  g_return_if_fail (client->priv->month != G_MAXUINT);
-  g_return_if_fail (client->priv->year != G_MAXUINT);
+  GSList *appointments, *l;
 
-  month_begin = make_time_for_day_begin (1,
-					 client->priv->month,
-					 client->priv->year);
-  month_end   = make_time_for_day_begin (1,
-					 client->priv->month + 1,
-					 client->priv->year);
-
-  appointments = calendar_client_filter_events (client,
-						client->priv->appointment_sources,
+  appointments = calendar_client_filter_source (client,
+						source,
 						filter_appointment,
 						month_begin,
 						month_end);
@@ -1920,10 +2265,54 @@ calendar_client_foreach_appointment_day (CalendarClient  *client,
     }
 
   g_slist_free (appointments);
+}
+
+void
+calendar_client_foreach_appointment_day (CalendarClient  *client,
+					 CalendarDayIter  iter_func,
+					 gpointer         user_data)
+{
+  GSList   *l;
+  gboolean  marked_days [32] = { FALSE, };
+  guint32   indexed_days = 0;
+  time_t    month_begin;
+  time_t    month_end;
+  int       i;
+
+  g_return_if_fail (CALENDAR_IS_CLIENT (client));
+  g_return_if_fail (iter_func != NULL);
+  g_return_if_fail (client->priv->month != G_MAXUINT);
+  g_return_if_fail (client->priv->year != G_MAXUINT);
+
+  month_begin = make_time_for_day_begin (1,
+					 client->priv->month,
+					 client->priv->year);
+  month_end   = make_time_for_day_begin (1,
+					 client->priv->month + 1,
+					 client->priv->year);
+
+  for (l = client->priv->appointment_sources; l; l = l->next)
+    {
+      CalendarClientSource *source = l->data;
+      CalendarClientQuery  *query = source->completed_query;
+
+      if (!query)
+	continue;
+
+      if (query->days &&
+	  calendar_day_index_is_month (query->days,
+				       client->priv->month,
+				       client->priv->year))
+	indexed_days |= calendar_day_index_get_marked_days (query->days);
+      else
+	calendar_client_mark_days (client, source,
+				   month_begin, month_end,
+				   marked_days);
+    }
 
   for (i = 1; i < 32; i++)
     {
-      if (marked_days [i])
+      if (marked_days [i] || (indexed_days & (1u << i)))
 	iter_func (client, i, user_data);
     }
 }
@@ -0,0 +1,194 @@
+/*
+ * calendar-day-index.c: calendar events by day of the month
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/*
+ * The beginning of every day of the month is computed once, with mktime()
+ * so that days across a daylight saving change keep their real length.
+ * An interval is then added to the days it occurs on, found by bisecting
+ * those beginnings, and a day costs only its own entries to look up.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "calendar-day-index.h"
+
+struct _CalendarDayIndex {
+	guint   month;
+	guint   year;
+	guint   n_days;
+
+	/* day_begin[n] for the days 1 to n_days, and the end of the month */
+	time_t  day_begin[33];
+
+	/* CalendarDayIndexEntry, NULL for a day without any */
+	GArray *days[32];
+
+	guint32 marked;
+};
+
+static time_t
+make_time_for_day_begin (int day,
+			 int month,
+			 int year)
+{
+	struct tm localtime_tm = { 0, };
+
+	localtime_tm.tm_mday  = day;
+	localtime_tm.tm_mon   = month;
+	localtime_tm.tm_year  = year - 1900;
+	localtime_tm.tm_isdst = -1;
+
+	return mktime (&localtime_tm);
+}
+
+CalendarDayIndex *
+calendar_day_index_new (guint month,
+			guint year)
+{
+	CalendarDayIndex *index;
+	guint             day;
+
+	g_return_val_if_fail (month <= 11, NULL);
+
+	index = g_new0 (CalendarDayIndex, 1);
+	index->month = month;
+	index->year = year;
+	index->n_days = g_date_get_days_in_month (month + 1, year);
+
+	/* mktime() normalizes the day after the last into the next month */
+	for (day = 1; day <= index->n_days + 1; day++)
+		index->day_begin[day] = make_time_for_day_begin (day, month, year);
+
+	return index;
+}
+
+void
+calendar_day_index_free (CalendarDayIndex *index)
+{
+	guint day;
+
+	if (!index)
+		return;
+
+	for (day = 1; day <= index->n_days; day++)
+		if (index->days[day])
+			g_array_free (index->days[day], TRUE);
+
+	g_free (index);
+}
+
+gboolean
+calendar_day_index_occurs (time_t start_time,
+			   time_t end_time,
+			   time_t day_begin,
+			   time_t day_end)
+{
+	return (start_time >= day_begin && start_time < day_end) ||
+	       (start_time <= day_begin && (end_time - 1) > day_begin);
+}
+
+/* The day @t falls on, 0 before the month and n_days + 1 after it */
+static guint
+calendar_day_index_find_day (CalendarDayIndex *index,
+			     time_t            t)
+{
+	guint low = 1, high = index->n_days + 1;
+
+	if (t < index->day_begin[1])
+		return 0;
+
+	/* The last day beginning at or before @t */
+	while (low < high) {
+		guint middle = (low + high + 1) / 2;
+
+		if (index->day_begin[middle] <= t)
+			low = middle;
+		else
+			high = middle - 1;
+	}
+
+	return low;
+}
+
+void
+calendar_day_index_add (CalendarDayIndex *index,
+			gpointer          data,
+			time_t            start_time,
+			time_t            end_time)
+{
+	CalendarDayIndexEntry entry;
+	guint                 first, day;
+
+	first = MAX (calendar_day_index_find_day (index, start_time), 1);
+
+	for (day = first; day <= index->n_days; day++) {
+		/* Only the day it starts on for an empty interval */
+		if (day > first && index->day_begin[day] >= end_time)
+			break;
+
+		if (!calendar_day_index_occurs (start_time, end_time,
+						index->day_begin[day],
+						index->day_begin[day + 1]))
+			continue;
+
+		if (!index->days[day])
+			index->days[day] = g_array_new (FALSE, FALSE,
+							sizeof (CalendarDayIndexEntry));
+
+		entry.data = data;
+		entry.start_time = start_time;
+		entry.end_time = end_time;
+		g_array_append_val (index->days[day], entry);
+
+		index->marked |= 1u << day;
+	}
+}
+
+gboolean
+calendar_day_index_is_month (CalendarDayIndex *index,
+			     guint             month,
+			     guint             year)
+{
+	return index->month == month && index->year == year;
+}
+
+const CalendarDayIndexEntry *
+calendar_day_index_get_day (CalendarDayIndex *index,
+			    guint             day,
+			    guint            *n_entries)
+{
+	if (day < 1 || day > index->n_days || !index->days[day]) {
+		*n_entries = 0;
+		return NULL;
+	}
+
+	*n_entries = index->days[day]->len;
+
+	return (const CalendarDayIndexEntry *) index->days[day]->data;
+}
+
+guint32
+calendar_day_index_get_marked_days (CalendarDayIndex *index)
+{
+	return index->marked;
+}
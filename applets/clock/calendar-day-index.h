@@ -0,0 +1,74 @@
+/*
+ * calendar-day-index.h: calendar events by day of the month
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __CALENDAR_DAY_INDEX_H__
+#define __CALENDAR_DAY_INDEX_H__
+
+#include <time.h>
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _CalendarDayIndex CalendarDayIndex;
+
+typedef struct
+{
+	gpointer data;
+	time_t   start_time;
+	time_t   end_time;
+} CalendarDayIndexEntry;
+
+/* @month is 0 based, as in struct tm. The days are those of the local time. */
+CalendarDayIndex            *calendar_day_index_new             (guint             month,
+								 guint             year);
+void                         calendar_day_index_free            (CalendarDayIndex *index);
+
+/* Adds @data to every day of the month the interval occurs on */
+void                         calendar_day_index_add             (CalendarDayIndex *index,
+								 gpointer          data,
+								 time_t            start_time,
+								 time_t            end_time);
+
+gboolean                     calendar_day_index_is_month        (CalendarDayIndex *index,
+								 guint             month,
+								 guint             year);
+
+/* The entries of @day, in the order they were added */
+const CalendarDayIndexEntry *calendar_day_index_get_day         (CalendarDayIndex *index,
+								 guint             day,
+								 guint            *n_entries);
+
+/* Bit n is set when day n has entries */
+guint32                      calendar_day_index_get_marked_days (CalendarDayIndex *index);
+
+/* Whether an interval occurs on the day starting at @day_begin */
+gboolean                     calendar_day_index_occurs          (time_t            start_time,
+								 time_t            end_time,
+								 time_t            day_begin,
+								 time_t            day_end);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CALENDAR_DAY_INDEX_H__ */
@@ -13,6 +13,7 @@
 #include "clock-location-tile.h"
 #include "clock-location.h"
 #include "clock-utils.h"
+#include "clock-tick.h"
 #include "clock-marshallers.h"
 #include "set-timezone.h"
 
@@ -47,11 +48,15 @@ typedef struct {
         GtkWidget *weather_icon;
 
         gulong location_weather_updated_id;
+
+        guint tick;
 } ClockLocationTilePrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (ClockLocationTile, clock_location_tile, GTK_TYPE_BIN)
 
 static void clock_location_tile_finalize (GObject *);
+static void clock_location_tile_map (GtkWidget *widget);
+static void clock_location_tile_unmap (GtkWidget *widget);
 
 static void clock_location_tile_fill (ClockLocationTile *this);
 static void update_weather_icon (ClockLocation *loc, WeatherInfo *info, gpointer data);
@@ -92,9 +97,13 @@ static void
 clock_location_tile_class_init (ClockLocationTileClass *this_class)
 {
         GObjectClass *g_obj_class = G_OBJECT_CLASS (this_class);
+        GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (this_class);
 
         g_obj_class->finalize = clock_location_tile_finalize;
 
+        widget_class->map = clock_location_tile_map;
+        widget_class->unmap = clock_location_tile_unmap;
+
         signals[TILE_PRESSED] = g_signal_new ("tile-pressed",
                                               G_TYPE_FROM_CLASS (g_obj_class),
                                               G_SIGNAL_RUN_FIRST,
@@ -157,9 +166,50 @@ clock_location_tile_finalize (GObject *g_obj)
         g_clear_object (&priv->button_group);
         g_clear_object (&priv->current_group);
 
+        if (priv->tick)
+                clock_tick_remove (priv->tick);
+        priv->tick = 0;
+
         G_OBJECT_CLASS (clock_location_tile_parent_class)->finalize (g_obj);
 }
 
+static void
+tile_tick (time_t   now,
+           gpointer data)
+{
+        clock_location_tile_refresh (CLOCK_LOCATION_TILE (data), FALSE);
+}
+
+/* Tiles only follow the time while they can be seen */
+static void
+clock_location_tile_map (GtkWidget *widget)
+{
+        ClockLocationTile *this = CLOCK_LOCATION_TILE (widget);
+        ClockLocationTilePrivate *priv = clock_location_tile_get_instance_private (this);
+
+        GTK_WIDGET_CLASS (clock_location_tile_parent_class)->map (widget);
+
+        if (!priv->tick)
+                priv->tick = clock_tick_add (priv->size == CLOCK_FACE_LARGE ?
+                                             CLOCK_TICK_SECOND : CLOCK_TICK_MINUTE,
+                                             tile_tick, this);
+
+        clock_location_tile_refresh (this, FALSE);
+}
+
+static void
+clock_location_tile_unmap (GtkWidget *widget)
+{
+        ClockLocationTile *this = CLOCK_LOCATION_TILE (widget);
+        ClockLocationTilePrivate *priv = clock_location_tile_get_instance_private (this);
+
+        if (priv->tick)
+                clock_tick_remove (priv->tick);
+        priv->tick = 0;
+
+        GTK_WIDGET_CLASS (clock_location_tile_parent_class)->unmap (widget);
+}
+
 static gboolean
 press_on_tile      (GtkWidget             *widget,
                     GdkEventButton        *event,
@@ -486,10 +536,10 @@ format_time (struct tm   *now,
 }
 
 static char *
-convert_time_to_str (time_t now, ClockFormat clock_format)
+convert_time_to_str (ClockLocation *location, time_t now, ClockFormat clock_format)
 {
         const gchar *format;
-        struct tm *tm;
+        struct tm tm;
         gchar buf[128];
 
         if (clock_format == CLOCK_FORMAT_12) {
@@ -507,8 +557,8 @@ convert_time_to_str (time_t now, ClockFormat clock_format)
                 format = _("%H:%M");
         }
 
-        tm = localtime (&now);
-        strftime (buf, sizeof (buf) - 1, format, tm);
+        clock_location_localtime_at (location, now, &tm);
+        strftime (buf, sizeof (buf) - 1, format, &tm);
 
         return g_locale_to_utf8 (buf, -1, NULL, NULL, NULL);
 }
@@ -577,7 +627,6 @@ weather_info_setup_tooltip (WeatherInfo *info, ClockLocation *location, GtkToolt
         gchar *temp, *apparent;
         gchar *line1, *line2, *line3, *line4, *tip;
         const gchar *icon_name;
-        const gchar *sys_timezone;
         time_t sunrise_time, sunset_time;
         gchar *sunrise_str, *sunset_str;
         gint icon_scale;
@@ -619,15 +668,12 @@ weather_info_setup_tooltip (WeatherInfo *info, ClockLocation *location, GtkToolt
         else
                 line3 = g_strdup ("");
 
-        sys_timezone = getenv ("TZ");
-        setenv ("TZ", clock_location_get_timezone (location), 1);
-        tzset ();
         if (weather_info_get_value_sunrise (info, &sunrise_time))
-                sunrise_str = convert_time_to_str (sunrise_time, clock_format);
+                sunrise_str = convert_time_to_str (location, sunrise_time, clock_format);
         else
                 sunrise_str = g_strdup ("???");
         if (weather_info_get_value_sunset (info, &sunset_time))
-                sunset_str = convert_time_to_str (sunset_time, clock_format);
+                sunset_str = convert_time_to_str (location, sunset_time, clock_format);
         else
                 sunset_str = g_strdup ("???");
         line4 = g_strdup_printf (_("Sunrise: %s / Sunset: %s"),
@@ -635,12 +681,6 @@ weather_info_setup_tooltip (WeatherInfo *info, ClockLocation *location, GtkToolt
         g_free (sunrise_str);
         g_free (sunset_str);
 
-        if (sys_timezone)
-                setenv ("TZ", sys_timezone, 1);
-        else
-                unsetenv ("TZ");
-        tzset ();
-
         tip = g_strdup_printf ("<b>%s</b>\n%s\n%s%s", line1, line2, line3, line4);
         gtk_tooltip_set_markup (tooltip, tip);
         g_free (line1);
@@ -21,6 +21,7 @@
 #include "clock-marshallers.h"
 #include "set-timezone.h"
 #include "system-timezone.h"
+#include "clock-weather.h"
 
 typedef struct {
         gchar *name;
@@ -29,6 +30,7 @@ typedef struct {
         SystemTimezone *systz;
 
         gchar *timezone;
+        GTimeZone *tz;
 
         gchar *tzname;
 
@@ -36,9 +38,7 @@ typedef struct {
         gfloat longitude;
 
         gchar *weather_code;
-        WeatherInfo *weather_info;
-        guint weather_timeout;
-        guint weather_retry_time;
+        guint weather_id;
 
         TempUnit temperature_unit;
         SpeedUnit speed_unit;
@@ -46,8 +46,6 @@ typedef struct {
 
 G_DEFINE_TYPE_WITH_PRIVATE (ClockLocation, clock_location, G_TYPE_OBJECT)
 
-#define WEATHER_TIMEOUT_BASE 30
-#define WEATHER_TIMEOUT_MAX  1800
 #define WEATHER_EMPTY_CODE   "-"
 
 enum {
@@ -59,9 +57,7 @@ enum {
 static guint location_signals[LAST_SIGNAL] = { 0 };
 
 static void clock_location_finalize (GObject *);
-static void clock_location_set_tz (ClockLocation *this);
-static void clock_location_unset_tz (ClockLocation *this);
-static gboolean update_weather_info (gpointer data);
+static void clock_location_update_tz (ClockLocation *this);
 static void setup_weather_updates (ClockLocation *loc);
 
 static gchar *clock_location_get_valid_weather_code (const gchar *code);
@@ -113,9 +109,7 @@ clock_location_new (const gchar *name, const gchar *city,
         priv->city = g_strdup (city);
         priv->timezone = g_strdup (timezone);
 
-        /* initialize priv->tzname */
-        clock_location_set_tz (this);
-        clock_location_unset_tz (this);
+        clock_location_update_tz (this);
 
         priv->latitude = latitude;
         priv->longitude = longitude;
@@ -160,24 +154,10 @@ clock_location_class_init (ClockLocationClass *this_class)
                               G_TYPE_NONE, 0);
 }
 
-static void
-network_changed (GNetworkMonitor *monitor,
-                 gboolean         available,
-                 ClockLocation   *loc)
-{
-        ClockLocationPrivate *priv = clock_location_get_instance_private (loc);
-
-        if (available) {
-                priv->weather_retry_time = WEATHER_TIMEOUT_BASE;
-                update_weather_info (loc);
-        }
-}
-
 static void
 clock_location_init (ClockLocation *this)
 {
         ClockLocationPrivate *priv = clock_location_get_instance_private (this);
-        GNetworkMonitor *monitor;
 
         priv->name = NULL;
         priv->city = NULL;
@@ -191,10 +171,6 @@ clock_location_init (ClockLocation *this)
         priv->latitude = 0;
         priv->longitude = 0;
 
-        monitor = g_network_monitor_get_default();
-        g_signal_connect (monitor, "network-changed",
-                          G_CALLBACK (network_changed), this);
-
         priv->temperature_unit = TEMP_UNIT_CENTIGRADE;
         priv->speed_unit = SPEED_UNIT_MS;
 }
@@ -203,12 +179,6 @@ static void
 clock_location_finalize (GObject *g_obj)
 {
         ClockLocationPrivate *priv = clock_location_get_instance_private (CLOCK_LOCATION(g_obj));
-        GNetworkMonitor      *monitor;
-
-        monitor = g_network_monitor_get_default ();
-        g_signal_handlers_disconnect_by_func (monitor,
-                                              G_CALLBACK (network_changed),
-                                              CLOCK_LOCATION (g_obj));
 
         g_clear_pointer (&priv->name, g_free);
         g_clear_pointer (&priv->city, g_free);
@@ -216,17 +186,13 @@ clock_location_finalize (GObject *g_obj)
         g_clear_object (&priv->systz);
 
         g_clear_pointer (&priv->timezone, g_free);
+        g_clear_pointer (&priv->tz, g_time_zone_unref);
         g_clear_pointer (&priv->tzname, g_free);
         g_clear_pointer (&priv->weather_code, g_free);
 
-        if (priv->weather_info) {
-                weather_info_free (priv->weather_info);
-                priv->weather_info = NULL;
-        }
-
-        if (priv->weather_timeout) {
-                g_source_remove (priv->weather_timeout);
-                priv->weather_timeout = 0;
+        if (priv->weather_id) {
+                clock_weather_unsubscribe (priv->weather_id);
+                priv->weather_id = 0;
         }
 
         G_OBJECT_CLASS (clock_location_parent_class)->finalize (g_obj);
@@ -292,6 +258,8 @@ clock_location_set_timezone (ClockLocation *loc, const gchar *timezone)
 
         g_free (priv->timezone);
         priv->timezone = g_strdup (timezone);
+
+        clock_location_update_tz (loc);
 }
 
 gchar *
@@ -338,62 +306,112 @@ clock_location_set_tzname (ClockLocation *this, const char *tzname)
         }
 }
 
-static void
-clock_location_set_tz (ClockLocation *this)
+static GTimeZone *
+clock_location_tz_new (const gchar *identifier)
+{
+#if GLIB_CHECK_VERSION(2,68,0)
+        GTimeZone *tz;
+
+        tz = g_time_zone_new_identifier (identifier);
+        if (tz == NULL)
+                tz = g_time_zone_new_utc ();
+
+        return tz;
+#else
+        return g_time_zone_new (identifier);
+#endif
+}
+
+/* The zone of the panel, built again only when the system timezone changes */
+static GTimeZone *
+clock_location_get_system_tz (ClockLocation *this)
 {
         ClockLocationPrivate *priv = clock_location_get_instance_private (this);
+        static GTimeZone *system_tz = NULL;
+        static gchar *system_tz_id = NULL;
+        const char *id;
 
-        time_t now_t;
-        struct tm now;
+        id = system_timezone_get_env (priv->systz);
+        if (id == NULL)
+                id = system_timezone_get (priv->systz);
 
-        if (priv->timezone == NULL) {
-                return;
+        if (system_tz == NULL || g_strcmp0 (id, system_tz_id) != 0) {
+                if (system_tz)
+                        g_time_zone_unref (system_tz);
+
+                system_tz = id ? clock_location_tz_new (id) : g_time_zone_new_local ();
+
+                g_free (system_tz_id);
+                system_tz_id = g_strdup (id);
         }
 
-        setenv ("TZ", priv->timezone, 1);
-        tzset();
+        return system_tz;
+}
 
-        now_t = time (NULL);
-        localtime_r (&now_t, &now);
+static GTimeZone *
+clock_location_get_tz (ClockLocation *this)
+{
+        ClockLocationPrivate *priv = clock_location_get_instance_private (this);
 
-        if (now.tm_isdst > 0) {
-                clock_location_set_tzname (this, tzname[1]);
-        } else {
-                clock_location_set_tzname (this, tzname[0]);
-        }
+        if (priv->tz)
+                return priv->tz;
+
+        return clock_location_get_system_tz (this);
 }
 
+/* Parses the zoneinfo file once, and not on every conversion */
 static void
-clock_location_unset_tz (ClockLocation *this)
+clock_location_update_tz (ClockLocation *this)
 {
         ClockLocationPrivate *priv = clock_location_get_instance_private (this);
-        const char *env_timezone;
+        GDateTime *now;
+
+        g_clear_pointer (&priv->tz, g_time_zone_unref);
 
         if (priv->timezone == NULL) {
                 return;
         }
 
-        env_timezone = system_timezone_get_env (priv->systz);
+        priv->tz = clock_location_tz_new (priv->timezone);
 
-        if (env_timezone) {
-                setenv ("TZ", env_timezone, 1);
-        } else {
-                unsetenv ("TZ");
-        }
-        tzset();
+        now = g_date_time_new_now (priv->tz);
+        clock_location_set_tzname (this, g_date_time_get_timezone_abbreviation (now));
+        g_date_time_unref (now);
 }
 
 void
-clock_location_localtime (ClockLocation *loc, struct tm *tm)
+clock_location_localtime_at (ClockLocation *loc, time_t t, struct tm *tm)
 {
-        time_t now;
+        GDateTime *utc, *dt;
+
+        memset (tm, 0, sizeof (struct tm));
+
+        utc = g_date_time_new_from_unix_utc (t);
+        if (utc == NULL)
+                return;
 
-        clock_location_set_tz (loc);
+        dt = g_date_time_to_timezone (utc, clock_location_get_tz (loc));
+        g_date_time_unref (utc);
 
-        time (&now);
-        localtime_r (&now, tm);
+        tm->tm_sec = g_date_time_get_second (dt);
+        tm->tm_min = g_date_time_get_minute (dt);
+        tm->tm_hour = g_date_time_get_hour (dt);
+        tm->tm_mday = g_date_time_get_day_of_month (dt);
+        tm->tm_mon = g_date_time_get_month (dt) - 1;
+        tm->tm_year = g_date_time_get_year (dt) - 1900;
+        tm->tm_wday = g_date_time_get_day_of_week (dt) % 7;
+        tm->tm_yday = g_date_time_get_day_of_year (dt) - 1;
+        tm->tm_isdst = g_date_time_is_daylight_savings (dt) ? 1 : 0;
 
-        clock_location_unset_tz (loc);
+        clock_location_set_tzname (loc, g_date_time_get_timezone_abbreviation (dt));
+
+        g_date_time_unref (dt);
+}
+
+void
+clock_location_localtime (ClockLocation *loc, struct tm *tm)
+{
+        clock_location_localtime_at (loc, time (NULL), tm);
 }
 
 gboolean
@@ -437,35 +455,22 @@ clock_location_is_current (ClockLocation *loc)
 glong
 clock_location_get_offset (ClockLocation *loc)
 {
-        ClockLocationPrivate *priv = clock_location_get_instance_private (loc);
-        glong sys_timezone, local_timezone;
-        glong offset;
-        time_t t;
-        struct tm *tm;
+        gint64 now;
+        gint sys_offset, local_offset;
 
-        t = time (NULL);
+        now = g_get_real_time () / G_USEC_PER_SEC;
 
-        unsetenv ("TZ");
-        tm = localtime (&t);
-        sys_timezone = timezone;
+        sys_offset = g_time_zone_get_offset (clock_location_get_system_tz (loc),
+                                             g_time_zone_find_interval (clock_location_get_system_tz (loc),
+                                                                        G_TIME_TYPE_UNIVERSAL,
+                                                                        now));
+        local_offset = g_time_zone_get_offset (clock_location_get_tz (loc),
+                                               g_time_zone_find_interval (clock_location_get_tz (loc),
+                                                                          G_TIME_TYPE_UNIVERSAL,
+                                                                          now));
 
-        if (tm->tm_isdst > 0) {
-                sys_timezone -= 3600;
-        }
-
-        setenv ("TZ", priv->timezone, 1);
-        tm = localtime (&t);
-        local_timezone = timezone;
-
-        if (tm->tm_isdst > 0) {
-                local_timezone -= 3600;
-        }
-
-        offset = local_timezone - sys_timezone;
-
-        clock_location_unset_tz (loc);
-
-        return offset;
+        /* Seconds west of the system timezone, like the libc timezone variable */
+        return sys_offset - local_offset;
 }
 
 typedef struct {
@@ -587,55 +592,14 @@ clock_location_get_weather_info (ClockLocation *loc)
 {
         ClockLocationPrivate *priv = clock_location_get_instance_private (loc);
 
-        return priv->weather_info;
-}
-
-static void
-set_weather_update_timeout (ClockLocation *loc)
-{
-        ClockLocationPrivate *priv = clock_location_get_instance_private (loc);
-        guint timeout;
-
-        if (!weather_info_network_error (priv->weather_info)) {
-                /* The last update succeeded; set the next update to
-                 * happen in half an hour, and reset the retry timer.
-                 */
-                timeout = WEATHER_TIMEOUT_MAX;
-                priv->weather_retry_time = WEATHER_TIMEOUT_BASE;
-        } else {
-                /* The last update failed; set the next update
-                 * according to the retry timer, and exponentially
-                 * back off the retry timer.
-                 */
-                timeout = priv->weather_retry_time;
-                priv->weather_retry_time *= 2;
-                if (priv->weather_retry_time > WEATHER_TIMEOUT_MAX)
-                        priv->weather_retry_time = WEATHER_TIMEOUT_MAX;
-        }
-
-        if (priv->weather_timeout)
-                g_source_remove (priv->weather_timeout);
-        priv->weather_timeout =
-                g_timeout_add_seconds (timeout, update_weather_info, loc);
+        return clock_weather_get (priv->weather_id);
 }
 
 static void
-weather_info_updated (WeatherInfo *info, gpointer data)
+weather_backend_get_prefs (const ClockWeatherRequest *request,
+                           WeatherPrefs              *prefs)
 {
-        ClockLocation *loc = data;
-        ClockLocationPrivate *priv = clock_location_get_instance_private (loc);
-
-        set_weather_update_timeout (loc);
-        g_signal_emit (loc, location_signals[WEATHER_UPDATED],
-                       0, priv->weather_info);
-}
-
-static gboolean
-update_weather_info (gpointer data)
-{
-        ClockLocation *loc = (ClockLocation *) data;
-        ClockLocationPrivate *priv = clock_location_get_instance_private (loc);
-        WeatherPrefs prefs = {
+        WeatherPrefs defaults = {
                 FORECAST_STATE,
                 FALSE,
                 NULL,
@@ -645,19 +609,70 @@ update_weather_info (gpointer data)
                 DISTANCE_UNIT_KM
         };
 
+        *prefs = defaults;
+
         /* set temperature and speed units only if different from
          * invalid/default
          */
-        if (priv->temperature_unit > TEMP_UNIT_DEFAULT)
-                prefs.temperature_unit = priv->temperature_unit;
-        if (priv->speed_unit > SPEED_UNIT_DEFAULT)
-                prefs.speed_unit = priv->speed_unit;
+        if (request->temperature_unit > TEMP_UNIT_DEFAULT)
+                prefs->temperature_unit = request->temperature_unit;
+        if (request->speed_unit > SPEED_UNIT_DEFAULT)
+                prefs->speed_unit = request->speed_unit;
+}
+
+static gpointer
+weather_backend_create (const ClockWeatherRequest *request,
+                        ClockWeatherFetched        fetched,
+                        gpointer                   data)
+{
+        WeatherLocation *wl;
+        WeatherInfo *info;
+        WeatherPrefs prefs;
 
-        weather_info_abort (priv->weather_info);
-        weather_info_update (priv->weather_info,
-                             &prefs, weather_info_updated, loc);
+        weather_backend_get_prefs (request, &prefs);
 
-        return TRUE;
+        wl = weather_location_new (request->city, request->code,
+                                   NULL, NULL, request->coordinates, NULL, NULL);
+        info = weather_info_new (wl, &prefs, (WeatherInfoFunc) fetched, data);
+        weather_location_free (wl);
+
+        return info;
+}
+
+static void
+weather_backend_fetch (gpointer                   weather,
+                       const ClockWeatherRequest *request,
+                       ClockWeatherFetched        fetched,
+                       gpointer                   data)
+{
+        WeatherPrefs prefs;
+
+        weather_backend_get_prefs (request, &prefs);
+
+        weather_info_abort (weather);
+        weather_info_update (weather, &prefs, (WeatherInfoFunc) fetched, data);
+}
+
+static gboolean
+weather_backend_network_error (gpointer weather)
+{
+        return weather_info_network_error (weather);
+}
+
+static const ClockWeatherBackend weather_backend = {
+        weather_backend_create,
+        weather_backend_fetch,
+        (void (*) (gpointer)) weather_info_free,
+        weather_backend_network_error
+};
+
+static void
+weather_info_updated (gpointer weather, gpointer data)
+{
+        ClockLocation *loc = data;
+
+        g_signal_emit (loc, location_signals[WEATHER_UPDATED],
+                       0, weather);
 }
 
 static gchar *
@@ -683,47 +698,34 @@ static void
 setup_weather_updates (ClockLocation *loc)
 {
         ClockLocationPrivate *priv = clock_location_get_instance_private (loc);
-        WeatherLocation *wl;
-        WeatherPrefs prefs = {
-                FORECAST_STATE,
-                FALSE,
-                NULL,
-                TEMP_UNIT_CENTIGRADE,
-                SPEED_UNIT_MS,
-                PRESSURE_UNIT_MB,
-                DISTANCE_UNIT_KM
-        };
-
+        ClockWeatherRequest request;
+        guint old_id;
         gchar *dms;
 
-        prefs.temperature_unit = priv->temperature_unit;
-        prefs.speed_unit = priv->speed_unit;
-
-        if (priv->weather_info) {
-                weather_info_free (priv->weather_info);
-                priv->weather_info = NULL;
+        old_id = priv->weather_id;
+        priv->weather_id = 0;
+
+        /* Subscribe before letting go of the old weather, so that an
+         * unchanged request keeps it instead of fetching it again */
+        if (priv->weather_code &&
+            strcmp (priv->weather_code, WEATHER_EMPTY_CODE) != 0) {
+                dms = rad2dms (priv->latitude, priv->longitude);
+
+                request.city = priv->city;
+                request.code = priv->weather_code;
+                request.coordinates = dms;
+                request.temperature_unit = priv->temperature_unit;
+                request.speed_unit = priv->speed_unit;
+
+                priv->weather_id = clock_weather_subscribe (&weather_backend,
+                                                            &request,
+                                                            weather_info_updated,
+                                                            loc);
+                g_free (dms);
         }
 
-        if (priv->weather_timeout) {
-                g_source_remove (priv->weather_timeout);
-                priv->weather_timeout = 0;
-        }
-
-        if (!priv->weather_code ||
-            strcmp (priv->weather_code, WEATHER_EMPTY_CODE) == 0)
-                return;
-
-        dms = rad2dms (priv->latitude, priv->longitude);
-        wl = weather_location_new (priv->city, priv->weather_code,
-                                   NULL, NULL, dms, NULL, NULL);
-
-        priv->weather_info =
-                weather_info_new (wl, &prefs, weather_info_updated, loc);
-
-        set_weather_update_timeout (loc);
-
-        weather_location_free (wl);
-        g_free (dms);
+        if (old_id)
+                clock_weather_unsubscribe (old_id);
 }
 
 void
@@ -735,6 +737,5 @@ clock_location_set_weather_prefs (ClockLocation *loc,
         priv->temperature_unit = prefs->temperature_unit;
         priv->speed_unit = prefs->speed_unit;
 
-        update_weather_info (loc);
+        setup_weather_updates (loc);
 }
-
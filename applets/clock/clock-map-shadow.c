@@ -0,0 +1,229 @@
+/*
+ * clock-map-shadow.c: day and night shadow of the world map
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/*
+ * A point of the map is sunlit when the dot product of its unit vector with
+ * the one of the sun is positive. That product is
+ *
+ *   cos(lat) cos(sun_lat) cos(lon - sun_lon) + sin(lat) sin(sun_lat)
+ *
+ * so with cos(lat) and sin(lat) kept per row, and cos(lon - sun_lon)
+ * computed once per column for a given sun position, every pixel only
+ * costs a multiply-add, in loops the compiler can vectorize.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "clock-map-shadow.h"
+#include "clock-sunpos.h"
+
+/* twilight */
+#define SHADOW_EPSILON 0.01f
+
+struct _ClockMapShadow {
+	int        width;
+	int        height;
+
+	/* per row and per column, for the current size */
+	gfloat    *cos_lat;
+	gfloat    *sin_lat;
+	gdouble   *lon;
+
+	/* per column, for the current sun position */
+	gfloat    *cos_dlon;
+
+	/* alpha of one row */
+	guchar    *row;
+
+	/* where the sun was when the shadow was rendered, in pixels */
+	gdouble    sun_x;
+	gdouble    sun_y;
+
+	GdkPixbuf *pixbuf;
+};
+
+ClockMapShadow *
+clock_map_shadow_new (void)
+{
+	return g_new0 (ClockMapShadow, 1);
+}
+
+static void
+clock_map_shadow_clear (ClockMapShadow *shadow)
+{
+	g_clear_pointer (&shadow->cos_lat, g_free);
+	g_clear_pointer (&shadow->sin_lat, g_free);
+	g_clear_pointer (&shadow->lon, g_free);
+	g_clear_pointer (&shadow->cos_dlon, g_free);
+	g_clear_pointer (&shadow->row, g_free);
+	g_clear_object (&shadow->pixbuf);
+
+	shadow->width = 0;
+	shadow->height = 0;
+}
+
+void
+clock_map_shadow_free (ClockMapShadow *shadow)
+{
+	if (!shadow)
+		return;
+
+	clock_map_shadow_clear (shadow);
+	g_free (shadow);
+}
+
+GdkPixbuf *
+clock_map_shadow_get_pixbuf (ClockMapShadow *shadow)
+{
+	return shadow->pixbuf;
+}
+
+static void
+clock_map_shadow_resize (ClockMapShadow *shadow,
+			 int             width,
+			 int             height)
+{
+	int x, y;
+
+	clock_map_shadow_clear (shadow);
+
+	shadow->width = width;
+	shadow->height = height;
+
+	shadow->cos_lat = g_new (gfloat, height);
+	shadow->sin_lat = g_new (gfloat, height);
+	for (y = 0; y < height; y++) {
+		gdouble lat = (height / 2.0 - y) / (height / 2.0) * (M_PI / 2.0);
+
+		shadow->cos_lat[y] = cos (lat);
+		shadow->sin_lat[y] = sin (lat);
+	}
+
+	shadow->lon = g_new (gdouble, width);
+	shadow->cos_dlon = g_new (gfloat, width);
+	for (x = 0; x < width; x++)
+		shadow->lon[x] = (x - width / 2.0) / (width / 2.0) * M_PI;
+
+	shadow->row = g_new (guchar, width);
+
+	shadow->pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
+					 width, height);
+
+	/* Initialize to all shadow */
+	gdk_pixbuf_fill (shadow->pixbuf, 0x6d9ccdff);
+}
+
+static void
+clock_map_shadow_render_row (const gfloat *cos_dlon,
+			     gfloat        a,
+			     gfloat        b,
+			     guchar       *row,
+			     int           width)
+{
+	int x;
+
+	/* Branch-free, so that it vectorizes: 0 in daylight, 255 at night
+	 * and a ramp across the twilight */
+	for (x = 0; x < width; x++) {
+		gfloat shade;
+
+		shade = -128.0f * ((a * cos_dlon[x] + b) / SHADOW_EPSILON - 1.0f);
+		shade = shade < 0.0f ? 0.0f : shade;
+		shade = shade > 255.0f ? 255.0f : shade;
+
+		row[x] = (guchar) shade;
+	}
+}
+
+static void
+clock_map_shadow_render (ClockMapShadow *shadow,
+			 gdouble         sun_lat,
+			 gdouble         sun_lon)
+{
+	int     x, y;
+	int     n_channels, rowstride;
+	guchar *pixels;
+	gdouble sun_lat_rad, sun_lon_rad;
+	gfloat  cos_sun_lat, sin_sun_lat;
+
+	n_channels = gdk_pixbuf_get_n_channels (shadow->pixbuf);
+	rowstride = gdk_pixbuf_get_rowstride (shadow->pixbuf);
+	pixels = gdk_pixbuf_get_pixels (shadow->pixbuf);
+
+	sun_lat_rad = sun_lat * (M_PI / 180.0);
+	sun_lon_rad = sun_lon * (M_PI / 180.0);
+
+	cos_sun_lat = cos (sun_lat_rad);
+	sin_sun_lat = sin (sun_lat_rad);
+
+	for (x = 0; x < shadow->width; x++)
+		shadow->cos_dlon[x] = cos (shadow->lon[x] - sun_lon_rad);
+
+	for (y = 0; y < shadow->height; y++) {
+		guchar *p = pixels + y * rowstride + 3;
+
+		clock_map_shadow_render_row (shadow->cos_dlon,
+					     shadow->cos_lat[y] * cos_sun_lat,
+					     shadow->sin_lat[y] * sin_sun_lat,
+					     shadow->row, shadow->width);
+
+		for (x = 0; x < shadow->width; x++, p += n_channels)
+			*p = shadow->row[x];
+	}
+}
+
+gboolean
+clock_map_shadow_update (ClockMapShadow *shadow,
+			 int             width,
+			 int             height,
+			 time_t          now)
+{
+	gdouble sun_lat, sun_lon;
+	gdouble sun_x, sun_y;
+
+	g_return_val_if_fail (width > 0 && height > 0, FALSE);
+
+	sun_position (now, &sun_lat, &sun_lon);
+
+	sun_x = sun_lon / 360.0 * width;
+	sun_y = sun_lat / 180.0 * height;
+
+	if (shadow->pixbuf &&
+	    shadow->width == width && shadow->height == height &&
+	    fabs (sun_x - shadow->sun_x) < 1.0 &&
+	    fabs (sun_y - shadow->sun_y) < 1.0)
+		return FALSE;
+
+	if (shadow->width != width || shadow->height != height)
+		clock_map_shadow_resize (shadow, width, height);
+
+	clock_map_shadow_render (shadow, sun_lat, sun_lon);
+
+	shadow->sun_x = sun_x;
+	shadow->sun_y = sun_y;
+
+	return TRUE;
+}
@@ -9,8 +9,9 @@
 
 #include "clock.h"
 #include "clock-map.h"
-#include "clock-sunpos.h"
+#include "clock-map-shadow.h"
 #include "clock-marshallers.h"
+#include "clock-tick.h"
 
 enum {
 	NEED_LOCATIONS,
@@ -33,20 +34,21 @@ static char *marker_files[MARKER_NB] = {
 static guint signals[LAST_SIGNAL] = { 0 };
 
 typedef struct {
-        time_t last_refresh;
-
         gint width;
         gint height;
 
 	guint highlight_timeout_id;
 
+        /* Only while the map is mapped */
+        guint tick;
+
         GdkPixbuf *stock_map_pixbuf;
         GdkPixbuf *location_marker_pixbuf[MARKER_NB];
 
         GdkPixbuf *location_map_pixbuf;
 
         /* The shadow itself */
-        GdkPixbuf *shadow_pixbuf;
+        ClockMapShadow *shadow;
 
         /* The map with the shadow composited onto it */
         GdkPixbuf *shadow_map_pixbuf;
@@ -55,6 +57,8 @@ typedef struct {
 G_DEFINE_TYPE_WITH_PRIVATE (ClockMap, clock_map, GTK_TYPE_WIDGET)
 
 static void clock_map_finalize (GObject *);
+static void clock_map_map (GtkWidget *this);
+static void clock_map_unmap (GtkWidget *this);
 static void clock_map_size_allocate (GtkWidget *this,
 					 GtkAllocation *allocation);
 static gboolean clock_map_draw (GtkWidget *this,
@@ -66,7 +70,7 @@ static void clock_map_get_preferred_height (GtkWidget *widget,
 					    gint *minimum_height,
 					    gint *natural_height);
 static void clock_map_place_locations (ClockMap *this);
-static void clock_map_render_shadow (ClockMap *this);
+static gboolean clock_map_render_shadow (ClockMap *this, gboolean force);
 static void clock_map_display (ClockMap *this);
 
 ClockMap *
@@ -91,6 +95,8 @@ clock_map_class_init (ClockMapClass *this_class)
 
         widget_class->size_allocate = clock_map_size_allocate;
         widget_class->draw = clock_map_draw;
+        widget_class->map = clock_map_map;
+        widget_class->unmap = clock_map_unmap;
 	widget_class->get_preferred_width = clock_map_get_preferred_width;
 	widget_class->get_preferred_height = clock_map_get_preferred_height;
 
@@ -122,11 +128,11 @@ clock_map_init (ClockMap *this)
 
         gtk_widget_set_has_window (GTK_WIDGET (this), FALSE);
 
-	priv->last_refresh = 0;
 	priv->width = 0;
 	priv->height = 0;
 	priv->highlight_timeout_id = 0;
         priv->stock_map_pixbuf = NULL;
+        priv->shadow = clock_map_shadow_new ();
 
         g_assert (sizeof (marker_files)/sizeof (char *) == MARKER_NB);
 
@@ -150,6 +156,10 @@ clock_map_finalize (GObject *g_obj)
 		priv->highlight_timeout_id = 0;
 	}
 
+        if (priv->tick)
+                clock_tick_remove (priv->tick);
+        priv->tick = 0;
+
         g_clear_object (&priv->stock_map_pixbuf);
 
 	for (i = 0; i < MARKER_NB; i++) {
@@ -157,7 +167,7 @@ clock_map_finalize (GObject *g_obj)
 	}
 
         g_clear_object (&priv->location_map_pixbuf);
-        g_clear_object (&priv->shadow_pixbuf);
+        g_clear_pointer (&priv->shadow, clock_map_shadow_free);
         g_clear_object (&priv->shadow_map_pixbuf);
 
         G_OBJECT_CLASS (clock_map_parent_class)->finalize (g_obj);
@@ -234,6 +244,40 @@ clock_map_draw (GtkWidget *this, cairo_t *cr)
 	return FALSE;
 }
 
+static void
+clock_map_tick (time_t   now,
+                gpointer data)
+{
+        clock_map_update_time (CLOCK_MAP (data));
+}
+
+/* The shadow only follows the sun while the map can be seen, and catches
+ * up when it is shown again */
+static void
+clock_map_map (GtkWidget *this)
+{
+        ClockMapPrivate *priv = clock_map_get_instance_private (CLOCK_MAP (this));
+
+        GTK_WIDGET_CLASS (clock_map_parent_class)->map (this);
+
+        if (!priv->tick)
+                priv->tick = clock_tick_add (CLOCK_TICK_MINUTE, clock_map_tick, this);
+
+        clock_map_update_time (CLOCK_MAP (this));
+}
+
+static void
+clock_map_unmap (GtkWidget *this)
+{
+        ClockMapPrivate *priv = clock_map_get_instance_private (CLOCK_MAP (this));
+
+        if (priv->tick)
+                clock_tick_remove (priv->tick);
+        priv->tick = 0;
+
+        GTK_WIDGET_CLASS (clock_map_parent_class)->unmap (this);
+}
+
 static void
 clock_map_get_preferred_width (GtkWidget *this,
                                 gint *minimum_width,
@@ -455,99 +499,19 @@ clock_map_place_locations (ClockMap *this)
 #endif
 }
 
-static void
-clock_map_compute_vector (gdouble lat, gdouble lon, gdouble *vec)
-{
-        gdouble lat_rad, lon_rad;
-        lat_rad = lat * (M_PI/180.0);
-        lon_rad = lon * (M_PI/180.0);
-
-        vec[0] = sin(lon_rad) * cos(lat_rad);
-        vec[1] = sin(lat_rad);
-        vec[2] = cos(lon_rad) * cos(lat_rad);
-}
-
-static guchar
-clock_map_is_sunlit (gdouble pos_lat, gdouble pos_long,
-                         gdouble sun_lat, gdouble sun_long)
-{
-        gdouble pos_vec[3];
-        gdouble sun_vec[3];
-        gdouble dot;
-
-        /* twilight */
-        gdouble epsilon = 0.01;
-
-        clock_map_compute_vector (pos_lat, pos_long, pos_vec);
-        clock_map_compute_vector (sun_lat, sun_long, sun_vec);
-
-        /* compute the dot product of the two */
-        dot = pos_vec[0]*sun_vec[0] + pos_vec[1]*sun_vec[1]
-                + pos_vec[2]*sun_vec[2];
-
-        if (dot > epsilon) {
-                return 0x00;
-        }
-
-        if (dot < -epsilon) {
-                return 0xFF;
-        }
-
-        return (guchar)(-128 * ((dot / epsilon) - 1));
-}
-
-static void
-clock_map_render_shadow_pixbuf (GdkPixbuf *pixbuf)
-{
-        int x, y;
-        int height, width;
-        int n_channels, rowstride;
-        guchar *pixels, *p;
-        gdouble sun_lat, sun_lon;
-        time_t now = time (NULL);
-
-        n_channels = gdk_pixbuf_get_n_channels (pixbuf);
-        rowstride = gdk_pixbuf_get_rowstride (pixbuf);
-        pixels = gdk_pixbuf_get_pixels (pixbuf);
-
-        width = gdk_pixbuf_get_width (pixbuf);
-        height = gdk_pixbuf_get_height (pixbuf);
-
-        sun_position (now, &sun_lat, &sun_lon);
-
-        for (y = 0; y < height; y++) {
-                gdouble lat = (height / 2.0 - y) / (height / 2.0) * 90.0;
-
-                for (x = 0; x < width; x++) {
-                        guchar shade;
-                        gdouble lon =
-                                (x - width / 2.0) / (width / 2.0) * 180.0;
-
-                        shade = clock_map_is_sunlit (lat, lon,
-                                                         sun_lat, sun_lon);
-
-                        p = pixels + y * rowstride + x * n_channels;
-                        p[3] = shade;
-                }
-        }
-}
-
-static void
-clock_map_render_shadow (ClockMap *this)
+/* Returns TRUE if the map was composited again */
+static gboolean
+clock_map_render_shadow (ClockMap *this, gboolean force)
 {
         ClockMapPrivate *priv = clock_map_get_instance_private (this);
+        gboolean changed;
 
-        if (priv->shadow_pixbuf) {
-                g_object_unref (priv->shadow_pixbuf);
-        }
-
-        priv->shadow_pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
-                                              priv->width, priv->height);
-
-        /* Initialize to all shadow */
-        gdk_pixbuf_fill (priv->shadow_pixbuf, 0x6d9ccdff);
+        changed = clock_map_shadow_update (priv->shadow,
+                                           priv->width, priv->height,
+                                           time (NULL));
 
-        clock_map_render_shadow_pixbuf (priv->shadow_pixbuf);
+        if (!changed && !force && priv->shadow_map_pixbuf)
+                return FALSE;
 
         if (priv->shadow_map_pixbuf) {
                 g_object_unref (priv->shadow_map_pixbuf);
@@ -555,9 +519,12 @@ clock_map_render_shadow (ClockMap *this)
 
         priv->shadow_map_pixbuf = gdk_pixbuf_copy (priv->location_map_pixbuf);
 
-        gdk_pixbuf_composite (priv->shadow_pixbuf, priv->shadow_map_pixbuf,
+        gdk_pixbuf_composite (clock_map_shadow_get_pixbuf (priv->shadow),
+                              priv->shadow_map_pixbuf,
                               0, 0, priv->width, priv->height,
                               0, 0, 1, 1, GDK_INTERP_NEAREST, 0x66);
+
+        return TRUE;
 }
 
 static void
@@ -566,10 +533,8 @@ clock_map_display (ClockMap *this)
         ClockMapPrivate *priv = clock_map_get_instance_private (this);
 
         if (priv->width > 0 || priv->height > 0)
-                clock_map_render_shadow (this);
+                clock_map_render_shadow (this, TRUE);
 	gtk_widget_queue_draw (GTK_WIDGET (this));
-
-        time (&priv->last_refresh);
 }
 
 typedef struct {
@@ -639,27 +604,19 @@ clock_map_blink_location (ClockMap *this, ClockLocation *loc)
 							highlight_destroy);
 }
 
-static gboolean
-clock_map_needs_refresh (ClockMap *this)
-{
-        ClockMapPrivate *priv = clock_map_get_instance_private (this);
-        time_t now_t;
-
-        time (&now_t);
-
-	/* refresh once per minute */
-	return (ABS (now_t - priv->last_refresh) >= 60);
-}
-
 void
 clock_map_update_time (ClockMap *this)
 {
+        ClockMapPrivate *priv;
 
 	g_return_if_fail (IS_CLOCK_MAP (this));
 
-        if (!clock_map_needs_refresh (this)) {
+        priv = clock_map_get_instance_private (this);
+
+        if (priv->width <= 0 || priv->height <= 0 || !priv->location_map_pixbuf)
                 return;
-        }
 
-        clock_map_display (this);
+        /* Only redraw once the sun has moved by a pixel */
+        if (clock_map_render_shadow (this, FALSE))
+                gtk_widget_queue_draw (GTK_WIDGET (this));
 }
@@ -0,0 +1,383 @@
+/*
+ * clock-tick.c: shared wall-clock tick source
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/*
+ * All the widgets of the clock that display the time share a single timer,
+ * armed for the next second or minute boundary needed by any of them.
+ *
+ * On Linux, the timer is a CLOCK_REALTIME timerfd with an absolute expiry,
+ * so that it fires right on the boundary even after a suspend or an NTP
+ * step, and is cancelled when the system time is set. Elsewhere, a
+ * monotonic timeout is computed from the wall-clock time.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib-unix.h>
+
+#ifdef HAVE_SYS_TIMERFD_H
+#include <sys/timerfd.h>
+#ifndef TFD_TIMER_CANCEL_ON_SET
+#define TFD_TIMER_CANCEL_ON_SET (1 << 1)
+#endif
+#endif
+
+#include "clock-tick.h"
+
+typedef struct {
+	guint                id;
+	ClockTickGranularity granularity;
+	ClockTickFunc        func;
+	gpointer             user_data;
+	/* time of the last call */
+	time_t               last;
+	gboolean             removed;
+} ClockTickWatch;
+
+static GSList   *watches      = NULL;
+static guint     next_id      = 1;
+static gboolean  dispatching  = FALSE;
+
+static guint     n_calls      = 0;
+static gint64    call_time    = 0;
+
+static gboolean  use_fake_time = FALSE;
+static gint64    fake_time     = 0;
+
+static int       timer_fd      = -1;
+static gboolean  timerfd_broken = FALSE;
+static guint     timer_source  = 0;
+static time_t    timer_target  = 0;
+
+static void clock_tick_rearm (void);
+
+static gint64
+clock_tick_now (void)
+{
+	if (use_fake_time)
+		return fake_time;
+
+	return g_get_real_time ();
+}
+
+time_t
+clock_tick_get_time (void)
+{
+	return (time_t) (clock_tick_now () / G_USEC_PER_SEC);
+}
+
+static ClockTickWatch *
+clock_tick_find (guint id)
+{
+	GSList *l;
+
+	for (l = watches; l; l = l->next) {
+		ClockTickWatch *watch = l->data;
+
+		if (watch->id == id && !watch->removed)
+			return watch;
+	}
+
+	return NULL;
+}
+
+static void
+clock_tick_dispatch (gboolean clock_set)
+{
+	GSList *l;
+	time_t  now;
+	gint64  start;
+
+	now = clock_tick_get_time ();
+	start = g_get_monotonic_time ();
+
+	dispatching = TRUE;
+
+	/* Watches added by a callback are appended, and are not due yet */
+	for (l = watches; l; l = l->next) {
+		ClockTickWatch *watch = l->data;
+		gboolean        due;
+
+		if (watch->removed)
+			continue;
+
+		if (watch->granularity == CLOCK_TICK_SECOND)
+			due = (now != watch->last);
+		else
+			due = (now / 60 != watch->last / 60);
+
+		if (!due && !clock_set)
+			continue;
+
+		watch->last = now;
+		watch->func (now, watch->user_data);
+		n_calls++;
+	}
+
+	dispatching = FALSE;
+
+	call_time += g_get_monotonic_time () - start;
+
+	l = watches;
+	while (l) {
+		GSList         *next = l->next;
+		ClockTickWatch *watch = l->data;
+
+		if (watch->removed) {
+			watches = g_slist_delete_link (watches, l);
+			g_free (watch);
+		}
+
+		l = next;
+	}
+
+	clock_tick_rearm ();
+}
+
+static void
+clock_tick_disarm (void)
+{
+	if (timer_source)
+		g_source_remove (timer_source);
+	timer_source = 0;
+
+	if (timer_fd >= 0)
+		close (timer_fd);
+	timer_fd = -1;
+
+	timer_target = 0;
+}
+
+static time_t
+clock_tick_next_boundary (time_t now)
+{
+	GSList *l;
+
+	for (l = watches; l; l = l->next) {
+		ClockTickWatch *watch = l->data;
+
+		if (!watch->removed && watch->granularity == CLOCK_TICK_SECOND)
+			return now + 1;
+	}
+
+	return (now / 60 + 1) * 60;
+}
+
+#ifdef HAVE_SYS_TIMERFD_H
+static gboolean
+clock_tick_timerfd_cb (gint         fd,
+		       GIOCondition condition,
+		       gpointer     user_data)
+{
+	guint64  expirations;
+	gboolean clock_set = FALSE;
+
+	if (read (fd, &expirations, sizeof (expirations)) < 0) {
+		if (errno == ECANCELED)
+			clock_set = TRUE;
+		else
+			return G_SOURCE_CONTINUE;
+	}
+
+	timer_target = 0;
+	clock_tick_dispatch (clock_set);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+clock_tick_arm_timerfd (time_t target)
+{
+	struct itimerspec spec;
+
+	if (timerfd_broken)
+		return FALSE;
+
+	if (timer_fd < 0) {
+		timer_fd = timerfd_create (CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+		if (timer_fd < 0) {
+			timerfd_broken = TRUE;
+			return FALSE;
+		}
+
+		timer_source = g_unix_fd_add (timer_fd, G_IO_IN,
+					      clock_tick_timerfd_cb, NULL);
+	}
+
+	memset (&spec, 0, sizeof (spec));
+	spec.it_value.tv_sec = target;
+
+	if (timerfd_settime (timer_fd,
+			     TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+			     &spec, NULL) < 0) {
+		timerfd_broken = TRUE;
+		clock_tick_disarm ();
+		return FALSE;
+	}
+
+	return TRUE;
+}
+#endif
+
+static gboolean
+clock_tick_timeout_cb (gpointer user_data)
+{
+	timer_source = 0;
+	timer_target = 0;
+
+	clock_tick_dispatch (FALSE);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+clock_tick_rearm (void)
+{
+	gint64 delay;
+	time_t target;
+
+	if (dispatching)
+		return;
+
+	if (watches == NULL || use_fake_time) {
+		clock_tick_disarm ();
+		return;
+	}
+
+	target = clock_tick_next_boundary (clock_tick_get_time ());
+	if (target == timer_target)
+		return;
+
+#ifdef HAVE_SYS_TIMERFD_H
+	if (clock_tick_arm_timerfd (target)) {
+		timer_target = target;
+		return;
+	}
+#endif
+
+	if (timer_source)
+		g_source_remove (timer_source);
+
+	/* Wake up just after the boundary, a monotonic timeout may be a bit
+	 * early compared to the wall clock */
+	delay = (target * G_USEC_PER_SEC - clock_tick_now ()) / 1000 + 1;
+	timer_source = g_timeout_add ((guint) MAX (delay, 1),
+				      clock_tick_timeout_cb, NULL);
+	timer_target = target;
+}
+
+guint
+clock_tick_add (ClockTickGranularity  granularity,
+		ClockTickFunc         func,
+		gpointer              user_data)
+{
+	ClockTickWatch *watch;
+
+	g_return_val_if_fail (func != NULL, 0);
+
+	watch = g_new0 (ClockTickWatch, 1);
+	watch->id = next_id++;
+	watch->granularity = granularity;
+	watch->func = func;
+	watch->user_data = user_data;
+	watch->last = clock_tick_get_time ();
+
+	watches = g_slist_append (watches, watch);
+
+	clock_tick_rearm ();
+
+	return watch->id;
+}
+
+void
+clock_tick_remove (guint id)
+{
+	ClockTickWatch *watch;
+
+	watch = clock_tick_find (id);
+	if (!watch)
+		return;
+
+	if (dispatching) {
+		watch->removed = TRUE;
+		return;
+	}
+
+	watches = g_slist_remove (watches, watch);
+	g_free (watch);
+
+	clock_tick_rearm ();
+}
+
+void
+clock_tick_set_granularity (guint                id,
+			    ClockTickGranularity granularity)
+{
+	ClockTickWatch *watch;
+
+	watch = clock_tick_find (id);
+	if (!watch || watch->granularity == granularity)
+		return;
+
+	watch->granularity = granularity;
+
+	clock_tick_rearm ();
+}
+
+void
+clock_tick_get_counters (guint  *n_watches,
+			 guint  *n_callbacks,
+			 gint64 *usec)
+{
+	GSList *l;
+
+	if (n_watches) {
+		*n_watches = 0;
+		for (l = watches; l; l = l->next)
+			if (!((ClockTickWatch *) l->data)->removed)
+				(*n_watches)++;
+	}
+
+	if (n_callbacks)
+		*n_callbacks = n_calls;
+
+	if (usec)
+		*usec = call_time;
+}
+
+void
+clock_tick_set_fake_time (gint64   now,
+			  gboolean clock_set)
+{
+	if (!use_fake_time) {
+		use_fake_time = TRUE;
+		clock_tick_disarm ();
+	}
+
+	fake_time = now;
+
+	clock_tick_dispatch (clock_set);
+}
@@ -0,0 +1,67 @@
+/*
+ * clock-tick.h: shared wall-clock tick source
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __CLOCK_TICK_H__
+#define __CLOCK_TICK_H__
+
+#include <time.h>
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+	CLOCK_TICK_SECOND,
+	CLOCK_TICK_MINUTE
+} ClockTickGranularity;
+
+/* @now is the wall-clock time of the tick. Callbacks are also called,
+ * whatever their granularity, when the system time is set. */
+typedef void (*ClockTickFunc) (time_t   now,
+			       gpointer user_data);
+
+guint    clock_tick_add             (ClockTickGranularity  granularity,
+				     ClockTickFunc         func,
+				     gpointer              user_data);
+void     clock_tick_remove          (guint                 id);
+void     clock_tick_set_granularity (guint                 id,
+				     ClockTickGranularity  granularity);
+
+time_t   clock_tick_get_time        (void);
+
+/* How many watches there are, and how many callbacks ran so far and for
+ * how long, to tell what a tick costs */
+void     clock_tick_get_counters    (guint                *n_watches,
+				     guint                *n_callbacks,
+				     gint64               *usec);
+
+/* For tests: stops using the system clock. Every call moves the fake clock
+ * to @now (in microseconds since the epoch) and runs the ticks that are
+ * due, or all of them if @clock_set is TRUE. */
+void     clock_tick_set_fake_time   (gint64                now,
+				     gboolean              clock_set);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCK_TICK_H__ */
@@ -0,0 +1,552 @@
+/*
+ * clock-weather.c: weather refreshes shared by all the locations
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/*
+ * Locations of all the clocks of the process asking for the weather of the
+ * same station, at the same place and in the same units, share one weather
+ * and one fetch, whose result goes to all of them.
+ *
+ * Refreshes are due on slot boundaries, offset by a random jitter picked
+ * once per process, so that the refreshes of all the weathers happen in
+ * the same wakeups, and that different sessions do not all hit the weather
+ * servers at the same time.
+ */
+
+#include <config.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "clock-weather.h"
+
+/* in seconds */
+#define CLOCK_WEATHER_SLOT        60
+#define CLOCK_WEATHER_RETRY_BASE  30
+#define CLOCK_WEATHER_REFRESH     1800
+
+typedef struct {
+	gchar                     *key;
+
+	const ClockWeatherBackend *backend;
+	ClockWeatherRequest        request;
+	gpointer                   weather;
+
+	GSList                    *subscribers;
+
+	guint                      retry_time;
+	/* monotonic time of the next refresh, in seconds */
+	gint64                     due;
+	gboolean                   fetching;
+	gboolean                   fetched;
+
+	gboolean                   notifying;
+	gboolean                   orphaned;
+} ClockWeatherEntry;
+
+typedef struct {
+	guint              id;
+	ClockWeatherEntry *entry;
+	ClockWeatherFunc   func;
+	gpointer           user_data;
+	guint              idle;
+} ClockWeatherSubscriber;
+
+static GHashTable *entries     = NULL;
+static GHashTable *subscribers = NULL;
+static guint       next_id     = 1;
+
+static gint64      jitter      = -1;
+
+static guint       timer_source = 0;
+static gint64      timer_due    = 0;
+
+static gulong      network_handler = 0;
+
+static guint       n_fetches   = 0;
+static guint       n_wakeups   = 0;
+
+static gboolean    use_fake_time = FALSE;
+static gint64      fake_time     = 0;
+
+static void clock_weather_rearm (void);
+
+static gint64
+clock_weather_now (void)
+{
+	if (use_fake_time)
+		return fake_time;
+
+	return g_get_monotonic_time () / G_USEC_PER_SEC;
+}
+
+/* First slot boundary at or after @time */
+static gint64
+clock_weather_slot (gint64 time)
+{
+	gint64 slot;
+
+	if (jitter < 0)
+		jitter = g_random_int_range (0, CLOCK_WEATHER_SLOT);
+
+	slot = time - jitter + CLOCK_WEATHER_SLOT - 1;
+
+	return slot - slot % CLOCK_WEATHER_SLOT + jitter;
+}
+
+static gchar *
+clock_weather_make_key (const ClockWeatherRequest *request)
+{
+	return g_strdup_printf ("%s|%s|%d|%d",
+				request->code,
+				request->coordinates ? request->coordinates : "",
+				request->temperature_unit,
+				request->speed_unit);
+}
+
+static void
+clock_weather_entry_free (ClockWeatherEntry *entry)
+{
+	if (entry->weather)
+		entry->backend->free (entry->weather);
+
+	g_slist_free (entry->subscribers);
+
+	g_free ((gchar *) entry->request.city);
+	g_free ((gchar *) entry->request.code);
+	g_free ((gchar *) entry->request.coordinates);
+	g_free (entry->key);
+	g_free (entry);
+}
+
+static gboolean
+clock_weather_entry_free_idle (gpointer data)
+{
+	clock_weather_entry_free (data);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+clock_weather_notify (ClockWeatherEntry *entry)
+{
+	GArray *ids;
+	GSList *l;
+	guint   i;
+
+	/* Subscribers may come and go from the callbacks */
+	ids = g_array_new (FALSE, FALSE, sizeof (guint));
+	for (l = entry->subscribers; l; l = l->next)
+		g_array_append_val (ids, ((ClockWeatherSubscriber *) l->data)->id);
+
+	entry->notifying = TRUE;
+
+	for (i = 0; i < ids->len; i++) {
+		ClockWeatherSubscriber *subscriber;
+
+		subscriber = g_hash_table_lookup (subscribers,
+						  GUINT_TO_POINTER (g_array_index (ids, guint, i)));
+		if (!subscriber || subscriber->entry != entry)
+			continue;
+
+		if (subscriber->idle) {
+			g_source_remove (subscriber->idle);
+			subscriber->idle = 0;
+		}
+
+		subscriber->func (entry->weather, subscriber->user_data);
+	}
+
+	entry->notifying = FALSE;
+
+	g_array_free (ids, TRUE);
+
+	/* Not from here, the backend is still calling back into it */
+	if (entry->orphaned)
+		g_idle_add (clock_weather_entry_free_idle, entry);
+}
+
+static void
+clock_weather_fetched (gpointer weather,
+		       gpointer data)
+{
+	ClockWeatherEntry *entry = data;
+	gint64             delay;
+
+	entry->fetching = FALSE;
+	entry->fetched = TRUE;
+
+	if (!entry->backend->network_error (weather)) {
+		/* The last update succeeded; refresh in half an hour, and
+		 * reset the retry timer */
+		delay = CLOCK_WEATHER_REFRESH;
+		entry->retry_time = CLOCK_WEATHER_RETRY_BASE;
+	} else {
+		/* The last update failed; retry according to the retry
+		 * timer, and exponentially back it off */
+		delay = entry->retry_time;
+		entry->retry_time = MIN (entry->retry_time * 2, CLOCK_WEATHER_REFRESH);
+	}
+
+	entry->due = clock_weather_slot (clock_weather_now () + delay);
+
+	clock_weather_rearm ();
+
+	clock_weather_notify (entry);
+}
+
+static void
+clock_weather_entry_fetch (ClockWeatherEntry *entry)
+{
+	entry->fetching = TRUE;
+	entry->due = 0;
+	n_fetches++;
+
+	entry->backend->fetch (entry->weather, &entry->request,
+			       clock_weather_fetched, entry);
+}
+
+static void
+clock_weather_dispatch (void)
+{
+	GHashTableIter iter;
+	gpointer       value;
+	GSList        *due = NULL, *l;
+	gint64         now;
+
+	if (!entries)
+		return;
+
+	now = clock_weather_now ();
+
+	g_hash_table_iter_init (&iter, entries);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		ClockWeatherEntry *entry = value;
+
+		if (!entry->fetching && entry->due && entry->due <= now)
+			due = g_slist_prepend (due, entry);
+	}
+
+	if (due)
+		n_wakeups++;
+
+	for (l = due; l; l = l->next)
+		clock_weather_entry_fetch (l->data);
+
+	g_slist_free (due);
+}
+
+static gint64
+clock_weather_next_due (void)
+{
+	GHashTableIter iter;
+	gpointer       value;
+	gint64         next = -1;
+
+	if (!entries)
+		return -1;
+
+	g_hash_table_iter_init (&iter, entries);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		ClockWeatherEntry *entry = value;
+
+		if (entry->fetching || !entry->due)
+			continue;
+
+		if (next < 0 || entry->due < next)
+			next = entry->due;
+	}
+
+	return next;
+}
+
+static gboolean
+clock_weather_timeout_cb (gpointer user_data)
+{
+	timer_source = 0;
+	timer_due = 0;
+
+	clock_weather_dispatch ();
+	clock_weather_rearm ();
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+clock_weather_rearm (void)
+{
+	gint64 due;
+
+	if (use_fake_time)
+		return;
+
+	due = clock_weather_next_due ();
+	if (due == timer_due)
+		return;
+
+	if (timer_source)
+		g_source_remove (timer_source);
+	timer_source = 0;
+	timer_due = 0;
+
+	if (due < 0)
+		return;
+
+	timer_source = g_timeout_add_seconds ((guint) MAX (due - clock_weather_now (), 1),
+					      clock_weather_timeout_cb, NULL);
+	timer_due = due;
+}
+
+static void
+clock_weather_network_changed (GNetworkMonitor *monitor,
+			       gboolean         available,
+			       gpointer         user_data)
+{
+	if (available)
+		clock_weather_refresh_all ();
+}
+
+/* A single handler for the process, only while there are weathers */
+static void
+clock_weather_watch_network (gboolean watch)
+{
+	GNetworkMonitor *monitor;
+
+	if (use_fake_time || watch == (network_handler != 0))
+		return;
+
+	monitor = g_network_monitor_get_default ();
+
+	if (watch) {
+		network_handler = g_signal_connect (monitor, "network-changed",
+						    G_CALLBACK (clock_weather_network_changed),
+						    NULL);
+	} else {
+		g_signal_handler_disconnect (monitor, network_handler);
+		network_handler = 0;
+	}
+}
+
+static ClockWeatherEntry *
+clock_weather_entry_new (const ClockWeatherBackend *backend,
+			 const ClockWeatherRequest *request,
+			 gchar                     *key)
+{
+	ClockWeatherEntry *entry;
+
+	entry = g_new0 (ClockWeatherEntry, 1);
+	entry->key = key;
+	entry->backend = backend;
+	entry->request.city = g_strdup (request->city);
+	entry->request.code = g_strdup (request->code);
+	entry->request.coordinates = g_strdup (request->coordinates);
+	entry->request.temperature_unit = request->temperature_unit;
+	entry->request.speed_unit = request->speed_unit;
+	entry->retry_time = CLOCK_WEATHER_RETRY_BASE;
+
+	/* Creating the weather fetches it a first time */
+	entry->fetching = TRUE;
+	n_fetches++;
+	entry->weather = backend->create (&entry->request,
+					  clock_weather_fetched, entry);
+
+	return entry;
+}
+
+static gboolean
+clock_weather_subscriber_idle (gpointer data)
+{
+	ClockWeatherSubscriber *subscriber = data;
+
+	subscriber->idle = 0;
+	subscriber->func (subscriber->entry->weather, subscriber->user_data);
+
+	return G_SOURCE_REMOVE;
+}
+
+guint
+clock_weather_subscribe (const ClockWeatherBackend *backend,
+			 const ClockWeatherRequest *request,
+			 ClockWeatherFunc           func,
+			 gpointer                   user_data)
+{
+	ClockWeatherSubscriber *subscriber;
+	ClockWeatherEntry      *entry;
+	gchar                  *key;
+
+	g_return_val_if_fail (backend != NULL, 0);
+	g_return_val_if_fail (request != NULL && request->code != NULL, 0);
+	g_return_val_if_fail (func != NULL, 0);
+
+	if (!entries) {
+		entries = g_hash_table_new (g_str_hash, g_str_equal);
+		subscribers = g_hash_table_new (NULL, NULL);
+	}
+
+	key = clock_weather_make_key (request);
+	entry = g_hash_table_lookup (entries, key);
+
+	subscriber = g_new0 (ClockWeatherSubscriber, 1);
+	subscriber->id = next_id++;
+	subscriber->func = func;
+	subscriber->user_data = user_data;
+
+	if (entry) {
+		g_free (key);
+
+		/* Already fetched, the new subscriber gets it right away */
+		if (entry->fetched)
+			subscriber->idle = g_idle_add (clock_weather_subscriber_idle,
+						       subscriber);
+	} else {
+		entry = clock_weather_entry_new (backend, request, key);
+		g_hash_table_insert (entries, entry->key, entry);
+
+		clock_weather_watch_network (TRUE);
+	}
+
+	subscriber->entry = entry;
+	entry->subscribers = g_slist_append (entry->subscribers, subscriber);
+	g_hash_table_insert (subscribers, GUINT_TO_POINTER (subscriber->id),
+			     subscriber);
+
+	return subscriber->id;
+}
+
+void
+clock_weather_unsubscribe (guint id)
+{
+	ClockWeatherSubscriber *subscriber;
+	ClockWeatherEntry      *entry;
+
+	if (!subscribers || id == 0)
+		return;
+
+	subscriber = g_hash_table_lookup (subscribers, GUINT_TO_POINTER (id));
+	if (!subscriber)
+		return;
+
+	g_hash_table_remove (subscribers, GUINT_TO_POINTER (id));
+
+	if (subscriber->idle)
+		g_source_remove (subscriber->idle);
+
+	entry = subscriber->entry;
+	entry->subscribers = g_slist_remove (entry->subscribers, subscriber);
+	g_free (subscriber);
+
+	if (entry->subscribers)
+		return;
+
+	g_hash_table_remove (entries, entry->key);
+
+	if (entry->notifying)
+		entry->orphaned = TRUE;
+	else
+		clock_weather_entry_free (entry);
+
+	if (g_hash_table_size (entries) == 0)
+		clock_weather_watch_network (FALSE);
+
+	clock_weather_rearm ();
+}
+
+gpointer
+clock_weather_get (guint id)
+{
+	ClockWeatherSubscriber *subscriber;
+
+	if (!subscribers || id == 0)
+		return NULL;
+
+	subscriber = g_hash_table_lookup (subscribers, GUINT_TO_POINTER (id));
+
+	return subscriber ? subscriber->entry->weather : NULL;
+}
+
+void
+clock_weather_refresh_all (void)
+{
+	GHashTableIter iter;
+	gpointer       value;
+	gint64         slot;
+
+	if (!entries)
+		return;
+
+	/* The network comes back in several steps, the refreshes of all of
+	 * them are coalesced into the next slot */
+	slot = clock_weather_slot (clock_weather_now ());
+
+	g_hash_table_iter_init (&iter, entries);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		ClockWeatherEntry *entry = value;
+
+		entry->retry_time = CLOCK_WEATHER_RETRY_BASE;
+		if (!entry->fetching)
+			entry->due = slot;
+	}
+
+	clock_weather_rearm ();
+}
+
+void
+clock_weather_get_counters (guint *n_weathers,
+			    guint *n_subscribers,
+			    guint *n_fetches_out,
+			    guint *n_wakeups_out)
+{
+	if (n_weathers)
+		*n_weathers = entries ? g_hash_table_size (entries) : 0;
+
+	if (n_subscribers)
+		*n_subscribers = subscribers ? g_hash_table_size (subscribers) : 0;
+
+	if (n_fetches_out)
+		*n_fetches_out = n_fetches;
+
+	if (n_wakeups_out)
+		*n_wakeups_out = n_wakeups;
+}
+
+gint64
+clock_weather_set_fake_time (gint64 seconds)
+{
+	if (!use_fake_time) {
+		use_fake_time = TRUE;
+
+		if (timer_source)
+			g_source_remove (timer_source);
+		timer_source = 0;
+		timer_due = 0;
+
+		if (network_handler) {
+			g_signal_handler_disconnect (g_network_monitor_get_default (),
+						     network_handler);
+			network_handler = 0;
+		}
+	}
+
+	fake_time = seconds;
+
+	clock_weather_dispatch ();
+
+	return clock_weather_next_due ();
+}
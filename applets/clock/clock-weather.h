@@ -0,0 +1,88 @@
+/*
+ * clock-weather.h: weather refreshes shared by all the locations
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __CLOCK_WEATHER_H__
+#define __CLOCK_WEATHER_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* What to fetch the weather of. Requests with the same fields share one
+ * weather and one fetch. */
+typedef struct {
+	const gchar *city;
+	const gchar *code;
+	const gchar *coordinates;
+	gint         temperature_unit;
+	gint         speed_unit;
+} ClockWeatherRequest;
+
+typedef void (*ClockWeatherFetched) (gpointer weather,
+				     gpointer data);
+
+/* Fetches the weather, the clock uses libmateweather and the tests a fake */
+typedef struct {
+	/* Creates the weather of @request and starts a first fetch */
+	gpointer (*create)        (const ClockWeatherRequest *request,
+				   ClockWeatherFetched        fetched,
+				   gpointer                   data);
+	/* Fetches again, aborting a fetch still running */
+	void     (*fetch)         (gpointer                   weather,
+				   const ClockWeatherRequest *request,
+				   ClockWeatherFetched        fetched,
+				   gpointer                   data);
+	void     (*free)          (gpointer                   weather);
+	gboolean (*network_error) (gpointer                   weather);
+} ClockWeatherBackend;
+
+/* Called with the weather after every fetch */
+typedef void (*ClockWeatherFunc) (gpointer weather,
+				  gpointer user_data);
+
+guint    clock_weather_subscribe     (const ClockWeatherBackend *backend,
+				      const ClockWeatherRequest *request,
+				      ClockWeatherFunc           func,
+				      gpointer                   user_data);
+void     clock_weather_unsubscribe   (guint                      id);
+
+gpointer clock_weather_get           (guint                      id);
+
+/* Fetches every weather at the next slot, as when the network comes back */
+void     clock_weather_refresh_all   (void);
+
+void     clock_weather_get_counters  (guint                     *n_weathers,
+				      guint                     *n_subscribers,
+				      guint                     *n_fetches,
+				      guint                     *n_wakeups);
+
+/* For tests: stops using the real clock and the network monitor. Every call
+ * moves the fake monotonic clock to @seconds and runs the refreshes that are
+ * due. Returns the time of the next slot with refreshes, or -1. */
+gint64   clock_weather_set_fake_time (gint64                     seconds);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCK_WEATHER_H__ */
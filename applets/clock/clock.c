@@ -75,6 +75,7 @@
 #include "clock-location.h"
 #include "clock-location-tile.h"
 #include "clock-map.h"
+#include "clock-tick.h"
 #include "clock-utils.h"
 #include "set-timezone.h"
 #include "system-timezone.h"
@@ -186,15 +187,18 @@ struct _ClockData {
         /* runtime data */
         time_t             current_time;
         char              *timeformat;
-        guint              timeout;
+        guint              tick;
+        guint              set_time_tick;
         MatePanelAppletOrient  orient;
         int                size;
         GtkAllocation      old_allocation;
 
         SystemTimezone *systz;
 
-        int fixed_width;
-        int fixed_height;
+        gboolean layout_dirty;
+        time_t   last_size_report;
+        guint    last_tick_callbacks;
+        gint64   last_tick_usec;
 
         GtkWidget *showseconds_check;
         GtkWidget *showdate_check;
@@ -226,7 +230,6 @@ static int clock_numbers = 0;
 static void  update_clock (ClockData * cd);
 static void  update_tooltip (ClockData * cd);
 static void  update_panel_weather (ClockData *cd);
-static int   clock_timeout_callback (gpointer data);
 static float get_itime    (time_t current_time);
 
 static void set_atk_name_description (GtkWidget *widget,
@@ -270,13 +273,172 @@ clock_box_class_init (ClockBoxClass *klass)
 {
 }
 
+/* ClockLabel, a GtkLabel that keeps the size reserved for its format */
+
+typedef struct {
+        GtkLabel parent;
+
+        /* -1 until measured for the current format, font and angle */
+        int      fixed_width;
+        int      fixed_height;
+
+        /* Times the requested size changed, ie. the panel had to relayout */
+        guint    n_size_changes;
+} ClockLabel;
+
+typedef GtkLabelClass ClockLabelClass;
+
+static GType clock_label_get_type (void);
+
+#define CLOCK_LABEL(o) (G_TYPE_CHECK_INSTANCE_CAST ((o), clock_label_get_type (), ClockLabel))
+
+G_DEFINE_TYPE (ClockLabel, clock_label, GTK_TYPE_LABEL)
+
+/* How much wider the text would be with its digits replaced by the widest
+ * one of the font, so that the label does not have to grow when the time
+ * changes. Digits are ASCII, so the byte offsets of the attributes of the
+ * layout remain valid. */
+static int
+clock_label_get_digit_slack (ClockLabel *label)
+{
+        PangoLayout *layout;
+        PangoLayout *copy;
+        const char  *text;
+        char        *digits;
+        int          current, widest;
+        char         digit;
+
+        layout = gtk_label_get_layout (GTK_LABEL (label));
+        text = pango_layout_get_text (layout);
+
+        pango_layout_get_pixel_size (layout, &current, NULL);
+        widest = current;
+
+        copy = pango_layout_copy (layout);
+        digits = g_strdup (text);
+
+        for (digit = '0'; digit <= '9'; digit++) {
+                int   width;
+                char *c;
+
+                for (c = digits; *c; c++)
+                        if (text[c - digits] >= '0' && text[c - digits] <= '9')
+                                *c = digit;
+
+                pango_layout_set_text (copy, digits, -1);
+                pango_layout_get_pixel_size (copy, &width, NULL);
+                widest = MAX (widest, width);
+        }
+
+        g_free (digits);
+        g_object_unref (copy);
+
+        return widest - current;
+}
+
+static void
+clock_label_reserve (ClockLabel *label,
+                     int        *width,
+                     int        *height)
+{
+        int fixed_width;
+        int fixed_height;
+
+        fixed_width = label->fixed_width;
+        fixed_height = label->fixed_height;
+
+        if (fixed_width < 0) {
+                int slack;
+
+                slack = clock_label_get_digit_slack (label);
+
+                /* The text runs along the height when rotated */
+                if (((int) gtk_label_get_angle (GTK_LABEL (label))) % 180 != 0)
+                        *height += slack;
+                else
+                        *width += slack;
+        }
+
+        /* Never ask for less than before, the label would jump when
+         * proportional fonts are used */
+        label->fixed_width = MAX (fixed_width, *width);
+        label->fixed_height = MAX (fixed_height, *height);
+
+        if (label->fixed_width != fixed_width ||
+            label->fixed_height != fixed_height)
+                label->n_size_changes++;
+
+        *width = label->fixed_width;
+        *height = label->fixed_height;
+}
+
+static void
+clock_label_get_preferred_width (GtkWidget *widget,
+                                 gint      *minimum_width,
+                                 gint      *natural_width)
+{
+        ClockLabel *label = CLOCK_LABEL (widget);
+        int         height;
+
+        GTK_WIDGET_CLASS (clock_label_parent_class)->get_preferred_width (widget,
+                                                                          minimum_width,
+                                                                          natural_width);
+        GTK_WIDGET_CLASS (clock_label_parent_class)->get_preferred_height (widget,
+                                                                           NULL,
+                                                                           &height);
+
+        clock_label_reserve (label, natural_width, &height);
+        *minimum_width = *natural_width;
+}
+
+static void
+clock_label_get_preferred_height (GtkWidget *widget,
+                                  gint      *minimum_height,
+                                  gint      *natural_height)
+{
+        ClockLabel *label = CLOCK_LABEL (widget);
+        int         width;
+
+        GTK_WIDGET_CLASS (clock_label_parent_class)->get_preferred_width (widget,
+                                                                          NULL,
+                                                                          &width);
+        GTK_WIDGET_CLASS (clock_label_parent_class)->get_preferred_height (widget,
+                                                                           minimum_height,
+                                                                           natural_height);
+
+        clock_label_reserve (label, &width, natural_height);
+        *minimum_height = *natural_height;
+}
+
+static void
+clock_label_init (ClockLabel *label)
+{
+        label->fixed_width = -1;
+        label->fixed_height = -1;
+}
+
+static void
+clock_label_class_init (ClockLabelClass *klass)
+{
+        GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+        widget_class->get_preferred_width = clock_label_get_preferred_width;
+        widget_class->get_preferred_height = clock_label_get_preferred_height;
+}
+
 /* Clock */
 
 static void
 unfix_size (ClockData *cd)
 {
-        cd->fixed_width = -1;
-        cd->fixed_height = -1;
+        if (cd->clockw) {
+                ClockLabel *label = CLOCK_LABEL (cd->clockw);
+
+                label->fixed_width = -1;
+                label->fixed_height = -1;
+        }
+
+        cd->layout_dirty = TRUE;
         gtk_widget_queue_resize (cd->panel_button);
 }
 
@@ -308,73 +470,6 @@ calculate_minimum_width (GtkWidget   *widget,
         return width;
 }
 
-static void
-clock_set_timeout (ClockData *cd,
-                   time_t     now)
-{
-        int timeouttime;
-
-        if (cd->format == CLOCK_FORMAT_INTERNET) {
-                int itime_ms;
-
-                itime_ms = ((unsigned int) (get_itime (now) * 1000));
-
-                if (!cd->showseconds)
-                        timeouttime = (999 - itime_ms % 1000) * 86.4 + 1;
-                else {
-                        struct timeval tv;
-                        gettimeofday (&tv, NULL);
-                        itime_ms += (tv.tv_usec * 86.4) / 1000;
-                        timeouttime = ((999 - itime_ms % 1000) * 86.4) / 100 + 1;
-                }
-        } else {
-                 struct timeval tv;
-
-                gettimeofday (&tv, NULL);
-                 timeouttime = (G_USEC_PER_SEC - tv.tv_usec)/1000+20;
-
-                /* timeout of one minute if we don't care about the seconds */
-                 if (cd->format != CLOCK_FORMAT_UNIX &&
-                    !cd->showseconds &&
-                    (!cd->set_time_window || !gtk_widget_get_visible (cd->set_time_window)))
-                         timeouttime += 1000 * (59 - now % 60);
-         }
-
-        cd->timeout = g_timeout_add (timeouttime,
-                                     clock_timeout_callback,
-                                     cd);
-}
-
-static int
-clock_timeout_callback (gpointer data)
-{
-        ClockData *cd = data;
-        time_t new_time;
-
-        time (&new_time);
-
-        if (!cd->showseconds &&
-            (!cd->set_time_window || !gtk_widget_get_visible (cd->set_time_window)) &&
-            cd->format != CLOCK_FORMAT_UNIX &&
-            cd->format != CLOCK_FORMAT_CUSTOM) {
-                if (cd->format == CLOCK_FORMAT_INTERNET &&
-                    (unsigned int)get_itime (new_time) !=
-                    (unsigned int)get_itime (cd->current_time)) {
-                        update_clock (cd);
-                } else if ((cd->format == CLOCK_FORMAT_12 ||
-                            cd->format == CLOCK_FORMAT_24) &&
-                           new_time / 60 != cd->current_time / 60) {
-                        update_clock (cd);
-                }
-        } else {
-                update_clock (cd);
-        }
-
-        clock_set_timeout (cd, new_time);
-
-        return FALSE;
-}
-
 static float
 get_itime (time_t current_time)
 {
@@ -610,12 +705,12 @@ format_time (ClockData *cd)
 }
 
 static gchar *
-format_time_24 (ClockData *cd)
+format_time_24 (time_t now)
 {
         struct tm *tm;
         gchar buf[128];
 
-        tm = localtime (&cd->current_time);
+        tm = localtime (&now);
         strftime (buf, sizeof (buf) - 1, "%k:%M:%S", tm);
         return g_locale_to_utf8 (buf, -1, NULL, NULL, NULL);
 }
@@ -626,7 +721,7 @@ update_clock (ClockData * cd)
         gboolean use_markup;
         char *utf8, *text;
 
-        time (&cd->current_time);
+        cd->current_time = clock_tick_get_time ();
         utf8 = format_time (cd);
 
         use_markup = FALSE;
@@ -635,31 +730,26 @@ update_clock (ClockData * cd)
         else
                 text = g_strdup (utf8);
 
-        if (use_markup)
-                gtk_label_set_markup (GTK_LABEL (cd->clockw), utf8);
-        else
-                gtk_label_set_text (GTK_LABEL (cd->clockw), utf8);
+        /* The label keeps its size, see ClockLabel, so that only the
+         * clock has to be redrawn on an ordinary tick */
+        if (g_strcmp0 (gtk_label_get_label (GTK_LABEL (cd->clockw)), utf8) != 0) {
+                if (use_markup)
+                        gtk_label_set_markup (GTK_LABEL (cd->clockw), utf8);
+                else
+                        gtk_label_set_text (GTK_LABEL (cd->clockw), utf8);
 
-        set_atk_name_description (cd->applet, text, NULL);
+                set_atk_name_description (cd->applet, text, NULL);
+        }
 
         g_free (utf8);
         g_free (text);
 
-        update_orient (cd);
-        gtk_widget_queue_resize (cd->panel_button);
+        if (cd->layout_dirty) {
+                cd->layout_dirty = FALSE;
+                update_orient (cd);
+        }
 
         update_tooltip (cd);
-        update_location_tiles (cd);
-
-        if (cd->map_widget && cd->calendar_popup && gtk_widget_get_visible (cd->calendar_popup))
-                clock_map_update_time (CLOCK_MAP (cd->map_widget));
-
-        if (cd->current_time_label &&
-            gtk_widget_get_visible (cd->current_time_label)) {
-                utf8 = format_time_24 (cd);
-                gtk_label_set_text (GTK_LABEL (cd->current_time_label), utf8);
-                g_free (utf8);
-        }
 }
 
 static void
@@ -672,8 +762,6 @@ update_tooltip (ClockData * cd)
                 char date[256];
                 char *utf8, *loc;
                 char *zone;
-                time_t now_t;
-                struct tm now;
 
                 tm = localtime (&cd->current_time);
 
@@ -692,13 +780,9 @@ update_tooltip (ClockData * cd)
 
                 utf8 = g_locale_to_utf8 (date, -1, NULL, NULL, NULL);
 
-                /* Add the timezone name */
+                /* Add the timezone name, localtime() has set tzname */
 
-                tzset ();
-                time (&now_t);
-                localtime_r (&now_t, &now);
-
-                if (now.tm_isdst > 0) {
+                if (tm->tm_isdst > 0) {
                         zone = tzname[1];
                 } else {
                         zone = tzname[0];
@@ -732,6 +816,75 @@ refresh_clock (ClockData *cd)
         update_clock (cd);
 }
 
+static void
+clock_tick_cb (time_t   now,
+               gpointer data)
+{
+        ClockData *cd = data;
+
+        if (now / 60 != cd->last_size_report / 60) {
+                ClockLabel *label = CLOCK_LABEL (cd->clockw);
+                guint       n_watches, n_callbacks;
+                gint64      usec;
+
+                clock_tick_get_counters (&n_watches, &n_callbacks, &usec);
+
+                /* Only whole minutes are reported: not the one the applet
+                 * started in */
+                if (cd->last_size_report != 0 &&
+                    now - cd->last_size_report >= 60) {
+                        g_debug ("clock: %u size changes in the last minute",
+                                 label->n_size_changes);
+
+                        /* With the popup closed, the panel clock is the only watch */
+                        g_debug ("clock: %u tick callbacks for %u watches in the last minute, %.1f ms",
+                                 n_callbacks - cd->last_tick_callbacks, n_watches,
+                                 (usec - cd->last_tick_usec) / 1000.0);
+                }
+
+                cd->last_size_report = now;
+                label->n_size_changes = 0;
+                cd->last_tick_callbacks = n_callbacks;
+                cd->last_tick_usec = usec;
+        }
+
+        /* Internet time is followed every second, but only changes every
+         * 86.4 seconds when the centibeats are not shown */
+        if (cd->format == CLOCK_FORMAT_INTERNET &&
+            !cd->showseconds &&
+            (unsigned int) get_itime (now) == (unsigned int) get_itime (cd->current_time))
+                return;
+
+        update_clock (cd);
+}
+
+static void
+clock_update_tick (ClockData *cd)
+{
+        ClockTickGranularity granularity;
+
+        /* The time is caught up on in applet_change_visibility() */
+        if (!mate_panel_applet_get_panel_visible (MATE_PANEL_APPLET (cd->applet))) {
+                if (cd->tick)
+                        clock_tick_remove (cd->tick);
+                cd->tick = 0;
+                return;
+        }
+
+        if (cd->showseconds ||
+            cd->format == CLOCK_FORMAT_UNIX ||
+            cd->format == CLOCK_FORMAT_CUSTOM ||
+            cd->format == CLOCK_FORMAT_INTERNET)
+                granularity = CLOCK_TICK_SECOND;
+        else
+                granularity = CLOCK_TICK_MINUTE;
+
+        if (cd->tick)
+                clock_tick_set_granularity (cd->tick, granularity);
+        else
+                cd->tick = clock_tick_add (granularity, clock_tick_cb, cd);
+}
+
 static void
 refresh_clock_timeout(ClockData *cd)
 {
@@ -739,12 +892,9 @@ refresh_clock_timeout(ClockData *cd)
 
         update_timeformat (cd);
 
-        if (cd->timeout)
-                g_source_remove (cd->timeout);
-
         update_clock (cd);
 
-        clock_set_timeout (cd, cd->current_time);
+        clock_update_tick (cd);
 }
 
 /**
@@ -754,9 +904,20 @@ refresh_clock_timeout(ClockData *cd)
 static void
 refresh_click_timeout_time_only (ClockData *cd)
 {
-        if (cd->timeout)
-                g_source_remove (cd->timeout);
-        clock_timeout_callback (cd);
+        update_clock (cd);
+
+        clock_update_tick (cd);
+}
+
+static void
+applet_change_visibility (MatePanelApplet *applet,
+                          gboolean         visible,
+                          ClockData       *cd)
+{
+        if (visible)
+                update_clock (cd);
+
+        clock_update_tick (cd);
 }
 
 static void
@@ -792,9 +953,13 @@ destroy_clock (GtkWidget * widget, ClockData *cd)
                 g_object_unref (cd->settings);
         cd->settings = NULL;
 
-        if (cd->timeout)
-                g_source_remove (cd->timeout);
-        cd->timeout = 0;
+        if (cd->tick)
+                clock_tick_remove (cd->tick);
+        cd->tick = 0;
+
+        if (cd->set_time_tick)
+                clock_tick_remove (cd->set_time_tick);
+        cd->set_time_tick = 0;
 
         if (cd->props)
                 gtk_widget_destroy (cd->props);
@@ -1475,25 +1640,6 @@ do_not_eat_button_press (GtkWidget      *widget,
         return FALSE;
 }
 
-/* Don't request smaller size then the last one we did, this avoids
-   jumping when proportional fonts are used.  We must take care to
-   call "unfix_size" whenever options are changed or such where
-   we'd want to forget the fixed size */
-/*FIXME-this cannot be used because size request gsignal invalid for label */
-/*
-static void
-clock_size_request (GtkWidget *clock, GtkRequisition *req, gpointer data)
-{
-        ClockData *cd = data;
-
-        if (req->width > cd->fixed_width)
-                cd->fixed_width = req->width;
-        if (req->height > cd->fixed_height)
-                cd->fixed_height = req->height;
-        req->width = cd->fixed_width;
-        req->height = cd->fixed_height;
-}
-*/
 static void
 clock_update_text_gravity (GtkWidget *label)
 {
@@ -1545,7 +1691,10 @@ create_main_clock_label (ClockData *cd)
 {
         GtkWidget *label;
 
-        label = gtk_label_new (NULL);
+        /* The label does not request a smaller size than the last one
+         * it did. We must take care to call "unfix_size" whenever options
+         * are changed or such where we'd want to forget the fixed size */
+        label = g_object_new (clock_label_get_type (), NULL);
 
         // Fix proportional font by font feature tabular numbers (tnum) (if supported by the font)
         PangoAttribute *attr;
@@ -1556,12 +1705,6 @@ create_main_clock_label (ClockData *cd)
         gtk_label_set_attributes (GTK_LABEL (label), alist);
         pango_attr_list_unref (alist);
 
-/*Fixme-this is invalid for labels with any recent GTK3 version, maybe all of them*/
-/*
-        g_signal_connect (label, "size-request",
-                          G_CALLBACK (clock_size_request),
-                          cd);
-*/
         g_signal_connect_swapped (label, "style-set",
                                   G_CALLBACK (unfix_size),
                                   cd);
@@ -2028,6 +2171,39 @@ output_cb (GtkSpinButton *spin,
         return TRUE;
 }
 
+static void
+update_current_time_label (time_t   now,
+                           gpointer data)
+{
+        ClockData *cd = data;
+        char *utf8;
+
+        utf8 = format_time_24 (now);
+        gtk_label_set_text (GTK_LABEL (cd->current_time_label), utf8);
+        g_free (utf8);
+}
+
+static void
+time_settings_window_shown (GtkWidget *widget,
+                            ClockData *cd)
+{
+        if (!cd->set_time_tick)
+                cd->set_time_tick = clock_tick_add (CLOCK_TICK_SECOND,
+                                                    update_current_time_label,
+                                                    cd);
+
+        update_current_time_label (clock_tick_get_time (), cd);
+}
+
+static void
+time_settings_window_hidden (GtkWidget *widget,
+                             ClockData *cd)
+{
+        if (cd->set_time_tick)
+                clock_tick_remove (cd->set_time_tick);
+        cd->set_time_tick = 0;
+}
+
 static void
 ensure_time_settings_window_is_created (ClockData *cd)
 {
@@ -2059,6 +2235,11 @@ ensure_time_settings_window_is_created (ClockData *cd)
         g_signal_connect (cancel_button, "clicked", G_CALLBACK (cancel_time_settings), cd);
 
         cd->current_time_label = _clock_get_widget (cd, "current_time_label");
+
+        g_signal_connect (cd->set_time_window, "show",
+                          G_CALLBACK (time_settings_window_shown), cd);
+        g_signal_connect (cd->set_time_window, "hide",
+                          G_CALLBACK (time_settings_window_hidden), cd);
 }
 
 static void
@@ -2752,8 +2933,7 @@ fill_clock_applet (MatePanelApplet *applet)
         mate_panel_applet_set_flags (applet, MATE_PANEL_APPLET_EXPAND_MINOR);
 
         cd = g_new0 (ClockData, 1);
-        cd->fixed_width = -1;
-        cd->fixed_height = -1;
+        cd->layout_dirty = TRUE;
 
         cd->applet = GTK_WIDGET (applet);
 
@@ -2783,6 +2963,10 @@ fill_clock_applet (MatePanelApplet *applet)
                           G_CALLBACK (clock_applet_activate),
                           cd);
 
+        g_signal_connect (cd->applet, "change-visibility",
+                          G_CALLBACK (applet_change_visibility),
+                          cd);
+
         g_signal_connect (cd->panel_button, "size-allocate",
                           G_CALLBACK (panel_button_change_pixel_size),
                           cd);
@@ -74,12 +74,23 @@ static char *files_to_check[CHECK_NB] = {
         ETC_LOCALTIME
 };
 
+/* A file change usually comes as a burst of events, on several of the files
+ * above. The timezone is looked up again once it is over. */
+#define CHANGE_DELAY_MS 250
+
+/* The system timezone is a service shared by the whole process: there is
+ * only one set of monitors, and the timezone is only looked up when one of
+ * the files changes. */
 static GObject *systz_singleton = NULL;
 
+/* Number of times the timezone was looked up */
+static guint n_lookups = 0;
+
 typedef struct {
         char *tz;
         char *env_tz;
         GFileMonitor *monitors[CHECK_NB];
+        guint changed_timeout;
 } SystemTimezonePrivate;
 
 enum {
@@ -160,6 +171,7 @@ system_timezone_init (SystemTimezone *systz)
         priv->env_tz = NULL;
         for (i = 0; i < CHECK_NB; i++)
                 priv->monitors[i] = NULL;
+        priv->changed_timeout = 0;
 }
 
 static GObject *
@@ -220,6 +232,11 @@ system_timezone_constructor (GType                  type,
 
         systz_singleton = obj;
 
+        /* Keep it for the lifetime of the process, so that a short-lived
+         * user, like a calendar query, does not set up the monitors and
+         * look the timezone up again every time */
+        g_object_ref (systz_singleton);
+
         return systz_singleton;
 }
 
@@ -236,6 +253,10 @@ system_timezone_finalize (GObject *obj)
         g_clear_pointer (&priv->tz, g_free);
         g_clear_pointer (&priv->env_tz, g_free);
 
+        if (priv->changed_timeout)
+                g_source_remove (priv->changed_timeout);
+        priv->changed_timeout = 0;
+
         for (i = 0; i < CHECK_NB; i++) {
                 g_clear_object (&priv->monitors[i]);
         }
@@ -247,23 +268,37 @@ system_timezone_finalize (GObject *obj)
         systz_singleton = NULL;
 }
 
-static void
-system_timezone_monitor_changed (GFileMonitor *handle,
-                                 GFile *file,
-                                 GFile *other_file,
-                                 GFileMonitorEvent event,
-                                 gpointer user_data)
+void
+system_timezone_get_counters (guint *monitors,
+                              guint *lookups)
+{
+        guint n_monitors = 0;
+
+        if (systz_singleton) {
+                SystemTimezonePrivate *priv;
+                int i;
+
+                priv = system_timezone_get_instance_private (SYSTEM_TIMEZONE (systz_singleton));
+
+                for (i = 0; i < CHECK_NB; i++)
+                        if (priv->monitors[i])
+                                n_monitors++;
+        }
+
+        if (monitors)
+                *monitors = n_monitors;
+        if (lookups)
+                *lookups = n_lookups;
+}
+
+static gboolean
+system_timezone_changed_timeout (gpointer user_data)
 {
         SystemTimezonePrivate *priv;
         char *new_tz;
 
         priv = system_timezone_get_instance_private (user_data);
-
-        if (event != G_FILE_MONITOR_EVENT_CHANGED &&
-            event != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT &&
-            event != G_FILE_MONITOR_EVENT_DELETED &&
-            event != G_FILE_MONITOR_EVENT_CREATED)
-                return;
+        priv->changed_timeout = 0;
 
         new_tz = system_timezone_find ();
 
@@ -278,6 +313,33 @@ system_timezone_monitor_changed (GFileMonitor *handle,
                                0, priv->tz);
         }
         g_free (new_tz);
+
+        return G_SOURCE_REMOVE;
+}
+
+static void
+system_timezone_monitor_changed (GFileMonitor *handle,
+                                 GFile *file,
+                                 GFile *other_file,
+                                 GFileMonitorEvent event,
+                                 gpointer user_data)
+{
+        SystemTimezonePrivate *priv;
+
+        priv = system_timezone_get_instance_private (user_data);
+
+        if (event != G_FILE_MONITOR_EVENT_CHANGED &&
+            event != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT &&
+            event != G_FILE_MONITOR_EVENT_DELETED &&
+            event != G_FILE_MONITOR_EVENT_CREATED)
+                return;
+
+        if (priv->changed_timeout)
+                g_source_remove (priv->changed_timeout);
+
+        priv->changed_timeout = g_timeout_add (CHANGE_DELAY_MS,
+                                               system_timezone_changed_timeout,
+                                               user_data);
 }
 
 /*
@@ -764,38 +826,238 @@ files_are_identical_content (struct stat *a_stat,
         return (cmp == 0);
 }
 
-/* Determine if /etc/localtime is a copy of a timezone file */
+/*
+ * Index of the timezone files by the checksum of their content, so that
+ * finding which one /etc/localtime is a copy of does not need to read all
+ * of them. It is kept in memory and in the user cache directory, and is
+ * built again when the mtime of one of the directories it was built from
+ * changed.
+ */
+
+#define ZONEINFO_INDEX_VERSION     1
+#define ZONEINFO_INDEX_GROUP       "Index"
+#define ZONEINFO_INDEX_GROUP_DIRS  "Directories"
+#define ZONEINFO_INDEX_GROUP_FILES "Files"
+
+static GKeyFile *zoneinfo_index = NULL;
+
 static char *
-system_timezone_read_etc_localtime_content (void)
+zoneinfo_index_get_filename (void)
+{
+        return g_build_filename (g_get_user_cache_dir (),
+                                 "mate-panel", "zoneinfo.index", NULL);
+}
+
+static char *
+zoneinfo_checksum (const char *content,
+                   gsize       content_len)
+{
+        return g_compute_checksum_for_data (G_CHECKSUM_SHA256,
+                                            (const guchar *) content,
+                                            content_len);
+}
+
+static gboolean
+zoneinfo_index_is_valid (GKeyFile *index)
+{
+        char     **dirs;
+        gsize      n_dirs;
+        gsize      i;
+        gboolean   valid;
+
+        if (g_key_file_get_integer (index, ZONEINFO_INDEX_GROUP,
+                                    "Version", NULL) != ZONEINFO_INDEX_VERSION)
+                return FALSE;
+
+        dirs = g_key_file_get_keys (index, ZONEINFO_INDEX_GROUP_DIRS,
+                                    &n_dirs, NULL);
+        valid = (dirs != NULL && n_dirs > 0);
+
+        for (i = 0; valid && i < n_dirs; i++) {
+                struct stat dir_stat;
+                gint64      mtime;
+
+                mtime = g_key_file_get_int64 (index, ZONEINFO_INDEX_GROUP_DIRS,
+                                              dirs[i], NULL);
+
+                if (g_stat (dirs[i], &dir_stat) != 0 ||
+                    (gint64) dir_stat.st_mtime != mtime)
+                        valid = FALSE;
+        }
+
+        g_strfreev (dirs);
+
+        return valid;
+}
+
+static void
+zoneinfo_index_add (GKeyFile   *index,
+                    const char *file)
 {
-        struct stat  stat_localtime;
-        char        *localtime_content = NULL;
-        gsize        localtime_content_len = -1;
+        struct stat file_stat;
+
+        if (g_stat (file, &file_stat) != 0)
+                return;
+
+        if (S_ISREG (file_stat.st_mode)) {
+                char  *tz;
+                char  *content = NULL;
+                gsize  content_len = 0;
+                char  *checksum;
+
+                tz = system_timezone_strip_path_if_valid (file);
+                if (tz == NULL)
+                        return;
+
+                if (!g_file_get_contents (file, &content, &content_len, NULL) ||
+                    content_len < strlen (TZ_MAGIC) ||
+                    strncmp (content, TZ_MAGIC, strlen (TZ_MAGIC)) != 0) {
+                        g_free (content);
+                        g_free (tz);
+                        return;
+                }
+
+                /* Like recursive_compare(), the first file found wins */
+                checksum = zoneinfo_checksum (content, content_len);
+                if (!g_key_file_has_key (index, ZONEINFO_INDEX_GROUP_FILES,
+                                         checksum, NULL))
+                        g_key_file_set_string (index, ZONEINFO_INDEX_GROUP_FILES,
+                                               checksum, tz);
+
+                g_free (checksum);
+                g_free (content);
+                g_free (tz);
+        } else if (S_ISDIR (file_stat.st_mode)) {
+                GDir       *dir;
+                const char *subfile;
+
+                dir = g_dir_open (file, 0, NULL);
+                if (dir == NULL)
+                        return;
+
+                g_key_file_set_int64 (index, ZONEINFO_INDEX_GROUP_DIRS,
+                                      file, (gint64) file_stat.st_mtime);
+
+                while ((subfile = g_dir_read_name (dir)) != NULL) {
+                        char *subpath;
+
+                        subpath = g_build_filename (file, subfile, NULL);
+                        zoneinfo_index_add (index, subpath);
+                        g_free (subpath);
+                }
+
+                g_dir_close (dir);
+        }
+}
+
+static GKeyFile *
+zoneinfo_index_get (void)
+{
+        char  *filename;
+        char  *dirname;
+        char  *data;
+        gsize  data_len;
+
+        if (zoneinfo_index && zoneinfo_index_is_valid (zoneinfo_index))
+                return zoneinfo_index;
+
+        g_clear_pointer (&zoneinfo_index, g_key_file_free);
+
+        zoneinfo_index = g_key_file_new ();
+        filename = zoneinfo_index_get_filename ();
+
+        if (g_key_file_load_from_file (zoneinfo_index, filename,
+                                       G_KEY_FILE_NONE, NULL) &&
+            zoneinfo_index_is_valid (zoneinfo_index)) {
+                g_free (filename);
+                return zoneinfo_index;
+        }
+
+        g_key_file_free (zoneinfo_index);
+        zoneinfo_index = g_key_file_new ();
+
+        g_key_file_set_integer (zoneinfo_index, ZONEINFO_INDEX_GROUP,
+                                "Version", ZONEINFO_INDEX_VERSION);
+        zoneinfo_index_add (zoneinfo_index, SYSTEM_ZONEINFODIR);
+
+        /* The index is only a cache, it does not matter if it can't be
+         * saved */
+        dirname = g_path_get_dirname (filename);
+        g_mkdir_with_parents (dirname, 0700);
+        g_free (dirname);
+
+        data = g_key_file_to_data (zoneinfo_index, &data_len, NULL);
+        g_file_set_contents (filename, data, data_len, NULL);
+        g_free (data);
+
+        g_free (filename);
+
+        return zoneinfo_index;
+}
+
+void
+system_timezone_drop_index (gboolean remove_file)
+{
+        g_clear_pointer (&zoneinfo_index, g_key_file_free);
+
+        if (remove_file) {
+                char *filename;
+
+                filename = zoneinfo_index_get_filename ();
+                g_unlink (filename);
+                g_free (filename);
+        }
+}
+
+char *
+system_timezone_find_copy_of (const char *file,
+                              gboolean    use_index)
+{
+        struct stat  file_stat;
+        char        *content = NULL;
+        gsize        content_len = -1;
         char        *retval;
 
-        if (g_stat (ETC_LOCALTIME, &stat_localtime) != 0)
+        if (g_stat (file, &file_stat) != 0)
                 return NULL;
 
-        if (!S_ISREG (stat_localtime.st_mode))
+        if (!S_ISREG (file_stat.st_mode))
                 return NULL;
 
-        if (!g_file_get_contents (ETC_LOCALTIME,
-                                  &localtime_content,
-                                  &localtime_content_len,
+        if (!g_file_get_contents (file,
+                                  &content,
+                                  &content_len,
                                   NULL))
                 return NULL;
 
-        retval = recursive_compare (&stat_localtime,
-                                   localtime_content,
-                                   localtime_content_len,
-                                   SYSTEM_ZONEINFODIR,
-                                   files_are_identical_content);
+        if (use_index) {
+                char *checksum;
+
+                checksum = zoneinfo_checksum (content, content_len);
+                retval = g_key_file_get_string (zoneinfo_index_get (),
+                                                ZONEINFO_INDEX_GROUP_FILES,
+                                                checksum, NULL);
+                g_free (checksum);
+        } else {
+                retval = recursive_compare (&file_stat,
+                                            content,
+                                            content_len,
+                                            SYSTEM_ZONEINFODIR,
+                                            files_are_identical_content);
+        }
 
-        g_free (localtime_content);
+        g_free (content);
 
         return retval;
 }
 
+/* Determine if /etc/localtime is a copy of a timezone file */
+static char *
+system_timezone_read_etc_localtime_content (void)
+{
+        return system_timezone_find_copy_of (ETC_LOCALTIME, TRUE);
+}
+
 typedef char * (*GetSystemTimezone) (void);
 /* The order of the functions here define the priority of the methods used
  * to find the timezone. First method has higher priority. */
@@ -839,6 +1101,8 @@ system_timezone_find (void)
 {
         int i;
 
+        n_lookups++;
+
         for (i = 0; get_system_timezone_methods[i] != NULL; i++) {
                 char *tz = get_system_timezone_methods[i] ();
 
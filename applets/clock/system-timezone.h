@@ -62,6 +62,18 @@ SystemTimezone *system_timezone_new (void);
 const char *system_timezone_get (SystemTimezone *systz);
 const char *system_timezone_get_env (SystemTimezone *systz);
 
+/* The number of files monitored for the whole process, and the number of
+ * times the timezone was looked up */
+void system_timezone_get_counters (guint *monitors,
+                                   guint *lookups);
+
+/* Returns the timezone that @file is a copy of, looking it up in the index
+ * of the zoneinfo directory or comparing it with every file there. Those
+ * are exposed for test-system-timezone. */
+char *system_timezone_find_copy_of (const char *file,
+                                    gboolean    use_index);
+void  system_timezone_drop_index   (gboolean    remove_file);
+
 /* Functions to set the timezone. They won't be used by the applet, but
  * by a program with more privileges */
 
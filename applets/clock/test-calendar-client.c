@@ -0,0 +1,372 @@
+/* Test for the calendar queries, against a local file-backed calendar
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Needs a running evolution-data-server. The fixture is an ics file, which
+ * is added to the registry as a calendar of the local backend for the run
+ * and removed afterwards.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <libedataserver/libedataserver.h>
+
+#include "calendar-client.h"
+
+static gboolean changed;
+static gint64   last_beat;
+static gint64   longest_stall;
+
+static void
+appointments_changed (CalendarClient *client,
+		      gpointer        data)
+{
+	changed = TRUE;
+}
+
+static gboolean
+heartbeat (gpointer data)
+{
+	gint64 now = g_get_monotonic_time ();
+
+	if (last_beat)
+		longest_stall = MAX (longest_stall, now - last_beat);
+	last_beat = now;
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+run_for (guint milliseconds)
+{
+	gint64 deadline = g_get_monotonic_time () + (gint64) milliseconds * 1000;
+
+	while (g_get_monotonic_time () < deadline)
+		g_main_context_iteration (NULL, TRUE);
+}
+
+static gboolean
+wait_changed (guint seconds)
+{
+	gint64 deadline = g_get_monotonic_time () + (gint64) seconds * G_USEC_PER_SEC;
+
+	while (!changed && g_get_monotonic_time () < deadline)
+		g_main_context_iteration (NULL, TRUE);
+
+	return changed;
+}
+
+/* Single events on the second of every month from @first to @last months
+ * from now, and an event every week for the whole range */
+static char *
+make_fixture (int first,
+	      int last,
+	      int events)
+{
+	GString   *ics;
+	GDateTime *now, *start, *month;
+	char      *date;
+	int        i, j;
+
+	now = g_date_time_new_now_utc ();
+	start = g_date_time_new_utc (g_date_time_get_year (now),
+				     g_date_time_get_month (now), 2,
+				     12, 0, 0);
+
+	ics = g_string_new ("BEGIN:VCALENDAR\r\n"
+			    "VERSION:2.0\r\n"
+			    "PRODID:-//MATE//test-calendar-client//EN\r\n");
+
+	for (i = first; i <= last; i++) {
+		char *label;
+
+		month = g_date_time_add_months (start, i);
+		date = g_date_time_format (month, "%Y%m%dT%H%M%SZ");
+		label = g_date_time_format (month, "%Y-%m");
+
+		for (j = 0; j < events; j++)
+			g_string_append_printf (ics,
+						"BEGIN:VEVENT\r\n"
+						"UID:fixture-%d-%d\r\n"
+						"DTSTAMP:%s\r\n"
+						"DTSTART:%s\r\n"
+						"DURATION:PT30M\r\n"
+						"SUMMARY:Fixture %s %d\r\n"
+						"END:VEVENT\r\n",
+						i - first, j, date, date, label, j);
+
+		g_free (label);
+		g_free (date);
+		g_date_time_unref (month);
+	}
+
+	month = g_date_time_add_months (start, first);
+	date = g_date_time_format (month, "%Y%m%dT%H%M%SZ");
+	g_string_append_printf (ics,
+				"BEGIN:VEVENT\r\n"
+				"UID:fixture-weekly\r\n"
+				"DTSTAMP:%s\r\n"
+				"DTSTART:%s\r\n"
+				"DURATION:PT1H\r\n"
+				"RRULE:FREQ=WEEKLY;COUNT=%d\r\n"
+				"SUMMARY:Fixture weekly\r\n"
+				"END:VEVENT\r\n",
+				date, date, (last - first + 1) * 5);
+	g_free (date);
+	g_date_time_unref (month);
+
+	g_string_append (ics, "END:VCALENDAR\r\n");
+
+	g_date_time_unref (start);
+	g_date_time_unref (now);
+
+	return g_string_free (ics, FALSE);
+}
+
+static ESource *
+add_calendar (ESourceRegistry *registry,
+	      const char      *path,
+	      GError         **error)
+{
+	ESource         *source;
+	ESourceCalendar *calendar;
+	ESourceLocal    *local;
+	GFile           *file;
+
+	source = e_source_new (NULL, NULL, error);
+	if (!source)
+		return NULL;
+
+	e_source_set_display_name (source, "test-calendar-client");
+	e_source_set_parent (source, "local-stub");
+
+	calendar = e_source_get_extension (source, E_SOURCE_EXTENSION_CALENDAR);
+	e_source_backend_set_backend_name (E_SOURCE_BACKEND (calendar), "local");
+	e_source_selectable_set_selected (E_SOURCE_SELECTABLE (calendar), TRUE);
+
+	local = e_source_get_extension (source, E_SOURCE_EXTENSION_LOCAL_BACKEND);
+	file = g_file_new_for_path (path);
+	e_source_local_set_custom_file (local, file);
+	g_object_unref (file);
+
+	if (!e_source_registry_commit_source_sync (registry, source, NULL, error)) {
+		g_object_unref (source);
+		return NULL;
+	}
+
+	return source;
+}
+
+/* Whether the appointments of the selected day include the fixture's */
+static gboolean
+has_fixture_events (CalendarClient *client,
+		    int             events)
+{
+	GSList *list, *l;
+	guint   year, month;
+	char   *prefix;
+	int     found = 0;
+
+	calendar_client_get_date (client, &year, &month, NULL);
+	prefix = g_strdup_printf ("Fixture %04u-%02u ", year, month + 1);
+
+	list = calendar_client_get_events (client, CALENDAR_EVENT_APPOINTMENT);
+	for (l = list; l; l = l->next) {
+		CalendarAppointment *appointment = l->data;
+
+		if (appointment->summary && g_str_has_prefix (appointment->summary, prefix))
+			found++;
+
+		calendar_event_free (l->data);
+	}
+	g_slist_free (list);
+	g_free (prefix);
+
+	return found == events;
+}
+
+static gint     months = 6;
+static gint     events = 20;
+static gint     timeout = 30;
+static gboolean check_events;
+
+static void
+test_months (void)
+{
+	CalendarClient *client;
+	GDateTime      *now;
+	guint           year, month;
+	int             i;
+
+	now = g_date_time_new_now_local ();
+	year = g_date_time_get_year (now);
+	month = g_date_time_get_month (now) - 1;
+	g_date_time_unref (now);
+
+	client = calendar_client_new (NULL);
+	g_signal_connect (client, "appointments-changed",
+			  G_CALLBACK (appointments_changed), NULL);
+
+	calendar_client_select_day (client, 2);
+
+	/* The first query also waits for the fixture to show up */
+	changed = FALSE;
+	calendar_client_select_month (client, month, year);
+	if (!wait_changed (timeout)) {
+		g_test_message ("The calendar did not load");
+		g_test_fail ();
+		g_object_unref (client);
+		return;
+	}
+
+	/* Let the prefetching of the months around it complete */
+	run_for (1000);
+
+	longest_stall = 0;
+	last_beat = 0;
+
+	for (i = 1; i <= months; i++) {
+		gint64   start, elapsed;
+		gboolean cached;
+
+		month++;
+		if (month == 12) {
+			month = 0;
+			year++;
+		}
+
+		changed = FALSE;
+		start = g_get_monotonic_time ();
+		calendar_client_select_month (client, month, year);
+		cached = changed;
+		g_assert_true (wait_changed (timeout));
+		elapsed = g_get_monotonic_time () - start;
+
+		g_test_message ("%04u-%02u: %8.1f ms%s", year, month + 1,
+				elapsed / 1000.0, cached ? " (prefetched)" : "");
+
+		if (check_events)
+			g_assert_true (has_fixture_events (client, events));
+
+		/* Time to look at the month, as a user would */
+		run_for (200);
+	}
+
+	g_test_message ("longest main loop stall: %.1f ms", longest_stall / 1000.0);
+
+	g_object_unref (client);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	ESourceRegistry *registry;
+	ESource         *source;
+	char            *fixture = NULL;
+	char            *path = NULL;
+	int              status;
+	GError          *error;
+	GOptionContext  *context;
+	GOptionEntry     options[] = {
+		{ "ics", 'f', 0, G_OPTION_ARG_FILENAME, &fixture, "Calendar to use instead of the generated one", "FILE" },
+		{ "months", 'm', 0, G_OPTION_ARG_INT, &months, "Number of months to step through", "N" },
+		{ "events", 'e', 0, G_OPTION_ARG_INT, &events, "Number of events per month in the generated calendar", "N" },
+		{ "timeout", 't', 0, G_OPTION_ARG_INT, &timeout, "Seconds to wait for a month", "N" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	g_test_init (&argc, &argv, NULL);
+	/* The calendar added to the registry is removed afterwards */
+	g_test_set_nonfatal_assertions ();
+
+	context = g_option_context_new ("");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	error = NULL;
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return 1;
+	}
+
+	g_option_context_free (context);
+
+	if (months < 1)
+		months = 1;
+
+	if (!fixture) {
+		char *ics;
+		int   fd;
+
+		fd = g_file_open_tmp ("test-calendar-client-XXXXXX.ics", &path, &error);
+		if (fd == -1) {
+			g_printerr ("%s\n", error->message);
+			g_error_free (error);
+			return 1;
+		}
+		close (fd);
+
+		ics = make_fixture (-1, months + 1, events);
+		if (!g_file_set_contents (path, ics, -1, &error)) {
+			g_printerr ("%s\n", error->message);
+			g_error_free (error);
+			g_free (ics);
+			return 1;
+		}
+		g_free (ics);
+	} else {
+		path = g_strdup (fixture);
+	}
+
+	registry = e_source_registry_new_sync (NULL, &error);
+	if (!registry) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		return 1;
+	}
+
+	source = add_calendar (registry, path, &error);
+	if (!source) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_object_unref (registry);
+		return 1;
+	}
+
+	g_timeout_add (1, heartbeat, NULL);
+
+	check_events = fixture == NULL;
+
+	g_test_add_func ("/calendar-client/months", test_months);
+	status = g_test_run ();
+
+	e_source_remove_sync (source, NULL, NULL);
+	g_object_unref (source);
+	g_object_unref (registry);
+
+	if (!fixture)
+		g_unlink (path);
+	g_free (path);
+	g_free (fixture);
+
+	return status;
+}
@@ -0,0 +1,244 @@
+/* Benchmark for the calendar day index
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <time.h>
+
+#include <glib.h>
+#include "calendar-day-index.h"
+
+typedef struct {
+	time_t start_time;
+	time_t end_time;
+} Instance;
+
+static time_t
+day_begin (int day,
+	   int month,
+	   int year)
+{
+	struct tm tm = { 0, };
+
+	tm.tm_mday  = day;
+	tm.tm_mon   = month;
+	tm.tm_year  = year - 1900;
+	tm.tm_isdst = -1;
+
+	return mktime (&tm);
+}
+
+/* Series of recurring events, each instance a day apart from the previous
+ * one, some of them lasting all day or several days */
+static Instance *
+make_instances (int    month,
+		int    year,
+		guint  n_instances)
+{
+	static const int durations[] = { 1800, 3600, 7200, 86400, 3 * 86400 };
+	Instance *instances;
+	GRand    *rand;
+	time_t    begin;
+	guint     i;
+
+	rand = g_rand_new_with_seed (42);
+	instances = g_new (Instance, n_instances);
+	begin = day_begin (1, month, year);
+
+	for (i = 0; i < n_instances; i++) {
+		int series = i / 25;
+		int occurrence = i % 25;
+
+		instances[i].start_time = begin
+			+ (series % 40) * 900
+			+ (occurrence + series / 40 % 6) * 86400
+			- 2 * 86400;
+		instances[i].end_time = instances[i].start_time
+			+ durations[g_rand_int_range (rand, 0, G_N_ELEMENTS (durations))];
+	}
+
+	g_rand_free (rand);
+
+	return instances;
+}
+
+/* What the calendar did for every day shown: a walk of all the events */
+static guint
+legacy_count_day (Instance *instances,
+		  guint     n_instances,
+		  time_t    begin,
+		  time_t    end)
+{
+	guint i, n = 0;
+
+	for (i = 0; i < n_instances; i++)
+		if (calendar_day_index_occurs (instances[i].start_time,
+					       instances[i].end_time,
+					       begin, end))
+			n++;
+
+	return n;
+}
+
+/* And to mark the days of the month, a walk of the events of the month */
+static guint32
+legacy_mark_days (Instance *instances,
+		  guint     n_instances,
+		  time_t    month_begin,
+		  time_t    month_end)
+{
+	guint32 marked = 0;
+	guint   i;
+
+	for (i = 0; i < n_instances; i++) {
+		time_t     t = instances[i].start_time;
+		struct tm *tm;
+
+		if (!calendar_day_index_occurs (instances[i].start_time,
+						instances[i].end_time,
+						month_begin, month_end))
+			continue;
+
+		for (; t < instances[i].end_time && t < month_end; t += 86400) {
+			if (t < month_begin)
+				continue;
+
+			tm = localtime (&t);
+			marked |= 1u << tm->tm_mday;
+		}
+	}
+
+	return marked;
+}
+
+static gint n_instances = 10000;
+static gint refreshes = 20;
+
+static void
+test_day_index (void)
+{
+	CalendarDayIndex *index = NULL;
+	Instance         *instances;
+	GDateTime        *now;
+	gint64            start, t_legacy, t_build, t_lookup;
+	gint              month, year, n_days;
+	gint              i, day;
+	guint32           marked = 0;
+
+	now = g_date_time_new_now_local ();
+	month = g_date_time_get_month (now) - 1;
+	year = g_date_time_get_year (now);
+	g_date_time_unref (now);
+
+	n_days = g_date_get_days_in_month (month + 1, year);
+	instances = make_instances (month, year, n_instances);
+
+	/* Showing a month marks its days and lists the events of every
+	 * day selected, here all of them */
+	start = g_get_monotonic_time ();
+	for (i = 0; i < refreshes; i++) {
+		marked |= legacy_mark_days (instances, n_instances,
+					    day_begin (1, month, year),
+					    day_begin (1, month + 1, year));
+		for (day = 1; day <= n_days; day++)
+			legacy_count_day (instances, n_instances,
+					  day_begin (day, month, year),
+					  day_begin (day + 1, month, year));
+	}
+	t_legacy = g_get_monotonic_time () - start;
+
+	/* The index is built once, when the query results arrive */
+	start = g_get_monotonic_time ();
+	for (i = 0; i < refreshes; i++) {
+		calendar_day_index_free (index);
+		index = calendar_day_index_new (month, year);
+		for (day = 0; day < n_instances; day++)
+			calendar_day_index_add (index, &instances[day],
+						instances[day].start_time,
+						instances[day].end_time);
+	}
+	t_build = (g_get_monotonic_time () - start) / refreshes;
+
+	start = g_get_monotonic_time ();
+	for (i = 0; i < refreshes; i++) {
+		calendar_day_index_get_marked_days (index);
+		for (day = 1; day <= n_days; day++) {
+			guint n_entries;
+
+			calendar_day_index_get_day (index, day, &n_entries);
+		}
+	}
+	t_lookup = g_get_monotonic_time () - start;
+
+	for (day = 1; day <= n_days; day++) {
+		guint n_entries, expected;
+
+		calendar_day_index_get_day (index, day, &n_entries);
+		expected = legacy_count_day (instances, n_instances,
+					     day_begin (day, month, year),
+					     day_begin (day + 1, month, year));
+
+		g_assert_cmpuint (n_entries, ==, expected);
+	}
+
+	g_test_message ("%d instances, month shown %d times", n_instances, refreshes);
+	g_test_message ("  walking every event: %8.1f us per month shown", (double) t_legacy / refreshes);
+	g_test_message ("  day index lookups:   %8.1f us per month shown", (double) t_lookup / refreshes);
+	g_test_message ("  day index build:     %8.1f us once per query result", (double) t_build);
+	g_test_message ("  days marked: index %08x, walk %08x",
+			calendar_day_index_get_marked_days (index), marked);
+
+	calendar_day_index_free (index);
+	g_free (instances);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	GError         *error;
+	GOptionContext *context;
+	GOptionEntry    options[] = {
+		{ "instances", 'n', 0, G_OPTION_ARG_INT, &n_instances, "Number of event instances in the month", "N" },
+		{ "refreshes", 'r', 0, G_OPTION_ARG_INT, &refreshes, "Number of times the month is shown", "N" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	g_test_init (&argc, &argv, NULL);
+
+	context = g_option_context_new ("");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	error = NULL;
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return 1;
+	}
+
+	g_option_context_free (context);
+
+	if (n_instances < 1)
+		n_instances = 1;
+	if (refreshes < 1)
+		refreshes = 1;
+
+	g_test_add_func ("/calendar-day-index/days", test_day_index);
+
+	return g_test_run ();
+}
@@ -0,0 +1,126 @@
+/* Benchmark for world clock timezone conversions
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <glib.h>
+#include "clock-location.h"
+
+static const char *zones[] = {
+	"Africa/Cairo", "Africa/Johannesburg", "Africa/Lagos", "Africa/Nairobi",
+	"America/Anchorage", "America/Argentina/Buenos_Aires", "America/Bogota",
+	"America/Chicago", "America/Denver", "America/Halifax", "America/Havana",
+	"America/Los_Angeles", "America/Mexico_City", "America/New_York",
+	"America/Santiago", "America/Sao_Paulo", "America/St_Johns",
+	"America/Toronto", "Asia/Dhaka", "Asia/Dubai", "Asia/Hong_Kong",
+	"Asia/Jakarta", "Asia/Jerusalem", "Asia/Kabul", "Asia/Karachi",
+	"Asia/Kathmandu", "Asia/Kolkata", "Asia/Manila", "Asia/Seoul",
+	"Asia/Shanghai", "Asia/Singapore", "Asia/Tehran", "Asia/Tokyo",
+	"Atlantic/Azores", "Atlantic/Reykjavik", "Australia/Adelaide",
+	"Australia/Perth", "Australia/Sydney", "Europe/Athens", "Europe/Berlin",
+	"Europe/Istanbul", "Europe/Lisbon", "Europe/London", "Europe/Madrid",
+	"Europe/Moscow", "Europe/Paris", "Pacific/Auckland", "Pacific/Chatham",
+	"Pacific/Honolulu", "UTC"
+};
+
+/* What clock_location_localtime() used to do */
+static void
+legacy_localtime (const char *zone,
+		  struct tm  *tm)
+{
+	const char *env_tz;
+	time_t      now;
+
+	env_tz = g_getenv ("TZ");
+
+	setenv ("TZ", zone, 1);
+	tzset ();
+
+	time (&now);
+	localtime_r (&now, tm);
+
+	if (env_tz)
+		setenv ("TZ", env_tz, 1);
+	else
+		unsetenv ("TZ");
+	tzset ();
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	GSList         *locations = NULL;
+	GSList         *l;
+	gint            ticks = 600;
+	gint64          start, cached, legacy;
+	struct tm       tm;
+	gint            i;
+	guint           j;
+	GError         *error;
+	GOptionContext *context;
+	GOptionEntry    options[] = {
+		{ "ticks", 't', 0, G_OPTION_ARG_INT, &ticks, "Number of ticks to run", "N" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	context = g_option_context_new ("");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	error = NULL;
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return 1;
+	}
+
+	g_option_context_free (context);
+
+	for (j = 0; j < G_N_ELEMENTS (zones); j++)
+		locations = g_slist_prepend (locations,
+					     clock_location_new (zones[j], zones[j], zones[j],
+								 0, 0, NULL, NULL));
+
+	/* One tick refreshes every tile: its time and its offset */
+	start = g_get_monotonic_time ();
+	for (i = 0; i < ticks; i++) {
+		for (l = locations; l; l = l->next) {
+			clock_location_localtime (l->data, &tm);
+			clock_location_get_offset (l->data);
+		}
+	}
+	cached = g_get_monotonic_time () - start;
+
+	start = g_get_monotonic_time ();
+	for (i = 0; i < ticks; i++) {
+		for (j = 0; j < G_N_ELEMENTS (zones); j++)
+			legacy_localtime (zones[j], &tm);
+	}
+	legacy = g_get_monotonic_time () - start;
+
+	g_print ("%u locations, %d ticks\n", G_N_ELEMENTS (zones), ticks);
+	g_print ("cached GTimeZone: %8.1f us per tick\n", (double) cached / ticks);
+	g_print ("setenv/tzset:     %8.1f us per tick (localtime only)\n", (double) legacy / ticks);
+
+	g_slist_free_full (locations, g_object_unref);
+
+	return 0;
+}
@@ -0,0 +1,196 @@
+/* Benchmark for the day and night shadow of the world map
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <glib.h>
+#include "clock-map-shadow.h"
+#include "clock-sunpos.h"
+
+/* The size of the map in the calendar window */
+#define MAP_WIDTH  250
+#define MAP_HEIGHT 125
+
+/* What the map used to do: trigonometry for every pixel */
+static void
+legacy_compute_vector (gdouble lat, gdouble lon, gdouble *vec)
+{
+	gdouble lat_rad, lon_rad;
+	lat_rad = lat * (M_PI/180.0);
+	lon_rad = lon * (M_PI/180.0);
+
+	vec[0] = sin(lon_rad) * cos(lat_rad);
+	vec[1] = sin(lat_rad);
+	vec[2] = cos(lon_rad) * cos(lat_rad);
+}
+
+static guchar
+legacy_is_sunlit (gdouble pos_lat, gdouble pos_long,
+		  gdouble sun_lat, gdouble sun_long)
+{
+	gdouble pos_vec[3];
+	gdouble sun_vec[3];
+	gdouble dot;
+	gdouble epsilon = 0.01;
+
+	legacy_compute_vector (pos_lat, pos_long, pos_vec);
+	legacy_compute_vector (sun_lat, sun_long, sun_vec);
+
+	dot = pos_vec[0]*sun_vec[0] + pos_vec[1]*sun_vec[1]
+		+ pos_vec[2]*sun_vec[2];
+
+	if (dot > epsilon)
+		return 0x00;
+
+	if (dot < -epsilon)
+		return 0xFF;
+
+	return (guchar)(-128 * ((dot / epsilon) - 1));
+}
+
+static void
+legacy_render (GdkPixbuf *pixbuf, time_t now)
+{
+	int x, y;
+	int height, width;
+	int n_channels, rowstride;
+	guchar *pixels, *p;
+	gdouble sun_lat, sun_lon;
+
+	n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+	rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+	pixels = gdk_pixbuf_get_pixels (pixbuf);
+
+	width = gdk_pixbuf_get_width (pixbuf);
+	height = gdk_pixbuf_get_height (pixbuf);
+
+	sun_position (now, &sun_lat, &sun_lon);
+
+	for (y = 0; y < height; y++) {
+		gdouble lat = (height / 2.0 - y) / (height / 2.0) * 90.0;
+
+		for (x = 0; x < width; x++) {
+			gdouble lon = (x - width / 2.0) / (width / 2.0) * 180.0;
+
+			p = pixels + y * rowstride + x * n_channels;
+			p[3] = legacy_is_sunlit (lat, lon, sun_lat, sun_lon);
+		}
+	}
+}
+
+/* Largest difference of the alpha channels, the twilight ramp is computed
+ * in single precision now */
+static int
+compare (GdkPixbuf *a, GdkPixbuf *b)
+{
+	int x, y, diff = 0;
+
+	for (y = 0; y < gdk_pixbuf_get_height (a); y++) {
+		for (x = 0; x < gdk_pixbuf_get_width (a); x++) {
+			guchar pa = gdk_pixbuf_get_pixels (a)[y * gdk_pixbuf_get_rowstride (a) + x * 4 + 3];
+			guchar pb = gdk_pixbuf_get_pixels (b)[y * gdk_pixbuf_get_rowstride (b) + x * 4 + 3];
+
+			diff = MAX (diff, abs (pa - pb));
+		}
+	}
+
+	return diff;
+}
+
+static void
+run (int scale, int iterations)
+{
+	ClockMapShadow *shadow;
+	GdkPixbuf      *legacy;
+	int             width = MAP_WIDTH * scale;
+	int             height = MAP_HEIGHT * scale;
+	time_t          start_time = time (NULL);
+	gint64          start, t_legacy, t_render, t_ticks;
+	int             i, renders;
+
+	legacy = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, width, height);
+	shadow = clock_map_shadow_new ();
+
+	start = g_get_monotonic_time ();
+	for (i = 0; i < iterations; i++)
+		legacy_render (legacy, start_time + i * 3600);
+	t_legacy = g_get_monotonic_time () - start;
+
+	/* An hour apart, so that every update renders */
+	start = g_get_monotonic_time ();
+	for (i = 0; i < iterations; i++)
+		clock_map_shadow_update (shadow, width, height, start_time + i * 3600);
+	t_render = g_get_monotonic_time () - start;
+
+	legacy_render (legacy, start_time);
+	clock_map_shadow_update (shadow, width, height, start_time);
+
+	/* A day of ticks of a clock showing seconds */
+	renders = 0;
+	start = g_get_monotonic_time ();
+	for (i = 0; i < 24 * 3600; i++)
+		renders += clock_map_shadow_update (shadow, width, height, start_time + i);
+	t_ticks = g_get_monotonic_time () - start;
+
+	g_print ("%dx (%dx%d)\n", scale, width, height);
+	g_print ("  per-pixel trig:  %8.1f us per render\n", (double) t_legacy / iterations);
+	g_print ("  trig tables:     %8.1f us per render\n", (double) t_render / iterations);
+	g_print ("  one day of ticks: %d renders, %.1f ms\n", renders, t_ticks / 1000.0);
+	g_print ("  largest alpha difference: %d\n",
+		 compare (legacy, clock_map_shadow_get_pixbuf (shadow)));
+
+	clock_map_shadow_free (shadow);
+	g_object_unref (legacy);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	gint            iterations = 100;
+	GError         *error;
+	GOptionContext *context;
+	GOptionEntry    options[] = {
+		{ "iterations", 'i', 0, G_OPTION_ARG_INT, &iterations, "Number of renders to time", "N" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	context = g_option_context_new ("");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	error = NULL;
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return 1;
+	}
+
+	g_option_context_free (context);
+
+	if (iterations < 1)
+		iterations = 1;
+
+	run (1, iterations);
+	run (2, iterations);
+
+	return 0;
+}
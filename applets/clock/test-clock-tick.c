@@ -0,0 +1,158 @@
+/* Test for the clock tick source
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include "clock-tick.h"
+
+/* 2026-01-01 00:00:00 UTC */
+#define START ((gint64) 1767225600 * G_USEC_PER_SEC)
+
+static guint seconds;
+static guint minutes;
+static guint removed_calls;
+static guint removed_id;
+
+static void
+count_seconds (time_t   now,
+	       gpointer data)
+{
+	seconds++;
+}
+
+static void
+count_minutes (time_t   now,
+	       gpointer data)
+{
+	minutes++;
+}
+
+static void
+remove_self (time_t   now,
+	     gpointer data)
+{
+	removed_calls++;
+	clock_tick_remove (removed_id);
+}
+
+static void
+test_fake_time (void)
+{
+	guint second_id, minute_id;
+	guint n_watches, n_callbacks;
+	int   i;
+
+	clock_tick_set_fake_time (START, FALSE);
+
+	second_id = clock_tick_add (CLOCK_TICK_SECOND, count_seconds, NULL);
+	minute_id = clock_tick_add (CLOCK_TICK_MINUTE, count_minutes, NULL);
+	removed_id = clock_tick_add (CLOCK_TICK_SECOND, remove_self, NULL);
+
+	/* Sub-second steps only tick on the boundaries */
+	for (i = 1; i <= 120 * 4; i++)
+		clock_tick_set_fake_time (START + i * G_USEC_PER_SEC / 4, FALSE);
+
+	g_assert_cmpuint (seconds, ==, 120);
+	g_assert_cmpuint (minutes, ==, 2);
+	/* removed during dispatch */
+	g_assert_cmpuint (removed_calls, ==, 1);
+
+	/* Setting the clock backwards runs every tick */
+	clock_tick_set_fake_time (START, TRUE);
+	g_assert_cmpuint (seconds, ==, 121);
+	g_assert_cmpuint (minutes, ==, 3);
+
+	/* A suspend of an hour is a single tick, not a burst */
+	clock_tick_set_fake_time (START + (gint64) 3600 * G_USEC_PER_SEC, FALSE);
+	g_assert_cmpuint (seconds, ==, 122);
+	g_assert_cmpuint (minutes, ==, 4);
+
+	clock_tick_set_granularity (second_id, CLOCK_TICK_MINUTE);
+	for (i = 1; i <= 59; i++)
+		clock_tick_set_fake_time (START + (gint64) (3600 + i) * G_USEC_PER_SEC, FALSE);
+	g_assert_cmpuint (seconds, ==, 122);
+
+	clock_tick_remove (second_id);
+	clock_tick_remove (minute_id);
+
+	clock_tick_get_counters (&n_watches, &n_callbacks, NULL);
+	g_assert_cmpuint (n_watches, ==, 0);
+	g_assert_cmpuint (n_callbacks, ==, seconds + minutes + removed_calls);
+}
+
+static void
+print_lateness (time_t   now,
+		gpointer data)
+{
+	gint64 late;
+
+	late = g_get_real_time () - (gint64) now * G_USEC_PER_SEC;
+	g_print ("%ld: %" G_GINT64_FORMAT " us late\n", (long) now, late);
+}
+
+static void
+run_live (gboolean minute)
+{
+	GMainLoop *mainloop;
+
+	clock_tick_add (minute ? CLOCK_TICK_MINUTE : CLOCK_TICK_SECOND,
+			print_lateness, NULL);
+
+	mainloop = g_main_loop_new (NULL, FALSE);
+	g_main_loop_run (mainloop);
+	g_main_loop_unref (mainloop);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	gboolean        live = FALSE;
+	gboolean        minute = FALSE;
+	GError         *error;
+	GOptionContext *context;
+	GOptionEntry    options[] = {
+		{ "live", 'l', 0, G_OPTION_ARG_NONE, &live, "Print how late the real ticks are", NULL },
+		{ "minute", 'm', 0, G_OPTION_ARG_NONE, &minute, "Tick every minute in live mode", NULL },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	g_test_init (&argc, &argv, NULL);
+
+	context = g_option_context_new ("");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	error = NULL;
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return 1;
+	}
+
+	g_option_context_free (context);
+
+	if (live) {
+		run_live (minute);
+		return 0;
+	}
+
+	g_test_add_func ("/clock-tick/fake-time", test_fake_time);
+
+	return g_test_run ();
+}
@@ -0,0 +1,321 @@
+/* Test for the shared weather refreshes, with an offline weather backend
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+#include "clock-weather.h"
+
+/* A weather that only answers when told to */
+typedef struct {
+	gchar               *code;
+	guint                n_fetches;
+	gboolean             network_error;
+	ClockWeatherFetched  fetched;
+	gpointer             data;
+} FakeWeather;
+
+static GSList *fake_weathers = NULL;
+
+static void
+fake_fetch (gpointer                   weather,
+	    const ClockWeatherRequest *request,
+	    ClockWeatherFetched        fetched,
+	    gpointer                   data)
+{
+	FakeWeather *fake = weather;
+
+	fake->n_fetches++;
+	fake->fetched = fetched;
+	fake->data = data;
+}
+
+static gpointer
+fake_create (const ClockWeatherRequest *request,
+	     ClockWeatherFetched        fetched,
+	     gpointer                   data)
+{
+	FakeWeather *fake;
+
+	fake = g_new0 (FakeWeather, 1);
+	fake->code = g_strdup (request->code);
+	fake_weathers = g_slist_prepend (fake_weathers, fake);
+
+	fake_fetch (fake, request, fetched, data);
+
+	return fake;
+}
+
+static void
+fake_free (gpointer weather)
+{
+	FakeWeather *fake = weather;
+
+	fake_weathers = g_slist_remove (fake_weathers, fake);
+	g_free (fake->code);
+	g_free (fake);
+}
+
+static gboolean
+fake_network_error (gpointer weather)
+{
+	return ((FakeWeather *) weather)->network_error;
+}
+
+static const ClockWeatherBackend fake_backend = {
+	fake_create,
+	fake_fetch,
+	fake_free,
+	fake_network_error
+};
+
+/* Completes the fetches in progress of a station, returns how many */
+static guint
+fake_answer (const gchar *code,
+	     gboolean     network_error)
+{
+	GSList *pending = NULL, *l;
+	guint   n = 0;
+
+	for (l = fake_weathers; l; l = l->next) {
+		FakeWeather *fake = l->data;
+
+		if (fake->fetched && g_strcmp0 (fake->code, code) == 0)
+			pending = g_slist_prepend (pending, fake);
+	}
+
+	for (l = pending; l; l = l->next) {
+		FakeWeather         *fake = l->data;
+		ClockWeatherFetched  fetched = fake->fetched;
+
+		fake->network_error = network_error;
+		fake->fetched = NULL;
+		fetched (fake, fake->data);
+		n++;
+	}
+
+	g_slist_free (pending);
+
+	return n;
+}
+
+static void
+count_update (gpointer weather,
+	      gpointer user_data)
+{
+	(*(guint *) user_data)++;
+}
+
+static void
+run_idles (void)
+{
+	while (g_main_context_iteration (NULL, FALSE));
+}
+
+static void
+test_shared (void)
+{
+	ClockWeatherRequest paris = { "Paris", "LFPG", "49-00N 02-33E", 0, 0 };
+	ClockWeatherRequest paris_f = { "Paris", "LFPG", "49-00N 02-33E", 1, 0 };
+	guint               updates[3] = { 0, };
+	guint               id[3];
+	guint               n_weathers, n_fetches, n_subscribers;
+
+	clock_weather_set_fake_time (1000);
+
+	/* Two clocks showing the same city */
+	id[0] = clock_weather_subscribe (&fake_backend, &paris, count_update, &updates[0]);
+	id[1] = clock_weather_subscribe (&fake_backend, &paris, count_update, &updates[1]);
+	/* And one in other units */
+	id[2] = clock_weather_subscribe (&fake_backend, &paris_f, count_update, &updates[2]);
+
+	clock_weather_get_counters (&n_weathers, &n_subscribers, &n_fetches, NULL);
+	/* One weather per station and units, fetched once */
+	g_assert_cmpuint (n_weathers, ==, 2);
+	g_assert_cmpuint (n_subscribers, ==, 3);
+	g_assert_cmpuint (n_fetches, ==, 2);
+	g_assert_true (clock_weather_get (id[0]) == clock_weather_get (id[1]));
+
+	fake_answer ("LFPG", FALSE);
+
+	g_assert_cmpuint (updates[0], ==, 1);
+	g_assert_cmpuint (updates[1], ==, 1);
+	g_assert_cmpuint (updates[2], ==, 1);
+
+	clock_weather_unsubscribe (id[2]);
+	clock_weather_unsubscribe (id[1]);
+
+	clock_weather_get_counters (&n_weathers, &n_subscribers, NULL, NULL);
+	/* Weathers go with their last subscriber */
+	g_assert_cmpuint (n_weathers, ==, 1);
+	g_assert_cmpuint (n_subscribers, ==, 1);
+
+	/* A late subscriber gets the weather already there, without a fetch */
+	id[1] = clock_weather_subscribe (&fake_backend, &paris, count_update, &updates[1]);
+	run_idles ();
+	clock_weather_get_counters (NULL, NULL, &n_fetches, NULL);
+	g_assert_cmpuint (updates[1], ==, 2);
+	g_assert_cmpuint (n_fetches, ==, 2);
+
+	clock_weather_unsubscribe (id[0]);
+	clock_weather_unsubscribe (id[1]);
+
+	clock_weather_get_counters (&n_weathers, &n_subscribers, NULL, NULL);
+	g_assert_cmpuint (n_weathers, ==, 0);
+	g_assert_cmpuint (n_subscribers, ==, 0);
+	g_assert_null (fake_weathers);
+}
+
+static void
+test_slots (void)
+{
+	ClockWeatherRequest requests[] = {
+		{ "Paris",  "LFPG", "49-00N 02-33E", 0, 0 },
+		{ "Berlin", "EDDT", "52-33N 13-17E", 0, 0 },
+		{ "Oslo",   "ENGM", "60-11N 11-06E", 0, 0 },
+	};
+	guint    updates = 0;
+	guint    ids[G_N_ELEMENTS (requests)];
+	guint    i, n_fetches, n_wakeups, fetches_before, wakeups_before;
+	gint64   start, now = 100000, due, first_due = -1;
+	gboolean aligned = TRUE;
+
+	/* Find where the slots are, the jitter is random */
+	clock_weather_set_fake_time (now);
+	ids[0] = clock_weather_subscribe (&fake_backend, &requests[0],
+					  count_update, &updates);
+	fake_answer (requests[0].code, FALSE);
+	due = clock_weather_set_fake_time (now);
+	clock_weather_unsubscribe (ids[0]);
+
+	/* Refreshes are due after half an hour */
+	g_assert_cmpint (due, >=, now + 1800);
+	g_assert_cmpint (due, <, now + 1800 + 60);
+
+	/* Locations added and answering twenty seconds apart, within a
+	 * slot: each of them used to have its own timer */
+	start = now = due + 1;
+	for (i = 0; i < G_N_ELEMENTS (requests); i++) {
+		clock_weather_set_fake_time (now);
+		ids[i] = clock_weather_subscribe (&fake_backend, &requests[i],
+						  count_update, &updates);
+		fake_answer (requests[i].code, FALSE);
+
+		due = clock_weather_set_fake_time (now);
+		if (first_due < 0)
+			first_due = due;
+		aligned &= due == first_due;
+
+		now += 20;
+	}
+
+	/* Refreshes are due on the same slot */
+	g_assert_true (aligned);
+
+	clock_weather_get_counters (NULL, NULL, &fetches_before, &wakeups_before);
+
+	/* Wake up when told to, for an hour */
+	for (;;) {
+		due = clock_weather_set_fake_time (now);
+		if (due < 0 || due > start + 3600)
+			break;
+
+		now = due;
+		clock_weather_set_fake_time (now);
+		for (i = 0; i < G_N_ELEMENTS (requests); i++)
+			fake_answer (requests[i].code, FALSE);
+	}
+
+	clock_weather_get_counters (NULL, NULL, &n_fetches, &n_wakeups);
+	g_test_message ("%u fetches in %u wakeups",
+			n_fetches - fetches_before, n_wakeups - wakeups_before);
+	/* One refresh of every weather, in a single wakeup */
+	g_assert_cmpuint (n_fetches - fetches_before, ==, G_N_ELEMENTS (requests));
+	g_assert_cmpuint (n_wakeups - wakeups_before, ==, 1);
+	g_assert_cmpuint (updates, ==, 2 * G_N_ELEMENTS (requests) + 1);
+
+	for (i = 0; i < G_N_ELEMENTS (requests); i++)
+		clock_weather_unsubscribe (ids[i]);
+}
+
+static void
+test_backoff (void)
+{
+	ClockWeatherRequest paris = { "Paris", "LFPG", "49-00N 02-33E", 0, 0 };
+	guint    updates = 0;
+	guint    id, n, retry = 30;
+	gint64   now = 200000, due;
+	gboolean backs_off = TRUE;
+
+	clock_weather_set_fake_time (now);
+	id = clock_weather_subscribe (&fake_backend, &paris, count_update, &updates);
+
+	/* Offline: retries come later and later, up to half an hour */
+	for (n = 0; n < 8; n++) {
+		fake_answer ("LFPG", TRUE);
+		due = clock_weather_set_fake_time (now);
+		backs_off &= due - now >= retry && due - now < retry + 60;
+		retry = MIN (retry * 2, 1800);
+
+		now = due;
+		clock_weather_set_fake_time (now);
+	}
+
+	/* Failed fetches back off, up to half an hour */
+	g_assert_true (backs_off);
+
+	/* The network comes back */
+	now++;
+	clock_weather_set_fake_time (now);
+	fake_answer ("LFPG", TRUE);
+	clock_weather_refresh_all ();
+	due = clock_weather_set_fake_time (now);
+	/* Network changes refresh at the next slot */
+	g_assert_cmpint (due, >=, now);
+	g_assert_cmpint (due, <, now + 60);
+
+	now = due;
+	clock_weather_set_fake_time (now);
+	fake_answer ("LFPG", FALSE);
+	due = clock_weather_set_fake_time (now);
+	/* Successful fetches refresh after half an hour */
+	g_assert_cmpint (due - now, >=, 1800);
+
+	now = due;
+	clock_weather_set_fake_time (now);
+	fake_answer ("LFPG", TRUE);
+	due = clock_weather_set_fake_time (now);
+	/* And reset the retries */
+	g_assert_cmpint (due - now, <, 30 + 60);
+
+	g_assert_cmpuint (updates, ==, 11);
+
+	clock_weather_unsubscribe (id);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/clock-weather/shared", test_shared);
+	g_test_add_func ("/clock-weather/slots", test_slots);
+	g_test_add_func ("/clock-weather/backoff", test_backoff);
+
+	return g_test_run ();
+}
@@ -52,7 +52,11 @@ timezone_changed (SystemTimezone *systz,
 		  const char     *new_tz,
 		  gpointer        data)
 {
-	g_print ("Timezone changed to: %s\n", new_tz);
+	guint monitors, lookups;
+
+	system_timezone_get_counters (&monitors, &lookups);
+	g_print ("Timezone changed to: %s (%u files monitored, %u lookups)\n",
+		 new_tz, monitors, lookups);
 }
 
 static void
@@ -60,11 +64,20 @@ timezone_monitor (void)
 {
 	SystemTimezone *systz;
 	GMainLoop      *mainloop;
+	guint           monitors, lookups;
+	int             i;
 
 	systz = system_timezone_new ();
 	g_signal_connect (systz, "changed",
 			  G_CALLBACK (timezone_changed), NULL);
 
+	/* Like the locations of a clock, other users share the same monitors */
+	for (i = 0; i < 20; i++)
+		g_object_unref (system_timezone_new ());
+
+	system_timezone_get_counters (&monitors, &lookups);
+	g_print ("Monitoring %u files, %u lookups so far\n", monitors, lookups);
+
 	mainloop = g_main_loop_new (NULL, FALSE);
 	g_main_loop_run (mainloop);
 	g_main_loop_unref (mainloop);
@@ -72,6 +85,43 @@ timezone_monitor (void)
 	g_object_unref (systz);
 }
 
+static void
+timezone_benchmark (const char *file,
+		    int         iterations)
+{
+	char   *tz;
+	gint64  start;
+	int     i;
+
+	g_print ("Looking up the timezone of %s\n", file);
+
+	start = g_get_monotonic_time ();
+	tz = system_timezone_find_copy_of (file, FALSE);
+	g_print ("  walking the zoneinfo files: %8.2f ms (%s)\n",
+		 (g_get_monotonic_time () - start) / 1000.0, tz ? tz : "not found");
+	g_free (tz);
+
+	system_timezone_drop_index (TRUE);
+	start = g_get_monotonic_time ();
+	tz = system_timezone_find_copy_of (file, TRUE);
+	g_print ("  building the index:         %8.2f ms (%s)\n",
+		 (g_get_monotonic_time () - start) / 1000.0, tz ? tz : "not found");
+	g_free (tz);
+
+	system_timezone_drop_index (FALSE);
+	start = g_get_monotonic_time ();
+	tz = system_timezone_find_copy_of (file, TRUE);
+	g_print ("  loading the index:          %8.2f ms\n",
+		 (g_get_monotonic_time () - start) / 1000.0);
+	g_free (tz);
+
+	start = g_get_monotonic_time ();
+	for (i = 0; i < iterations; i++)
+		g_free (system_timezone_find_copy_of (file, TRUE));
+	g_print ("  indexed lookup:             %8.2f ms\n",
+		 (g_get_monotonic_time () - start) / 1000.0 / iterations);
+}
+
 int
 main (int    argc,
       char **argv)
@@ -81,6 +131,8 @@ main (int    argc,
 	gboolean  get = FALSE;
 	gboolean  monitor = FALSE;
 	char     *tz_set = NULL;
+	char     *benchmark = NULL;
+	int       iterations = 100;
 
 	GError         *error;
 	GOptionContext *context;
@@ -88,6 +140,8 @@ main (int    argc,
                 { "get", 'g', 0, G_OPTION_ARG_NONE, &get, "Get the current timezone", NULL },
                 { "set", 's', 0, G_OPTION_ARG_STRING, &tz_set, "Set the timezone to TIMEZONE", "TIMEZONE" },
                 { "monitor", 'm', 0, G_OPTION_ARG_NONE, &monitor, "Monitor timezone changes", NULL },
+                { "benchmark", 'b', 0, G_OPTION_ARG_FILENAME, &benchmark, "Time the lookup of the timezone that FILE is a copy of", "FILE" },
+                { "iterations", 'i', 0, G_OPTION_ARG_INT, &iterations, "Number of indexed lookups to time", "N" },
                 { NULL, 0, 0, 0, NULL, NULL, NULL }
         };
 
@@ -107,7 +161,9 @@ main (int    argc,
 
 	g_option_context_free (context);
 
-	if (get || (!tz_set && !monitor))
+	if (benchmark)
+		timezone_benchmark (benchmark, MAX (iterations, 1));
+	else if (get || (!tz_set && !monitor))
 		timezone_print ();
 	else if (tz_set)
 		retval = timezone_set (tz_set);
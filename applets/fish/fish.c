@@ -1209,12 +1209,22 @@ static void setup_timeout(FishApplet *fish)
 {
 	if (fish->timeout)
 		g_source_remove (fish->timeout);
+	fish->timeout = 0;
+
+	/* No point animating while nobody can see the fish */
+	if (!mate_panel_applet_get_panel_visible (MATE_PANEL_APPLET (fish)))
+		return;
 
 	fish->timeout = g_timeout_add (fish->speed * 1000,
 				       timeout_handler,
 				       fish);
 }
 
+static void fish_change_visibility(MatePanelApplet *applet, gboolean visible, FishApplet *fish)
+{
+	setup_timeout (fish);
+}
+
 static void speed_changed_notify(GSettings* settings, gchar* key, FishApplet* fish)
 {
 	gdouble value;
@@ -1680,6 +1690,8 @@ static void setup_fish_widget(FishApplet* fish)
 
 	g_signal_connect (fish, "key-press-event",
 			  G_CALLBACK (handle_keypress), fish);
+	g_signal_connect (fish, "change-visibility",
+			  G_CALLBACK (fish_change_visibility), fish);
 
 	gtk_widget_show_all (widget);
 }
@@ -26,9 +26,18 @@ struct _GfSnWatcherV0
   guint                     bus_name_id;
 
   GSList                   *hosts;
-  GSList                   *items;
+
+  /* Items by bus name and object path, and in registration order */
+  GHashTable               *items;
+  GQueue                    item_queue;
+
+  guint                     update_id;
 };
 
+/* Registrations come in bursts at login, the list of registered items is
+ * published at most this often */
+#define UPDATE_TIMEOUT 100
+
 typedef enum
 {
   GF_WATCH_TYPE_HOST,
@@ -44,8 +53,15 @@ typedef struct
   gchar         *bus_name;
   gchar         *object_path;
   guint          watch_id;
+
+  /* For items, the bus name and object path together, and the link in
+   * the item queue */
+  gchar         *item;
+  GList         *link;
 } GfWatch;
 
+static GDBusInterfaceGetPropertyFunc parent_get_property;
+
 static void gf_sn_watcher_v0_gen_init (GfSnWatcherV0GenIface *iface);
 
 G_DEFINE_TYPE_WITH_CODE (GfSnWatcherV0, gf_sn_watcher_v0, GF_TYPE_SN_WATCHER_V0_GEN_SKELETON,
@@ -54,33 +70,55 @@ G_DEFINE_TYPE_WITH_CODE (GfSnWatcherV0, gf_sn_watcher_v0, GF_TYPE_SN_WATCHER_V0_
 static void
 update_registered_items (GfSnWatcherV0 *v0)
 {
-  GVariantBuilder builder;
-  GSList *l;
-  GVariant *variant;
   const gchar **items;
+  GList *l;
+  guint i;
 
-  g_variant_builder_init (&builder, G_VARIANT_TYPE ("as"));
+  if (v0->update_id > 0)
+    {
+      g_source_remove (v0->update_id);
+      v0->update_id = 0;
+    }
+
+  items = g_new (const gchar *, v0->item_queue.length + 1);
 
-  for (l = v0->items; l != NULL; l = g_slist_next (l))
+  for (l = v0->item_queue.head, i = 0; l != NULL; l = l->next, i++)
     {
       GfWatch *watch;
-      gchar *item;
 
       watch = (GfWatch *) l->data;
-
-      item = g_strdup_printf ("%s%s", watch->bus_name, watch->object_path);
-      g_variant_builder_add (&builder, "s", item);
-      g_free (item);
+      items[i] = watch->item;
     }
 
-  variant = g_variant_builder_end (&builder);
-  items = g_variant_get_strv (variant, NULL);
+  items[i] = NULL;
 
   gf_sn_watcher_v0_gen_set_registered_items (GF_SN_WATCHER_V0_GEN (v0), items);
-  g_variant_unref (variant);
   g_free (items);
 }
 
+static gboolean
+update_registered_items_cb (gpointer user_data)
+{
+  GfSnWatcherV0 *v0;
+
+  v0 = GF_SN_WATCHER_V0 (user_data);
+  v0->update_id = 0;
+
+  update_registered_items (v0);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_update_registered_items (GfSnWatcherV0 *v0)
+{
+  if (v0->update_id > 0)
+    return;
+
+  v0->update_id = g_timeout_add (UPDATE_TIMEOUT, update_registered_items_cb, v0);
+  g_source_set_name_by_id (v0->update_id, "[status-notifier-watcher] update_registered_items_cb");
+}
+
 static void
 gf_watch_free (gpointer data)
 {
@@ -94,6 +132,7 @@ gf_watch_free (gpointer data)
   g_free (watch->service);
   g_free (watch->bus_name);
   g_free (watch->object_path);
+  g_free (watch->item);
 
   g_free (watch);
 }
@@ -123,15 +162,12 @@ name_vanished_cb (GDBusConnection *connection,
     }
   else if (watch->type == GF_WATCH_TYPE_ITEM)
     {
-      gchar *tmp;
+      g_queue_delete_link (&v0->item_queue, watch->link);
+      g_hash_table_steal (v0->items, watch->item);
 
-      v0->items = g_slist_remove (v0->items, watch);
+      queue_update_registered_items (v0);
 
-      update_registered_items (v0);
-
-      tmp = g_strdup_printf ("%s%s", watch->bus_name, watch->object_path);
-      gf_sn_watcher_v0_gen_emit_item_unregistered (gen, tmp);
-      g_free (tmp);
+      gf_sn_watcher_v0_gen_emit_item_unregistered (gen, watch->item);
     }
   else
     {
@@ -158,6 +194,7 @@ gf_watch_new (GfSnWatcherV0 *v0,
   watch->service = g_strdup (service);
   watch->bus_name = g_strdup (bus_name);
   watch->object_path = g_strdup (object_path);
+  watch->item = g_strdup_printf ("%s%s", bus_name, object_path);
   watch->watch_id = g_bus_watch_name (G_BUS_TYPE_SESSION, bus_name,
                                       G_BUS_NAME_WATCHER_FLAGS_NONE, NULL,
                                       name_vanished_cb, watch, NULL);
@@ -242,6 +279,14 @@ gf_sn_watcher_v0_handle_register_host (GfSnWatcherV0Gen      *object,
       gf_sn_watcher_v0_gen_emit_host_registered (object);
     }
 
+  /* Hosts read the registered items once registered, and only listen to
+   * ItemRegistered from then on: items registered just before have to be
+   * in the registered items by the time the reply arrives */
+  if (v0->update_id > 0)
+    update_registered_items (v0);
+
+  g_dbus_interface_skeleton_flush (G_DBUS_INTERFACE_SKELETON (v0));
+
   gf_sn_watcher_v0_gen_complete_register_host (object, invocation);
 
   return TRUE;
@@ -256,7 +301,7 @@ gf_sn_watcher_v0_handle_register_item (GfSnWatcherV0Gen      *object,
   const gchar *bus_name;
   const gchar *object_path;
   GfWatch *watch;
-  gchar *tmp;
+  gchar *item;
 
   v0 = GF_SN_WATCHER_V0 (object);
 
@@ -281,7 +326,9 @@ gf_sn_watcher_v0_handle_register_item (GfSnWatcherV0Gen      *object,
       return TRUE;
     }
 
-  watch = gf_watch_find (v0->items, bus_name, object_path);
+  item = g_strdup_printf ("%s%s", bus_name, object_path);
+  watch = g_hash_table_lookup (v0->items, item);
+  g_free (item);
 
   if (watch != NULL)
     {
@@ -308,13 +355,14 @@ gf_sn_watcher_v0_handle_register_item (GfSnWatcherV0Gen      *object,
     }
 
   watch = gf_watch_new (v0, GF_WATCH_TYPE_ITEM, service, bus_name, object_path);
-  v0->items = g_slist_prepend (v0->items, watch);
+  /* Newest first, as the items have always been listed */
+  g_queue_push_head (&v0->item_queue, watch);
+  watch->link = v0->item_queue.head;
+  g_hash_table_insert (v0->items, watch->item, watch);
 
-  update_registered_items (v0);
+  queue_update_registered_items (v0);
 
-  tmp = g_strdup_printf ("%s%s", bus_name, object_path);
-  gf_sn_watcher_v0_gen_emit_item_registered (object, tmp);
-  g_free (tmp);
+  gf_sn_watcher_v0_gen_emit_item_registered (object, watch->item);
 
   gf_sn_watcher_v0_gen_complete_register_item (object, invocation);
 
@@ -371,23 +419,74 @@ gf_sn_watcher_v0_dispose (GObject *object)
       v0->hosts = NULL;
     }
 
-  if (v0->items != NULL)
+  if (v0->update_id > 0)
     {
-      g_slist_free_full (v0->items, gf_watch_free);
-      v0->items = NULL;
+      g_source_remove (v0->update_id);
+      v0->update_id = 0;
     }
 
+  g_queue_clear (&v0->item_queue);
+  g_clear_pointer (&v0->items, g_hash_table_destroy);
+
   G_OBJECT_CLASS (gf_sn_watcher_v0_parent_class)->dispose (object);
 }
 
+static GVariant *
+gf_sn_watcher_v0_get_property (GDBusConnection  *connection,
+                               const gchar      *sender,
+                               const gchar      *object_path,
+                               const gchar      *interface_name,
+                               const gchar      *property_name,
+                               GError          **error,
+                               gpointer          user_data)
+{
+  GfSnWatcherV0 *v0;
+
+  v0 = GF_SN_WATCHER_V0 (user_data);
+
+  /* Answer with the items registered so far, not with those published */
+  if (v0->update_id > 0)
+    update_registered_items (v0);
+
+  return parent_get_property (connection, sender, object_path,
+                              interface_name, property_name,
+                              error, user_data);
+}
+
+static GDBusInterfaceVTable *
+gf_sn_watcher_v0_get_vtable (GDBusInterfaceSkeleton *skeleton)
+{
+  static GDBusInterfaceVTable vtable;
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      GDBusInterfaceSkeletonClass *parent_class;
+
+      parent_class = G_DBUS_INTERFACE_SKELETON_CLASS (gf_sn_watcher_v0_parent_class);
+
+      vtable = *parent_class->get_vtable (skeleton);
+      parent_get_property = vtable.get_property;
+      vtable.get_property = gf_sn_watcher_v0_get_property;
+
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return &vtable;
+}
+
 static void
 gf_sn_watcher_v0_class_init (GfSnWatcherV0Class *v0_class)
 {
   GObjectClass *object_class;
+  GDBusInterfaceSkeletonClass *skeleton_class;
 
   object_class = G_OBJECT_CLASS (v0_class);
+  skeleton_class = G_DBUS_INTERFACE_SKELETON_CLASS (v0_class);
 
   object_class->dispose = gf_sn_watcher_v0_dispose;
+
+  skeleton_class->get_vtable = gf_sn_watcher_v0_get_vtable;
 }
 
 static void
@@ -395,6 +494,10 @@ gf_sn_watcher_v0_init (GfSnWatcherV0 *v0)
 {
   GBusNameOwnerFlags flags;
 
+  v0->items = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                     NULL, gf_watch_free);
+  g_queue_init (&v0->item_queue);
+
   flags = G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT |
           G_BUS_NAME_OWNER_FLAGS_REPLACE;
 
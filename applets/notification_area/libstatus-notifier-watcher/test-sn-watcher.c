@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test for the registry of the watcher, with many items registering and
+ * going away at once, as at login and logout.
+ *
+ * Needs a session bus, and takes the watcher name on it: run it with
+ * dbus-run-session.
+ */
+
+#include <config.h>
+
+#include "gf-sn-watcher-v0.h"
+
+#define WATCHER_NAME "org.kde.StatusNotifierWatcher"
+#define WATCHER_PATH "/StatusNotifierWatcher"
+#define WATCHER_INTERFACE "org.kde.StatusNotifierWatcher"
+
+static guint    watcher_appeared = 0;
+static guint    n_changed = 0;
+static guint    n_registered = 0;
+static guint    n_unregistered = 0;
+static guint    n_replies = 0;
+static guint    n_errors = 0;
+static gint     n_items_got = -1;
+static gchar   *first_item_got = NULL;
+static gint     n_items = 500;
+
+static GDBusConnection *
+connection_new (void)
+{
+  GDBusConnection *connection;
+  gchar *address;
+  GError *error;
+
+  /* A connection of its own, as every application would have */
+  error = NULL;
+  connection = NULL;
+  address = g_dbus_address_get_for_bus_sync (G_BUS_TYPE_SESSION, NULL, &error);
+  if (address != NULL)
+    connection =
+      g_dbus_connection_new_for_address_sync (address,
+                                              G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                              G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                              NULL, NULL, &error);
+  g_free (address);
+
+  if (error != NULL)
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+    }
+
+  return connection;
+}
+
+static gboolean
+wait_for (guint *counter,
+          guint  value)
+{
+  gint64 deadline = g_get_monotonic_time () + 10 * G_USEC_PER_SEC;
+
+  while (*counter < value && g_get_monotonic_time () < deadline)
+    g_main_context_iteration (NULL, TRUE);
+
+  return *counter >= value;
+}
+
+static gboolean
+quit_cb (gpointer data)
+{
+  *(gboolean *) data = TRUE;
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+run_for (guint milliseconds)
+{
+  gboolean done = FALSE;
+
+  g_timeout_add (milliseconds, quit_cb, &done);
+  while (!done)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+watcher_appeared_cb (GDBusConnection *connection,
+                     const gchar     *name,
+                     const gchar     *name_owner,
+                     gpointer         user_data)
+{
+  watcher_appeared = 1;
+}
+
+static void
+properties_changed_cb (GDBusConnection *connection,
+                       const gchar     *sender_name,
+                       const gchar     *object_path,
+                       const gchar     *interface_name,
+                       const gchar     *signal_name,
+                       GVariant        *parameters,
+                       gpointer         user_data)
+{
+  GVariant *changed;
+  GVariant *value;
+
+  g_variant_get (parameters, "(&s@a{sv}@as)", NULL, &changed, NULL);
+
+  value = g_variant_lookup_value (changed, "RegisteredStatusNotifierItems", NULL);
+  if (value != NULL)
+    {
+      n_changed++;
+      g_variant_unref (value);
+    }
+
+  g_variant_unref (changed);
+}
+
+static void
+watcher_signal_cb (GDBusConnection *connection,
+                   const gchar     *sender_name,
+                   const gchar     *object_path,
+                   const gchar     *interface_name,
+                   const gchar     *signal_name,
+                   GVariant        *parameters,
+                   gpointer         user_data)
+{
+  if (g_strcmp0 (signal_name, "StatusNotifierItemRegistered") == 0)
+    n_registered++;
+  else if (g_strcmp0 (signal_name, "StatusNotifierItemUnregistered") == 0)
+    n_unregistered++;
+}
+
+static void
+register_item_cb (GObject      *source_object,
+                  GAsyncResult *res,
+                  gpointer      user_data)
+{
+  GVariant *reply;
+  GError *error;
+
+  error = NULL;
+  reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object),
+                                         res, &error);
+
+  if (reply != NULL)
+    g_variant_unref (reply);
+
+  if (error != NULL)
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      n_errors++;
+    }
+
+  n_replies++;
+}
+
+static void
+register_items (GDBusConnection *connection,
+                guint            from,
+                guint            to)
+{
+  guint i;
+
+  for (i = from; i < to; i++)
+    {
+      gchar *path;
+
+      path = g_strdup_printf ("/org/ayatana/NotificationItem/item%u", i);
+      g_dbus_connection_call (connection, WATCHER_NAME, WATCHER_PATH,
+                              WATCHER_INTERFACE, "RegisterStatusNotifierItem",
+                              g_variant_new ("(s)", path), NULL,
+                              G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+                              register_item_cb, NULL);
+      g_free (path);
+    }
+}
+
+static void
+get_items_cb (GObject      *source_object,
+              GAsyncResult *res,
+              gpointer      user_data)
+{
+  GVariant *reply;
+  GVariant *items;
+
+  reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object),
+                                         res, NULL);
+
+  if (reply != NULL)
+    {
+      g_variant_get (reply, "(v)", &items);
+      n_items_got = g_variant_n_children (items);
+      if (n_items_got > 0)
+        g_variant_get_child (items, 0, "s", &first_item_got);
+      g_variant_unref (items);
+      g_variant_unref (reply);
+    }
+
+  (*(guint *) user_data)++;
+}
+
+/* The items the watcher says are registered, or -1 */
+static gint
+get_n_items (GDBusConnection *connection)
+{
+  guint done = 0;
+
+  n_items_got = -1;
+  g_clear_pointer (&first_item_got, g_free);
+  g_dbus_connection_call (connection, WATCHER_NAME, WATCHER_PATH,
+                          "org.freedesktop.DBus.Properties", "Get",
+                          g_variant_new ("(ss)", WATCHER_INTERFACE,
+                                         "RegisteredStatusNotifierItems"),
+                          G_VARIANT_TYPE ("(v)"),
+                          G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+                          get_items_cb, &done);
+  wait_for (&done, 1);
+
+  return n_items_got;
+}
+
+static void
+test_registry (void)
+{
+  GfSnWatcherV0 *watcher;
+  GDBusConnection *observer;
+  GDBusConnection *items;
+  guint watch_id;
+  gint64 start, t_register, t_unregister;
+  guint n_changed_register;
+  gchar *last_path;
+
+  /* A host, watching what the watcher publishes, and the applications */
+  observer = connection_new ();
+  items = connection_new ();
+  g_assert_nonnull (observer);
+  g_assert_nonnull (items);
+
+  g_dbus_connection_signal_subscribe (observer, WATCHER_NAME,
+                                      "org.freedesktop.DBus.Properties",
+                                      "PropertiesChanged", WATCHER_PATH, NULL,
+                                      G_DBUS_SIGNAL_FLAGS_NONE,
+                                      properties_changed_cb, NULL, NULL);
+  g_dbus_connection_signal_subscribe (observer, WATCHER_NAME,
+                                      WATCHER_INTERFACE, NULL, WATCHER_PATH,
+                                      NULL, G_DBUS_SIGNAL_FLAGS_NONE,
+                                      watcher_signal_cb, NULL, NULL);
+
+  watch_id = g_bus_watch_name_on_connection (observer, WATCHER_NAME,
+                                             G_BUS_NAME_WATCHER_FLAGS_NONE,
+                                             watcher_appeared_cb, NULL,
+                                             NULL, NULL);
+
+  watcher = gf_sn_watcher_v0_new ();
+  g_assert_true (wait_for (&watcher_appeared, 1));
+
+  /* Half of the items, and the registry asked for right away */
+  start = g_get_monotonic_time ();
+  register_items (items, 0, n_items / 2);
+  wait_for (&n_replies, n_items / 2);
+  g_assert_cmpint (get_n_items (observer), ==, n_items / 2);
+
+  register_items (items, n_items / 2, n_items);
+  wait_for (&n_replies, n_items);
+  t_register = g_get_monotonic_time () - start;
+
+  run_for (500);
+  n_changed_register = n_changed;
+
+  /* Every item is registered, the newest first */
+  g_assert_cmpuint (n_errors, ==, 0);
+  g_assert_cmpuint (n_registered, ==, n_items);
+  g_assert_cmpint (get_n_items (observer), ==, n_items);
+  last_path = g_strdup_printf ("/org/ayatana/NotificationItem/item%d", n_items - 1);
+  g_assert_nonnull (first_item_got);
+  g_assert_true (g_str_has_suffix (first_item_got, last_path));
+  g_free (last_path);
+  /* And the changes of the registered items are coalesced */
+  g_assert_cmpuint (n_changed_register, <, n_items / 10);
+
+  /* And all of them gone at once */
+  start = g_get_monotonic_time ();
+  g_dbus_connection_close (items, NULL, NULL, NULL);
+  wait_for (&n_unregistered, n_items);
+  t_unregister = g_get_monotonic_time () - start;
+
+  run_for (500);
+
+  g_assert_cmpuint (n_unregistered, ==, n_items);
+  g_assert_cmpint (get_n_items (observer), ==, 0);
+  g_assert_cmpuint (n_changed - n_changed_register, <, n_items / 10);
+
+  g_test_message ("%d items registered in %.1f ms, %u changes of the registered items",
+                  n_items, t_register / 1000.0, n_changed_register);
+  g_test_message ("%d items gone in %.1f ms, %u changes of the registered items",
+                  n_items, t_unregister / 1000.0, n_changed - n_changed_register);
+
+  g_bus_unwatch_name (watch_id);
+  g_object_unref (watcher);
+  g_object_unref (items);
+  g_dbus_connection_close_sync (observer, NULL, NULL);
+  g_object_unref (observer);
+  g_clear_pointer (&first_item_got, g_free);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GError *error;
+  GOptionContext *context;
+  GOptionEntry options[] = {
+    { "items", 'n', 0, G_OPTION_ARG_INT, &n_items, "Number of items registering at once", "N" },
+    { NULL, 0, 0, 0, NULL, NULL, NULL }
+  };
+
+  g_test_init (&argc, &argv, NULL);
+
+  context = g_option_context_new ("");
+  g_option_context_add_main_entries (context, options, NULL);
+
+  error = NULL;
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  if (n_items < 2)
+    n_items = 2;
+
+  g_test_add_func ("/sn-watcher/registry", test_registry);
+
+  return g_test_run ();
+}
@@ -37,13 +37,6 @@
 
 #define MIN_ICON_SIZE_DEFAULT 24
 
-typedef struct
-{
-  GtkOrientation  orientation;
-  gint            index;
-  NaGrid         *grid;
-} SortData;
-
 struct _NaGrid
 {
   GtkGrid    parent;
@@ -57,7 +50,12 @@ struct _NaGrid
   gint       length;
 
   GSList    *hosts;
-  GSList    *items;
+  /* sorted with compare_items() */
+  GPtrArray *items;
+
+  /* first item not at its place, G_MAXINT if none */
+  gint       dirty_from;
+  guint      relayout_id;
 };
 
 enum
@@ -97,26 +95,51 @@ compare_items (gconstpointer a,
   return g_strcmp0 (id1, id2);
 }
 
+/* Where @item goes in the sorted items, after the ones equal to it */
+static guint
+find_position (NaGrid *self,
+               NaItem *item)
+{
+  guint low, high;
+
+  low = 0;
+  high = self->items->len;
+
+  while (low < high)
+    {
+      guint mid = low + (high - low) / 2;
+
+      if (compare_items (item, g_ptr_array_index (self->items, mid)) < 0)
+        high = mid;
+      else
+        low = mid + 1;
+    }
+
+  return low;
+}
+
 static void
-sort_items (GtkWidget *item,
-            SortData  *data)
+place_item (NaGrid         *self,
+            GtkWidget      *item,
+            gint            index,
+            GtkOrientation  orientation)
 {
   gint col, row, left_attach, top_attach;
 
   /* row / col number depends on whether we are horizontal or vertical */
-  if (data->orientation == GTK_ORIENTATION_HORIZONTAL)
+  if (orientation == GTK_ORIENTATION_HORIZONTAL)
     {
-      col = data->index / data->grid->rows;
-      row = data->index % data->grid->rows;
+      col = index / self->rows;
+      row = index % self->rows;
     }
   else
     {
-      row = data->index / data->grid->cols;
-      col = data->index % data->grid->cols;
+      row = index / self->cols;
+      col = index % self->cols;
     }
 
   /* only update item position if it has changed from current */
-  gtk_container_child_get (GTK_CONTAINER (data->grid),
+  gtk_container_child_get (GTK_CONTAINER (self),
                            item,
                            "left-attach", &left_attach,
                            "top-attach", &top_attach,
@@ -124,15 +147,12 @@ sort_items (GtkWidget *item,
 
   if (left_attach != col || top_attach != row)
     {
-      gtk_container_child_set (GTK_CONTAINER (data->grid),
+      gtk_container_child_set (GTK_CONTAINER (self),
                                item,
                                "left-attach", col,
                                "top-attach", row,
                                NULL);
     }
-
-  /* increment to index of next item */
-  data->index++;
 }
 
 static void
@@ -141,10 +161,11 @@ refresh_grid (NaGrid *self)
   GtkOrientation orientation;
   GtkAllocation allocation;
   gint rows, cols, length;
+  gint i;
 
   orientation = gtk_orientable_get_orientation (GTK_ORIENTABLE (self));
   gtk_widget_get_allocation (GTK_WIDGET (self), &allocation);
-  length = g_slist_length (self->items);
+  length = self->items->len;
 
   if (orientation == GTK_ORIENTATION_HORIZONTAL)
     {
@@ -165,21 +186,47 @@ refresh_grid (NaGrid *self)
         rows++;
     }
 
-  if (self->cols != cols || self->rows != rows || self->length != length)
+  if (self->cols != cols || self->rows != rows)
     {
       self->cols = cols;
       self->rows = rows;
-      self->length = length;
+      self->dirty_from = 0;
+    }
 
-      SortData data;
-      data.orientation = gtk_orientable_get_orientation (GTK_ORIENTABLE (self));
-      data.index = 0;
-      data.grid = self;
+  self->length = length;
 
-      g_slist_foreach (self->items,
-                       (GFunc) sort_items,
-                       &data);
-    }
+  /* the items before the ones added or removed stay where they are */
+  for (i = self->dirty_from; i < length; i++)
+    place_item (self, g_ptr_array_index (self->items, i), i, orientation);
+
+  self->dirty_from = G_MAXINT;
+}
+
+static gboolean
+relayout_cb (gpointer user_data)
+{
+  NaGrid *self = NA_GRID (user_data);
+
+  self->relayout_id = 0;
+  refresh_grid (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Items come in bursts, at session start mostly, and are placed once for
+ * all of them, before the next frame */
+static void
+queue_relayout (NaGrid *self,
+                gint    index)
+{
+  self->dirty_from = MIN (self->dirty_from, index);
+
+  if (self->relayout_id != 0)
+    return;
+
+  self->relayout_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE, relayout_cb,
+                                       self, NULL);
+  g_source_set_name_by_id (self->relayout_id, "[notification-area] relayout_cb");
 }
 
 void
@@ -198,6 +245,8 @@ item_added_cb (NaHost *host,
                NaItem *item,
                NaGrid *self)
 {
+  guint position;
+
   g_return_if_fail (NA_IS_HOST (host));
   g_return_if_fail (NA_IS_ITEM (item));
   g_return_if_fail (NA_IS_GRID (self));
@@ -206,7 +255,8 @@ item_added_cb (NaHost *host,
                           item, "orientation",
                           G_BINDING_SYNC_CREATE);
 
-  self->items = g_slist_prepend (self->items, item);
+  position = find_position (self, item);
+  g_ptr_array_insert (self->items, position, item);
 
   gtk_widget_set_hexpand (GTK_WIDGET (item), TRUE);
   gtk_widget_set_vexpand (GTK_WIDGET (item), TRUE);
@@ -216,8 +266,7 @@ item_added_cb (NaHost *host,
                    self->rows - 1,
                    1, 1);
 
-  self->items = g_slist_sort (self->items, compare_items);
-  refresh_grid (self);
+  queue_relayout (self, position);
 }
 
 static void
@@ -225,13 +274,23 @@ item_removed_cb (NaHost *host,
                  NaItem *item,
                  NaGrid *self)
 {
+  guint i;
+
   g_return_if_fail (NA_IS_HOST (host));
   g_return_if_fail (NA_IS_ITEM (item));
   g_return_if_fail (NA_IS_GRID (self));
 
+  for (i = 0; i < self->items->len; i++)
+    {
+      if (g_ptr_array_index (self->items, i) == item)
+        {
+          g_ptr_array_remove_index (self->items, i);
+          queue_relayout (self, i);
+          break;
+        }
+    }
+
   gtk_container_remove (GTK_CONTAINER (self), GTK_WIDGET (item));
-  self->items = g_slist_remove (self->items, item);
-  refresh_grid (self);
 }
 
 static void
@@ -246,17 +305,25 @@ na_grid_init (NaGrid *self)
   self->length = 0;
 
   self->hosts = NULL;
-  self->items = NULL;
+  self->items = g_ptr_array_new ();
+
+  self->dirty_from = G_MAXINT;
+  self->relayout_id = 0;
 
   gtk_grid_set_row_homogeneous (GTK_GRID (self), TRUE);
   gtk_grid_set_column_homogeneous (GTK_GRID (self), TRUE);
 
 }
 
-static void
-add_host (NaGrid *self,
-          NaHost *host)
+/* Takes the reference of @host, hosts are added by the grid itself when it
+ * is realized */
+void
+na_grid_add_host (NaGrid *self,
+                  NaHost *host)
 {
+  g_return_if_fail (NA_IS_GRID (self));
+  g_return_if_fail (NA_IS_HOST (host));
+
   self->hosts = g_slist_prepend (self->hosts, host);
 
   g_object_bind_property (self, "icon-padding", host, "icon-padding",
@@ -339,12 +406,12 @@ na_grid_realize (GtkWidget *widget)
                           tray_host, "orientation",
                           G_BINDING_DEFAULT);
 
-    add_host (self, tray_host);
+    na_grid_add_host (self, tray_host);
   }
 #endif
   settings = g_settings_new ("org.mate.panel");
   if (g_settings_get_boolean (settings, "enable-sni-support"))
-    add_host (self, sn_host_v0_new ());
+    na_grid_add_host (self, sn_host_v0_new ());
   g_object_unref (settings);
 }
 
@@ -359,7 +426,14 @@ na_grid_unrealize (GtkWidget *widget)
       self->hosts = NULL;
     }
 
-  g_clear_pointer (&self->items, g_slist_free);
+  g_ptr_array_set_size (self->items, 0);
+  self->dirty_from = G_MAXINT;
+
+  if (self->relayout_id != 0)
+    {
+      g_source_remove (self->relayout_id);
+      self->relayout_id = 0;
+    }
 
   GTK_WIDGET_CLASS (na_grid_parent_class)->unrealize (widget);
 }
@@ -372,6 +446,20 @@ na_grid_size_allocate (GtkWidget     *widget,
   refresh_grid (NA_GRID (widget));
 }
 
+static void
+na_grid_finalize (GObject *object)
+{
+  NaGrid *self = NA_GRID (object);
+
+  if (self->relayout_id != 0)
+    g_source_remove (self->relayout_id);
+
+  g_ptr_array_free (self->items, TRUE);
+  g_slist_free_full (self->hosts, g_object_unref);
+
+  G_OBJECT_CLASS (na_grid_parent_class)->finalize (object);
+}
+
 static void
 na_grid_get_property (GObject    *object,
                       guint       property_id,
@@ -426,6 +514,7 @@ na_grid_class_init (NaGridClass *klass)
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
+  gobject_class->finalize = na_grid_finalize;
   gobject_class->get_property = na_grid_get_property;
   gobject_class->set_property = na_grid_set_property;
 
@@ -38,6 +38,8 @@
 
 #include <gtk/gtk.h>
 
+#include "na-host.h"
+
 G_BEGIN_DECLS
 
 #define NA_TYPE_GRID (na_grid_get_type ())
@@ -47,6 +49,8 @@ void            na_grid_set_min_icon_size       (NaGrid *grid,
                                                  gint    min_icon_size);
 GtkWidget      *na_grid_new                     (GtkOrientation orientation);
 void            na_grid_force_redraw            (NaGrid *grid);
+void            na_grid_add_host                (NaGrid *grid,
+                                                 NaHost *host);
 
 G_END_DECLS
 
@@ -312,9 +312,20 @@ sn_dbus_menu_item_update_props (SnDBusMenuItem *item,
       else if (g_strcmp0 (prop, "icon-name") == 0)
         {
           GtkWidget *image;
+          gchar *icon_name;
+
+          icon_name = g_variant_dup_string (value, NULL);
+          if (g_strcmp0 (icon_name, item->icon_name) == 0 ||
+              !MATE_IS_IMAGE_MENU_ITEM (item->item))
+            {
+              g_free (item->icon_name);
+              item->icon_name = icon_name;
+              g_variant_unref (value);
+              continue;
+            }
 
           g_free (item->icon_name);
-          item->icon_name = g_variant_dup_string (value, NULL);
+          item->icon_name = icon_name;
 
           if (item->icon_name)
             {
@@ -336,7 +347,9 @@ sn_dbus_menu_item_update_props (SnDBusMenuItem *item,
           g_clear_object (&item->icon_data);
           item->icon_data = pixbuf_new (value);
 
-          if (item->icon_data)
+          if (!MATE_IS_IMAGE_MENU_ITEM (item->item))
+            image = NULL;
+          else if (item->icon_data)
             {
               cairo_surface_t *surface;
               surface = gdk_cairo_surface_create_from_pixbuf (item->icon_data, 0, NULL);
@@ -348,8 +361,9 @@ sn_dbus_menu_item_update_props (SnDBusMenuItem *item,
               image = NULL;
             }
 
-          mate_image_menu_item_set_image (MATE_IMAGE_MENU_ITEM (item->item),
-                                         image);
+          if (MATE_IS_IMAGE_MENU_ITEM (item->item))
+            mate_image_menu_item_set_image (MATE_IMAGE_MENU_ITEM (item->item),
+                                           image);
         }
       else if (g_strcmp0 (prop, "label") == 0)
         {
@@ -437,6 +451,9 @@ sn_dbus_menu_item_remove_props (SnDBusMenuItem *item,
         }
       else if (g_strcmp0 (prop, "icon-name") == 0)
         {
+          if (item->icon_name == NULL)
+            continue;
+
           g_clear_pointer (&item->icon_name, g_free);
           if (MATE_IS_IMAGE_MENU_ITEM (item->item))
             {
@@ -446,6 +463,9 @@ sn_dbus_menu_item_remove_props (SnDBusMenuItem *item,
         }
       else if (g_strcmp0 (prop, "icon-data") == 0)
         {
+          if (item->icon_data == NULL)
+            continue;
+
           g_clear_object (&item->icon_data);
           if (MATE_IS_IMAGE_MENU_ITEM (item->item))
             {
@@ -486,3 +506,65 @@ sn_dbus_menu_item_remove_props (SnDBusMenuItem *item,
         }
     }
 }
+
+/* Whether the menu item is not the kind its properties ask for any more,
+ * as a separator turned into a check item, and has to be built again */
+gboolean
+sn_dbus_menu_item_needs_rebuild (SnDBusMenuItem *item)
+{
+  gboolean separator;
+  gboolean check;
+  gboolean radio;
+  gboolean submenu;
+
+  separator = g_strcmp0 (item->type, "separator") == 0;
+  if (separator != GTK_IS_SEPARATOR_MENU_ITEM (item->item))
+    return TRUE;
+
+  if (separator)
+    return FALSE;
+
+  check = g_strcmp0 (item->toggle_type, "checkmark") == 0;
+  radio = g_strcmp0 (item->toggle_type, "radio") == 0;
+  if ((check || radio) != GTK_IS_CHECK_MENU_ITEM (item->item))
+    return TRUE;
+
+  if (radio != (GTK_IS_CHECK_MENU_ITEM (item->item) &&
+                gtk_check_menu_item_get_draw_as_radio (GTK_CHECK_MENU_ITEM (item->item))))
+    return TRUE;
+
+  submenu = g_strcmp0 (item->children_display, "submenu") == 0;
+
+  return submenu != (item->submenu != NULL);
+}
+
+/* Replaces all the properties of the item with @props, from a layout:
+ * the ones not there are back to their defaults */
+void
+sn_dbus_menu_item_set_props (SnDBusMenuItem      *item,
+                             GVariant            *props,
+                             const gchar * const *names)
+{
+  GVariantBuilder builder;
+  GVariant *removed;
+  guint i;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_STRING_ARRAY);
+
+  for (i = 0; names[i] != NULL; i++)
+    {
+      GVariant *value;
+
+      value = g_variant_lookup_value (props, names[i], NULL);
+      if (value != NULL)
+        g_variant_unref (value);
+      else
+        g_variant_builder_add (&builder, "s", names[i]);
+    }
+
+  removed = g_variant_ref_sink (g_variant_builder_end (&builder));
+  sn_dbus_menu_item_remove_props (item, removed);
+  g_variant_unref (removed);
+
+  sn_dbus_menu_item_update_props (item, props);
+}
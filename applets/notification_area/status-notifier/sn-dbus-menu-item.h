@@ -59,6 +59,12 @@ void            sn_dbus_menu_item_update_props (SnDBusMenuItem *item,
 void            sn_dbus_menu_item_remove_props (SnDBusMenuItem *item,
                                                 GVariant       *props);
 
+gboolean        sn_dbus_menu_item_needs_rebuild (SnDBusMenuItem      *item);
+
+void            sn_dbus_menu_item_set_props     (SnDBusMenuItem      *item,
+                                                 GVariant            *props,
+                                                 const gchar * const *names);
+
 G_END_DECLS
 
 #endif
@@ -34,6 +34,12 @@ struct _SnDBusMenu
   guint          name_id;
 
   SnDBusMenuGen *proxy;
+
+  /* Layouts to fetch: all of it, or the subtrees of these items */
+  gboolean       layout_all;
+  GHashTable    *layout_parents;
+  guint          layout_id;
+  guint          layout_calls;
 };
 
 enum
@@ -67,6 +73,39 @@ static const gchar *property_names[] =
 
 G_DEFINE_TYPE (SnDBusMenu, sn_dbus_menu, GTK_TYPE_MENU)
 
+static void
+event_cb (GObject      *source_object,
+          GAsyncResult *res,
+          gpointer      user_data)
+{
+  GError *error;
+
+  error = NULL;
+  sn_dbus_menu_gen_call_event_finish (SN_DBUS_MENU_GEN (source_object),
+                                      res, &error);
+
+  if (error != NULL)
+    {
+      g_debug ("%s", error->message);
+      g_error_free (error);
+    }
+}
+
+/* Events are not waited for, a busy application must not block the panel */
+static void
+send_event (SnDBusMenu  *menu,
+            guint        id,
+            const gchar *event_id)
+{
+  if (menu->proxy == NULL)
+    return;
+
+  sn_dbus_menu_gen_call_event (menu->proxy, id, event_id,
+                               g_variant_new ("v", g_variant_new_int32 (0)),
+                               gtk_get_current_event_time (),
+                               NULL, event_cb, NULL);
+}
+
 static void
 activate_cb (GtkWidget  *widget,
              SnDBusMenu *menu)
@@ -77,9 +116,31 @@ activate_cb (GtkWidget  *widget,
     return;
 
   id = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (widget), "item-id"));
-  sn_dbus_menu_gen_call_event_sync (menu->proxy, id, "clicked",
-                                    g_variant_new ("v", g_variant_new_int32 (0)),
-                                    gtk_get_current_event_time (), NULL, NULL);
+  send_event (menu, id, "clicked");
+}
+
+static void
+remove_item (SnDBusMenu *menu,
+             guint       id)
+{
+  SnDBusMenuItem *item;
+
+  item = g_hash_table_lookup (menu->items, GUINT_TO_POINTER (id));
+  if (item == NULL)
+    return;
+
+  if (item->submenu != NULL)
+    {
+      GList *children;
+      GList *l;
+
+      children = gtk_container_get_children (GTK_CONTAINER (item->submenu));
+      for (l = children; l != NULL; l = l->next)
+        remove_item (menu, GPOINTER_TO_UINT (g_object_get_data (l->data, "item-id")));
+      g_list_free (children);
+    }
+
+  g_hash_table_remove (menu->items, GUINT_TO_POINTER (id));
 }
 
 static GtkMenu *
@@ -89,29 +150,107 @@ layout_update_item (SnDBusMenu *menu,
                     GVariant   *props)
 {
   SnDBusMenuItem *item;
+  gint position;
 
   if (id == 0)
     return gtk_menu;
 
+  position = -1;
+
   item = g_hash_table_lookup (menu->items, GUINT_TO_POINTER (id));
 
+  /* Items moved to another menu are built again */
+  if (item != NULL &&
+      gtk_widget_get_parent (item->item) != GTK_WIDGET (gtk_menu))
+    {
+      remove_item (menu, id);
+      item = NULL;
+    }
+
+  if (item != NULL)
+    {
+      sn_dbus_menu_item_set_props (item, props, property_names);
+
+      /* And the ones turned into another kind of item too, in their place */
+      if (sn_dbus_menu_item_needs_rebuild (item))
+        {
+          GList *children;
+
+          children = gtk_container_get_children (GTK_CONTAINER (gtk_menu));
+          position = g_list_index (children, item->item);
+          g_list_free (children);
+
+          remove_item (menu, id);
+          item = NULL;
+        }
+    }
+
   if (item == NULL)
     {
       item = sn_dbus_menu_item_new (props);
 
       g_object_set_data (G_OBJECT (item->item), "item-id", GUINT_TO_POINTER (id));
-      gtk_menu_shell_append (GTK_MENU_SHELL (gtk_menu), item->item);
+      gtk_menu_shell_insert (GTK_MENU_SHELL (gtk_menu), item->item, position);
 
       item->activate_id = g_signal_connect (item->item, "activate",
                                             G_CALLBACK (activate_cb), menu);
 
       g_hash_table_replace (menu->items, GUINT_TO_POINTER (id), item);
     }
-  else
+
+  return item->submenu;
+}
+
+/* Removes the items of @gtk_menu not in the layout any more, and puts the
+ * others in the order of the layout */
+static void
+layout_sync_children (SnDBusMenu *menu,
+                      GtkMenu    *gtk_menu,
+                      GArray     *ids)
+{
+  GHashTable *wanted;
+  GList *children;
+  GList *l;
+  gboolean in_order;
+  guint i;
+
+  wanted = g_hash_table_new (NULL, NULL);
+  for (i = 0; i < ids->len; i++)
+    g_hash_table_add (wanted, GUINT_TO_POINTER (g_array_index (ids, guint, i)));
+
+  children = gtk_container_get_children (GTK_CONTAINER (gtk_menu));
+  for (l = children; l != NULL; l = l->next)
     {
-      sn_dbus_menu_item_update_props (item, props);
+      guint id;
+
+      id = GPOINTER_TO_UINT (g_object_get_data (l->data, "item-id"));
+      if (!g_hash_table_contains (wanted, GUINT_TO_POINTER (id)))
+        remove_item (menu, id);
     }
-  return item->submenu;
+  g_list_free (children);
+  g_hash_table_destroy (wanted);
+
+  children = gtk_container_get_children (GTK_CONTAINER (gtk_menu));
+  in_order = TRUE;
+  for (i = 0, l = children; i < ids->len; i++)
+    {
+      SnDBusMenuItem *item;
+
+      item = g_hash_table_lookup (menu->items,
+                                  GUINT_TO_POINTER (g_array_index (ids, guint, i)));
+      if (item == NULL)
+        continue;
+
+      if (in_order && l != NULL && l->data == item->item)
+        {
+          l = l->next;
+          continue;
+        }
+
+      in_order = FALSE;
+      gtk_menu_reorder_child (gtk_menu, item->item, i);
+    }
+  g_list_free (children);
 }
 
 static void
@@ -125,6 +264,7 @@ layout_parse (SnDBusMenu *menu,
   GtkMenu *submenu;
   GVariantIter iter;
   GVariant *child;
+  GArray *ids;
 
   if (!g_variant_is_of_type (layout, G_VARIANT_TYPE ("(ia{sv}av)")))
     {
@@ -140,6 +280,14 @@ layout_parse (SnDBusMenu *menu,
   submenu = layout_update_item (menu, gtk_menu, id, props);
   g_variant_unref (props);
 
+  if (submenu == NULL)
+    {
+      g_variant_unref (items);
+      return;
+    }
+
+  ids = g_array_new (FALSE, FALSE, sizeof (guint));
+
   g_variant_iter_init (&iter, items);
   while ((child = g_variant_iter_next_value (&iter)))
     {
@@ -147,6 +295,14 @@ layout_parse (SnDBusMenu *menu,
 
       value = g_variant_get_variant (child);
 
+      if (g_variant_is_of_type (value, G_VARIANT_TYPE ("(ia{sv}av)")))
+        {
+          gint32 child_id;
+
+          g_variant_get_child (value, 0, "i", &child_id);
+          g_array_append_val (ids, child_id);
+        }
+
       layout_parse (menu, value, submenu);
       g_variant_unref (value);
 
@@ -154,8 +310,56 @@ layout_parse (SnDBusMenu *menu,
     }
 
   g_variant_unref (items);
+
+  layout_sync_children (menu, submenu, ids);
+  g_array_free (ids, TRUE);
+}
+
+/* The id of the item the menu item is in, 0 for the top of the menu */
+static gint
+get_parent_id (GtkWidget *widget)
+{
+  GtkWidget *parent;
+  GtkWidget *attach_widget;
+
+  parent = gtk_widget_get_parent (widget);
+  if (!GTK_IS_MENU (parent))
+    return 0;
+
+  attach_widget = gtk_menu_get_attach_widget (GTK_MENU (parent));
+  if (attach_widget == NULL)
+    return 0;
+
+  return GPOINTER_TO_INT (g_object_get_data (G_OBJECT (attach_widget), "item-id"));
 }
 
+/* The menu the layout goes in, NULL if its item is gone meanwhile */
+static GtkMenu *
+get_layout_menu (SnDBusMenu *menu,
+                 GVariant   *layout)
+{
+  SnDBusMenuItem *item;
+  GtkWidget *parent;
+  gint32 id;
+
+  if (!g_variant_is_of_type (layout, G_VARIANT_TYPE ("(ia{sv}av)")))
+    return GTK_MENU (menu);
+
+  g_variant_get_child (layout, 0, "i", &id);
+  if (id == 0)
+    return GTK_MENU (menu);
+
+  item = g_hash_table_lookup (menu->items, GINT_TO_POINTER (id));
+  if (item == NULL)
+    return NULL;
+
+  parent = gtk_widget_get_parent (item->item);
+
+  return GTK_IS_MENU (parent) ? GTK_MENU (parent) : NULL;
+}
+
+static void request_layouts (SnDBusMenu *menu);
+
 static void
 get_layout_cb (GObject      *source_object,
                GAsyncResult *res,
@@ -165,6 +369,7 @@ get_layout_cb (GObject      *source_object,
   guint revision;
   GError *error;
   SnDBusMenu *menu;
+  GtkMenu *gtk_menu;
 
   error = NULL;
   sn_dbus_menu_gen_call_get_layout_finish (SN_DBUS_MENU_GEN (source_object),
@@ -177,36 +382,133 @@ get_layout_cb (GObject      *source_object,
     }
 
   menu = SN_DBUS_MENU (user_data);
+  menu->layout_calls--;
 
   if (error != NULL)
     {
       g_warning ("%s", error->message);
       g_error_free (error);
+    }
+  else
+    {
+      /* The menu shown is patched in place, rebuilding it would make it
+       * flicker and lose the selected item */
+      gtk_menu = get_layout_menu (menu, layout);
+      if (gtk_menu != NULL)
+        layout_parse (menu, layout, gtk_menu);
+
+      /* Reposition menu to accomodate any size changes   */
+      /* Menu size never changes with GTK 3.20 or earlier */
+      gtk_menu_reposition(GTK_MENU(menu));
+
+      g_variant_unref (layout);
+    }
+
+  /* Updates that came in the meantime */
+  if (menu->layout_calls == 0)
+    request_layouts (menu);
+}
+
+/* Whether the layout of an item the item is in is fetched too */
+static gboolean
+has_parent_requested (SnDBusMenu     *menu,
+                      SnDBusMenuItem *item)
+{
+  gint id;
+
+  for (id = get_parent_id (item->item); id != 0; id = get_parent_id (item->item))
+    {
+      if (g_hash_table_contains (menu->layout_parents, GINT_TO_POINTER (id)))
+        return TRUE;
+
+      item = g_hash_table_lookup (menu->items, GINT_TO_POINTER (id));
+      if (item == NULL)
+        break;
+    }
+
+  return FALSE;
+}
+
+static void
+request_layout (SnDBusMenu *menu,
+                gint        parent)
+{
+  menu->layout_calls++;
+
+  sn_dbus_menu_gen_call_get_layout (menu->proxy, parent, -1,
+                                    property_names, menu->cancellable,
+                                    get_layout_cb, menu);
+}
+
+static void
+request_layouts (SnDBusMenu *menu)
+{
+  GHashTableIter iter;
+  gpointer key;
+
+  if (menu->proxy == NULL)
+    {
+      menu->layout_all = FALSE;
+      g_hash_table_remove_all (menu->layout_parents);
       return;
     }
 
-  g_hash_table_remove_all (menu->items);
-  layout_parse (menu, layout, GTK_MENU (menu));
+  if (menu->layout_all)
+    {
+      request_layout (menu, 0);
+    }
+  else
+    {
+      g_hash_table_iter_init (&iter, menu->layout_parents);
+      while (g_hash_table_iter_next (&iter, &key, NULL))
+        {
+          SnDBusMenuItem *item;
+
+          /* Gone, or in a subtree fetched anyway */
+          item = g_hash_table_lookup (menu->items, key);
+          if (item == NULL || has_parent_requested (menu, item))
+            continue;
+
+          request_layout (menu, GPOINTER_TO_INT (key));
+        }
+    }
 
-  /* Reposition menu to accomodate any size changes   */
-  /* Menu size never changes with GTK 3.20 or earlier */
-  gtk_menu_reposition(GTK_MENU(menu));
+  menu->layout_all = FALSE;
+  g_hash_table_remove_all (menu->layout_parents);
+}
 
-  g_variant_unref (layout);
+static gboolean
+layout_cb (gpointer user_data)
+{
+  SnDBusMenu *menu;
+
+  menu = SN_DBUS_MENU (user_data);
+  menu->layout_id = 0;
+
+  if (menu->layout_calls == 0)
+    request_layouts (menu);
+
+  return G_SOURCE_REMOVE;
 }
 
+/* Only the subtree of @parent is fetched and built again. Updates coming
+ * together are fetched together, and the ones coming while a layout is
+ * fetched wait for it. */
 static void
 update_layout (SnDBusMenu *menu,
                gint        parent)
 {
-  gint depth;
-
-  parent = 0;
-  depth = -1;
+  if (parent == 0 ||
+      !g_hash_table_contains (menu->items, GINT_TO_POINTER (parent)))
+    menu->layout_all = TRUE;
+  else
+    g_hash_table_add (menu->layout_parents, GINT_TO_POINTER (parent));
 
-  sn_dbus_menu_gen_call_get_layout (menu->proxy, parent, depth,
-                                    property_names, menu->cancellable,
-                                    get_layout_cb, menu);
+  if (menu->layout_id == 0 && menu->layout_calls == 0)
+    {
+      menu->layout_id = g_idle_add (layout_cb, menu);
+      g_source_set_name_by_id (menu->layout_id, "[status-notifier] layout_cb");
+    }
 }
 
 static void
@@ -226,7 +528,12 @@ items_properties_updated_cb (SnDBusMenuGen *proxy,
       item = g_hash_table_lookup (menu->items, GUINT_TO_POINTER (id));
 
       if (item != NULL)
-        sn_dbus_menu_item_update_props (item, props);
+        {
+          sn_dbus_menu_item_update_props (item, props);
+
+          if (sn_dbus_menu_item_needs_rebuild (item))
+            update_layout (menu, get_parent_id (item->item));
+        }
 
       g_variant_unref (props);
     }
@@ -237,7 +544,12 @@ items_properties_updated_cb (SnDBusMenuGen *proxy,
       item = g_hash_table_lookup (menu->items, GUINT_TO_POINTER (id));
 
       if (item != NULL)
-        sn_dbus_menu_item_remove_props (item, props);
+        {
+          sn_dbus_menu_item_remove_props (item, props);
+
+          if (sn_dbus_menu_item_needs_rebuild (item))
+            update_layout (menu, get_parent_id (item->item));
+        }
 
       g_variant_unref (props);
     }
@@ -262,33 +574,57 @@ item_activation_requested_cb (SnDBusMenuGen *proxy,
 }
 
 static void
-map_cb (GtkWidget  *widget,
-        SnDBusMenu *menu)
+about_to_show_cb (GObject      *source_object,
+                  GAsyncResult *res,
+                  gpointer      user_data)
 {
   gboolean need_update;
+  GError *error;
+  SnDBusMenu *menu;
+
+  error = NULL;
+  sn_dbus_menu_gen_call_about_to_show_finish (SN_DBUS_MENU_GEN (source_object),
+                                              &need_update, res, &error);
 
-  sn_dbus_menu_gen_call_event_sync (menu->proxy, 0, "opened",
-                                    g_variant_new ("v", g_variant_new_int32 (0)),
-                                    gtk_get_current_event_time (),
-                                    NULL, NULL);
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      g_error_free (error);
+      return;
+    }
 
-  sn_dbus_menu_gen_call_about_to_show_sync (menu->proxy, 0, &need_update,
-                                            NULL, NULL);
+  menu = SN_DBUS_MENU (user_data);
 
-  if (need_update)
+  if (error != NULL)
     {
-      update_layout (menu, 0);
+      g_debug ("%s", error->message);
+      g_error_free (error);
+      return;
     }
+
+  if (need_update && menu->proxy != NULL)
+    update_layout (menu, 0);
+}
+
+/* The menu is shown right away with the layout fetched beforehand, and
+ * patched if the application has a newer one */
+static void
+map_cb (GtkWidget  *widget,
+        SnDBusMenu *menu)
+{
+  if (menu->proxy == NULL)
+    return;
+
+  send_event (menu, 0, "opened");
+
+  sn_dbus_menu_gen_call_about_to_show (menu->proxy, 0, menu->cancellable,
+                                       about_to_show_cb, menu);
 }
 
 static void
 unmap_cb (GtkWidget  *widget,
           SnDBusMenu *menu)
 {
-  sn_dbus_menu_gen_call_event_sync (menu->proxy, 0, "closed",
-                                    g_variant_new ("v", g_variant_new_int32 (0)),
-                                    gtk_get_current_event_time (),
-                                    NULL, NULL);
+  send_event (menu, 0, "closed");
 }
 
 static void
@@ -403,7 +739,14 @@ sn_dbus_menu_dispose (GObject *object)
       menu->name_id = 0;
     }
 
+  if (menu->layout_id != 0)
+    {
+      g_source_remove (menu->layout_id);
+      menu->layout_id = 0;
+    }
+
   g_clear_pointer (&menu->items, g_hash_table_destroy);
+  g_clear_pointer (&menu->layout_parents, g_hash_table_destroy);
 
   g_cancellable_cancel (menu->cancellable);
   g_clear_object (&menu->cancellable);
@@ -486,6 +829,7 @@ static void
 sn_dbus_menu_init (SnDBusMenu *menu)
 {
   menu->items = g_hash_table_new_full (NULL, NULL, NULL, sn_dbus_menu_item_free);
+  menu->layout_parents = g_hash_table_new (NULL, NULL);
   menu->cancellable = g_cancellable_new ();
 }
 
@@ -41,6 +41,7 @@ struct _SnHostV0
   SnWatcherV0Gen      *watcher;
 
   GSList              *items;
+  SnIconCache         *icon_cache;
 
   gint                 icon_padding;
   gint                 icon_size;
@@ -125,6 +126,8 @@ add_registered_item (SnHostV0    *v0,
   item = sn_item_v0_new (bus_name, object_path);
   g_object_ref_sink (item);
 
+  sn_item_v0_set_icon_cache (SN_ITEM_V0 (item), v0->icon_cache);
+
   g_object_bind_property (v0, "icon-padding", item, "icon-padding",
                           G_BINDING_DEFAULT | G_BINDING_SYNC_CREATE);
   g_object_bind_property (v0, "icon-size", item, "icon-size",
@@ -443,6 +446,7 @@ sn_host_v0_finalize (GObject *object)
 
   g_clear_pointer (&v0->bus_name, g_free);
   g_clear_pointer (&v0->object_path, g_free);
+  g_clear_pointer (&v0->icon_cache, sn_icon_cache_unref);
 
   G_OBJECT_CLASS (sn_host_v0_parent_class)->finalize (object);
 }
@@ -479,6 +483,8 @@ sn_host_v0_init (SnHostV0 *v0)
 
   v0->icon_size = 16;
   v0->icon_padding = 0;
+
+  v0->icon_cache = sn_icon_cache_new ();
 }
 
 NaHost *
@@ -0,0 +1,456 @@
+/*
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Items switching between a few icons, as network, volume or chat status
+ * ones do, would otherwise look the icon theme up again on every change.
+ *
+ * Icons are kept by theme path, name, size and scale, until the icon
+ * theme changes. Items with an IconThemePath get an icon theme of their
+ * own with that path added, shared by the items with the same path and
+ * dropped with the last of them, as applications like Electron ones use a
+ * new temporary path on every start. Monitors on that directory and the
+ * ones below it, down to where themes keep their icons, tell when it
+ * changes, and the items are told to look their icons up again.
+ */
+
+#include <config.h>
+
+#include "sn-icon-cache.h"
+
+/* Enough for all the icons of all the items, in a few sizes */
+#define SN_ICON_CACHE_MAX_ICONS 256
+
+/* <path>/<theme>/<size>/<context>/<icon> */
+#define SN_ICON_CACHE_MAX_DEPTH 3
+/* Paths larger than that are only checked by GTK when looking icons up */
+#define SN_ICON_CACHE_MAX_MONITORS 64
+
+typedef struct
+{
+  SnIconCacheChangedFunc func;
+  gpointer               user_data;
+} SnIconCacheListener;
+
+typedef struct
+{
+  SnIconCache  *cache;
+  gchar        *theme_path;
+  guint         users;
+  GtkIconTheme *theme;
+  gulong        changed_id;
+  GPtrArray    *monitors;
+} SnIconCacheTheme;
+
+struct _SnIconCache
+{
+  gint        ref_count;
+
+  /* theme path, or "" for the default theme, to SnIconCacheTheme */
+  GHashTable *themes;
+  /* key to surface, or NULL for missing icons */
+  GHashTable *icons;
+
+  GSList     *listeners;
+};
+
+static gboolean
+remove_theme_icon (gpointer key,
+                   gpointer value,
+                   gpointer user_data)
+{
+  return g_str_has_prefix (key, user_data);
+}
+
+/* Drops the icons of @theme_path, or all of them if NULL */
+static void
+invalidate (SnIconCache *cache,
+            const gchar *theme_path)
+{
+  gchar *prefix;
+
+  if (theme_path == NULL)
+    {
+      g_hash_table_remove_all (cache->icons);
+      return;
+    }
+
+  prefix = g_strconcat (theme_path, "\n", NULL);
+  g_hash_table_foreach_remove (cache->icons, remove_theme_icon, prefix);
+  g_free (prefix);
+}
+
+static void
+theme_changed (SnIconCacheTheme *cache_theme)
+{
+  SnIconCache *cache;
+  GSList *l;
+
+  cache = cache_theme->cache;
+  invalidate (cache, cache_theme->theme_path);
+
+  for (l = cache->listeners; l != NULL; l = l->next)
+    {
+      SnIconCacheListener *listener = l->data;
+
+      listener->func (cache, cache_theme->theme_path, listener->user_data);
+    }
+}
+
+static void
+theme_changed_cb (GtkIconTheme     *theme,
+                  SnIconCacheTheme *cache_theme)
+{
+  theme_changed (cache_theme);
+}
+
+static void monitor_directory (SnIconCacheTheme *cache_theme,
+                               GFile            *directory,
+                               gint              depth);
+
+static void
+directory_changed_cb (GFileMonitor      *monitor,
+                      GFile             *file,
+                      GFile             *other_file,
+                      GFileMonitorEvent  event_type,
+                      SnIconCacheTheme  *cache_theme)
+{
+  gint depth;
+
+  if (event_type == G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT ||
+      event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+    return;
+
+  depth = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (monitor), "sn-depth"));
+
+  if (event_type == G_FILE_MONITOR_EVENT_CREATED &&
+      depth < SN_ICON_CACHE_MAX_DEPTH &&
+      g_file_query_file_type (file, G_FILE_QUERY_INFO_NONE, NULL) == G_FILE_TYPE_DIRECTORY)
+    monitor_directory (cache_theme, file, depth + 1);
+
+  /* Emits "changed" if GTK sees the change, and not otherwise */
+  if (!gtk_icon_theme_rescan_if_needed (cache_theme->theme))
+    theme_changed (cache_theme);
+}
+
+static void
+monitor_directory (SnIconCacheTheme *cache_theme,
+                   GFile            *directory,
+                   gint              depth)
+{
+  GFileMonitor *monitor;
+  GFileEnumerator *enumerator;
+  GFileInfo *info;
+
+  if (cache_theme->monitors->len >= SN_ICON_CACHE_MAX_MONITORS)
+    return;
+
+  monitor = g_file_monitor_directory (directory, G_FILE_MONITOR_NONE, NULL, NULL);
+  if (monitor == NULL)
+    return;
+
+  g_object_set_data (G_OBJECT (monitor), "sn-depth", GINT_TO_POINTER (depth));
+  g_signal_connect (monitor, "changed",
+                    G_CALLBACK (directory_changed_cb), cache_theme);
+  g_ptr_array_add (cache_theme->monitors, monitor);
+
+  if (depth >= SN_ICON_CACHE_MAX_DEPTH)
+    return;
+
+  enumerator = g_file_enumerate_children (directory,
+                                          G_FILE_ATTRIBUTE_STANDARD_NAME ","
+                                          G_FILE_ATTRIBUTE_STANDARD_TYPE,
+                                          G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  if (enumerator == NULL)
+    return;
+
+  while ((info = g_file_enumerator_next_file (enumerator, NULL, NULL)) != NULL)
+    {
+      if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+        {
+          GFile *child;
+
+          child = g_file_get_child (directory, g_file_info_get_name (info));
+          monitor_directory (cache_theme, child, depth + 1);
+          g_object_unref (child);
+        }
+
+      g_object_unref (info);
+    }
+
+  g_object_unref (enumerator);
+}
+
+static void
+monitor_free (gpointer data)
+{
+  GFileMonitor *monitor = data;
+
+  g_file_monitor_cancel (monitor);
+  g_signal_handlers_disconnect_matched (monitor, G_SIGNAL_MATCH_FUNC, 0, 0,
+                                        NULL, directory_changed_cb, NULL);
+  g_object_unref (monitor);
+}
+
+static SnIconCacheTheme *
+cache_theme_new (SnIconCache *cache,
+                 const gchar *theme_path)
+{
+  SnIconCacheTheme *cache_theme;
+
+  cache_theme = g_new0 (SnIconCacheTheme, 1);
+  cache_theme->cache = cache;
+  cache_theme->theme_path = g_strdup (theme_path);
+  cache_theme->monitors = g_ptr_array_new_with_free_func (monitor_free);
+
+  if (theme_path[0] == '\0')
+    {
+      cache_theme->theme = g_object_ref (gtk_icon_theme_get_default ());
+    }
+  else
+    {
+      GFile *file;
+
+      cache_theme->theme = gtk_icon_theme_new ();
+      gtk_icon_theme_set_screen (cache_theme->theme, gdk_screen_get_default ());
+      gtk_icon_theme_append_search_path (cache_theme->theme, theme_path);
+
+      file = g_file_new_for_path (theme_path);
+      monitor_directory (cache_theme, file, 0);
+      g_object_unref (file);
+    }
+
+  cache_theme->changed_id = g_signal_connect (cache_theme->theme, "changed",
+                                              G_CALLBACK (theme_changed_cb),
+                                              cache_theme);
+
+  return cache_theme;
+}
+
+static void
+cache_theme_free (gpointer data)
+{
+  SnIconCacheTheme *cache_theme = data;
+
+  g_ptr_array_free (cache_theme->monitors, TRUE);
+
+  g_signal_handler_disconnect (cache_theme->theme, cache_theme->changed_id);
+  g_object_unref (cache_theme->theme);
+
+  g_free (cache_theme->theme_path);
+  g_free (cache_theme);
+}
+
+static SnIconCacheTheme *
+cache_theme_ref (SnIconCache *cache,
+                 const gchar *theme_path)
+{
+  SnIconCacheTheme *cache_theme;
+
+  if (theme_path == NULL)
+    theme_path = "";
+
+  cache_theme = g_hash_table_lookup (cache->themes, theme_path);
+  if (cache_theme == NULL)
+    {
+      cache_theme = cache_theme_new (cache, theme_path);
+      g_hash_table_insert (cache->themes, cache_theme->theme_path, cache_theme);
+    }
+
+  cache_theme->users++;
+
+  return cache_theme;
+}
+
+static void
+cache_theme_unref (SnIconCache      *cache,
+                   SnIconCacheTheme *cache_theme)
+{
+  g_return_if_fail (cache_theme->users > 0);
+
+  /* The default theme is there for the life of the panel anyway */
+  if (--cache_theme->users > 0 || cache_theme->theme_path[0] == '\0')
+    return;
+
+  invalidate (cache, cache_theme->theme_path);
+  g_hash_table_remove (cache->themes, cache_theme->theme_path);
+}
+
+SnIconCache *
+sn_icon_cache_new (void)
+{
+  SnIconCache *cache;
+
+  cache = g_new0 (SnIconCache, 1);
+  cache->ref_count = 1;
+  cache->themes = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         NULL, cache_theme_free);
+  cache->icons = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                        (GDestroyNotify) cairo_surface_destroy);
+
+  return cache;
+}
+
+SnIconCache *
+sn_icon_cache_ref (SnIconCache *cache)
+{
+  cache->ref_count++;
+
+  return cache;
+}
+
+void
+sn_icon_cache_unref (SnIconCache *cache)
+{
+  if (cache == NULL || --cache->ref_count > 0)
+    return;
+
+  g_hash_table_destroy (cache->icons);
+  g_hash_table_destroy (cache->themes);
+  g_slist_free_full (cache->listeners, g_free);
+  g_free (cache);
+}
+
+void
+sn_icon_cache_ref_theme_path (SnIconCache *cache,
+                              const gchar *theme_path)
+{
+  cache_theme_ref (cache, theme_path);
+}
+
+void
+sn_icon_cache_unref_theme_path (SnIconCache *cache,
+                                const gchar *theme_path)
+{
+  SnIconCacheTheme *cache_theme;
+
+  cache_theme = g_hash_table_lookup (cache->themes,
+                                     theme_path != NULL ? theme_path : "");
+  g_return_if_fail (cache_theme != NULL);
+
+  cache_theme_unref (cache, cache_theme);
+}
+
+void
+sn_icon_cache_add_changed_func (SnIconCache            *cache,
+                                SnIconCacheChangedFunc  func,
+                                gpointer                user_data)
+{
+  SnIconCacheListener *listener;
+
+  listener = g_new0 (SnIconCacheListener, 1);
+  listener->func = func;
+  listener->user_data = user_data;
+
+  cache->listeners = g_slist_prepend (cache->listeners, listener);
+}
+
+void
+sn_icon_cache_remove_changed_func (SnIconCache            *cache,
+                                   SnIconCacheChangedFunc  func,
+                                   gpointer                user_data)
+{
+  GSList *l;
+
+  for (l = cache->listeners; l != NULL; l = l->next)
+    {
+      SnIconCacheListener *listener = l->data;
+
+      if (listener->func == func && listener->user_data == user_data)
+        {
+          cache->listeners = g_slist_delete_link (cache->listeners, l);
+          g_free (listener);
+          return;
+        }
+    }
+}
+
+static cairo_surface_t *
+load_icon (GtkIconTheme *icon_theme,
+           const gchar  *icon_name,
+           gint          requested_size,
+           gint          scale)
+{
+  gint *sizes;
+  gint i;
+  gint chosen_size = 0;
+
+  sizes = gtk_icon_theme_get_icon_sizes (icon_theme, icon_name);
+  for (i = 0; sizes[i] != 0; i++)
+    {
+      if (sizes[i] == requested_size ||
+          sizes[i] == -1) /* scalable */
+        {
+          /* perfect match, stop here */
+          chosen_size = requested_size;
+          break;
+        }
+      else if (sizes[i] < requested_size && sizes[i] > chosen_size)
+        chosen_size = sizes[i];
+    }
+  g_free (sizes);
+
+  if (chosen_size == 0)
+    chosen_size = requested_size;
+
+  return gtk_icon_theme_load_surface (icon_theme, icon_name,
+                                      chosen_size, scale,
+                                      NULL, GTK_ICON_LOOKUP_FORCE_SIZE, NULL);
+}
+
+cairo_surface_t *
+sn_icon_cache_load (SnIconCache *cache,
+                    const gchar *theme_path,
+                    const gchar *icon_name,
+                    gint         size,
+                    gint         scale)
+{
+  SnIconCacheTheme *cache_theme;
+  cairo_surface_t *surface;
+  gpointer value;
+  gchar *key;
+
+  g_return_val_if_fail (icon_name != NULL && icon_name[0] != '\0', NULL);
+  g_return_val_if_fail (size > 0, NULL);
+
+  if (theme_path == NULL)
+    theme_path = "";
+
+  key = g_strdup_printf ("%s\n%s\n%d\n%d", theme_path, icon_name, size, scale);
+
+  if (g_hash_table_lookup_extended (cache->icons, key, NULL, &value))
+    {
+      g_free (key);
+
+      return value ? cairo_surface_reference (value) : NULL;
+    }
+
+  /* Held by the items with that path, only while loading otherwise */
+  cache_theme = cache_theme_ref (cache, theme_path);
+
+  surface = load_icon (cache_theme->theme, icon_name, size, scale);
+
+  if (g_hash_table_size (cache->icons) >= SN_ICON_CACHE_MAX_ICONS)
+    invalidate (cache, NULL);
+
+  g_hash_table_insert (cache->icons, key,
+                       surface ? cairo_surface_reference (surface) : NULL);
+
+  cache_theme_unref (cache, cache_theme);
+
+  return surface;
+}
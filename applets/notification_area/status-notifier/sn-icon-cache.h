@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SN_ICON_CACHE_H
+#define SN_ICON_CACHE_H
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+typedef struct _SnIconCache SnIconCache;
+
+/* @theme_path is "" for the default theme */
+typedef void (* SnIconCacheChangedFunc) (SnIconCache *cache,
+                                         const gchar *theme_path,
+                                         gpointer     user_data);
+
+SnIconCache     *sn_icon_cache_new          (void);
+SnIconCache     *sn_icon_cache_ref          (SnIconCache *cache);
+void             sn_icon_cache_unref        (SnIconCache *cache);
+
+/* Items hold the icon theme of their IconThemePath while they use it */
+void             sn_icon_cache_ref_theme_path      (SnIconCache *cache,
+                                                    const gchar *theme_path);
+void             sn_icon_cache_unref_theme_path    (SnIconCache *cache,
+                                                    const gchar *theme_path);
+
+/* Called when the icons of a theme path changed and have to be loaded
+ * again */
+void             sn_icon_cache_add_changed_func    (SnIconCache            *cache,
+                                                    SnIconCacheChangedFunc  func,
+                                                    gpointer                user_data);
+void             sn_icon_cache_remove_changed_func (SnIconCache            *cache,
+                                                    SnIconCacheChangedFunc  func,
+                                                    gpointer                user_data);
+
+/* Loads @icon_name from the icon theme, with @theme_path as an additional
+ * search path if not NULL. Returns NULL if there is no such icon. */
+cairo_surface_t *sn_icon_cache_load         (SnIconCache *cache,
+                                             const gchar *theme_path,
+                                             const gchar *icon_name,
+                                             gint         size,
+                                             gint         scale);
+
+G_END_DECLS
+
+#endif
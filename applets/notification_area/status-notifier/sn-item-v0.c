@@ -18,25 +18,34 @@
 
 #include <config.h>
 
-#include <math.h>
-
 #include "sn-item.h"
 #include "sn-item-v0.h"
 #include "sn-item-v0-gen.h"
+#include "sn-pixmap.h"
 
 #define SN_ITEM_INTERFACE "org.kde.StatusNotifierItem"
 
-typedef struct
+/* Signals are collapsed into one GetAll per frame, and into at most one
+ * every SN_REFRESH_THROTTLE ms once an item has been refreshed
+ * SN_REFRESH_BURST times within a second */
+#define SN_REFRESH_DELAY    16
+#define SN_REFRESH_THROTTLE 250
+#define SN_REFRESH_BURST    5
+
+/* Properties announced by the New* signals */
+typedef enum
 {
-  cairo_surface_t *surface;
-  gint             width;
-  gint             height;
-} SnIconPixmap;
+  SN_PROPERTY_TITLE          = 1 << 0,
+  SN_PROPERTY_ICON           = 1 << 1,
+  SN_PROPERTY_OVERLAY_ICON   = 1 << 2,
+  SN_PROPERTY_ATTENTION_ICON = 1 << 3,
+  SN_PROPERTY_TOOLTIP        = 1 << 4
+} SnProperty;
 
 typedef struct
 {
   gchar         *icon_name;
-  SnIconPixmap **icon_pixmap;
+  SnPixmap     **icon_pixmap;
   gchar         *title;
   gchar         *text;
 } SnTooltip;
@@ -60,18 +69,33 @@ struct _SnItemV0
   gint32         window_id;
   gchar         *icon_name;
   gchar         *label;
-  SnIconPixmap **icon_pixmap;
+  SnPixmap     **icon_pixmap;
   gchar         *overlay_icon_name;
-  SnIconPixmap **overlay_icon_pixmap;
+  SnPixmap     **overlay_icon_pixmap;
   gchar         *attention_icon_name;
-  SnIconPixmap **attention_icon_pixmap;
+  SnPixmap     **attention_icon_pixmap;
   gchar         *attention_movie_name;
   SnTooltip     *tooltip;
   gchar         *icon_theme_path;
   gchar         *menu;
+  SnIconCache   *icon_cache;
   gboolean       item_is_menu;
 
   guint          update_id;
+
+  guint          refresh_id;
+  /* properties changed, and being fetched */
+  guint          refresh_pending;
+  guint          refresh_running;
+  gint64         burst_start;
+  guint          burst_count;
+  gint64         last_refresh;
+
+  guint          n_signals;
+  guint          n_calls;
+  gint64         stats_start;
+  guint          stats_signals;
+  guint          stats_calls;
 };
 
 enum
@@ -88,150 +112,129 @@ static GParamSpec *obj_properties[LAST_PROP] = { NULL };
 
 G_DEFINE_TYPE (SnItemV0, sn_item_v0, SN_TYPE_ITEM)
 
+static gint
+pixmap_length (SnPixmap       *pixmap,
+               GtkOrientation  orientation)
+{
+  if (orientation == GTK_ORIENTATION_HORIZONTAL)
+    return sn_pixmap_get_height (pixmap);
+  else
+    return sn_pixmap_get_width (pixmap);
+}
+
 static cairo_surface_t *
-scale_surface (SnIconPixmap   *pixmap,
-               GtkOrientation  orientation,
-               gint            size)
+get_surface (SnPixmap      **icon_pixmap,
+             GtkOrientation  orientation,
+             gint            size)
 {
-  gdouble ratio;
-  gdouble new_width;
-  gdouble new_height;
-  gdouble scale_x;
-  gdouble scale_y;
-  gint width;
-  gint height;
-  cairo_content_t content;
-  cairo_surface_t *scaled;
-  cairo_t *cr;
+  gint i;
+  gint limit = G_MAXINT;
+  SnPixmap *pixmap = NULL;
+  SnPixmap *smallest = NULL;
 
-  g_return_val_if_fail (pixmap != NULL, NULL);
+  g_assert (icon_pixmap != NULL && icon_pixmap[0] != NULL);
 
-  ratio = pixmap->width / (gdouble) pixmap->height;
-  if (orientation == GTK_ORIENTATION_HORIZONTAL)
-    {
-      new_height = (gdouble) size;
-      new_width = new_height * ratio;
-    }
-  else
+  /* The longest pixmap along the orientation shorter than the first one
+   * too large both ways, or the shortest one */
+  for (i = 0; icon_pixmap[i] != NULL; i++)
     {
-      new_width = (gdouble) size;
-      new_height = new_width * ratio;
+      SnPixmap *p = icon_pixmap[i];
+
+      if (sn_pixmap_get_width (p) > size && sn_pixmap_get_height (p) > size)
+        limit = MIN (limit, pixmap_length (p, orientation));
     }
 
-  scale_x = new_width / pixmap->width;
-  scale_y = new_height / pixmap->height;
+  for (i = 0; icon_pixmap[i] != NULL; i++)
+    {
+      SnPixmap *p = icon_pixmap[i];
+      gint length = pixmap_length (p, orientation);
 
-  width = ceil (new_width);
-  height = ceil (new_height);
+      if (smallest == NULL || length < pixmap_length (smallest, orientation))
+        smallest = p;
 
-  content = CAIRO_CONTENT_COLOR_ALPHA;
-  scaled = cairo_surface_create_similar (pixmap->surface, content, width, height);
-  cr = cairo_create (scaled);
+      if (length < limit &&
+          (pixmap == NULL || length >= pixmap_length (pixmap, orientation)))
+        pixmap = p;
+    }
 
-  cairo_scale (cr, scale_x, scale_y);
-  cairo_set_source_surface (cr, pixmap->surface, 0, 0);
-  cairo_paint (cr);
+  if (pixmap == NULL)
+    pixmap = smallest;
 
-  cairo_destroy (cr);
-  return scaled;
+  if (sn_pixmap_get_height (pixmap) > size || sn_pixmap_get_width (pixmap) > size)
+    return sn_pixmap_get_scaled (pixmap, orientation, size);
+  else
+    return cairo_surface_reference (sn_pixmap_get_surface (pixmap));
 }
 
-static gint
-compare_size (gconstpointer a,
-              gconstpointer b,
-              gpointer      user_data)
-{
-  SnIconPixmap *p1;
-  SnIconPixmap *p2;
-  GtkOrientation orientation;
+static void queue_update (SnItemV0 *v0);
 
-  p1 = (SnIconPixmap *) a;
-  p2 = (SnIconPixmap *) b;
-  orientation = GPOINTER_TO_UINT (user_data);
+static void
+icon_cache_changed_cb (SnIconCache *cache,
+                       const gchar *theme_path,
+                       gpointer     user_data)
+{
+  SnItemV0 *v0 = SN_ITEM_V0 (user_data);
 
-  if (orientation == GTK_ORIENTATION_HORIZONTAL)
-    return p1->height - p2->height;
-  else
-    return p1->width - p2->width;
+  if (g_strcmp0 (theme_path, v0->icon_theme_path ? v0->icon_theme_path : "") == 0)
+    queue_update (v0);
 }
 
-static cairo_surface_t *
-get_surface (SnIconPixmap  **icon_pixmap,
-             GtkOrientation  orientation,
-             gint            size)
+static void
+attach_icon_cache (SnItemV0    *v0,
+                   SnIconCache *cache)
 {
-  gint i;
-  GList *pixmaps = NULL;
-  SnIconPixmap *pixmap = NULL;
-  GList *l;
+  if (v0->icon_cache != NULL)
+    {
+      sn_icon_cache_remove_changed_func (v0->icon_cache, icon_cache_changed_cb, v0);
+      sn_icon_cache_unref_theme_path (v0->icon_cache, v0->icon_theme_path);
+      sn_icon_cache_unref (v0->icon_cache);
+    }
 
-  g_assert (icon_pixmap != NULL && icon_pixmap[0] != NULL);
+  v0->icon_cache = cache ? sn_icon_cache_ref (cache) : NULL;
 
-  for (i = 0; icon_pixmap[i] != NULL; i++)
-    pixmaps = g_list_prepend (pixmaps, icon_pixmap[i]);
+  if (v0->icon_cache != NULL)
+    {
+      sn_icon_cache_ref_theme_path (v0->icon_cache, v0->icon_theme_path);
+      sn_icon_cache_add_changed_func (v0->icon_cache, icon_cache_changed_cb, v0);
+    }
+}
 
-  pixmaps = g_list_sort_with_data (pixmaps, compare_size,
-                                   GUINT_TO_POINTER (orientation));
+static void
+set_icon_theme_path (SnItemV0    *v0,
+                     const gchar *icon_theme_path)
+{
+  if (g_strcmp0 (v0->icon_theme_path, icon_theme_path) == 0)
+    return;
 
-  pixmap = (SnIconPixmap *) pixmaps->data;
-  for (l = pixmaps; l != NULL; l = l->next)
+  /* The theme of the new path first, not to drop it if it is the same */
+  if (v0->icon_cache != NULL)
     {
-      SnIconPixmap *p = (SnIconPixmap *) l->data;
-
-      if (p->height > size && p->width > size)
-        {
-          break;
-        }
-      pixmap = p;
+      sn_icon_cache_ref_theme_path (v0->icon_cache, icon_theme_path);
+      sn_icon_cache_unref_theme_path (v0->icon_cache, v0->icon_theme_path);
     }
 
-  g_list_free (pixmaps);
-
-  if (pixmap == NULL || pixmap->surface == NULL)
-    return NULL;
-  else if (pixmap->height > size || pixmap->width > size)
-    return scale_surface (pixmap, orientation, size);
-  else
-    return cairo_surface_reference (pixmap->surface);
+  g_free (v0->icon_theme_path);
+  v0->icon_theme_path = g_strdup (icon_theme_path);
 }
 
 static cairo_surface_t *
-get_icon_by_name (const gchar *icon_name,
+get_icon_by_name (SnItemV0    *v0,
+                  const gchar *icon_name,
                   gint         requested_size,
                   gint         scale)
 {
-  GtkIconTheme *icon_theme;
-  gint *sizes;
-  gint i;
-  gint chosen_size = 0;
-
-  g_return_val_if_fail (icon_name != NULL && icon_name[0] != '\0', NULL);
-  g_return_val_if_fail (requested_size > 0, NULL);
-
-  icon_theme = gtk_icon_theme_get_default ();
-  gtk_icon_theme_rescan_if_needed (icon_theme);
-
-  sizes = gtk_icon_theme_get_icon_sizes (icon_theme, icon_name);
-  for (i = 0; sizes[i] != 0; i++)
+  /* Items not added by a host have a cache of their own */
+  if (v0->icon_cache == NULL)
     {
-      if (sizes[i] == requested_size ||
-          sizes[i] == -1) /* scalable */
-        {
-          /* perfect match, stop here */
-          chosen_size = requested_size;
-          break;
-        }
-      else if (sizes[i] < requested_size && sizes[i] > chosen_size)
-        chosen_size = sizes[i];
-    }
-  g_free (sizes);
+      SnIconCache *cache;
 
-  if (chosen_size == 0)
-    chosen_size = requested_size;
+      cache = sn_icon_cache_new ();
+      attach_icon_cache (v0, cache);
+      sn_icon_cache_unref (cache);
+    }
 
-  return gtk_icon_theme_load_surface (icon_theme, icon_name,
-                                      chosen_size, scale,
-                                      NULL, GTK_ICON_LOOKUP_FORCE_SIZE, NULL);
+  return sn_icon_cache_load (v0->icon_cache, v0->icon_theme_path,
+                             icon_name, requested_size, scale);
 }
 
 #define ICON_NAME_VALID(icon_name) (icon_name && icon_name[0] != '\0')
@@ -245,7 +248,7 @@ update (SnItemV0 *v0)
   SnTooltip *tip;
   gint icon_size;
   const gchar *icon_name;
-  SnIconPixmap **icon_pixmap;
+  SnPixmap **icon_pixmap;
 
   g_return_if_fail (SN_IS_ITEM_V0 (v0));
 
@@ -277,7 +280,7 @@ update (SnItemV0 *v0)
       gint scale;
 
       scale = gtk_widget_get_scale_factor (GTK_WIDGET (image));
-      surface = get_icon_by_name (icon_name, icon_size, scale);
+      surface = get_icon_by_name (v0, icon_name, icon_size, scale);
 
       if (!surface)
         {
@@ -301,7 +304,7 @@ update (SnItemV0 *v0)
       if (!surface)
         {
           /*deal with missing icon or failure to load icon*/
-          surface = get_icon_by_name ("image-missing", icon_size, scale);
+          surface = get_icon_by_name (v0, "image-missing", icon_size, scale);
         }
       gtk_image_set_from_surface (image, surface);
       cairo_surface_destroy (surface);
@@ -396,89 +399,7 @@ queue_update (SnItemV0 *v0)
   g_source_set_name_by_id (v0->update_id, "[status-notifier] update_cb");
 }
 
-static cairo_surface_t *
-surface_from_variant (GVariant *variant,
-                      gint      width,
-                      gint      height)
-{
-  cairo_format_t format;
-  gint stride;
-  guint32 *data;
-  gint x;
-  gint y;
-  guchar *p;
-
-  format = CAIRO_FORMAT_ARGB32;
-  stride = cairo_format_stride_for_width (format, width);
-  data = (guint32 *) g_variant_get_data (variant);
-
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-  {
-    gint i;
-
-    for (i = 0; i < width * height; i++)
-      data[i] = GUINT32_FROM_BE (data[i]);
-  }
-#endif
-
-  p = (guchar *) data;
-  /* premultiply alpha for Cairo */
-  for (y = 0; y < height; y++)
-    {
-      for (x = 0; x < width; x++)
-        {
-          guchar alpha = p[x * 4 + 3];
-
-          p[x * 4 + 0] = (p[x * 4 + 0] * alpha) / 255;
-          p[x * 4 + 1] = (p[x * 4 + 1] * alpha) / 255;
-          p[x * 4 + 2] = (p[x * 4 + 2] * alpha) / 255;
-        }
-
-      p += stride;
-    }
-
-  return cairo_image_surface_create_for_data ((guchar *) data, format,
-                                              width, height, stride);
-}
-
-static cairo_surface_t *
-icon_surface_new (GVariant *variant,
-                  gint      width,
-                  gint      height)
-{
-  cairo_surface_t *surface;
-  cairo_surface_t *tmp;
-  cairo_t *cr;
-
-  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
-  if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
-    return NULL;
-
-  tmp = surface_from_variant (variant, width, height);
-  if (cairo_surface_status (tmp) != CAIRO_STATUS_SUCCESS)
-    {
-      cairo_surface_destroy (surface);
-      return NULL;
-    }
-
-  cr = cairo_create (surface);
-  if (cairo_status (cr) != CAIRO_STATUS_SUCCESS)
-    {
-      cairo_surface_destroy (surface);
-      cairo_surface_destroy (tmp);
-      return NULL;
-    }
-
-  cairo_set_source_surface (cr, tmp, 0, 0);
-  cairo_paint (cr);
-
-  cairo_surface_destroy (tmp);
-  cairo_destroy (cr);
-
-  return surface;
-}
-
-static SnIconPixmap **
+static SnPixmap **
 icon_pixmap_new (GVariant *variant)
 {
   GPtrArray *array;
@@ -493,37 +414,22 @@ icon_pixmap_new (GVariant *variant)
   array = g_ptr_array_new ();
   while (g_variant_iter_next (&iter, "(ii@ay)", &width, &height, &value))
     {
-      cairo_surface_t *surface;
-
-      if (width == 0 || height == 0)
-        {
-          g_variant_unref (value);
-          continue;
-        }
+      SnPixmap *pixmap;
 
-      surface = icon_surface_new (value, width, height);
+      /* shared with the items sending the same pixels */
+      pixmap = sn_pixmap_get (value, width, height);
       g_variant_unref (value);
 
-      if (surface != NULL)
-        {
-          SnIconPixmap *pixmap;
-
-          pixmap = g_new0 (SnIconPixmap, 1);
-
-          pixmap->surface = surface;
-          pixmap->width = width;
-          pixmap->height = height;
-
-          g_ptr_array_add (array, pixmap);
-        }
+      if (pixmap != NULL)
+        g_ptr_array_add (array, pixmap);
     }
 
   g_ptr_array_add (array, NULL);
-  return (SnIconPixmap **) g_ptr_array_free (array, FALSE);
+  return (SnPixmap **) g_ptr_array_free (array, FALSE);
 }
 
 static void
-icon_pixmap_free (SnIconPixmap **data)
+icon_pixmap_free (SnPixmap **data)
 {
   gint i;
 
@@ -531,10 +437,7 @@ icon_pixmap_free (SnIconPixmap **data)
     return;
 
   for (i = 0; data[i] != NULL; i++)
-    {
-      cairo_surface_destroy (data[i]->surface);
-      g_free (data[i]);
-    }
+    sn_pixmap_unref (data[i]);
 
   g_free (data);
 }
@@ -588,275 +491,298 @@ sn_tooltip_free (SnTooltip *tooltip)
   g_free (tooltip);
 }
 
-static GVariant *
-get_property (GObject      *source_object,
-              GAsyncResult *res,
-              gpointer      user_data,
-              gboolean     *cancelled)
-{
-  GVariant *variant;
-  GError *error;
-  GVariant *property;
+static void
+refresh_cb (GObject      *source_object,
+            GAsyncResult *res,
+            gpointer      user_data);
 
-  error = NULL;
-  variant = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object),
-                                           res, &error);
+/* Logs the number of messages of the item every minute */
+static void
+update_stats (SnItemV0 *v0)
+{
+  gint64 now;
 
-  *cancelled = FALSE;
-  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-    {
-      *cancelled = TRUE;
-      g_error_free (error);
-      return NULL;
-    }
+  now = g_get_monotonic_time ();
 
-  if (g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS))
+  if (v0->stats_start == 0)
     {
-      g_error_free (error);
-      return NULL;
+      v0->stats_start = now;
+      return;
     }
 
-  if (error)
-    {
-      g_warning ("%s", error->message);
-      g_error_free (error);
-      return NULL;
-    }
+  if (now - v0->stats_start < 60 * G_USEC_PER_SEC)
+    return;
 
-  g_variant_get (variant, "(v)", &property);
-  g_variant_unref (variant);
+  g_debug ("%s: %u signals, %u property requests in the last minute",
+           v0->id ? v0->id : sn_item_get_bus_name (SN_ITEM (v0)),
+           v0->n_signals - v0->stats_signals,
+           v0->n_calls - v0->stats_calls);
 
-  return property;
+  v0->stats_start = now;
+  v0->stats_signals = v0->n_signals;
+  v0->stats_calls = v0->n_calls;
 }
 
-static void
-update_property (SnItemV0            *v0,
-                 const gchar         *property,
-                 GAsyncReadyCallback  callback)
+static gboolean
+refresh_timeout_cb (gpointer user_data)
 {
-  GDBusProxy *proxy;
+  SnItemV0 *v0;
   SnItem *item;
+  gint64 now;
 
-  proxy = G_DBUS_PROXY (v0->proxy);
+  v0 = SN_ITEM_V0 (user_data);
   item = SN_ITEM (v0);
 
-  g_dbus_connection_call (g_dbus_proxy_get_connection (proxy),
-                          sn_item_get_bus_name (item),
-                          sn_item_get_object_path (item),
-                          "org.freedesktop.DBus.Properties", "Get",
-                          g_variant_new ("(ss)", SN_ITEM_INTERFACE, property),
-                          G_VARIANT_TYPE ("(v)"),
-                          G_DBUS_CALL_FLAGS_NONE, -1,
-                          v0->cancellable, callback, v0);
-}
+  v0->refresh_id = 0;
 
-static void
-update_title (GObject      *source_object,
-              GAsyncResult *res,
-              gpointer      user_data)
-{
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
+  now = g_get_monotonic_time ();
+  if (now - v0->burst_start > G_USEC_PER_SEC)
+    {
+      v0->burst_start = now;
+      v0->burst_count = 0;
+    }
 
-  variant = get_property (source_object, res, user_data, &cancelled);
-  if (cancelled)
-    return;
+  v0->burst_count++;
+  v0->last_refresh = now;
 
-  v0 = SN_ITEM_V0 (user_data);
+  v0->refresh_running = v0->refresh_pending;
+  v0->refresh_pending = 0;
 
-  g_free (v0->title);
-  v0->title = g_variant_dup_string (variant, NULL);
-  g_clear_pointer (&variant, g_variant_unref);
+  v0->n_calls++;
+  update_stats (v0);
 
-  queue_update (v0);
-}
+  g_dbus_connection_call (g_dbus_proxy_get_connection (G_DBUS_PROXY (v0->proxy)),
+                          sn_item_get_bus_name (item),
+                          sn_item_get_object_path (item),
+                          "org.freedesktop.DBus.Properties", "GetAll",
+                          g_variant_new ("(s)", SN_ITEM_INTERFACE),
+                          G_VARIANT_TYPE ("(a{sv})"),
+                          G_DBUS_CALL_FLAGS_NONE, -1,
+                          v0->cancellable, refresh_cb, v0);
 
-static void
-new_title_cb (SnItemV0 *v0)
-{
-  update_property (v0, "Title", update_title);
+  return G_SOURCE_REMOVE;
 }
 
 static void
-update_icon_name (GObject      *source_object,
-                  GAsyncResult *res,
-                  gpointer      user_data)
+queue_refresh (SnItemV0   *v0,
+               SnProperty  property)
 {
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
+  gint64 delay;
 
-  variant = get_property (source_object, res, user_data, &cancelled);
-  if (cancelled)
-    return;
-
-  v0 = SN_ITEM_V0 (user_data);
-
-  g_free (v0->icon_name);
-  v0->icon_name = g_variant_dup_string (variant, NULL);
-  g_clear_pointer (&variant, g_variant_unref);
-
-  queue_update (v0);
-}
-
-static void
-update_icon_pixmap (GObject      *source_object,
-                    GAsyncResult *res,
-                    gpointer      user_data)
-{
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
+  v0->refresh_pending |= property;
 
-  variant = get_property (source_object, res, user_data, &cancelled);
-  if (cancelled)
+  /* Whatever comes while a refresh runs waits for the next one */
+  if (v0->refresh_id != 0 || v0->refresh_running != 0)
     return;
 
-  v0 = SN_ITEM_V0 (user_data);
-
-  g_clear_pointer (&v0->icon_pixmap, icon_pixmap_free);
-  v0->icon_pixmap = icon_pixmap_new (variant);
-  g_clear_pointer (&variant, g_variant_unref);
+  delay = SN_REFRESH_DELAY;
+  if (v0->burst_count >= SN_REFRESH_BURST &&
+      g_get_monotonic_time () - v0->burst_start <= G_USEC_PER_SEC)
+    {
+      gint64 wait;
 
-  queue_update (v0);
-}
+      /* Changing all the time, as an animation */
+      wait = (v0->last_refresh - g_get_monotonic_time ()) / 1000 +
+             SN_REFRESH_THROTTLE;
+      delay = MAX (delay, wait);
+    }
 
-static void
-new_icon_cb (SnItemV0 *v0)
-{
-  update_property (v0, "IconName", update_icon_name);
-  update_property (v0, "IconPixmap", update_icon_pixmap);
+  v0->refresh_id = g_timeout_add (delay, refresh_timeout_cb, v0);
+  g_source_set_name_by_id (v0->refresh_id, "[status-notifier] refresh_timeout_cb");
 }
 
-static void
-update_overlay_icon_name (GObject      *source_object,
-                          GAsyncResult *res,
-                          gpointer      user_data)
-{
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
-
-  variant = get_property (source_object, res, user_data, &cancelled);
-  if (cancelled)
-    return;
-
-  v0 = SN_ITEM_V0 (user_data);
-
-  g_free (v0->overlay_icon_name);
-  v0->overlay_icon_name = g_variant_dup_string (variant, NULL);
-  g_clear_pointer (&variant, g_variant_unref);
-
-  queue_update (v0);
+static SnProperty
+property_from_name (const gchar *name)
+{
+  if (g_strcmp0 (name, "Title") == 0)
+    return SN_PROPERTY_TITLE;
+  else if (g_strcmp0 (name, "IconName") == 0 ||
+           g_strcmp0 (name, "IconPixmap") == 0)
+    return SN_PROPERTY_ICON;
+  else if (g_strcmp0 (name, "OverlayIconName") == 0 ||
+           g_strcmp0 (name, "OverlayIconPixmap") == 0)
+    return SN_PROPERTY_OVERLAY_ICON;
+  else if (g_strcmp0 (name, "AttentionIconName") == 0 ||
+           g_strcmp0 (name, "AttentionIconPixmap") == 0)
+    return SN_PROPERTY_ATTENTION_ICON;
+  else if (g_strcmp0 (name, "ToolTip") == 0)
+    return SN_PROPERTY_TOOLTIP;
+
+  return 0;
 }
 
+/* Properties the item no longer has are missing from GetAll */
 static void
-update_overlay_icon_pixmap (GObject      *source_object,
-                            GAsyncResult *res,
-                            gpointer      user_data)
+clear_properties (SnItemV0 *v0,
+                  guint     properties)
 {
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
+  if (properties & SN_PROPERTY_TITLE)
+    g_clear_pointer (&v0->title, g_free);
 
-  variant = get_property (source_object, res, user_data, &cancelled);
-  if (cancelled)
-    return;
+  if (properties & SN_PROPERTY_ICON)
+    {
+      g_clear_pointer (&v0->icon_name, g_free);
+      g_clear_pointer (&v0->icon_pixmap, icon_pixmap_free);
+    }
 
-  v0 = SN_ITEM_V0 (user_data);
+  if (properties & SN_PROPERTY_OVERLAY_ICON)
+    {
+      g_clear_pointer (&v0->overlay_icon_name, g_free);
+      g_clear_pointer (&v0->overlay_icon_pixmap, icon_pixmap_free);
+    }
 
-  g_clear_pointer (&v0->overlay_icon_pixmap, icon_pixmap_free);
-  v0->overlay_icon_pixmap = icon_pixmap_new (variant);
-  g_clear_pointer (&variant, g_variant_unref);
+  if (properties & SN_PROPERTY_ATTENTION_ICON)
+    {
+      g_clear_pointer (&v0->attention_icon_name, g_free);
+      g_clear_pointer (&v0->attention_icon_pixmap, icon_pixmap_free);
+    }
 
-  queue_update (v0);
+  if (properties & SN_PROPERTY_TOOLTIP)
+    g_clear_pointer (&v0->tooltip, sn_tooltip_free);
 }
 
 static void
-new_overlay_icon_cb (SnItemV0 *v0)
+set_item_property (SnItemV0    *v0,
+                   const gchar *key,
+                   GVariant    *value)
 {
-  update_property (v0, "OverlayIconName", update_overlay_icon_name);
-  update_property (v0, "OverlayIconPixmap", update_overlay_icon_pixmap);
+  if (g_strcmp0 (key, "Category") == 0)
+    {
+      g_free (v0->category);
+      v0->category = g_variant_dup_string (value, NULL);
+    }
+  else if (g_strcmp0 (key, "Id") == 0)
+    {
+      g_free (v0->id);
+      v0->id = g_variant_dup_string (value, NULL);
+    }
+  else if (g_strcmp0 (key, "Title") == 0)
+    {
+      g_free (v0->title);
+      v0->title = g_variant_dup_string (value, NULL);
+    }
+  else if (g_strcmp0 (key, "Status") == 0)
+    {
+      g_free (v0->status);
+      v0->status = g_variant_dup_string (value, NULL);
+    }
+  else if (g_strcmp0 (key, "WindowId") == 0)
+    v0->window_id = g_variant_get_int32 (value);
+  else if (g_strcmp0 (key, "IconName") == 0)
+    {
+      g_free (v0->icon_name);
+      v0->icon_name = g_variant_dup_string (value, NULL);
+    }
+  else if (g_strcmp0 (key, "IconPixmap") == 0)
+    {
+      icon_pixmap_free (v0->icon_pixmap);
+      v0->icon_pixmap = icon_pixmap_new (value);
+    }
+  else if (g_strcmp0 (key, "OverlayIconName") == 0)
+    {
+      g_free (v0->overlay_icon_name);
+      v0->overlay_icon_name = g_variant_dup_string (value, NULL);
+    }
+  else if (g_strcmp0 (key, "OverlayIconPixmap") == 0)
+    {
+      icon_pixmap_free (v0->overlay_icon_pixmap);
+      v0->overlay_icon_pixmap = icon_pixmap_new (value);
+    }
+  else if (g_strcmp0 (key, "AttentionIconName") == 0)
+    {
+      g_free (v0->attention_icon_name);
+      v0->attention_icon_name = g_variant_dup_string (value, NULL);
+    }
+  else if (g_strcmp0 (key, "AttentionIconPixmap") == 0)
+    {
+      icon_pixmap_free (v0->attention_icon_pixmap);
+      v0->attention_icon_pixmap = icon_pixmap_new (value);
+    }
+  else if (g_strcmp0 (key, "AttentionMovieName") == 0)
+    {
+      g_free (v0->attention_movie_name);
+      v0->attention_movie_name = g_variant_dup_string (value, NULL);
+    }
+  else if (g_strcmp0 (key, "ToolTip") == 0)
+    {
+      sn_tooltip_free (v0->tooltip);
+      v0->tooltip = sn_tooltip_new (value);
+    }
+  else if (g_strcmp0 (key, "IconThemePath") == 0)
+    {
+      set_icon_theme_path (v0, g_variant_get_string (value, NULL));
+    }
+  else if (g_strcmp0 (key, "Menu") == 0)
+    {
+      g_free (v0->menu);
+      v0->menu = g_variant_dup_string (value, NULL);
+    }
+  else if (g_strcmp0 (key, "ItemIsMenu") == 0)
+    v0->item_is_menu = g_variant_get_boolean (value);
+  else if (g_strcmp0 (key, "XAyatanaLabel") == 0)
+    {
+      g_free (v0->label);
+      v0->label = g_variant_dup_string (value, NULL);
+    }
+  else
+    g_debug ("property '%s' not handled!", key);
 }
 
 static void
-update_attention_icon_name (GObject      *source_object,
-                            GAsyncResult *res,
-                            gpointer      user_data)
+refresh_cb (GObject      *source_object,
+            GAsyncResult *res,
+            gpointer      user_data)
 {
   SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
-
-  variant = get_property (source_object, res, user_data, &cancelled);
-  if (cancelled)
-    return;
-
-  v0 = SN_ITEM_V0 (user_data);
-
-  g_free (v0->attention_icon_name);
-  v0->attention_icon_name = g_variant_dup_string (variant, NULL);
-  g_clear_pointer (&variant, g_variant_unref);
-
-  queue_update (v0);
-}
+  GVariant *properties;
+  GError *error;
+  GVariantIter *iter;
+  gchar *key;
+  GVariant *value;
 
-static void
-update_attention_icon_pixmap (GObject      *source_object,
-                              GAsyncResult *res,
-                              gpointer      user_data)
-{
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
+  error = NULL;
+  properties = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object),
+                                              res, &error);
 
-  variant = get_property (source_object, res, user_data, &cancelled);
-  if (cancelled)
-    return;
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      g_error_free (error);
+      return;
+    }
 
   v0 = SN_ITEM_V0 (user_data);
 
-  icon_pixmap_free (v0->attention_icon_pixmap);
-  v0->attention_icon_pixmap = icon_pixmap_new (variant);
-  g_clear_pointer (&variant, g_variant_unref);
-
-  queue_update (v0);
-}
-
-static void
-new_attention_icon_cb (SnItemV0 *v0)
-{
-  update_property (v0, "AttentionIconName", update_attention_icon_name);
-  update_property (v0, "AttentionIconPixmap", update_attention_icon_pixmap);
-}
+  if (error)
+    {
+      g_warning ("%s", error->message);
+      g_error_free (error);
+    }
+  else
+    {
+      /* Only the properties announced, the others did not change and
+       * decoding pixmaps is not free */
+      clear_properties (v0, v0->refresh_running);
 
-static void
-update_tooltip (GObject      *source_object,
-                GAsyncResult *res,
-                gpointer      user_data)
-{
-  SnItemV0 *v0;
-  GVariant *variant;
-  gboolean cancelled;
+      g_variant_get (properties, "(a{sv})", &iter);
+      while (g_variant_iter_next (iter, "{sv}", &key, &value))
+        {
+          if (property_from_name (key) & v0->refresh_running)
+            set_item_property (v0, key, value);
 
-  variant = get_property (source_object, res, user_data, &cancelled);
-  if (cancelled)
-    return;
+          g_variant_unref (value);
+          g_free (key);
+        }
 
-  v0 = SN_ITEM_V0 (user_data);
+      g_variant_iter_free (iter);
+      g_variant_unref (properties);
 
-  sn_tooltip_free (v0->tooltip);
-  v0->tooltip = sn_tooltip_new (variant);
-  g_clear_pointer (&variant, g_variant_unref);
+      queue_update (v0);
+    }
 
-  queue_update (v0);
-}
+  v0->refresh_running = 0;
 
-static void
-new_tooltip_cb (SnItemV0 *v0)
-{
-  update_property (v0, "ToolTip", update_tooltip);
+  if (v0->refresh_pending != 0)
+    queue_refresh (v0, 0);
 }
 
 static void
@@ -897,19 +823,9 @@ new_icon_theme_path_cb (SnItemV0 *v0,
 
   variant = g_variant_get_child_value (parameters, 0);
 
-  g_free (v0->icon_theme_path);
-  v0->icon_theme_path = g_variant_dup_string (variant, NULL);
+  set_icon_theme_path (v0, g_variant_get_string (variant, NULL));
   g_variant_unref (variant);
 
-  if (v0->icon_theme_path != NULL)
-    {
-      GtkIconTheme *icon_theme;
-
-      icon_theme = gtk_icon_theme_get_default ();
-
-      gtk_icon_theme_append_search_path (icon_theme, v0->icon_theme_path);
-    }
-
   queue_update (v0);
 }
 
@@ -933,16 +849,19 @@ g_signal_cb (GDBusProxy *proxy,
              GVariant   *parameters,
              SnItemV0   *v0)
 {
+  v0->n_signals++;
+  update_stats (v0);
+
   if (g_strcmp0 (signal_name, "NewTitle") == 0)
-    new_title_cb (v0);
+    queue_refresh (v0, SN_PROPERTY_TITLE);
   else if (g_strcmp0 (signal_name, "NewIcon") == 0)
-    new_icon_cb (v0);
+    queue_refresh (v0, SN_PROPERTY_ICON);
   else if (g_strcmp0 (signal_name, "NewOverlayIcon") == 0)
-    new_overlay_icon_cb (v0);
+    queue_refresh (v0, SN_PROPERTY_OVERLAY_ICON);
   else if (g_strcmp0 (signal_name, "NewAttentionIcon") == 0)
-    new_attention_icon_cb (v0);
+    queue_refresh (v0, SN_PROPERTY_ATTENTION_ICON);
   else if (g_strcmp0 (signal_name, "NewToolTip") == 0)
-    new_tooltip_cb (v0);
+    queue_refresh (v0, SN_PROPERTY_TOOLTIP);
   else if (g_strcmp0 (signal_name, "NewStatus") == 0)
     new_status_cb (v0, parameters);
   else if (g_strcmp0 (signal_name, "NewIconThemePath") == 0)
@@ -987,42 +906,7 @@ get_all_cb (GObject      *source_object,
   g_variant_get (properties, "(a{sv})", &iter);
   while (g_variant_iter_next (iter, "{sv}", &key, &value))
     {
-      if (g_strcmp0 (key, "Category") == 0)
-        v0->category = g_variant_dup_string (value, NULL);
-      else if (g_strcmp0 (key, "Id") == 0)
-        v0->id = g_variant_dup_string (value, NULL);
-      else if (g_strcmp0 (key, "Title") == 0)
-        v0->title = g_variant_dup_string (value, NULL);
-      else if (g_strcmp0 (key, "Status") == 0)
-        v0->status = g_variant_dup_string (value, NULL);
-      else if (g_strcmp0 (key, "WindowId") == 0)
-        v0->window_id = g_variant_get_int32 (value);
-      else if (g_strcmp0 (key, "IconName") == 0)
-        v0->icon_name = g_variant_dup_string (value, NULL);
-      else if (g_strcmp0 (key, "IconPixmap") == 0)
-        v0->icon_pixmap = icon_pixmap_new (value);
-      else if (g_strcmp0 (key, "OverlayIconName") == 0)
-        v0->overlay_icon_name = g_variant_dup_string (value, NULL);
-      else if (g_strcmp0 (key, "OverlayIconPixmap") == 0)
-        v0->overlay_icon_pixmap = icon_pixmap_new (value);
-      else if (g_strcmp0 (key, "AttentionIconName") == 0)
-        v0->attention_icon_name = g_variant_dup_string (value, NULL);
-      else if (g_strcmp0 (key, "AttentionIconPixmap") == 0)
-        v0->attention_icon_pixmap = icon_pixmap_new (value);
-      else if (g_strcmp0 (key, "AttentionMovieName") == 0)
-        v0->attention_movie_name = g_variant_dup_string (value, NULL);
-      else if (g_strcmp0 (key, "ToolTip") == 0)
-        v0->tooltip = sn_tooltip_new (value);
-      else if (g_strcmp0 (key, "IconThemePath") == 0)
-        v0->icon_theme_path = g_variant_dup_string (value, NULL);
-      else if (g_strcmp0 (key, "Menu") == 0)
-        v0->menu = g_variant_dup_string (value, NULL);
-      else if (g_strcmp0 (key, "ItemIsMenu") == 0)
-        v0->item_is_menu = g_variant_get_boolean (value);
-      else if (g_strcmp0 (key, "XAyatanaLabel") == 0)
-        v0->label = g_variant_dup_string (value, NULL);
-      else
-        g_debug ("property '%s' not handled!", key);
+      set_item_property (v0, key, value);
 
       g_variant_unref (value);
       g_free (key);
@@ -1047,15 +931,6 @@ get_all_cb (GObject      *source_object,
       return;
     }
 
-  if (v0->icon_theme_path != NULL)
-    {
-      GtkIconTheme *icon_theme;
-
-      icon_theme = gtk_icon_theme_get_default ();
-
-      gtk_icon_theme_append_search_path (icon_theme, v0->icon_theme_path);
-    }
-
   g_signal_connect (v0->proxy, "g-properties-changed",
                     G_CALLBACK (g_properties_changed_cb), v0);
 
@@ -1141,6 +1016,12 @@ sn_item_v0_dispose (GObject *object)
       v0->update_id = 0;
     }
 
+  if (v0->refresh_id != 0)
+    {
+      g_source_remove (v0->refresh_id);
+      v0->refresh_id = 0;
+    }
+
   G_OBJECT_CLASS (sn_item_v0_parent_class)->dispose (object);
 }
 
@@ -1165,6 +1046,7 @@ sn_item_v0_finalize (GObject *object)
   g_clear_pointer (&v0->attention_icon_pixmap, icon_pixmap_free);
   g_clear_pointer (&v0->attention_movie_name, g_free);
   g_clear_pointer (&v0->tooltip, sn_tooltip_free);
+  attach_icon_cache (v0, NULL);
   g_clear_pointer (&v0->icon_theme_path, g_free);
   g_clear_pointer (&v0->menu, g_free);
 
@@ -1518,3 +1400,15 @@ sn_item_v0_set_icon_size (SnItemV0 *v0,
         queue_update (v0);
     }
 }
+
+void
+sn_item_v0_set_icon_cache (SnItemV0    *v0,
+                           SnIconCache *cache)
+{
+  if (v0->icon_cache == cache)
+    return;
+
+  attach_icon_cache (v0, cache);
+
+  queue_update (v0);
+}
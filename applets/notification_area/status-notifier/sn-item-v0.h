@@ -18,6 +18,7 @@
 #ifndef SN_ITEM_V0_H
 #define SN_ITEM_V0_H
 
+#include "sn-icon-cache.h"
 #include "sn-item.h"
 
 G_BEGIN_DECLS
@@ -46,6 +47,9 @@ gint sn_item_v0_get_icon_size (SnItemV0 *v0);
 void sn_item_v0_set_icon_size (SnItemV0 *v0,
                                gint size);
 
+void sn_item_v0_set_icon_cache (SnItemV0    *v0,
+                                SnIconCache *cache);
+
 G_END_DECLS
 
 #endif
@@ -0,0 +1,431 @@
+/*
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Items re-send their whole IconPixmap on every NewIcon signal, most of the
+ * time with pixels already seen: the same icon, or one of the few frames
+ * of a blinking one. Decoded pixmaps are kept by content, with their
+ * scaled versions, and shared by all the items. Pixmaps no longer used by
+ * any item stay around for a while, in case they come back.
+ */
+
+#include <config.h>
+
+#include <math.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "sn-pixmap.h"
+
+#define SN_PIXMAP_MAX_UNUSED 32
+#define SN_PIXMAP_MAX_SCALED 4
+
+typedef struct
+{
+  GtkOrientation   orientation;
+  gint             size;
+  cairo_surface_t *surface;
+} SnScaledPixmap;
+
+struct _SnPixmap
+{
+  gint             ref_count;
+
+  guint            hash;
+  gint             width;
+  gint             height;
+  /* as received, to tell hash collisions apart */
+  guchar          *data;
+  gsize            size;
+
+  cairo_surface_t *surface;
+  GSList          *scaled;
+
+  /* in the unused queue, when no item uses it */
+  GList           *unused_link;
+};
+
+static GHashTable *pixmaps = NULL;
+static GQueue      unused = G_QUEUE_INIT;
+
+static guint       cache_hits = 0;
+static guint       cache_misses = 0;
+
+static guint
+pixmap_hash (gconstpointer key)
+{
+  return ((const SnPixmap *) key)->hash;
+}
+
+static gboolean
+pixmap_equal (gconstpointer a,
+              gconstpointer b)
+{
+  const SnPixmap *p1 = a;
+  const SnPixmap *p2 = b;
+
+  return p1->hash == p2->hash &&
+         p1->width == p2->width &&
+         p1->height == p2->height &&
+         p1->size == p2->size &&
+         memcmp (p1->data, p2->data, p1->size) == 0;
+}
+
+static guint
+hash_data (const guchar *data,
+           gsize         size)
+{
+  guint64 hash = G_GUINT64_CONSTANT (0xcbf29ce484222325);
+  gsize i;
+
+  /* FNV-1a, a word at a time */
+  for (i = 0; i + 8 <= size; i += 8)
+    {
+      guint64 word;
+
+      memcpy (&word, data + i, sizeof (word));
+      hash = (hash ^ word) * G_GUINT64_CONSTANT (0x100000001b3);
+      hash ^= hash >> 29;
+    }
+
+  for (; i < size; i++)
+    hash = (hash ^ data[i]) * G_GUINT64_CONSTANT (0x100000001b3);
+
+  return (guint) (hash ^ (hash >> 32));
+}
+
+void
+sn_pixmap_convert (const guchar *src,
+                   guint32      *dst,
+                   gint          n_pixels)
+{
+  gint i = 0;
+
+#ifdef __SSE2__
+  {
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i one = _mm_set1_epi16 (1);
+    /* The alpha of every pixel, first of its four channels */
+    const __m128i alpha_mask = _mm_set_epi16 (0, 0, 0, -1, 0, 0, 0, -1);
+
+    /* Four pixels at a time, two in each half: premultiplied in 16 bits,
+     * then the channels of each pixel reversed, from big-endian ARGB to
+     * native, little-endian, ARGB */
+    for (; i + 4 <= n_pixels; i += 4)
+      {
+        __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i * 4));
+        __m128i halves[2];
+        gint h;
+
+        halves[0] = _mm_unpacklo_epi8 (v, zero);
+        halves[1] = _mm_unpackhi_epi8 (v, zero);
+
+        for (h = 0; h < 2; h++)
+          {
+            __m128i x = halves[h];
+            __m128i a;
+            __m128i p;
+
+            a = _mm_shufflelo_epi16 (x, _MM_SHUFFLE (0, 0, 0, 0));
+            a = _mm_shufflehi_epi16 (a, _MM_SHUFFLE (0, 0, 0, 0));
+
+            p = _mm_mullo_epi16 (x, a);
+            p = _mm_srli_epi16 (_mm_add_epi16 (_mm_add_epi16 (p, one),
+                                               _mm_srli_epi16 (p, 8)), 8);
+            p = _mm_or_si128 (_mm_andnot_si128 (alpha_mask, p),
+                              _mm_and_si128 (alpha_mask, x));
+
+            p = _mm_shufflelo_epi16 (p, _MM_SHUFFLE (0, 1, 2, 3));
+            halves[h] = _mm_shufflehi_epi16 (p, _MM_SHUFFLE (0, 1, 2, 3));
+          }
+
+        _mm_storeu_si128 ((__m128i *) (dst + i),
+                          _mm_packus_epi16 (halves[0], halves[1]));
+      }
+  }
+#endif
+
+  /* Dividing by 255 as (x + 1 + (x >> 8)) >> 8, exact for products of two
+   * bytes, as above */
+  for (; i < n_pixels; i++)
+    {
+      guint32 a = src[i * 4 + 0];
+      guint32 r = src[i * 4 + 1] * a;
+      guint32 g = src[i * 4 + 2] * a;
+      guint32 b = src[i * 4 + 3] * a;
+
+      r = (r + 1 + (r >> 8)) >> 8;
+      g = (g + 1 + (g >> 8)) >> 8;
+      b = (b + 1 + (b >> 8)) >> 8;
+
+      dst[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+static cairo_surface_t *
+decode (const guchar *data,
+        gint          width,
+        gint          height)
+{
+  cairo_surface_t *surface;
+  guchar *pixels;
+  gint stride;
+  gint y;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+    {
+      cairo_surface_destroy (surface);
+      return NULL;
+    }
+
+  cairo_surface_flush (surface);
+  pixels = cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
+
+  for (y = 0; y < height; y++)
+    sn_pixmap_convert (data + (gsize) y * width * 4,
+                       (guint32 *) (gpointer) (pixels + (gsize) y * stride),
+                       width);
+
+  cairo_surface_mark_dirty (surface);
+
+  return surface;
+}
+
+static void
+scaled_pixmap_free (gpointer data)
+{
+  SnScaledPixmap *scaled = data;
+
+  cairo_surface_destroy (scaled->surface);
+  g_free (scaled);
+}
+
+static void
+pixmap_free (SnPixmap *pixmap)
+{
+  g_slist_free_full (pixmap->scaled, scaled_pixmap_free);
+  cairo_surface_destroy (pixmap->surface);
+  g_free (pixmap->data);
+  g_free (pixmap);
+}
+
+SnPixmap *
+sn_pixmap_get (GVariant *data,
+               gint      width,
+               gint      height)
+{
+  SnPixmap key;
+  SnPixmap *pixmap;
+  gsize size;
+
+  g_return_val_if_fail (data != NULL, NULL);
+
+  if (width <= 0 || height <= 0 || width > G_MAXINT / 4 / height)
+    return NULL;
+
+  size = (gsize) width * height * 4;
+  if (g_variant_get_size (data) < size)
+    return NULL;
+
+  if (pixmaps == NULL)
+    pixmaps = g_hash_table_new (pixmap_hash, pixmap_equal);
+
+  key.data = (guchar *) g_variant_get_data (data);
+  key.size = size;
+  key.width = width;
+  key.height = height;
+  key.hash = hash_data (key.data, size) ^ (guint) (width * 31 + height);
+
+  pixmap = g_hash_table_lookup (pixmaps, &key);
+  if (pixmap != NULL)
+    {
+      cache_hits++;
+      return sn_pixmap_ref (pixmap);
+    }
+
+  cache_misses++;
+
+  pixmap = g_new0 (SnPixmap, 1);
+  pixmap->ref_count = 1;
+  pixmap->hash = key.hash;
+  pixmap->width = width;
+  pixmap->height = height;
+  pixmap->size = size;
+
+  pixmap->surface = decode (key.data, width, height);
+  if (pixmap->surface == NULL)
+    {
+      g_free (pixmap);
+      return NULL;
+    }
+
+  pixmap->data = g_malloc (size);
+  memcpy (pixmap->data, key.data, size);
+
+  g_hash_table_add (pixmaps, pixmap);
+
+  return pixmap;
+}
+
+SnPixmap *
+sn_pixmap_ref (SnPixmap *pixmap)
+{
+  if (pixmap->ref_count++ == 0)
+    {
+      g_queue_delete_link (&unused, pixmap->unused_link);
+      pixmap->unused_link = NULL;
+    }
+
+  return pixmap;
+}
+
+void
+sn_pixmap_unref (SnPixmap *pixmap)
+{
+  if (pixmap == NULL || --pixmap->ref_count > 0)
+    return;
+
+  g_queue_push_head (&unused, pixmap);
+  pixmap->unused_link = unused.head;
+
+  if (unused.length > SN_PIXMAP_MAX_UNUSED)
+    {
+      SnPixmap *oldest;
+
+      oldest = g_queue_pop_tail (&unused);
+      g_hash_table_remove (pixmaps, oldest);
+      pixmap_free (oldest);
+    }
+}
+
+gint
+sn_pixmap_get_width (SnPixmap *pixmap)
+{
+  return pixmap->width;
+}
+
+gint
+sn_pixmap_get_height (SnPixmap *pixmap)
+{
+  return pixmap->height;
+}
+
+cairo_surface_t *
+sn_pixmap_get_surface (SnPixmap *pixmap)
+{
+  return pixmap->surface;
+}
+
+static cairo_surface_t *
+scale_surface (SnPixmap       *pixmap,
+               GtkOrientation  orientation,
+               gint            size)
+{
+  gdouble ratio;
+  gdouble new_width;
+  gdouble new_height;
+  gdouble scale_x;
+  gdouble scale_y;
+  gint width;
+  gint height;
+  cairo_content_t content;
+  cairo_surface_t *scaled;
+  cairo_t *cr;
+
+  ratio = pixmap->width / (gdouble) pixmap->height;
+  if (orientation == GTK_ORIENTATION_HORIZONTAL)
+    {
+      new_height = (gdouble) size;
+      new_width = new_height * ratio;
+    }
+  else
+    {
+      new_width = (gdouble) size;
+      new_height = new_width * ratio;
+    }
+
+  scale_x = new_width / pixmap->width;
+  scale_y = new_height / pixmap->height;
+
+  width = ceil (new_width);
+  height = ceil (new_height);
+
+  content = CAIRO_CONTENT_COLOR_ALPHA;
+  scaled = cairo_surface_create_similar (pixmap->surface, content, width, height);
+  cr = cairo_create (scaled);
+
+  cairo_scale (cr, scale_x, scale_y);
+  cairo_set_source_surface (cr, pixmap->surface, 0, 0);
+  cairo_paint (cr);
+
+  cairo_destroy (cr);
+  return scaled;
+}
+
+cairo_surface_t *
+sn_pixmap_get_scaled (SnPixmap       *pixmap,
+                      GtkOrientation  orientation,
+                      gint            size)
+{
+  SnScaledPixmap *scaled;
+  GSList *l;
+
+  for (l = pixmap->scaled; l != NULL; l = l->next)
+    {
+      scaled = l->data;
+
+      if (scaled->orientation == orientation && scaled->size == size)
+        return cairo_surface_reference (scaled->surface);
+    }
+
+  scaled = g_new0 (SnScaledPixmap, 1);
+  scaled->orientation = orientation;
+  scaled->size = size;
+  scaled->surface = scale_surface (pixmap, orientation, size);
+
+  pixmap->scaled = g_slist_prepend (pixmap->scaled, scaled);
+
+  /* Sizes only change when the panel does */
+  l = g_slist_nth (pixmap->scaled, SN_PIXMAP_MAX_SCALED - 1);
+  if (l != NULL && l->next != NULL)
+    {
+      g_slist_free_full (l->next, scaled_pixmap_free);
+      l->next = NULL;
+    }
+
+  return cairo_surface_reference (scaled->surface);
+}
+
+void
+sn_pixmap_get_counters (guint *n_pixmaps,
+                        guint *n_hits,
+                        guint *n_misses)
+{
+  if (n_pixmaps)
+    *n_pixmaps = pixmaps ? g_hash_table_size (pixmaps) : 0;
+
+  if (n_hits)
+    *n_hits = cache_hits;
+
+  if (n_misses)
+    *n_misses = cache_misses;
+}
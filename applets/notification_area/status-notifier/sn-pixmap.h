@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SN_PIXMAP_H
+#define SN_PIXMAP_H
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+typedef struct _SnPixmap SnPixmap;
+
+/* Decoded IconPixmap data, shared by all the items sending the same
+ * pixels. Returns NULL if @data is too short for the size. */
+SnPixmap        *sn_pixmap_get          (GVariant       *data,
+                                         gint            width,
+                                         gint            height);
+
+SnPixmap        *sn_pixmap_ref          (SnPixmap       *pixmap);
+void             sn_pixmap_unref        (SnPixmap       *pixmap);
+
+gint             sn_pixmap_get_width    (SnPixmap       *pixmap);
+gint             sn_pixmap_get_height   (SnPixmap       *pixmap);
+cairo_surface_t *sn_pixmap_get_surface  (SnPixmap       *pixmap);
+
+/* The pixmap scaled down to @size along @orientation, kept with it */
+cairo_surface_t *sn_pixmap_get_scaled   (SnPixmap       *pixmap,
+                                         GtkOrientation  orientation,
+                                         gint            size);
+
+/* Big-endian ARGB, as sent on the bus, to premultiplied native ARGB */
+void             sn_pixmap_convert      (const guchar   *src,
+                                         guint32        *dst,
+                                         gint            n_pixels);
+
+void             sn_pixmap_get_counters (guint          *n_pixmaps,
+                                         guint          *n_hits,
+                                         guint          *n_misses);
+
+G_END_DECLS
+
+#endif
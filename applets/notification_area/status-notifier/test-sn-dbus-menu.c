@@ -0,0 +1,612 @@
+/*
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Test for the dbusmenu menus, against a menu served by a thread of its own
+ * that takes its time to answer, as a busy application would.
+ *
+ * Needs a session bus and a display, run it with dbus-run-session and, if
+ * there is no display, xvfb-run.
+ */
+
+#include <string.h>
+
+#include "sn-dbus-menu.h"
+#include "sn-dbus-menu-gen.h"
+
+#define MENU_OBJECT_PATH "/MenuBar"
+
+/* The last item of the menu has a submenu */
+#define SUBMENU_ID 1000
+#define SUBMENU_ITEMS 5
+
+typedef struct
+{
+  GThread         *thread;
+  GMainContext    *context;
+  GMainLoop       *loop;
+  GDBusConnection *connection;
+  SnDBusMenuGen   *skeleton;
+
+  GMutex           mutex;
+  GCond            cond;
+  gboolean         ready;
+
+  guint            n_items;
+
+  /* Changed by the test while the server runs */
+  gint             delay;
+  gint             revision;
+  gint             served_revision;
+  gint             sub_revision;
+  gint             last_parent;
+
+  gint             n_opened;
+  gint             n_closed;
+  gint             n_clicked;
+  gint             n_layouts;
+} FakeServer;
+
+static gint64 last_beat;
+static gint64 longest_stall;
+
+static void
+server_wait (FakeServer *server)
+{
+  gint delay;
+
+  delay = g_atomic_int_get (&server->delay);
+  if (delay > 0)
+    g_usleep ((gulong) delay * 1000);
+}
+
+static GVariant *
+make_item (gint         id,
+           const gchar *label,
+           gboolean     submenu,
+           GPtrArray   *children)
+{
+  GVariantBuilder props;
+  GVariant *items;
+
+  g_variant_builder_init (&props, G_VARIANT_TYPE ("a{sv}"));
+
+  if (label != NULL)
+    g_variant_builder_add (&props, "{sv}", "label", g_variant_new_string (label));
+
+  if (submenu)
+    g_variant_builder_add (&props, "{sv}", "children-display",
+                           g_variant_new_string ("submenu"));
+
+  if (children != NULL)
+    items = g_variant_new_array (G_VARIANT_TYPE_VARIANT,
+                                 (GVariant **) children->pdata, children->len);
+  else
+    items = g_variant_new_array (G_VARIANT_TYPE_VARIANT, NULL, 0);
+
+  return g_variant_new ("(i@a{sv}@av)", id, g_variant_builder_end (&props), items);
+}
+
+static GVariant *
+make_submenu (FakeServer *server)
+{
+  GPtrArray *children;
+  GVariant *layout;
+  gint revision;
+  guint i;
+
+  children = g_ptr_array_new ();
+  revision = g_atomic_int_get (&server->sub_revision);
+
+  for (i = 1; i <= SUBMENU_ITEMS; i++)
+    {
+      gchar *label;
+
+      label = g_strdup_printf ("Sub %u (%d)", i, revision);
+      g_ptr_array_add (children,
+                       g_variant_new_variant (make_item (SUBMENU_ID + i, label,
+                                                         FALSE, NULL)));
+      g_free (label);
+    }
+
+  layout = make_item (SUBMENU_ID, "Submenu", TRUE, children);
+  g_ptr_array_free (children, TRUE);
+
+  return layout;
+}
+
+/* Items labelled after the revision, so that the test sees the updates */
+static GVariant *
+make_layout (FakeServer *server,
+             gint        revision)
+{
+  GPtrArray *children;
+  GVariant *layout;
+  guint i;
+
+  children = g_ptr_array_new ();
+
+  for (i = 1; i <= server->n_items; i++)
+    {
+      gchar *label;
+
+      label = g_strdup_printf ("Item %u (%d)", i, revision);
+      g_ptr_array_add (children,
+                       g_variant_new_variant (make_item (i, label, FALSE, NULL)));
+      g_free (label);
+    }
+
+  g_ptr_array_add (children, g_variant_new_variant (make_submenu (server)));
+
+  layout = make_item (0, NULL, TRUE, children);
+  g_ptr_array_free (children, TRUE);
+
+  return layout;
+}
+
+static gboolean
+handle_get_layout (SnDBusMenuGen         *skeleton,
+                   GDBusMethodInvocation *invocation,
+                   gint                   parent_id,
+                   gint                   depth,
+                   const gchar * const   *property_names,
+                   FakeServer            *server)
+{
+  gint revision;
+
+  server_wait (server);
+
+  revision = g_atomic_int_get (&server->revision);
+  g_atomic_int_set (&server->last_parent, parent_id);
+  g_atomic_int_inc (&server->n_layouts);
+
+  if (parent_id == SUBMENU_ID)
+    {
+      sn_dbus_menu_gen_complete_get_layout (skeleton, invocation, revision,
+                                            make_submenu (server));
+      return TRUE;
+    }
+
+  g_atomic_int_set (&server->served_revision, revision);
+  sn_dbus_menu_gen_complete_get_layout (skeleton, invocation, revision,
+                                        make_layout (server, revision));
+
+  return TRUE;
+}
+
+static gboolean
+handle_event (SnDBusMenuGen         *skeleton,
+              GDBusMethodInvocation *invocation,
+              gint                   id,
+              const gchar           *event_id,
+              GVariant              *data,
+              guint                  timestamp,
+              FakeServer            *server)
+{
+  server_wait (server);
+
+  if (g_strcmp0 (event_id, "opened") == 0)
+    g_atomic_int_inc (&server->n_opened);
+  else if (g_strcmp0 (event_id, "closed") == 0)
+    g_atomic_int_inc (&server->n_closed);
+  else if (g_strcmp0 (event_id, "clicked") == 0)
+    g_atomic_int_inc (&server->n_clicked);
+
+  sn_dbus_menu_gen_complete_event (skeleton, invocation);
+
+  return TRUE;
+}
+
+static gboolean
+handle_about_to_show (SnDBusMenuGen         *skeleton,
+                      GDBusMethodInvocation *invocation,
+                      gint                   id,
+                      FakeServer            *server)
+{
+  gboolean need_update;
+
+  server_wait (server);
+
+  need_update = g_atomic_int_get (&server->revision) !=
+                g_atomic_int_get (&server->served_revision);
+
+  sn_dbus_menu_gen_complete_about_to_show (skeleton, invocation, need_update);
+
+  return TRUE;
+}
+
+static gboolean
+emit_submenu_updated (gpointer data)
+{
+  FakeServer *server;
+
+  server = data;
+  g_atomic_int_inc (&server->sub_revision);
+
+  /* Applications tend to send a few of them in a row */
+  sn_dbus_menu_gen_emit_layout_updated (server->skeleton, 0, SUBMENU_ID);
+  sn_dbus_menu_gen_emit_layout_updated (server->skeleton, 0, SUBMENU_ID);
+  sn_dbus_menu_gen_emit_layout_updated (server->skeleton, 0, SUBMENU_ID);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+emit_label_updated (gpointer data)
+{
+  FakeServer *server;
+  GVariantBuilder updated;
+  GVariantBuilder props;
+
+  server = data;
+
+  g_variant_builder_init (&props, G_VARIANT_TYPE ("a{sv}"));
+  g_variant_builder_add (&props, "{sv}", "label",
+                         g_variant_new_string ("Item 1 (renamed)"));
+
+  g_variant_builder_init (&updated, G_VARIANT_TYPE ("a(ia{sv})"));
+  g_variant_builder_add (&updated, "(i@a{sv})", 1, g_variant_builder_end (&props));
+
+  sn_dbus_menu_gen_emit_items_properties_updated (server->skeleton,
+                                                  g_variant_builder_end (&updated),
+                                                  g_variant_new_array (G_VARIANT_TYPE ("(ias)"),
+                                                                       NULL, 0));
+
+  return G_SOURCE_REMOVE;
+}
+
+static gpointer
+server_thread (gpointer data)
+{
+  FakeServer *server;
+  gchar *address;
+  GError *error;
+
+  server = data;
+  g_main_context_push_thread_default (server->context);
+
+  /* A connection of its own, as the application would have */
+  error = NULL;
+  address = g_dbus_address_get_for_bus_sync (G_BUS_TYPE_SESSION, NULL, &error);
+  if (address != NULL)
+    server->connection =
+      g_dbus_connection_new_for_address_sync (address,
+                                              G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                              G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                              NULL, NULL, &error);
+  g_free (address);
+
+  if (server->connection != NULL)
+    {
+      server->skeleton = sn_dbus_menu_gen_skeleton_new ();
+
+      g_signal_connect (server->skeleton, "handle-get-layout",
+                        G_CALLBACK (handle_get_layout), server);
+      g_signal_connect (server->skeleton, "handle-event",
+                        G_CALLBACK (handle_event), server);
+      g_signal_connect (server->skeleton, "handle-about-to-show",
+                        G_CALLBACK (handle_about_to_show), server);
+
+      g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (server->skeleton),
+                                        server->connection, MENU_OBJECT_PATH,
+                                        &error);
+    }
+
+  if (error != NULL)
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_clear_object (&server->skeleton);
+      g_clear_object (&server->connection);
+    }
+
+  g_mutex_lock (&server->mutex);
+  server->ready = TRUE;
+  g_cond_signal (&server->cond);
+  g_mutex_unlock (&server->mutex);
+
+  if (server->connection != NULL)
+    {
+      g_main_loop_run (server->loop);
+
+      g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (server->skeleton));
+      g_object_unref (server->skeleton);
+      g_dbus_connection_close_sync (server->connection, NULL, NULL);
+      g_object_unref (server->connection);
+    }
+
+  g_main_context_pop_thread_default (server->context);
+
+  return NULL;
+}
+
+static FakeServer *
+server_start (guint n_items)
+{
+  FakeServer *server;
+
+  server = g_new0 (FakeServer, 1);
+  server->n_items = n_items;
+  server->context = g_main_context_new ();
+  server->loop = g_main_loop_new (server->context, FALSE);
+  g_mutex_init (&server->mutex);
+  g_cond_init (&server->cond);
+
+  server->thread = g_thread_new ("fake-menu-server", server_thread, server);
+
+  g_mutex_lock (&server->mutex);
+  while (!server->ready)
+    g_cond_wait (&server->cond, &server->mutex);
+  g_mutex_unlock (&server->mutex);
+
+  return server;
+}
+
+static gboolean
+quit_cb (gpointer data)
+{
+  g_main_loop_quit (data);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+server_stop (FakeServer *server)
+{
+  g_main_context_invoke (server->context, quit_cb, server->loop);
+  g_thread_join (server->thread);
+
+  g_main_loop_unref (server->loop);
+  g_main_context_unref (server->context);
+  g_mutex_clear (&server->mutex);
+  g_cond_clear (&server->cond);
+  g_free (server);
+}
+
+static gboolean
+heartbeat (gpointer data)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  if (last_beat)
+    longest_stall = MAX (longest_stall, now - last_beat);
+  last_beat = now;
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+run_for (guint milliseconds)
+{
+  gint64 deadline = g_get_monotonic_time () + (gint64) milliseconds * 1000;
+
+  while (g_get_monotonic_time () < deadline)
+    g_main_context_iteration (NULL, FALSE);
+}
+
+static GtkWidget *
+get_item (GtkMenu *menu,
+          guint    n)
+{
+  GList *children;
+  GtkWidget *item;
+
+  children = gtk_container_get_children (GTK_CONTAINER (menu));
+  item = g_list_nth_data (children, n);
+  g_list_free (children);
+
+  return item;
+}
+
+static GtkMenu *
+get_submenu (GtkMenu *menu)
+{
+  GList *children;
+  GList *last;
+  GtkWidget *submenu;
+
+  children = gtk_container_get_children (GTK_CONTAINER (menu));
+  last = g_list_last (children);
+  submenu = last ? gtk_menu_item_get_submenu (GTK_MENU_ITEM (last->data)) : NULL;
+  g_list_free (children);
+
+  return submenu ? GTK_MENU (submenu) : NULL;
+}
+
+static gboolean
+has_label (GtkWidget   *item,
+           const gchar *label)
+{
+  return item != NULL &&
+         g_strcmp0 (gtk_menu_item_get_label (GTK_MENU_ITEM (item)), label) == 0;
+}
+
+static gboolean
+wait_label (GtkMenu     *menu,
+            const gchar *label,
+            guint        seconds)
+{
+  gint64 deadline = g_get_monotonic_time () + (gint64) seconds * G_USEC_PER_SEC;
+
+  while (!has_label (get_item (menu, 0), label) &&
+         g_get_monotonic_time () < deadline)
+    g_main_context_iteration (NULL, FALSE);
+
+  return has_label (get_item (menu, 0), label);
+}
+
+static FakeServer *server;
+static GtkMenu    *menu;
+static gint        delay = 1000;
+
+/* The layout is fetched before the menu is shown */
+static void
+test_layout (void)
+{
+  g_assert_true (wait_label (menu, "Item 1 (0)", 5));
+}
+
+/* Updates of a part of the menu only fetch and rebuild that part */
+static void
+test_updates (void)
+{
+  GtkWidget *item;
+  GtkWidget *sub_item;
+  gint n_layouts;
+
+  item = get_item (menu, 0);
+  g_object_add_weak_pointer (G_OBJECT (item), (gpointer *) &item);
+
+  sub_item = get_item (get_submenu (menu), 0);
+  g_object_add_weak_pointer (G_OBJECT (sub_item), (gpointer *) &sub_item);
+
+  n_layouts = g_atomic_int_get (&server->n_layouts);
+  g_main_context_invoke (server->context, emit_submenu_updated, server);
+
+  g_assert_true (wait_label (get_submenu (menu), "Sub 1 (1)", 5));
+  run_for (200);
+  /* With fewer fetches than updates, of the submenu only */
+  g_assert_cmpint (g_atomic_int_get (&server->n_layouts) - n_layouts, <, 3);
+  g_assert_cmpint (g_atomic_int_get (&server->last_parent), ==, SUBMENU_ID);
+  /* The rest of the menu is left alone, and the submenu patched in place */
+  g_assert_nonnull (item);
+  g_assert_true (get_item (menu, 0) == item);
+  g_assert_nonnull (sub_item);
+  g_assert_true (get_item (get_submenu (menu), 0) == sub_item);
+
+  n_layouts = g_atomic_int_get (&server->n_layouts);
+  g_main_context_invoke (server->context, emit_label_updated, server);
+
+  /* Properties are updated in place, without a fetch */
+  g_assert_true (wait_label (menu, "Item 1 (renamed)", 5));
+  run_for (200);
+  g_assert_cmpint (g_atomic_int_get (&server->n_layouts), ==, n_layouts);
+  g_assert_nonnull (item);
+  g_assert_true (get_item (menu, 0) == item);
+
+  g_object_remove_weak_pointer (G_OBJECT (item), (gpointer *) &item);
+  g_object_remove_weak_pointer (G_OBJECT (sub_item), (gpointer *) &sub_item);
+}
+
+/* The application is slow to answer, and has a newer layout */
+static void
+test_slow_popup (void)
+{
+  GtkWidget *item;
+  gchar *label;
+  gint64 start, popup_time;
+
+  item = get_item (menu, 0);
+  g_object_add_weak_pointer (G_OBJECT (item), (gpointer *) &item);
+  label = g_strdup (gtk_menu_item_get_label (GTK_MENU_ITEM (item)));
+
+  g_atomic_int_set (&server->delay, delay);
+  g_atomic_int_inc (&server->revision);
+
+  g_timeout_add (1, heartbeat, NULL);
+  run_for (50);
+  longest_stall = 0;
+
+  start = g_get_monotonic_time ();
+  gtk_menu_popup_at_pointer (menu, NULL);
+  popup_time = g_get_monotonic_time () - start;
+
+  /* The menu is shown with the layout it has, and updated in place when
+   * the newer layout arrives */
+  g_assert_true (has_label (get_item (menu, 0), label));
+  g_assert_true (wait_label (menu, "Item 1 (1)", 5 + 3 * delay / 1000));
+  g_assert_nonnull (item);
+  g_assert_true (get_item (menu, 0) == item);
+
+  gtk_menu_item_activate (GTK_MENU_ITEM (get_item (menu, 1)));
+  gtk_menu_popdown (menu);
+
+  /* Every call is answered in turn */
+  run_for (3 * delay + 500);
+
+  g_test_message ("popup in %.1f ms, longest main loop stall %.1f ms",
+                  popup_time / 1000.0, longest_stall / 1000.0);
+  /* The panel does not wait for the menu, and every event is sent */
+  g_assert_cmpint (longest_stall, <, delay * 1000 / 2);
+  g_assert_cmpint (g_atomic_int_get (&server->n_opened), ==, 1);
+  g_assert_cmpint (g_atomic_int_get (&server->n_clicked), ==, 1);
+  g_assert_cmpint (g_atomic_int_get (&server->n_closed), ==, 1);
+
+  g_object_remove_weak_pointer (G_OBJECT (item), (gpointer *) &item);
+  g_free (label);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gint items = 20;
+  int status;
+  GError *error;
+  GOptionContext *context;
+  GOptionEntry options[] = {
+    { "delay", 'd', 0, G_OPTION_ARG_INT, &delay, "Milliseconds the menu takes to answer", "N" },
+    { "items", 'n', 0, G_OPTION_ARG_INT, &items, "Number of items in the menu", "N" },
+    { NULL, 0, 0, 0, NULL, NULL, NULL }
+  };
+
+  g_test_init (&argc, &argv, NULL);
+
+  context = g_option_context_new ("");
+  g_option_context_add_main_entries (context, options, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+
+  error = NULL;
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  if (delay < 1)
+    delay = 1;
+  if (items < 1)
+    items = 1;
+
+  server = server_start (items);
+  if (server->connection == NULL)
+    {
+      server_stop (server);
+      return 1;
+    }
+
+  menu = sn_dbus_menu_new (g_dbus_connection_get_unique_name (server->connection),
+                           MENU_OBJECT_PATH);
+  g_object_ref_sink (menu);
+
+  /* In that order, they run against the same menu */
+  g_test_add_func ("/sn-dbus-menu/layout", test_layout);
+  g_test_add_func ("/sn-dbus-menu/updates", test_updates);
+  g_test_add_func ("/sn-dbus-menu/slow-popup", test_slow_popup);
+
+  status = g_test_run ();
+
+  gtk_widget_destroy (GTK_WIDGET (menu));
+  g_object_unref (menu);
+  server_stop (server);
+
+  return status;
+}
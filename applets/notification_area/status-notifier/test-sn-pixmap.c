@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Test and benchmark for the decoding of StatusNotifierItem icon pixmaps */
+
+#include <string.h>
+
+#include "sn-pixmap.h"
+
+/* The icon in the panel */
+#define ICON_SIZE 22
+
+/* What the items did: swap the bytes in place, premultiply, then copy */
+static cairo_surface_t *
+legacy_decode (guchar *data,
+               gint    width,
+               gint    height)
+{
+  cairo_surface_t *surface;
+  cairo_surface_t *tmp;
+  cairo_t *cr;
+  guint32 *pixels;
+  gint stride;
+  gint i, x, y;
+  guchar *p;
+
+  stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, width);
+  pixels = (guint32 *) (gpointer) data;
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+  for (i = 0; i < width * height; i++)
+    pixels[i] = GUINT32_FROM_BE (pixels[i]);
+#endif
+
+  p = data;
+  for (y = 0; y < height; y++)
+    {
+      for (x = 0; x < width; x++)
+        {
+          guchar alpha = p[x * 4 + 3];
+
+          p[x * 4 + 0] = (p[x * 4 + 0] * alpha) / 255;
+          p[x * 4 + 1] = (p[x * 4 + 1] * alpha) / 255;
+          p[x * 4 + 2] = (p[x * 4 + 2] * alpha) / 255;
+        }
+
+      p += stride;
+    }
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  tmp = cairo_image_surface_create_for_data (data, CAIRO_FORMAT_ARGB32,
+                                             width, height, stride);
+  cr = cairo_create (surface);
+  cairo_set_source_surface (cr, tmp, 0, 0);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+  cairo_surface_destroy (tmp);
+
+  return surface;
+}
+
+static cairo_surface_t *
+legacy_scale (cairo_surface_t *surface,
+              gint             width,
+              gint             height,
+              gint             size)
+{
+  cairo_surface_t *scaled;
+  cairo_t *cr;
+
+  scaled = cairo_surface_create_similar (surface, CAIRO_CONTENT_COLOR_ALPHA,
+                                         size, size);
+  cr = cairo_create (scaled);
+  cairo_scale (cr, size / (gdouble) width, size / (gdouble) height);
+  cairo_set_source_surface (cr, surface, 0, 0);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  return scaled;
+}
+
+static guchar *
+make_pixels (gint size)
+{
+  GRand *rand;
+  guchar *data;
+  gint i;
+
+  rand = g_rand_new_with_seed (size);
+  data = g_malloc (size * size * 4);
+
+  for (i = 0; i < size * size * 4; i++)
+    data[i] = g_rand_int_range (rand, 0, 256);
+
+  g_rand_free (rand);
+
+  return data;
+}
+
+static gboolean
+same_pixels (cairo_surface_t *a,
+             cairo_surface_t *b,
+             gint             size)
+{
+  gint y;
+
+  cairo_surface_flush (a);
+  cairo_surface_flush (b);
+
+  for (y = 0; y < size; y++)
+    if (memcmp (cairo_image_surface_get_data (a) + y * cairo_image_surface_get_stride (a),
+                cairo_image_surface_get_data (b) + y * cairo_image_surface_get_stride (b),
+                size * 4) != 0)
+      return FALSE;
+
+  return TRUE;
+}
+
+static gint iterations = 1000;
+
+static void
+test_size (gconstpointer data)
+{
+  gint size = GPOINTER_TO_INT (data);
+  guchar *pixels;
+  guchar *copy;
+  guint32 *converted;
+  GVariant *variant;
+  SnPixmap *pixmap;
+  cairo_surface_t *surface;
+  gint64 start, t_legacy, t_convert, t_cached;
+  guint n_hits, n_misses;
+  gint i;
+
+  pixels = make_pixels (size);
+  copy = g_malloc (size * size * 4);
+  converted = g_new (guint32, size * size);
+
+  /* A new variant per update, as from the bus */
+  start = g_get_monotonic_time ();
+  for (i = 0; i < iterations; i++)
+    {
+      memcpy (copy, pixels, size * size * 4);
+      surface = legacy_decode (copy, size, size);
+      if (size > ICON_SIZE)
+        {
+          cairo_surface_t *scaled;
+
+          scaled = legacy_scale (surface, size, size, ICON_SIZE);
+          cairo_surface_destroy (scaled);
+        }
+      cairo_surface_destroy (surface);
+    }
+  t_legacy = g_get_monotonic_time () - start;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < iterations; i++)
+    sn_pixmap_convert (pixels, converted, size * size);
+  t_convert = g_get_monotonic_time () - start;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < iterations; i++)
+    {
+      variant = g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, pixels,
+                                           size * size * 4, 1);
+      g_variant_ref_sink (variant);
+
+      pixmap = sn_pixmap_get (variant, size, size);
+      if (size > ICON_SIZE)
+        surface = sn_pixmap_get_scaled (pixmap, GTK_ORIENTATION_HORIZONTAL, ICON_SIZE);
+      else
+        surface = cairo_surface_reference (sn_pixmap_get_surface (pixmap));
+
+      cairo_surface_destroy (surface);
+      sn_pixmap_unref (pixmap);
+      g_variant_unref (variant);
+    }
+  t_cached = g_get_monotonic_time () - start;
+
+  /* Same pixels as before */
+  memcpy (copy, pixels, size * size * 4);
+  surface = legacy_decode (copy, size, size);
+  variant = g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, pixels,
+                                       size * size * 4, 1);
+  g_variant_ref_sink (variant);
+  pixmap = sn_pixmap_get (variant, size, size);
+  g_assert_true (same_pixels (surface, sn_pixmap_get_surface (pixmap), size));
+  sn_pixmap_unref (pixmap);
+  g_variant_unref (variant);
+  cairo_surface_destroy (surface);
+
+  sn_pixmap_get_counters (NULL, &n_hits, &n_misses);
+
+  g_test_message ("%dx%d", size, size);
+  g_test_message ("  swap and premultiply, then copy: %8.2f us per update",
+                  (gdouble) t_legacy / iterations);
+#ifdef __SSE2__
+  g_test_message ("  SSE2 conversion:                 %8.2f us per update",
+#else
+  g_test_message ("  branch-free conversion:          %8.2f us per update",
+#endif
+                  (gdouble) t_convert / iterations);
+  g_test_message ("  re-sent pixmap, from the cache:  %8.2f us per update",
+                  (gdouble) t_cached / iterations);
+  g_test_message ("  cache: %u hits, %u misses so far", n_hits, n_misses);
+
+  g_free (converted);
+  g_free (copy);
+  g_free (pixels);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GError *error;
+  GOptionContext *context;
+  GOptionEntry options[] = {
+    { "iterations", 'i', 0, G_OPTION_ARG_INT, &iterations, "Number of updates to time", "N" },
+    { NULL, 0, 0, 0, NULL, NULL, NULL }
+  };
+
+  g_test_init (&argc, &argv, NULL);
+
+  context = g_option_context_new ("");
+  g_option_context_add_main_entries (context, options, NULL);
+
+  error = NULL;
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  if (iterations < 1)
+    iterations = 1;
+
+  g_test_add_data_func ("/sn-pixmap/22", GINT_TO_POINTER (22), test_size);
+  g_test_add_data_func ("/sn-pixmap/48", GINT_TO_POINTER (48), test_size);
+  g_test_add_data_func ("/sn-pixmap/256", GINT_TO_POINTER (256), test_size);
+
+  return g_test_run ();
+}
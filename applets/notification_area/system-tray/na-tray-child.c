@@ -555,6 +555,11 @@ na_tray_child_set_composited (NaTrayChild *child,
 /* If we are faking transparency with a window-relative background, force a
  * redraw of the icon. This should be called if the background changes or if
  * the child is shifted with respect to the background.
+ *
+ * The icon stays mapped: the plug window is cleared to the new background,
+ * which sends the client an expose event for it so that it paints its icon
+ * again. Hiding and showing the icon did the same, with flickering and a
+ * round of unmap, map and configure requests for every icon.
  */
 void
 na_tray_child_force_redraw (gpointer key,
@@ -565,15 +570,39 @@ na_tray_child_force_redraw (gpointer key,
   (void) user_data;
   NaTrayChild *child = key;
   GtkWidget *widget = GTK_WIDGET (child);
+  GdkWindow *plug_window;
+  GdkDisplay *display;
+
+  if (!gtk_widget_get_mapped (widget))
+    return;
 
-  if (gtk_widget_get_mapped (widget))
+  /* Icons with alpha are painted on the background by the parent, see
+   * na_tray_child_draw_on_parent(), and those with a plain background do
+   * not show it */
+  if (na_tray_child_has_alpha (child))
     {
-    /* Hiding and showing is the safe way to do it, but can result in more
-     * flickering.
-     */
-    gtk_widget_hide(widget);
-    gtk_widget_show_all(widget);
+      gtk_widget_queue_draw (widget);
+      return;
     }
+
+  if (!child->parent_relative_bg)
+    return;
+
+  /* The socket itself, in case the plug does not cover it */
+  gtk_widget_queue_draw (widget);
+
+  plug_window = gtk_socket_get_plug_window (GTK_SOCKET (child));
+  if (plug_window == NULL)
+    return;
+
+  display = gtk_widget_get_display (widget);
+
+  /* The plug window may be gone already, without waiting for the errors */
+  gdk_x11_display_error_trap_push (display);
+  XClearArea (GDK_DISPLAY_XDISPLAY (display),
+              GDK_WINDOW_XID (plug_window),
+              0, 0, 0, 0, True);
+  gdk_x11_display_error_trap_pop_ignored (display);
 }
 
 /* from libwnck/xutils.c, comes as LGPLv2+ */
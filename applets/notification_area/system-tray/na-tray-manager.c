@@ -66,6 +66,18 @@ typedef struct
 #endif
 } PendingMessage;
 
+/* The messages a tray icon has begun and not sent the whole of yet */
+typedef struct
+{
+  GQueue messages; /* PendingMessage, the last one begun first */
+  gsize  n_bytes;
+} PendingMessages;
+
+/* What a tray icon can have the manager hold for its pending messages.
+ * Icons send one message at a time, and balloon messages are short. */
+#define MAX_PENDING_MESSAGES 8
+#define MAX_PENDING_BYTES    (64 * 1024)
+
 static guint manager_signals[LAST_SIGNAL] = { 0 };
 
 #define SYSTEM_TRAY_REQUEST_DOCK    0
@@ -93,11 +105,28 @@ static void na_tray_manager_unmanage (NaTrayManager *manager);
 
 G_DEFINE_TYPE (NaTrayManager, na_tray_manager, G_TYPE_OBJECT)
 
+static void
+pending_message_free (PendingMessage *message)
+{
+  g_free (message->str);
+  g_free (message);
+}
+
+static void
+pending_messages_free (PendingMessages *pending)
+{
+  g_queue_foreach (&pending->messages, (GFunc) pending_message_free, NULL);
+  g_queue_clear (&pending->messages);
+  g_free (pending);
+}
+
 static void
 na_tray_manager_init (NaTrayManager *manager)
 {
   manager->invisible = NULL;
   manager->socket_table = g_hash_table_new (NULL, NULL);
+  manager->pending_messages = g_hash_table_new_full (NULL, NULL, NULL,
+                                                     (GDestroyNotify) pending_messages_free);
 
   manager->padding = 0;
   manager->icon_size = 0;
@@ -207,7 +236,7 @@ na_tray_manager_finalize (GObject *object)
 
   na_tray_manager_unmanage (manager);
 
-  g_list_free (manager->messages);
+  g_hash_table_destroy (manager->pending_messages);
   g_hash_table_destroy (manager->socket_table);
 
   G_OBJECT_CLASS (na_tray_manager_parent_class)->finalize (object);
@@ -271,6 +300,8 @@ na_tray_manager_plug_removed (GtkSocket       *socket,
 
   g_hash_table_remove (manager->socket_table,
                        GINT_TO_POINTER (child->icon_window));
+  g_hash_table_remove (manager->pending_messages,
+                       GINT_TO_POINTER (child->icon_window));
   g_signal_emit (manager, manager_signals[TRAY_ICON_REMOVED], 0, child);
 
   /* This destroys the socket. */
@@ -325,51 +356,71 @@ na_tray_manager_handle_dock_request (NaTrayManager       *manager,
 }
 
 static void
-pending_message_free (PendingMessage *message)
+pending_messages_remove (PendingMessages *pending,
+                         GList           *link)
 {
-  g_free (message->str);
-  g_free (message);
+  PendingMessage *msg = link->data;
+
+  pending->n_bytes -= msg->len;
+  g_queue_delete_link (&pending->messages, link);
+  pending_message_free (msg);
+}
+
+static GList *
+pending_messages_find (PendingMessages *pending,
+                       long             id)
+{
+  GList *p;
+
+  for (p = pending->messages.head; p; p = p->next)
+    {
+      PendingMessage *msg = p->data;
+
+      if (msg->id == id)
+        return p;
+    }
+
+  return NULL;
 }
 
 static void
 na_tray_manager_handle_message_data (NaTrayManager *manager,
                                      XClientMessageEvent *xevent)
 {
-  GList               *p;
+  PendingMessages     *pending;
+  PendingMessage      *msg;
   int                  len;
 
-  /* Try to see if we can find the pending message in the list */
-  for (p = manager->messages; p; p = p->next)
-    {
-      PendingMessage *msg = p->data;
+  /* The data is for the last message the icon began */
+  pending = g_hash_table_lookup (manager->pending_messages,
+                                 GINT_TO_POINTER (xevent->window));
+  if (!pending || !pending->messages.head)
+    return;
 
-      if (xevent->window == msg->window)
-	{
-	  /* Append the message */
-	  len = MIN (msg->remaining_len, 20);
+  msg = pending->messages.head->data;
 
-	  memcpy ((msg->str + msg->len - msg->remaining_len),
-		  &xevent->data, len);
-	  msg->remaining_len -= len;
+  /* Append the message */
+  len = MIN (msg->remaining_len, 20);
 
-	  if (msg->remaining_len == 0)
-	    {
-	      GtkSocket *socket;
+  memcpy ((msg->str + msg->len - msg->remaining_len),
+          &xevent->data, len);
+  msg->remaining_len -= len;
 
-	      socket = g_hash_table_lookup (manager->socket_table,
-                                            GINT_TO_POINTER (msg->window));
+  if (msg->remaining_len == 0)
+    {
+      GtkSocket *socket;
 
-	      if (socket)
-		  g_signal_emit (manager, manager_signals[MESSAGE_SENT], 0,
-				 socket, msg->str, msg->id, msg->timeout);
+      g_queue_pop_head (&pending->messages);
+      pending->n_bytes -= msg->len;
 
-	      pending_message_free (msg);
-	      manager->messages = g_list_remove_link (manager->messages, p);
-              g_list_free_1 (p);
-	    }
+      socket = g_hash_table_lookup (manager->socket_table,
+                                    GINT_TO_POINTER (xevent->window));
 
-          break;
-	}
+      if (socket)
+        g_signal_emit (manager, manager_signals[MESSAGE_SENT], 0,
+                       socket, msg->str, msg->id, msg->timeout);
+
+      pending_message_free (msg);
     }
 }
 
@@ -377,12 +428,13 @@ static void
 na_tray_manager_handle_begin_message (NaTrayManager       *manager,
 				      XClientMessageEvent *xevent)
 {
-  GtkSocket      *socket;
-  GList          *p;
-  PendingMessage *msg;
-  long            timeout;
-  long            len;
-  long            id;
+  GtkSocket       *socket;
+  GList           *p;
+  PendingMessages *pending;
+  PendingMessage  *msg;
+  long             timeout;
+  long             len;
+  long             id;
 
   socket = g_hash_table_lookup (manager->socket_table,
                                 GINT_TO_POINTER (xevent->window));
@@ -394,29 +446,37 @@ na_tray_manager_handle_begin_message (NaTrayManager       *manager,
   len     = xevent->data.l[3];
   id      = xevent->data.l[4];
 
-  /* Check if the same message is already in the queue and remove it if so */
-  for (p = manager->messages; p; p = p->next)
-    {
-      PendingMessage *pmsg = p->data;
+  pending = g_hash_table_lookup (manager->pending_messages,
+                                 GINT_TO_POINTER (xevent->window));
 
-      if (xevent->window == pmsg->window &&
-	  id == pmsg->id)
-	{
-	  /* Hmm, we found it, now remove it */
-	  pending_message_free (pmsg);
-	  manager->messages = g_list_remove_link (manager->messages, p);
-          g_list_free_1 (p);
-	  break;
-	}
-    }
+  /* Check if the same message is already in the queue and remove it if so */
+  if (pending && (p = pending_messages_find (pending, id)) != NULL)
+    pending_messages_remove (pending, p);
 
   if (len == 0)
     {
       g_signal_emit (manager, manager_signals[MESSAGE_SENT], 0,
                      socket, "", id, timeout);
     }
+  else if (len < 0 || len > MAX_PENDING_BYTES)
+    {
+      g_debug ("Ignoring a message of %ld bytes from tray icon 0x%lx",
+               len, xevent->window);
+    }
   else
     {
+      if (!pending)
+        {
+          pending = g_new0 (PendingMessages, 1);
+          g_hash_table_insert (manager->pending_messages,
+                               GINT_TO_POINTER (xevent->window), pending);
+        }
+
+      /* Make room, dropping the messages begun the longest ago */
+      while (pending->messages.length >= MAX_PENDING_MESSAGES ||
+             pending->n_bytes + len > MAX_PENDING_BYTES)
+        pending_messages_remove (pending, pending->messages.tail);
+
       /* Now add the new message to the queue */
       msg = g_new0 (PendingMessage, 1);
       msg->window = xevent->window;
@@ -426,7 +486,8 @@ na_tray_manager_handle_begin_message (NaTrayManager       *manager,
       msg->remaining_len = msg->len;
       msg->str = g_malloc (msg->len + 1);
       msg->str[msg->len] = '\0';
-      manager->messages = g_list_prepend (manager->messages, msg);
+      g_queue_push_head (&pending->messages, msg);
+      pending->n_bytes += len;
     }
 }
 
@@ -434,26 +495,18 @@ static void
 na_tray_manager_handle_cancel_message (NaTrayManager       *manager,
 				       XClientMessageEvent *xevent)
 {
-  GList     *p;
-  GtkSocket *socket;
-  long       id;
+  GList           *p;
+  GtkSocket       *socket;
+  PendingMessages *pending;
+  long             id;
 
   id = xevent->data.l[2];
 
   /* Check if the message is in the queue and remove it if so */
-  for (p = manager->messages; p; p = p->next)
-    {
-      PendingMessage *msg = p->data;
-
-      if (xevent->window == msg->window &&
-	  id == msg->id)
-	{
-	  pending_message_free (msg);
-	  manager->messages = g_list_remove_link (manager->messages, p);
-          g_list_free_1 (p);
-	  break;
-	}
-    }
+  pending = g_hash_table_lookup (manager->pending_messages,
+                                 GINT_TO_POINTER (xevent->window));
+  if (pending && (p = pending_messages_find (pending, id)) != NULL)
+    pending_messages_remove (pending, p);
 
   socket = g_hash_table_lookup (manager->socket_table,
                                 GINT_TO_POINTER (xevent->window));
@@ -489,7 +542,7 @@ na_tray_manager_window_filter (GdkXEvent *xev,
                xevent->xclient.data.l[1] == SYSTEM_TRAY_BEGIN_MESSAGE)
         {
           na_tray_manager_handle_begin_message (manager,
-                                                (XClientMessageEvent *) event);
+                                                (XClientMessageEvent *) xevent);
           return GDK_FILTER_REMOVE;
         }
       /* _NET_SYSTEM_TRAY_OPCODE: SYSTEM_TRAY_CANCEL_MESSAGE */
@@ -497,14 +550,14 @@ na_tray_manager_window_filter (GdkXEvent *xev,
                xevent->xclient.data.l[1] == SYSTEM_TRAY_CANCEL_MESSAGE)
         {
           na_tray_manager_handle_cancel_message (manager,
-                                                 (XClientMessageEvent *) event);
+                                                 (XClientMessageEvent *) xevent);
           return GDK_FILTER_REMOVE;
         }
       /* _NET_SYSTEM_TRAY_MESSAGE_DATA */
       else if (xevent->xclient.message_type == manager->message_data_atom)
         {
           na_tray_manager_handle_message_data (manager,
-                                               (XClientMessageEvent *) event);
+                                               (XClientMessageEvent *) xevent);
           return GDK_FILTER_REMOVE;
         }
     }
@@ -990,3 +1043,32 @@ na_tray_manager_get_orientation (NaTrayManager *manager)
 
   return manager->orientation;
 }
+
+/* How many messages, and bytes of them, the tray icons have begun and not
+ * sent the whole of yet */
+void
+na_tray_manager_get_pending_counters (NaTrayManager *manager,
+                                      guint         *n_messages,
+                                      gsize         *n_bytes)
+{
+  GHashTableIter iter;
+  gpointer value;
+  guint messages = 0;
+  gsize bytes = 0;
+
+  g_return_if_fail (NA_IS_TRAY_MANAGER (manager));
+
+  g_hash_table_iter_init (&iter, manager->pending_messages);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      PendingMessages *pending = value;
+
+      messages += pending->messages.length;
+      bytes += pending->n_bytes;
+    }
+
+  if (n_messages)
+    *n_messages = messages;
+  if (n_bytes)
+    *n_bytes = bytes;
+}
@@ -63,7 +63,7 @@ struct _NaTrayManager
   GdkRGBA warning;
   GdkRGBA success;
 
-  GList *messages;
+  GHashTable *pending_messages;
   GHashTable *socket_table;
 };
 
@@ -107,6 +107,9 @@ void            na_tray_manager_set_colors      (NaTrayManager      *manager,
 						 GdkRGBA            *error,
 						 GdkRGBA            *warning,
 						 GdkRGBA            *success);
+void            na_tray_manager_get_pending_counters (NaTrayManager      *manager,
+						      guint              *n_messages,
+						      gsize              *n_bytes);
 
 G_END_DECLS
 
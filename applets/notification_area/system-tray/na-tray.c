@@ -29,6 +29,7 @@
 #include <string.h>
 
 #include <gtk/gtk.h>
+#include <gdk/gdkx.h>
 
 #include "na-tray-manager.h"
 #include "fixedtip.h"
@@ -50,6 +51,12 @@ struct _NaTrayPrivate
 
   guint idle_redraw_id;
 
+  /* Where the X requests of the last redraw are counted from, until the
+   * frame painting it is done */
+  GdkFrameClock *redraw_clock;
+  gulong         redraw_paint_id;
+  gulong         redraw_serial;
+
   GtkOrientation orientation;
   gint           icon_padding;
   gint           icon_size;
@@ -532,6 +539,13 @@ na_tray_dispose (GObject *object)
       priv->idle_redraw_id = 0;
     }
 
+  if (priv->redraw_clock != NULL)
+    {
+      g_signal_handler_disconnect (priv->redraw_clock, priv->redraw_paint_id);
+      priv->redraw_paint_id = 0;
+      g_clear_object (&priv->redraw_clock);
+    }
+
   G_OBJECT_CLASS (na_tray_parent_class)->dispose (object);
 }
 
@@ -705,15 +719,62 @@ na_tray_style_updated (NaHost          *host,
   na_tray_set_colors (NA_TRAY (host), &fg, &error, &warning, &success);
 }
 
+static void
+redraw_report (NaTray *tray)
+{
+  NaTrayPrivate *priv = tray->priv;
+
+  g_debug ("Redrawing %u tray icons took %lu X requests",
+           g_hash_table_size (priv->trays_screen->icon_table),
+           NextRequest (GDK_SCREEN_XDISPLAY (priv->screen)) - priv->redraw_serial);
+}
+
+/* The icons only queue their draws, so what the redraw costs is only known
+ * once the frame is painted */
+static void
+redraw_after_paint_cb (GdkFrameClock *clock,
+                       NaTray        *tray)
+{
+  NaTrayPrivate *priv = tray->priv;
+
+  g_signal_handler_disconnect (clock, priv->redraw_paint_id);
+  priv->redraw_paint_id = 0;
+  g_clear_object (&priv->redraw_clock);
+
+  if (priv->trays_screen != NULL)
+    redraw_report (tray);
+}
+
 static gboolean
 idle_redraw_cb (NaTray *tray)
 {
   NaTrayPrivate *priv = tray->priv;
+  GdkFrameClock *clock;
+
+  priv->idle_redraw_id = 0;
+
+  /* A redraw requested before the last one got painted is counted with it */
+  if (priv->redraw_clock == NULL)
+    priv->redraw_serial = NextRequest (GDK_SCREEN_XDISPLAY (priv->screen));
 
   g_hash_table_foreach (priv->trays_screen->icon_table,
                         na_tray_child_force_redraw, NULL);
 
-  priv->idle_redraw_id = 0;
+  if (priv->redraw_clock != NULL)
+    return FALSE;
+
+  clock = gtk_widget_get_frame_clock (GTK_WIDGET (tray));
+  if (clock == NULL)
+    {
+      redraw_report (tray);
+      return FALSE;
+    }
+
+  priv->redraw_clock = g_object_ref (clock);
+  priv->redraw_paint_id = g_signal_connect (clock, "after-paint",
+                                            G_CALLBACK (redraw_after_paint_cb),
+                                            tray);
+  gdk_frame_clock_request_phase (clock, GDK_FRAME_CLOCK_PHASE_AFTER_PAINT);
 
   return FALSE;
 }
@@ -727,5 +788,8 @@ na_tray_force_redraw (NaHost *host)
   /* Force the icons to redraw their backgrounds.
    */
   if (priv->idle_redraw_id == 0)
-    priv->idle_redraw_id = g_idle_add ((GSourceFunc) idle_redraw_cb, tray);
+    {
+      priv->idle_redraw_id = g_idle_add ((GSourceFunc) idle_redraw_cb, tray);
+      g_source_set_name_by_id (priv->idle_redraw_id, "[notification-area] idle_redraw_cb");
+    }
 }
@@ -0,0 +1,419 @@
+/*
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/* Test and benchmark for the items arriving in a burst in the notification
+ * area, as at session start. Skipped without a display. */
+
+#include <config.h>
+#include <gtk/gtk.h>
+
+#include "na-grid.h"
+
+/* An item with only an id and a category */
+
+#define FAKE_TYPE_ITEM (fake_item_get_type ())
+G_DECLARE_FINAL_TYPE (FakeItem, fake_item, FAKE, ITEM, GtkBox)
+
+struct _FakeItem
+{
+  GtkBox          parent;
+
+  gchar          *id;
+  NaItemCategory  category;
+};
+
+static void fake_item_na_item_init (NaItemInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (FakeItem, fake_item, GTK_TYPE_BOX,
+                         G_IMPLEMENT_INTERFACE (NA_TYPE_ITEM,
+                                                fake_item_na_item_init))
+
+static const gchar *
+fake_item_get_id (NaItem *item)
+{
+  return FAKE_ITEM (item)->id;
+}
+
+static NaItemCategory
+fake_item_get_category (NaItem *item)
+{
+  return FAKE_ITEM (item)->category;
+}
+
+static void
+fake_item_na_item_init (NaItemInterface *iface)
+{
+  iface->get_id = fake_item_get_id;
+  iface->get_category = fake_item_get_category;
+}
+
+static void
+fake_item_finalize (GObject *object)
+{
+  g_free (FAKE_ITEM (object)->id);
+
+  G_OBJECT_CLASS (fake_item_parent_class)->finalize (object);
+}
+
+static void
+fake_item_class_init (FakeItemClass *klass)
+{
+  G_OBJECT_CLASS (klass)->finalize = fake_item_finalize;
+}
+
+static void
+fake_item_init (FakeItem *self)
+{
+}
+
+/* A host the items are added to by hand */
+
+#define FAKE_TYPE_HOST (fake_host_get_type ())
+G_DECLARE_FINAL_TYPE (FakeHost, fake_host, FAKE, HOST, GObject)
+
+struct _FakeHost
+{
+  GObject parent;
+
+  gint    icon_padding;
+  gint    icon_size;
+};
+
+enum
+{
+  PROP_0,
+  PROP_ICON_PADDING,
+  PROP_ICON_SIZE
+};
+
+static void fake_host_na_host_init (NaHostInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (FakeHost, fake_host, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (NA_TYPE_HOST,
+                                                fake_host_na_host_init))
+
+static void
+fake_host_na_host_init (NaHostInterface *iface)
+{
+}
+
+static void
+fake_host_get_property (GObject    *object,
+                        guint       property_id,
+                        GValue     *value,
+                        GParamSpec *pspec)
+{
+  FakeHost *self = FAKE_HOST (object);
+
+  switch (property_id)
+    {
+      case PROP_ICON_PADDING:
+        g_value_set_int (value, self->icon_padding);
+        break;
+
+      case PROP_ICON_SIZE:
+        g_value_set_int (value, self->icon_size);
+        break;
+
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+        break;
+    }
+}
+
+static void
+fake_host_set_property (GObject      *object,
+                        guint         property_id,
+                        const GValue *value,
+                        GParamSpec   *pspec)
+{
+  FakeHost *self = FAKE_HOST (object);
+
+  switch (property_id)
+    {
+      case PROP_ICON_PADDING:
+        self->icon_padding = g_value_get_int (value);
+        break;
+
+      case PROP_ICON_SIZE:
+        self->icon_size = g_value_get_int (value);
+        break;
+
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+        break;
+    }
+}
+
+static void
+fake_host_class_init (FakeHostClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->get_property = fake_host_get_property;
+  gobject_class->set_property = fake_host_set_property;
+
+  g_object_class_override_property (gobject_class, PROP_ICON_PADDING, "icon-padding");
+  g_object_class_override_property (gobject_class, PROP_ICON_SIZE, "icon-size");
+}
+
+static void
+fake_host_init (FakeHost *self)
+{
+}
+
+/* Items in a random order, as they register */
+static GPtrArray *
+make_items (guint n_items)
+{
+  GPtrArray *items;
+  GRand *rand;
+  guint i;
+
+  rand = g_rand_new_with_seed (42);
+  items = g_ptr_array_new_with_free_func (g_object_unref);
+
+  for (i = 0; i < n_items; i++)
+    {
+      FakeItem *item;
+
+      item = g_object_new (FAKE_TYPE_ITEM, NULL);
+      item->id = g_strdup_printf ("item-%04u", g_rand_int_range (rand, 0, 10000));
+      item->category = g_rand_int_range (rand, NA_ITEM_CATEGORY_APPLICATION_STATUS,
+                                         NA_ITEM_CATEGORY_HARDWARE + 1);
+
+      g_ptr_array_add (items, g_object_ref_sink (item));
+    }
+
+  g_rand_free (rand);
+
+  return items;
+}
+
+static gint
+compare_items (gconstpointer a,
+               gconstpointer b)
+{
+  NaItemCategory c1 = na_item_get_category ((NaItem *) a);
+  NaItemCategory c2 = na_item_get_category ((NaItem *) b);
+
+  if (c1 != c2)
+    return c1 < c2 ? -1 : 1;
+
+  return g_strcmp0 (na_item_get_id ((NaItem *) a), na_item_get_id ((NaItem *) b));
+}
+
+static gint
+compare_pointers (gconstpointer a,
+                  gconstpointer b)
+{
+  return compare_items (*(NaItem **) a, *(NaItem **) b);
+}
+
+static void
+child_notify_cb (GtkWidget  *widget,
+                 GParamSpec *pspec,
+                 guint      *n_moves)
+{
+  if (g_strcmp0 (pspec->name, "left-attach") == 0 ||
+      g_strcmp0 (pspec->name, "top-attach") == 0)
+    (*n_moves)++;
+}
+
+/* What the grid did: sort all the items, and place them all again, for
+ * every item added */
+static void
+legacy_add (GtkGrid  *grid,
+            GSList  **list,
+            NaItem   *item)
+{
+  GSList *l;
+  gint index;
+
+  *list = g_slist_prepend (*list, item);
+  gtk_grid_attach (grid, GTK_WIDGET (item), 0, 0, 1, 1);
+  *list = g_slist_sort (*list, compare_items);
+
+  for (l = *list, index = 0; l != NULL; l = l->next, index++)
+    {
+      gint left_attach;
+
+      gtk_container_child_get (GTK_CONTAINER (grid), l->data,
+                               "left-attach", &left_attach,
+                               NULL);
+
+      if (left_attach != index)
+        gtk_container_child_set (GTK_CONTAINER (grid), l->data,
+                                 "left-attach", index,
+                                 "top-attach", 0,
+                                 NULL);
+    }
+}
+
+/* Whether the items are in a single row, in order */
+static gboolean
+check_order (GtkContainer *grid,
+             GPtrArray    *items)
+{
+  GPtrArray *sorted;
+  gboolean ok = TRUE;
+  guint i;
+
+  sorted = g_ptr_array_sized_new (items->len);
+  for (i = 0; i < items->len; i++)
+    g_ptr_array_add (sorted, g_ptr_array_index (items, i));
+  g_ptr_array_sort (sorted, compare_pointers);
+
+  for (i = 0; i < sorted->len; i++)
+    {
+      gint left_attach, top_attach;
+
+      gtk_container_child_get (grid, g_ptr_array_index (sorted, i),
+                               "left-attach", &left_attach,
+                               "top-attach", &top_attach,
+                               NULL);
+
+      /* Items equal to each other can come in any order */
+      if (top_attach != 0 ||
+          left_attach < 0 || left_attach >= (gint) sorted->len ||
+          (left_attach != (gint) i &&
+           compare_items (g_ptr_array_index (sorted, left_attach),
+                          g_ptr_array_index (sorted, i)) != 0))
+        ok = FALSE;
+    }
+
+  g_ptr_array_free (sorted, TRUE);
+
+  return ok;
+}
+
+static gint      n_items = 200;
+static gboolean  has_display = FALSE;
+
+static void
+test_burst (void)
+{
+  GPtrArray *items;
+  GtkWidget *legacy;
+  GtkWidget *grid;
+  FakeHost *host;
+  GSList *list = NULL;
+  guint n_legacy_moves = 0;
+  guint n_moves = 0;
+  gint64 start, t_legacy, t_grid;
+  guint i;
+
+  if (!has_display)
+    {
+      g_test_skip ("No display");
+      return;
+    }
+
+  items = make_items (n_items);
+
+  legacy = g_object_ref_sink (gtk_grid_new ());
+  for (i = 0; i < items->len; i++)
+    g_signal_connect (g_ptr_array_index (items, i), "child-notify",
+                      G_CALLBACK (child_notify_cb), &n_legacy_moves);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < items->len; i++)
+    legacy_add (GTK_GRID (legacy), &list, g_ptr_array_index (items, i));
+  t_legacy = g_get_monotonic_time () - start;
+
+  g_assert_true (check_order (GTK_CONTAINER (legacy), items));
+
+  for (i = 0; i < items->len; i++)
+    {
+      g_signal_handlers_disconnect_by_func (g_ptr_array_index (items, i),
+                                            child_notify_cb, &n_legacy_moves);
+      g_signal_connect (g_ptr_array_index (items, i), "child-notify",
+                        G_CALLBACK (child_notify_cb), &n_moves);
+      gtk_container_remove (GTK_CONTAINER (legacy), g_ptr_array_index (items, i));
+    }
+
+  gtk_widget_destroy (legacy);
+  g_object_unref (legacy);
+  g_slist_free (list);
+
+  grid = g_object_ref_sink (na_grid_new (GTK_ORIENTATION_HORIZONTAL));
+  host = g_object_new (FAKE_TYPE_HOST, NULL);
+  na_grid_add_host (NA_GRID (grid), g_object_ref (NA_HOST (host)));
+
+  /* Every item within a frame, and the main loop until the grid is done */
+  start = g_get_monotonic_time ();
+  for (i = 0; i < items->len; i++)
+    na_host_emit_item_added (NA_HOST (host), g_ptr_array_index (items, i));
+  while (g_main_context_iteration (NULL, FALSE));
+  t_grid = g_get_monotonic_time () - start;
+
+  g_assert_true (check_order (GTK_CONTAINER (grid), items));
+
+  g_test_message ("%d items", n_items);
+  g_test_message ("  sort and place all, per item: %8.1f ms, %6u moves",
+                  t_legacy / 1000.0, n_legacy_moves);
+  g_test_message ("  ordered insertion, batched:   %8.1f ms, %6u moves",
+                  t_grid / 1000.0, n_moves);
+
+  for (i = 0; i < items->len; i++)
+    na_host_emit_item_removed (NA_HOST (host), g_ptr_array_index (items, i));
+
+  gtk_widget_destroy (grid);
+  g_object_unref (grid);
+  g_object_unref (host);
+  g_ptr_array_free (items, TRUE);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GError *error;
+  GOptionContext *context;
+  GOptionEntry options[] = {
+    { "items", 'n', 0, G_OPTION_ARG_INT, &n_items, "Number of items added", "N" },
+    { NULL, 0, 0, 0, NULL, NULL, NULL }
+  };
+
+  g_test_init (&argc, &argv, NULL);
+
+  context = g_option_context_new ("");
+  g_option_context_add_main_entries (context, options, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (FALSE));
+
+  error = NULL;
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  if (n_items < 1)
+    n_items = 1;
+
+  has_display = gtk_init_check (NULL, NULL);
+
+  g_test_add_func ("/na-grid/burst", test_burst);
+
+  return g_test_run ();
+}
@@ -0,0 +1,786 @@
+/*
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/*
+ * Load generator for the notification area. A child process registers
+ * StatusNotifierItems, each on a connection of its own as applications
+ * do, and docks XEmbed icons, and updates their icons, tooltips and menus
+ * at the given rates. This process hosts them in the grid of the applet,
+ * and reports its CPU time, its D-Bus messages and how long tooltips take
+ * to show their new text. Then, the load paused, it changes the background
+ * behind the icons a few times and reports the X requests each change takes.
+ *
+ * Takes the watcher name and the tray selection, run it on a session bus
+ * and a display of its own, without a GPU:
+ *
+ *   dbus-run-session -- xvfb-run -a ./test-na-load
+ *
+ * The panel schemas have to be installed, or found in GSETTINGS_SCHEMA_DIR.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <glib-unix.h>
+#include <gtk/gtk.h>
+#ifdef HAVE_X11
+#include <gtk/gtkx.h>
+#include <gdk/gdkx.h>
+#include <X11/Xlib.h>
+#endif
+
+#include "status-notifier/sn-dbus-menu-gen.h"
+#include "status-notifier/sn-item-v0-gen.h"
+#include "libstatus-notifier-watcher/gf-status-notifier-watcher.h"
+#include "na-grid.h"
+
+#define ITEM_OBJECT_PATH "/StatusNotifierItem"
+#define MENU_OBJECT_PATH "/MenuBar"
+#define MENU_ITEMS 8
+#define BACKGROUND_CHANGES 20
+
+typedef struct
+{
+  gint    n_items;
+  gint    n_icons;
+  gdouble icon_rate;
+  gdouble tooltip_rate;
+  gdouble menu_rate;
+  gint    duration;
+} Load;
+
+/* The child: the applications */
+
+typedef struct
+{
+  GDBusConnection *connection;
+  SnItemV0Gen     *item;
+  SnDBusMenuGen   *menu;
+  guint            index;
+  guint            revision;
+  gboolean         attention;
+} FakeItem;
+
+typedef struct
+{
+  GPtrArray *items;
+  GPtrArray *icons;
+  guint      next;
+} Updates;
+
+static GVariant *
+make_tooltip (const gchar *title)
+{
+  return g_variant_new ("(s@a(iiay)ss)", "",
+                        g_variant_new_array (G_VARIANT_TYPE ("(iiay)"), NULL, 0),
+                        title, "");
+}
+
+static GVariant *
+make_layout (FakeItem *fake)
+{
+  GVariantBuilder children;
+  guint i;
+
+  g_variant_builder_init (&children, G_VARIANT_TYPE ("av"));
+
+  for (i = 1; i <= MENU_ITEMS; i++)
+    {
+      GVariantBuilder props;
+      gchar *label;
+
+      label = g_strdup_printf ("Item %u (%u)", i, fake->revision);
+      g_variant_builder_init (&props, G_VARIANT_TYPE ("a{sv}"));
+      g_variant_builder_add (&props, "{sv}", "label", g_variant_new_string (label));
+      g_variant_builder_add (&children, "v",
+                             g_variant_new ("(ia{sv}av)", i, &props, NULL));
+      g_free (label);
+    }
+
+  return g_variant_new ("(i@a{sv}av)", 0,
+                        g_variant_new_array (G_VARIANT_TYPE ("{sv}"), NULL, 0),
+                        &children);
+}
+
+static gboolean
+handle_get_layout (SnDBusMenuGen         *menu,
+                   GDBusMethodInvocation *invocation,
+                   gint                   parent,
+                   gint                   depth,
+                   const gchar *const    *property_names,
+                   FakeItem              *fake)
+{
+  sn_dbus_menu_gen_complete_get_layout (menu, invocation, fake->revision,
+                                        make_layout (fake));
+
+  return TRUE;
+}
+
+static gboolean
+handle_event (SnDBusMenuGen         *menu,
+              GDBusMethodInvocation *invocation,
+              gint                   id,
+              const gchar           *event_id,
+              GVariant              *data,
+              guint                  timestamp,
+              FakeItem              *fake)
+{
+  sn_dbus_menu_gen_complete_event (menu, invocation);
+
+  return TRUE;
+}
+
+static gboolean
+handle_about_to_show (SnDBusMenuGen         *menu,
+                      GDBusMethodInvocation *invocation,
+                      gint                   id,
+                      FakeItem              *fake)
+{
+  sn_dbus_menu_gen_complete_about_to_show (menu, invocation, FALSE);
+
+  return TRUE;
+}
+
+static FakeItem *
+fake_item_new (const gchar *address,
+               guint        index)
+{
+  FakeItem *fake;
+  gchar *id;
+  GError *error;
+
+  fake = g_new0 (FakeItem, 1);
+  fake->index = index;
+
+  error = NULL;
+  fake->connection =
+    g_dbus_connection_new_for_address_sync (address,
+                                            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                            G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                            NULL, NULL, &error);
+
+  if (fake->connection == NULL)
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_free (fake);
+      return NULL;
+    }
+
+  id = g_strdup_printf ("load-%u", index);
+
+  fake->item = sn_item_v0_gen_skeleton_new ();
+  sn_item_v0_gen_set_category (fake->item, "ApplicationStatus");
+  sn_item_v0_gen_set_id (fake->item, id);
+  sn_item_v0_gen_set_title (fake->item, id);
+  sn_item_v0_gen_set_status (fake->item, "Active");
+  sn_item_v0_gen_set_icon_name (fake->item, "dialog-information");
+  sn_item_v0_gen_set_tool_tip (fake->item, make_tooltip (id));
+  sn_item_v0_gen_set_item_is_menu (fake->item, FALSE);
+  sn_item_v0_gen_set_menu (fake->item, MENU_OBJECT_PATH);
+
+  fake->menu = sn_dbus_menu_gen_skeleton_new ();
+  sn_dbus_menu_gen_set_version (fake->menu, 3);
+  sn_dbus_menu_gen_set_status (fake->menu, "normal");
+
+  g_signal_connect (fake->menu, "handle-get-layout",
+                    G_CALLBACK (handle_get_layout), fake);
+  g_signal_connect (fake->menu, "handle-event",
+                    G_CALLBACK (handle_event), fake);
+  g_signal_connect (fake->menu, "handle-about-to-show",
+                    G_CALLBACK (handle_about_to_show), fake);
+
+  g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (fake->item),
+                                    fake->connection, ITEM_OBJECT_PATH, NULL);
+  g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (fake->menu),
+                                    fake->connection, MENU_OBJECT_PATH, NULL);
+
+  g_dbus_connection_call (fake->connection,
+                          "org.kde.StatusNotifierWatcher",
+                          "/StatusNotifierWatcher",
+                          "org.kde.StatusNotifierWatcher",
+                          "RegisterStatusNotifierItem",
+                          g_variant_new ("(s)", ITEM_OBJECT_PATH), NULL,
+                          G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL, NULL);
+
+  g_free (id);
+
+  return fake;
+}
+
+static FakeItem *
+next_item (Updates *updates)
+{
+  return g_ptr_array_index (updates->items, updates->next++ % updates->items->len);
+}
+
+static gboolean
+update_icon_cb (gpointer user_data)
+{
+  FakeItem *fake = next_item (user_data);
+
+  fake->attention = !fake->attention;
+  sn_item_v0_gen_set_icon_name (fake->item,
+                                fake->attention ? "dialog-warning" : "dialog-information");
+  sn_item_v0_gen_emit_new_icon (fake->item);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* The host reports when the text shows, see tooltip_cb() */
+static gboolean
+update_tooltip_cb (gpointer user_data)
+{
+  FakeItem *fake = next_item (user_data);
+  gchar *title;
+
+  title = g_strdup_printf ("load-%u %" G_GINT64_FORMAT,
+                           fake->index, g_get_monotonic_time ());
+  sn_item_v0_gen_set_tool_tip (fake->item, make_tooltip (title));
+  sn_item_v0_gen_emit_new_tool_tip (fake->item);
+  g_free (title);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+update_menu_cb (gpointer user_data)
+{
+  FakeItem *fake = next_item (user_data);
+
+  fake->revision++;
+  sn_dbus_menu_gen_emit_layout_updated (fake->menu, fake->revision, 0);
+
+  return G_SOURCE_CONTINUE;
+}
+
+#ifdef HAVE_X11
+static gboolean
+update_xembed_icon_cb (gpointer user_data)
+{
+  Updates *updates = user_data;
+  GtkWidget *image;
+
+  image = g_ptr_array_index (updates->icons, updates->next++ % updates->icons->len);
+  gtk_image_set_from_icon_name (GTK_IMAGE (image),
+                                updates->next % 2 ? "dialog-warning" : "dialog-information",
+                                GTK_ICON_SIZE_MENU);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static Window
+get_tray_manager (Display *xdisplay,
+                  gint     screen_number)
+{
+  gchar *selection_name;
+  Window owner;
+
+  selection_name = g_strdup_printf ("_NET_SYSTEM_TRAY_S%d", screen_number);
+  owner = XGetSelectionOwner (xdisplay, XInternAtom (xdisplay, selection_name, False));
+  g_free (selection_name);
+
+  return owner;
+}
+
+static GtkWidget *
+dock_icon (Display *xdisplay,
+           Window   manager_window)
+{
+  XClientMessageEvent ev;
+  GtkWidget *plug;
+  GtkWidget *image;
+
+  plug = gtk_plug_new (0);
+  image = gtk_image_new_from_icon_name ("dialog-information", GTK_ICON_SIZE_MENU);
+  gtk_container_add (GTK_CONTAINER (plug), image);
+  gtk_widget_show_all (plug);
+
+  memset (&ev, 0, sizeof (ev));
+  ev.type = ClientMessage;
+  ev.window = gtk_plug_get_id (GTK_PLUG (plug));
+  ev.message_type = XInternAtom (xdisplay, "_NET_SYSTEM_TRAY_OPCODE", False);
+  ev.format = 32;
+  ev.data.l[0] = CurrentTime;
+  ev.data.l[1] = 0; /* SYSTEM_TRAY_REQUEST_DOCK */
+  ev.data.l[2] = ev.window;
+
+  XSendEvent (xdisplay, manager_window, False, NoEventMask, (XEvent *) &ev);
+
+  return image;
+}
+#endif
+
+static void
+add_updates (gdouble      rate,
+             guint        n,
+             GSourceFunc  func,
+             Updates     *updates,
+             const gchar *name)
+{
+  guint id;
+
+  if (rate <= 0 || n == 0)
+    return;
+
+  /* Rates are per item, updates go to one item after another */
+  id = g_timeout_add (MAX (1, (guint) (1000 / (rate * n))), func, updates);
+  g_source_set_name_by_id (id, name);
+}
+
+static gboolean
+quit_cb (gpointer user_data)
+{
+  g_main_loop_quit (user_data);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Waits for the host to take the watcher name */
+static gboolean
+wait_for_watcher (void)
+{
+  GDBusConnection *connection;
+  gboolean has_owner = FALSE;
+  gint i;
+
+  connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
+  if (connection == NULL)
+    return FALSE;
+
+  for (i = 0; i < 200 && !has_owner; i++)
+    {
+      GVariant *reply;
+
+      reply = g_dbus_connection_call_sync (connection,
+                                           "org.freedesktop.DBus",
+                                           "/org/freedesktop/DBus",
+                                           "org.freedesktop.DBus",
+                                           "NameHasOwner",
+                                           g_variant_new ("(s)", "org.kde.StatusNotifierWatcher"),
+                                           G_VARIANT_TYPE ("(b)"),
+                                           G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+      if (reply != NULL)
+        {
+          g_variant_get (reply, "(b)", &has_owner);
+          g_variant_unref (reply);
+        }
+
+      if (!has_owner)
+        g_usleep (50 * 1000);
+    }
+
+  g_object_unref (connection);
+
+  return has_owner;
+}
+
+static int
+run_load (Load *load)
+{
+  Updates item_updates = { NULL, };
+  Updates icon_updates = { NULL, };
+  Updates tooltip_updates = { NULL, };
+  Updates menu_updates = { NULL, };
+  GMainLoop *loop;
+  gchar *address;
+  gint i;
+
+  gtk_init (NULL, NULL);
+
+  if (!wait_for_watcher ())
+    {
+      g_printerr ("No StatusNotifierWatcher on the bus\n");
+      return 1;
+    }
+
+  address = g_dbus_address_get_for_bus_sync (G_BUS_TYPE_SESSION, NULL, NULL);
+  item_updates.items = g_ptr_array_new ();
+
+  for (i = 0; i < load->n_items && address != NULL; i++)
+    {
+      FakeItem *fake;
+
+      fake = fake_item_new (address, i);
+      if (fake != NULL)
+        g_ptr_array_add (item_updates.items, fake);
+    }
+
+  g_free (address);
+
+  icon_updates.items = tooltip_updates.items = menu_updates.items = item_updates.items;
+
+  add_updates (load->icon_rate, item_updates.items->len, update_icon_cb,
+               &icon_updates, "[notification-area] update_icon_cb");
+  add_updates (load->tooltip_rate, item_updates.items->len, update_tooltip_cb,
+               &tooltip_updates, "[notification-area] update_tooltip_cb");
+  add_updates (load->menu_rate, item_updates.items->len, update_menu_cb,
+               &menu_updates, "[notification-area] update_menu_cb");
+
+#ifdef HAVE_X11
+  if (load->n_icons > 0 && GDK_IS_X11_DISPLAY (gdk_display_get_default ()))
+    {
+      Updates *xembed_updates;
+      GdkScreen *screen;
+      Display *xdisplay;
+      Window manager_window = None;
+
+      screen = gdk_screen_get_default ();
+      xdisplay = GDK_SCREEN_XDISPLAY (screen);
+
+      for (i = 0; i < 200 && manager_window == None; i++)
+        {
+          manager_window = get_tray_manager (xdisplay,
+                                             gdk_x11_screen_get_screen_number (screen));
+          if (manager_window == None)
+            g_usleep (50 * 1000);
+        }
+
+      xembed_updates = g_new0 (Updates, 1);
+      xembed_updates->icons = g_ptr_array_new ();
+
+      for (i = 0; i < load->n_icons && manager_window != None; i++)
+        g_ptr_array_add (xembed_updates->icons, dock_icon (xdisplay, manager_window));
+
+      add_updates (load->icon_rate, xembed_updates->icons->len, update_xembed_icon_cb,
+                   xembed_updates, "[notification-area] update_xembed_icon_cb");
+    }
+#endif
+
+  loop = g_main_loop_new (NULL, FALSE);
+  g_unix_signal_add (SIGTERM, quit_cb, loop);
+  g_main_loop_run (loop);
+
+  return 0;
+}
+
+/* The parent: the notification area */
+
+static gint n_messages_in = 0;
+static gint n_messages_out = 0;
+static guint n_shown = 0;
+static GArray *latencies = NULL;
+
+static GDBusMessage *
+count_messages_cb (GDBusConnection *connection,
+                   GDBusMessage    *message,
+                   gboolean         incoming,
+                   gpointer         user_data)
+{
+  /* Called from the D-Bus thread */
+  g_atomic_int_inc (incoming ? &n_messages_in : &n_messages_out);
+
+  return message;
+}
+
+static void
+tooltip_cb (GtkWidget  *widget,
+            GParamSpec *pspec,
+            gpointer    user_data)
+{
+  gchar *markup;
+  const gchar *sent;
+
+  markup = gtk_widget_get_tooltip_markup (widget);
+
+  /* "load-<index> <time it was sent>", once per update: the item sets its
+   * tooltip again whenever its icon changes */
+  if (markup != NULL && (sent = strrchr (markup, ' ')) != NULL &&
+      g_strcmp0 (sent, g_object_get_data (G_OBJECT (widget), "load-sent")) != 0)
+    {
+      gint64 latency;
+
+      latency = g_get_monotonic_time () - g_ascii_strtoll (sent + 1, NULL, 10);
+      if (latencies != NULL)
+        g_array_append_val (latencies, latency);
+
+      g_object_set_data_full (G_OBJECT (widget), "load-sent",
+                              g_strdup (sent), g_free);
+    }
+
+  g_free (markup);
+}
+
+/* The grid attaches its items without GtkContainer::add, they are looked
+ * for among its children */
+static void
+watch_items (GtkWidget *grid)
+{
+  GList *children;
+  GList *l;
+
+  children = gtk_container_get_children (GTK_CONTAINER (grid));
+
+  for (l = children; l != NULL; l = l->next)
+    {
+      if (g_object_get_data (l->data, "load-watched") != NULL)
+        continue;
+
+      g_object_set_data (l->data, "load-watched", GINT_TO_POINTER (TRUE));
+      g_signal_connect (l->data, "notify::tooltip-markup",
+                        G_CALLBACK (tooltip_cb), NULL);
+      n_shown++;
+    }
+
+  g_list_free (children);
+}
+
+static void
+run_for (guint milliseconds)
+{
+  gint64 end = g_get_monotonic_time () + milliseconds * (gint64) 1000;
+
+  while (g_get_monotonic_time () < end)
+    {
+      while (g_main_context_iteration (NULL, FALSE));
+      g_usleep (1000);
+    }
+}
+
+#ifdef HAVE_X11
+/* What the applet does when the panel background changes, see
+ * na_tray_applet_change_background(), once the load is paused: the X
+ * requests it takes, until every frame is painted */
+static gdouble
+measure_background_changes (GtkWidget *window,
+                            GtkWidget *grid)
+{
+  GtkCssProvider *provider;
+  Display *xdisplay;
+  gulong serial;
+  guint i;
+
+  provider = gtk_css_provider_new ();
+  gtk_style_context_add_provider (gtk_widget_get_style_context (window),
+                                  GTK_STYLE_PROVIDER (provider),
+                                  GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+  xdisplay = GDK_DISPLAY_XDISPLAY (gtk_widget_get_display (window));
+  run_for (100);
+  serial = NextRequest (xdisplay);
+
+  for (i = 0; i < BACKGROUND_CHANGES; i++)
+    {
+      gtk_css_provider_load_from_data (provider,
+                                       i % 2 ? "* { background-color: #3465a4; }"
+                                             : "* { background-color: #204a87; }",
+                                       -1, NULL);
+      na_grid_force_redraw (NA_GRID (grid));
+      run_for (100);
+    }
+
+  serial = NextRequest (xdisplay) - serial;
+
+  gtk_style_context_remove_provider (gtk_widget_get_style_context (window),
+                                     GTK_STYLE_PROVIDER (provider));
+  g_object_unref (provider);
+
+  return (gdouble) serial / BACKGROUND_CHANGES;
+}
+#endif
+
+static gint
+compare_latencies (gconstpointer a,
+                   gconstpointer b)
+{
+  gint64 la = *(const gint64 *) a;
+  gint64 lb = *(const gint64 *) b;
+
+  return la < lb ? -1 : la > lb;
+}
+
+static gdouble
+cpu_seconds (const struct timeval *tv)
+{
+  return tv->tv_sec + tv->tv_usec / 1000000.0;
+}
+
+static int
+run_host (Load  *load,
+          pid_t  child)
+{
+  GfStatusNotifierWatcher *watcher;
+  GDBusConnection *connection;
+  GtkWidget *window;
+  GtkWidget *grid;
+  struct rusage start_usage, end_usage;
+  gdouble user, system;
+  gint in, out;
+  gdouble background_requests = -1;
+  guint expected;
+  gint64 start;
+  gboolean ok;
+  int status;
+
+  gtk_init (NULL, NULL);
+
+  connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
+  if (connection == NULL)
+    {
+      g_printerr ("No session bus\n");
+      kill (child, SIGTERM);
+      return 1;
+    }
+
+  g_dbus_connection_add_filter (connection, count_messages_cb, NULL, NULL);
+
+  watcher = gf_status_notifier_watcher_new ();
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  grid = na_grid_new (GTK_ORIENTATION_HORIZONTAL);
+  gtk_container_add (GTK_CONTAINER (window), grid);
+  gtk_widget_show_all (window);
+
+  /* Every item and icon shown */
+  expected = load->n_items;
+#ifdef HAVE_X11
+  if (GDK_IS_X11_DISPLAY (gdk_display_get_default ()))
+    expected += load->n_icons;
+#endif
+
+  start = g_get_monotonic_time ();
+  while (n_shown < expected && g_get_monotonic_time () - start < 30 * G_USEC_PER_SEC)
+    {
+      run_for (10);
+      watch_items (grid);
+    }
+
+  g_print ("%d items, %d icons, %u of them shown in %.1f ms\n",
+           load->n_items, load->n_icons, n_shown,
+           (g_get_monotonic_time () - start) / 1000.0);
+
+  /* The load */
+  latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+  g_atomic_int_set (&n_messages_in, 0);
+  g_atomic_int_set (&n_messages_out, 0);
+  getrusage (RUSAGE_SELF, &start_usage);
+
+  run_for (load->duration * 1000);
+
+  getrusage (RUSAGE_SELF, &end_usage);
+  in = g_atomic_int_get (&n_messages_in);
+  out = g_atomic_int_get (&n_messages_out);
+
+#ifdef HAVE_X11
+  if (GDK_IS_X11_DISPLAY (gdk_display_get_default ()))
+    {
+      kill (child, SIGSTOP);
+      background_requests = measure_background_changes (window, grid);
+      kill (child, SIGCONT);
+    }
+#endif
+
+  kill (child, SIGTERM);
+  waitpid (child, &status, 0);
+
+  user = cpu_seconds (&end_usage.ru_utime) - cpu_seconds (&start_usage.ru_utime);
+  system = cpu_seconds (&end_usage.ru_stime) - cpu_seconds (&start_usage.ru_stime);
+
+  g_print ("  icons %.2f/s, tooltips %.2f/s, menus %.2f/s per item, for %d s\n",
+           load->icon_rate, load->tooltip_rate, load->menu_rate, load->duration);
+  g_print ("  CPU:             %6.2f s user, %6.2f s system, %5.1f %% of a core\n",
+           user, system, 100 * (user + system) / load->duration);
+  g_print ("  D-Bus messages:  %6d in, %6d out, %8.1f per second\n",
+           in, out, (gdouble) (in + out) / load->duration);
+
+  if (latencies->len > 0)
+    {
+      g_array_sort (latencies, compare_latencies);
+      g_print ("  tooltip latency: %6.1f ms median, %6.1f ms 95th percentile, %6.1f ms max, %u updates\n",
+               g_array_index (latencies, gint64, latencies->len / 2) / 1000.0,
+               g_array_index (latencies, gint64, latencies->len * 95 / 100) / 1000.0,
+               g_array_index (latencies, gint64, latencies->len - 1) / 1000.0,
+               latencies->len);
+    }
+
+  if (background_requests >= 0)
+    g_print ("  background:      %6.1f X requests per change, %d changes\n",
+             background_requests, BACKGROUND_CHANGES);
+
+  /* Everything shown, and the tooltips updated under the load */
+  ok = n_shown >= expected &&
+       (load->n_items == 0 || load->tooltip_rate <= 0 || latencies->len > 0);
+
+  g_array_free (latencies, TRUE);
+  latencies = NULL;
+  gtk_widget_destroy (window);
+  g_object_unref (watcher);
+  g_object_unref (connection);
+
+  g_print ("%s\n", ok ? "PASS" : "FAIL");
+
+  return ok ? 0 : 1;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Load load = { 20, 10, 1.0, 1.0, 0.2, 10 };
+  GError *error;
+  GOptionContext *context;
+  GOptionEntry options[] = {
+    { "items", 'n', 0, G_OPTION_ARG_INT, &load.n_items, "Number of StatusNotifierItems", "N" },
+    { "icons", 'm', 0, G_OPTION_ARG_INT, &load.n_icons, "Number of XEmbed icons", "M" },
+    { "icon-rate", 'i', 0, G_OPTION_ARG_DOUBLE, &load.icon_rate, "Icon updates per second, per item", "RATE" },
+    { "tooltip-rate", 't', 0, G_OPTION_ARG_DOUBLE, &load.tooltip_rate, "Tooltip updates per second, per item", "RATE" },
+    { "menu-rate", 'u', 0, G_OPTION_ARG_DOUBLE, &load.menu_rate, "Menu updates per second, per item", "RATE" },
+    { "duration", 'd', 0, G_OPTION_ARG_INT, &load.duration, "Seconds the load lasts", "SECONDS" },
+    { NULL, 0, 0, 0, NULL, NULL, NULL }
+  };
+  pid_t child;
+
+  context = g_option_context_new ("");
+  g_option_context_add_main_entries (context, options, NULL);
+
+  error = NULL;
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  load.n_items = MAX (load.n_items, 0);
+  load.n_icons = MAX (load.n_icons, 0);
+  load.duration = MAX (load.duration, 1);
+
+  /* Before anything has a thread or a connection */
+  child = fork ();
+  if (child < 0)
+    {
+      g_printerr ("Failed to fork: %s\n", g_strerror (errno));
+      return 1;
+    }
+
+  if (child == 0)
+    return run_load (&load);
+
+  return run_host (&load, child);
+}
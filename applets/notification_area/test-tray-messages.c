@@ -0,0 +1,393 @@
+/*
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/* Stress test for the balloon messages of the tray manager, with tray
+ * icons flooding it from within the test, as testtray hosts them. Needs
+ * a display without a tray running. */
+
+#include <config.h>
+
+#include <string.h>
+#include <gtk/gtk.h>
+#include <gtk/gtkx.h>
+#include <gdk/gdkx.h>
+#include <X11/Xlib.h>
+
+#include "system-tray/na-tray-manager.h"
+
+#define SYSTEM_TRAY_REQUEST_DOCK   0
+#define SYSTEM_TRAY_BEGIN_MESSAGE  1
+#define SYSTEM_TRAY_CANCEL_MESSAGE 2
+
+/* The limits of the manager, per icon */
+#define MAX_PENDING_MESSAGES 8
+#define MAX_PENDING_BYTES    (64 * 1024)
+
+typedef struct
+{
+  GtkWidget *plug;
+  Window     window;
+  guint      n_sent;
+  guint      n_cancelled;
+} Icon;
+
+#define N_ICONS 2
+
+static Display       *xdisplay;
+static Window         manager_window;
+static Atom           opcode_atom;
+static Atom           message_data_atom;
+static NaTrayManager *manager;
+static GtkWidget     *box;
+static guint          n_docked = 0;
+static guint          n_undocked = 0;
+static gint           n_messages = 2000;
+static gint           length = 200;
+
+static Icon *
+icon_for_child (NaTrayChild *child,
+                Icon        *icons)
+{
+  guint i;
+
+  for (i = 0; i < N_ICONS; i++)
+    if (icons[i].window == child->icon_window)
+      return &icons[i];
+
+  return NULL;
+}
+
+static void
+tray_icon_added_cb (NaTrayManager *manager,
+                    NaTrayChild   *child,
+                    gpointer       data)
+{
+  gtk_box_pack_start (GTK_BOX (box), GTK_WIDGET (child), FALSE, FALSE, 0);
+  n_docked++;
+}
+
+static void
+tray_icon_removed_cb (NaTrayManager *manager,
+                      NaTrayChild   *child,
+                      gpointer       data)
+{
+  gtk_container_remove (GTK_CONTAINER (box), GTK_WIDGET (child));
+  n_undocked++;
+}
+
+static void
+message_sent_cb (NaTrayManager *manager,
+                 NaTrayChild   *child,
+                 const gchar   *message,
+                 glong          id,
+                 glong          timeout,
+                 Icon          *icons)
+{
+  Icon *icon = icon_for_child (child, icons);
+
+  if (icon != NULL)
+    icon->n_sent++;
+}
+
+static void
+message_cancelled_cb (NaTrayManager *manager,
+                      NaTrayChild   *child,
+                      glong          id,
+                      Icon          *icons)
+{
+  Icon *icon = icon_for_child (child, icons);
+
+  if (icon != NULL)
+    icon->n_cancelled++;
+}
+
+/* Lets the manager handle everything sent so far */
+static void
+dispatch (void)
+{
+  XSync (xdisplay, False);
+  while (g_main_context_iteration (NULL, FALSE));
+}
+
+static gboolean
+wait_for (guint *counter,
+          guint  value)
+{
+  gint64 deadline = g_get_monotonic_time () + 5 * G_USEC_PER_SEC;
+
+  while (*counter < value && g_get_monotonic_time () < deadline)
+    {
+      dispatch ();
+      g_usleep (1000);
+    }
+
+  return *counter >= value;
+}
+
+static void
+send_opcode (Icon *icon,
+             long  opcode,
+             long  data2,
+             long  data3,
+             long  data4)
+{
+  XClientMessageEvent ev;
+
+  memset (&ev, 0, sizeof (ev));
+  ev.type = ClientMessage;
+  ev.window = icon->window;
+  ev.message_type = opcode_atom;
+  ev.format = 32;
+  ev.data.l[0] = CurrentTime;
+  ev.data.l[1] = opcode;
+  ev.data.l[2] = data2;
+  ev.data.l[3] = data3;
+  ev.data.l[4] = data4;
+
+  XSendEvent (xdisplay, manager_window, False, NoEventMask, (XEvent *) &ev);
+}
+
+/* Sends the bytes of the message last begun, from offset on */
+static void
+send_data (Icon        *icon,
+           const gchar *text,
+           gsize        offset,
+           gsize        n_bytes)
+{
+  XClientMessageEvent ev;
+  gsize end = MIN (strlen (text), offset + n_bytes);
+
+  memset (&ev, 0, sizeof (ev));
+  ev.type = ClientMessage;
+  ev.window = icon->window;
+  ev.message_type = message_data_atom;
+  ev.format = 8;
+
+  for (; offset < end; offset += 20)
+    {
+      memset (ev.data.b, 0, 20);
+      memcpy (ev.data.b, text + offset, MIN (20, end - offset));
+      XSendEvent (xdisplay, manager_window, False, NoEventMask, (XEvent *) &ev);
+    }
+}
+
+static void
+send_begin (Icon        *icon,
+            long         id,
+            const gchar *text)
+{
+  send_opcode (icon, SYSTEM_TRAY_BEGIN_MESSAGE, 0, strlen (text), id);
+}
+
+static void
+icon_init (Icon *icon)
+{
+  icon->plug = gtk_plug_new (0);
+  gtk_container_add (GTK_CONTAINER (icon->plug),
+                     gtk_image_new_from_icon_name ("dialog-information",
+                                                   GTK_ICON_SIZE_MENU));
+  gtk_widget_show_all (icon->plug);
+
+  icon->window = gtk_plug_get_id (GTK_PLUG (icon->plug));
+  send_opcode (icon, SYSTEM_TRAY_REQUEST_DOCK, icon->window, 0, 0);
+}
+
+static void
+test_messages (void)
+{
+  Icon icons[N_ICONS] = { { NULL, }, };
+  Icon *good = &icons[0];
+  Icon *chatty = &icons[1];
+  gchar *text;
+  guint n_pending;
+  gsize n_bytes;
+  gint64 start, t_alone, t_flooded;
+  guint n_chatty = 0;
+  guint i, offset;
+
+  g_signal_connect (manager, "message-sent",
+                    G_CALLBACK (message_sent_cb), icons);
+  g_signal_connect (manager, "message-cancelled",
+                    G_CALLBACK (message_cancelled_cb), icons);
+
+  icon_init (good);
+  icon_init (chatty);
+
+  g_assert_true (wait_for (&n_docked, 2));
+
+  text = g_strnfill (length, 'x');
+
+  /* An icon on its own */
+  start = g_get_monotonic_time ();
+  for (i = 0; i < (guint) n_messages; i++)
+    {
+      send_begin (good, i, text);
+      send_data (good, text, 0, length);
+    }
+  dispatch ();
+  t_alone = g_get_monotonic_time () - start;
+
+  /* Every message is sent */
+  g_assert_cmpuint (good->n_sent, ==, n_messages);
+
+  /* While another one begins messages and never finishes them, which
+   * every message data of the first one used to walk past */
+  good->n_sent = 0;
+  start = g_get_monotonic_time ();
+  for (i = 0; i < (guint) n_messages; i++)
+    {
+      send_begin (good, i, text);
+      for (offset = 0; offset < (guint) length; offset += 20)
+        {
+          send_begin (chatty, n_chatty++, text);
+          send_data (good, text, offset, 20);
+        }
+    }
+  dispatch ();
+  t_flooded = g_get_monotonic_time () - start;
+
+  /* Even while flooded, and pending messages are bounded */
+  g_assert_cmpuint (good->n_sent, ==, n_messages);
+
+  na_tray_manager_get_pending_counters (manager, &n_pending, &n_bytes);
+  g_assert_cmpuint (n_pending, <=, MAX_PENDING_MESSAGES);
+  g_assert_cmpuint (n_bytes, <=, MAX_PENDING_BYTES);
+
+  g_test_message ("%d messages of %d bytes", n_messages, length);
+  g_test_message ("  from one icon:          %8.1f ms", t_alone / 1000.0);
+  g_test_message ("  while another begins %u: %6.1f ms", n_chatty, t_flooded / 1000.0);
+  g_test_message ("  left pending:           %8u messages, %" G_GSIZE_FORMAT " bytes",
+                  n_pending, n_bytes);
+
+  /* Messages too long to hold are not */
+  send_opcode (chatty, SYSTEM_TRAY_BEGIN_MESSAGE, 0, G_MAXINT32, n_chatty);
+  dispatch ();
+  na_tray_manager_get_pending_counters (manager, NULL, &n_bytes);
+  g_assert_cmpuint (n_bytes, <=, MAX_PENDING_BYTES);
+
+  /* Nor messages that are cancelled */
+  for (i = 0; i < n_chatty; i++)
+    send_opcode (chatty, SYSTEM_TRAY_CANCEL_MESSAGE, i, 0, 0);
+  dispatch ();
+  na_tray_manager_get_pending_counters (manager, &n_pending, NULL);
+  g_assert_cmpuint (n_pending, ==, 0);
+  g_assert_cmpuint (chatty->n_cancelled, ==, n_chatty);
+
+  /* Nor those of icons gone */
+  send_begin (chatty, 0, text);
+  send_data (chatty, text, 0, length / 2);
+  dispatch ();
+  gtk_widget_destroy (chatty->plug);
+  wait_for (&n_undocked, 1);
+  na_tray_manager_get_pending_counters (manager, &n_pending, NULL);
+  g_assert_cmpuint (n_undocked, ==, 1);
+  g_assert_cmpuint (n_pending, ==, 0);
+
+  gtk_widget_destroy (good->plug);
+  wait_for (&n_undocked, 2);
+
+  g_free (text);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GtkWidget *window;
+  GdkScreen *screen;
+  gchar *selection_name;
+  int status;
+  GError *error;
+  GOptionContext *context;
+  GOptionEntry options[] = {
+    { "messages", 'n', 0, G_OPTION_ARG_INT, &n_messages, "Number of messages sent", "N" },
+    { "length", 'l', 0, G_OPTION_ARG_INT, &length, "Length of the messages", "BYTES" },
+    { NULL, 0, 0, 0, NULL, NULL, NULL }
+  };
+
+  g_test_init (&argc, &argv, NULL);
+
+  context = g_option_context_new ("");
+  g_option_context_add_main_entries (context, options, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+
+  error = NULL;
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  if (n_messages < 1)
+    n_messages = 1;
+  if (length < 1)
+    length = 1;
+
+  screen = gdk_screen_get_default ();
+  if (!GDK_IS_X11_SCREEN (screen))
+    {
+      g_printerr ("Not running on X11\n");
+      return 1;
+    }
+
+  if (na_tray_manager_check_running (screen))
+    {
+      g_printerr ("There is already a tray manager running on the screen\n");
+      return 1;
+    }
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+  gtk_container_add (GTK_CONTAINER (window), box);
+  gtk_widget_show_all (window);
+
+  manager = na_tray_manager_new ();
+  g_signal_connect (manager, "tray-icon-added",
+                    G_CALLBACK (tray_icon_added_cb), NULL);
+  g_signal_connect (manager, "tray-icon-removed",
+                    G_CALLBACK (tray_icon_removed_cb), NULL);
+
+  if (!na_tray_manager_manage_screen (manager, screen))
+    {
+      g_printerr ("Failed to manage the screen\n");
+      return 1;
+    }
+
+  xdisplay = GDK_SCREEN_XDISPLAY (screen);
+  opcode_atom = XInternAtom (xdisplay, "_NET_SYSTEM_TRAY_OPCODE", False);
+  message_data_atom = XInternAtom (xdisplay, "_NET_SYSTEM_TRAY_MESSAGE_DATA", False);
+
+  selection_name = g_strdup_printf ("_NET_SYSTEM_TRAY_S%d",
+                                    gdk_x11_screen_get_screen_number (screen));
+  manager_window = XGetSelectionOwner (xdisplay,
+                                       XInternAtom (xdisplay, selection_name, False));
+  g_free (selection_name);
+
+  g_test_add_func ("/tray-manager/messages", test_messages);
+  status = g_test_run ();
+
+  g_object_unref (manager);
+  gtk_widget_destroy (window);
+
+  return status;
+}
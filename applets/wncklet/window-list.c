@@ -243,6 +243,19 @@ static void applet_change_background(MatePanelApplet* applet, MatePanelAppletBac
 	}
 }
 
+static void applet_change_visibility(MatePanelApplet* applet, gboolean visible, TasklistData* tasklist)
+{
+	if (!visible && tasklist->preview != NULL)
+	{
+		gtk_widget_destroy (tasklist->preview);
+		tasklist->preview = NULL;
+	}
+
+	/* Keep the allocated size, but stop mapping and redrawing the
+	 * buttons while the panel cannot be seen. */
+	gtk_widget_set_child_visible (tasklist->tasklist, visible);
+}
+
 #ifdef HAVE_X11
 static cairo_surface_t*
 preview_window_thumbnail (WnckWindow   *wnck_window,
@@ -940,6 +953,9 @@ gboolean window_list_applet_fill(MatePanelApplet* applet)
 	g_signal_connect (tasklist->applet, "change-background",
 	                  G_CALLBACK(applet_change_background),
 	                  tasklist);
+	g_signal_connect (tasklist->applet, "change-visibility",
+	                  G_CALLBACK (applet_change_visibility),
+	                  tasklist);
 
 	action_group = gtk_action_group_new("Tasklist Applet Actions");
 	gtk_action_group_set_translation_domain(action_group, GETTEXT_PACKAGE);
@@ -87,6 +87,7 @@ typedef struct {
 
 	gboolean           locked;
 	gboolean           locked_down;
+	gboolean           panel_visible;
 } MatePanelAppletPrivate;
 
 enum {
@@ -95,6 +96,7 @@ enum {
 	CHANGE_BACKGROUND,
 	MOVE_FOCUS_OUT_OF_APPLET,
 	ACTIVATE,
+	CHANGE_VISIBILITY,
 	LAST_SIGNAL
 };
 
@@ -113,7 +115,8 @@ enum {
 	PROP_FLAGS,
 	PROP_SIZE_HINTS,
 	PROP_LOCKED,
-	PROP_LOCKED_DOWN
+	PROP_LOCKED_DOWN,
+	PROP_PANEL_VISIBLE
 };
 
 static void       mate_panel_applet_handle_background   (MatePanelApplet       *applet);
@@ -509,6 +512,54 @@ mate_panel_applet_set_locked_down (MatePanelApplet *applet,
 	g_object_notify (G_OBJECT (applet), "locked-down");
 }
 
+/**
+ * mate_panel_applet_get_panel_visible:
+ * @applet: a #MatePanelApplet.
+ *
+ * Gets whether @applet can currently be seen by the user. This is %FALSE
+ * while the panel holding @applet is hidden, auto-hidden, inside a closed
+ * drawer, or while the screen is locked. Applets doing periodic work that
+ * only updates what is drawn (clocks, animations, graphs) can stop it until
+ * the #MatePanelApplet::change-visibility signal reports %TRUE again.
+ *
+ * Returns: %TRUE if @applet is visible to the user.
+ **/
+gboolean
+mate_panel_applet_get_panel_visible (MatePanelApplet *applet)
+{
+	MatePanelAppletPrivate *priv;
+
+	g_return_val_if_fail (MATE_PANEL_IS_APPLET (applet), TRUE);
+
+	priv = mate_panel_applet_get_instance_private (applet);
+
+	return priv->panel_visible;
+}
+
+/* Only the panel knows whether the applet can be seen, so API is not public. */
+static void
+mate_panel_applet_set_panel_visible (MatePanelApplet *applet,
+				     gboolean         panel_visible)
+{
+	MatePanelAppletPrivate *priv;
+
+	g_return_if_fail (MATE_PANEL_IS_APPLET (applet));
+
+	priv = mate_panel_applet_get_instance_private (applet);
+
+	panel_visible = panel_visible != FALSE;
+	if (priv->panel_visible == panel_visible)
+		return;
+
+	priv->panel_visible = panel_visible;
+
+	g_signal_emit (G_OBJECT (applet),
+		       mate_panel_applet_signals [CHANGE_VISIBILITY],
+		       0, panel_visible);
+
+	g_object_notify (G_OBJECT (applet), "panel-visible");
+}
+
 #ifdef HAVE_X11
 
 static Atom _net_wm_window_type = None;
@@ -1718,6 +1769,9 @@ mate_panel_applet_get_property (GObject    *object,
 		case PROP_LOCKED_DOWN:
 			g_value_set_boolean (value, priv->locked_down);
 			break;
+		case PROP_PANEL_VISIBLE:
+			g_value_set_boolean (value, priv->panel_visible);
+			break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 	}
@@ -1780,6 +1834,9 @@ mate_panel_applet_set_property (GObject      *object,
 	case PROP_LOCKED_DOWN:
 		mate_panel_applet_set_locked_down (applet, g_value_get_boolean (value));
 		break;
+	case PROP_PANEL_VISIBLE:
+		mate_panel_applet_set_panel_visible (applet, g_value_get_boolean (value));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 	}
@@ -1899,6 +1956,7 @@ mate_panel_applet_init (MatePanelApplet *applet)
 	priv->flags  = MATE_PANEL_APPLET_FLAGS_NONE;
 	priv->orient = MATE_PANEL_APPLET_ORIENT_UP;
 	priv->size   = 24;
+	priv->panel_visible = TRUE;
 
 	priv->panel_action_group = gtk_action_group_new ("PanelActions");
 	gtk_action_group_set_translation_domain (priv->panel_action_group, GETTEXT_PACKAGE);
@@ -2100,6 +2158,13 @@ mate_panel_applet_class_init (MatePanelAppletClass *klass)
 							       "Whether Panel Applet is locked down",
 							       FALSE,
 							       G_PARAM_READWRITE));
+	g_object_class_install_property (gobject_class,
+					 PROP_PANEL_VISIBLE,
+					 g_param_spec_boolean ("panel-visible",
+							       "PanelVisible",
+							       "Whether Panel Applet can be seen by the user",
+							       TRUE,
+							       G_PARAM_READWRITE));
 
 	mate_panel_applet_signals [CHANGE_ORIENT] =
                 g_signal_new ("change-orient",
@@ -2164,6 +2229,27 @@ mate_panel_applet_class_init (MatePanelAppletClass *klass)
 			      G_TYPE_STRING,
 			      G_TYPE_UINT);
 
+	/**
+	 * MatePanelApplet::change-visibility:
+	 * @applet: the #MatePanelApplet which emitted the signal.
+	 * @visible: whether @applet can now be seen by the user.
+	 *
+	 * Emitted when the panel holding @applet is hidden or shown, when the
+	 * drawer holding it is closed or opened, and when the screen is locked
+	 * or unlocked.
+	 */
+	mate_panel_applet_signals [CHANGE_VISIBILITY] =
+		g_signal_new ("change-visibility",
+			      G_TYPE_FROM_CLASS (klass),
+			      G_SIGNAL_RUN_LAST,
+			      0,
+			      NULL,
+			      NULL,
+			      mate_panel_applet_marshal_VOID__BOOLEAN,
+			      G_TYPE_NONE,
+			      1,
+			      G_TYPE_BOOLEAN);
+
 	binding_set = gtk_binding_set_by_class (gobject_class);
 	add_tab_bindings (binding_set, 0, GTK_DIR_TAB_FORWARD);
 	add_tab_bindings (binding_set, GDK_SHIFT_MASK, GTK_DIR_TAB_BACKWARD);
@@ -2277,6 +2363,8 @@ get_property_cb (GDBusConnection *connection,
 		retval = g_variant_new_boolean (priv->locked);
 	} else if (g_strcmp0 (property_name, "LockedDown") == 0) {
 		retval = g_variant_new_boolean (priv->locked_down);
+	} else if (g_strcmp0 (property_name, "PanelVisible") == 0) {
+		retval = g_variant_new_boolean (priv->panel_visible);
 	}
 
 	return retval;
@@ -2314,6 +2402,8 @@ set_property_cb (GDBusConnection *connection,
 		mate_panel_applet_set_locked (applet, g_variant_get_boolean (value));
 	} else if (g_strcmp0 (property_name, "LockedDown") == 0) {
 		mate_panel_applet_set_locked_down (applet, g_variant_get_boolean (value));
+	} else if (g_strcmp0 (property_name, "PanelVisible") == 0) {
+		mate_panel_applet_set_panel_visible (applet, g_variant_get_boolean (value));
 	}
 
 	return TRUE;
@@ -2339,6 +2429,7 @@ static const gchar introspection_xml[] =
 	    "<property name='SizeHints' type='ai' access='readwrite'/>"
 	    "<property name='Locked' type='b' access='readwrite'/>"
 	    "<property name='LockedDown' type='b' access='readwrite'/>"
+	    "<property name='PanelVisible' type='b' access='readwrite'/>"
 	    "<signal name='Move' />"
 	    "<signal name='RemoveFromPanel' />"
 	    "<signal name='Lock' />"
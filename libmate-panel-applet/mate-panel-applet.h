@@ -111,6 +111,8 @@ void                    mate_panel_applet_set_size_hints            (MatePanelAp
 
 gboolean                mate_panel_applet_get_locked_down           (MatePanelApplet    *applet);
 
+gboolean                mate_panel_applet_get_panel_visible         (MatePanelApplet    *applet);
+
 /* Does nothing when not on X11 */
 void                    mate_panel_applet_request_focus             (MatePanelApplet    *applet,
                                                                      guint32             timestamp);
@@ -47,6 +47,9 @@ struct _MatePanelAppletContainerPrivate {
 	GtkWidget  *socket;
 
 	GHashTable *pending_ops;
+
+	/* number of signals received from the applet, for the watchdog */
+	guint64     n_messages;
 };
 
 enum {
@@ -73,7 +76,8 @@ static const AppletPropertyInfo applet_properties [] = {
 	{ "background",  "Background" },
 	{ "flags",       "Flags" },
 	{ "locked",      "Locked" },
-	{ "locked-down", "LockedDown" }
+	{ "locked-down", "LockedDown" },
+	{ "panel-visible", "PanelVisible" }
 };
 
 #define MATE_PANEL_APPLET_BUS_NAME            "org.mate.panel.applet.%s"
@@ -295,6 +299,8 @@ mate_panel_applet_container_child_signal (GDBusProxy           *proxy,
 				     GVariant             *parameters,
 				     MatePanelAppletContainer *container)
 {
+	container->priv->n_messages++;
+
 	if (g_strcmp0 (signal_name, "Move") == 0) {
 		g_signal_emit (container, signals[APPLET_MOVE], 0);
 	} else if (g_strcmp0 (signal_name, "RemoveFromPanel") == 0) {
@@ -320,6 +326,8 @@ on_property_changed (GDBusConnection      *connection,
 	GVariant    *value;
 	gchar       *key;
 
+	container->priv->n_messages++;
+
 	g_variant_get (parameters, "(s@a{sv}*)", NULL, &props, NULL);
 
 	g_variant_iter_init (&iter, props);
@@ -833,3 +841,23 @@ mate_panel_applet_container_cancel_operation (MatePanelAppletContainer *containe
 
 	g_cancellable_cancel (G_CANCELLABLE (value));
 }
+
+const gchar *
+mate_panel_applet_container_get_bus_name (MatePanelAppletContainer *container)
+{
+	g_return_val_if_fail (PANEL_IS_APPLET_CONTAINER (container), NULL);
+
+	/* In-process applets live in the panel itself */
+	if (!container->priv->out_of_process)
+		return NULL;
+
+	return container->priv->bus_name;
+}
+
+guint64
+mate_panel_applet_container_get_message_count (MatePanelAppletContainer *container)
+{
+	g_return_val_if_fail (PANEL_IS_APPLET_CONTAINER (container), 0);
+
+	return container->priv->n_messages;
+}
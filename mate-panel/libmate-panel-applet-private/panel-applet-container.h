@@ -115,6 +115,9 @@ GVariant  *mate_panel_applet_container_child_get_finish        (MatePanelAppletC
 void       mate_panel_applet_container_cancel_operation (MatePanelAppletContainer *container,
                                                          gconstpointer             operation);
 
+const gchar *mate_panel_applet_container_get_bus_name      (MatePanelAppletContainer *container);
+guint64    mate_panel_applet_container_get_message_count   (MatePanelAppletContainer *container);
+
 #ifdef __cplusplus
 }
 #endif
@@ -224,6 +224,17 @@ mate_panel_applet_frame_dbus_change_size (MatePanelAppletFrame *frame,
 					  NULL, NULL, NULL);
 }
 
+static void
+mate_panel_applet_frame_dbus_change_visibility (MatePanelAppletFrame *frame,
+					       gboolean              visible)
+{
+	MatePanelAppletFrameDBus *dbus_frame = MATE_PANEL_APPLET_FRAME_DBUS (frame);
+
+	mate_panel_applet_container_child_set (dbus_frame->priv->container,
+					  "panel-visible", g_variant_new_boolean (visible),
+					  NULL, NULL, NULL);
+}
+
 static void
 container_child_background_set (GObject      *source_object,
 				GAsyncResult *res,
@@ -271,6 +282,22 @@ mate_panel_applet_frame_dbus_change_background (MatePanelAppletFrame    *frame,
 #endif
 }
 
+static const char *
+mate_panel_applet_frame_dbus_get_bus_name (MatePanelAppletFrame *frame)
+{
+	MatePanelAppletFrameDBus *dbus_frame = MATE_PANEL_APPLET_FRAME_DBUS (frame);
+
+	return mate_panel_applet_container_get_bus_name (dbus_frame->priv->container);
+}
+
+static guint64
+mate_panel_applet_frame_dbus_get_message_count (MatePanelAppletFrame *frame)
+{
+	MatePanelAppletFrameDBus *dbus_frame = MATE_PANEL_APPLET_FRAME_DBUS (frame);
+
+	return mate_panel_applet_container_get_message_count (dbus_frame->priv->container);
+}
+
 static void
 mate_panel_applet_frame_dbus_flags_changed (MatePanelAppletContainer *container,
 				       const gchar          *prop_name,
@@ -387,6 +414,9 @@ mate_panel_applet_frame_dbus_class_init (MatePanelAppletFrameDBusClass *class)
 	frame_class->change_orientation = mate_panel_applet_frame_dbus_change_orientation;
 	frame_class->change_size = mate_panel_applet_frame_dbus_change_size;
 	frame_class->change_background = mate_panel_applet_frame_dbus_change_background;
+	frame_class->change_visibility = mate_panel_applet_frame_dbus_change_visibility;
+	frame_class->get_bus_name = mate_panel_applet_frame_dbus_get_bus_name;
+	frame_class->get_message_count = mate_panel_applet_frame_dbus_get_message_count;
 
 	GtkWidgetClass *widget_class  = GTK_WIDGET_CLASS (class);
 	gtk_widget_class_set_css_name (widget_class, "MatePanelAppletFrameDBus");
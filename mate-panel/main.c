@@ -32,6 +32,7 @@
 #include "panel-icon-names.h"
 #include "panel-reset.h"
 #include "panel-run-dialog.h"
+#include "panel-applet-watchdog.h"
 
 #ifdef HAVE_X11
 #include "panel-action-protocol.h"
@@ -71,18 +72,277 @@ parsing_error_cb (GtkCssProvider *provider,
     g_warning ("Can't parse mate-panel's CSS custom description: %s\n", error->message);
 }
 
+/* Startup is split in stages, run as soon as the stages they depend on are
+ * done. Registering on the bus is asynchronous, so everything that does not
+ * need the bus name runs while waiting for it. Timings are reported with
+ * G_MESSAGES_DEBUG=all. */
+typedef enum {
+	STARTUP_STAGE_SHELL,
+	STARTUP_STAGE_CSS,
+	STARTUP_STAGE_ICONS,
+	STARTUP_STAGE_MONITORS,
+	STARTUP_STAGE_CONFIG,
+	STARTUP_STAGE_WATCHDOG,
+	STARTUP_STAGE_ACTION_PROTOCOL,
+	STARTUP_STAGE_PROFILE,
+	STARTUP_STAGE_XSTUFF,
+	STARTUP_STAGE_SESSION,
+	STARTUP_N_STAGES
+} StartupStageId;
+
+#define STAGE(id) (1 << (STARTUP_STAGE_##id))
+
+typedef struct {
+	const char *name;
+	guint       deps;
+	/* Returns FALSE if the stage completes later, with
+	 * startup_stage_done() */
+	gboolean  (*run) (void);
+	gint64      start;
+	gint64      end;
+} StartupStage;
+
+static gboolean startup_register_shell   (void);
+static gboolean startup_load_css         (void);
+static gboolean startup_init_icons       (void);
+static gboolean startup_init_monitors    (void);
+static gboolean startup_load_config      (void);
+static gboolean startup_init_watchdog    (void);
+static gboolean startup_init_action_protocol (void);
+static gboolean startup_load_profile     (void);
+static gboolean startup_init_xstuff      (void);
+static gboolean startup_init_session     (void);
+
+static StartupStage startup_stages [STARTUP_N_STAGES] = {
+	{ "shell",           0, startup_register_shell, 0, 0 },
+	{ "css",             0, startup_load_css, 0, 0 },
+	{ "icons",           0, startup_init_icons, 0, 0 },
+	{ "monitors",        0, startup_init_monitors, 0, 0 },
+	{ "config",          0, startup_load_config, 0, 0 },
+	{ "watchdog",        STAGE (SHELL), startup_init_watchdog, 0, 0 },
+	{ "action-protocol", STAGE (SHELL), startup_init_action_protocol, 0, 0 },
+	{ "profile",         STAGE (SHELL) | STAGE (CSS) | STAGE (ICONS) |
+	                     STAGE (MONITORS) | STAGE (CONFIG), startup_load_profile, 0, 0 },
+	{ "xstuff",          STAGE (PROFILE), startup_init_xstuff, 0, 0 },
+	{ "session",         STAGE (PROFILE) | STAGE (XSTUFF) |
+	                     STAGE (ACTION_PROTOCOL), startup_init_session, 0, 0 }
+};
+
+static gint64   startup_time   = 0;
+static guint    startup_done   = 0;
+static gboolean startup_failed = FALSE;
+
+static void
+startup_report (void)
+{
+	int i;
+
+	for (i = 0; i < STARTUP_N_STAGES; i++)
+		g_debug ("Startup stage %-16s started at %8.2f ms, took %8.2f ms",
+			 startup_stages [i].name,
+			 (startup_stages [i].start - startup_time) / 1000.0,
+			 (startup_stages [i].end - startup_stages [i].start) / 1000.0);
+
+	g_debug ("Startup done after %.2f ms",
+		 (g_get_monotonic_time () - startup_time) / 1000.0);
+}
+
+static void
+startup_stage_done (StartupStageId id)
+{
+	startup_stages [id].end = g_get_monotonic_time ();
+	startup_done |= 1 << id;
+
+	if (startup_done == (1 << STARTUP_N_STAGES) - 1)
+		startup_report ();
+}
+
+static void
+startup_run_ready_stages (void)
+{
+	gboolean progress = TRUE;
+	int      i;
+
+	while (progress && !startup_failed) {
+		progress = FALSE;
+
+		for (i = 0; i < STARTUP_N_STAGES && !startup_failed; i++) {
+			StartupStage *stage = &startup_stages [i];
+
+			if (stage->start != 0 || (stage->deps & ~startup_done) != 0)
+				continue;
+
+			progress = TRUE;
+			stage->start = g_get_monotonic_time ();
+			if (stage->run ())
+				startup_stage_done (i);
+		}
+	}
+}
+
+static void
+startup_shell_registered (GObject      *source_object,
+			  GAsyncResult *res,
+			  gpointer      user_data)
+{
+	if (!panel_shell_register_finish (res)) {
+		startup_failed = TRUE;
+		gtk_main_quit ();
+		return;
+	}
+
+	startup_stage_done (STARTUP_STAGE_SHELL);
+	startup_run_ready_stages ();
+}
+
+static gboolean
+startup_register_shell (void)
+{
+	panel_shell_register_async (replace, startup_shell_registered, NULL);
+
+	return FALSE;
+}
+
+static gboolean
+startup_load_css (void)
+{
+	GtkCssProvider *css;
+	GtkStyleProvider *provider;
+
+	/*Load a css file from a GResource so the drag handle image can be loaded*/
+	css = gtk_css_provider_new ();
+	provider = GTK_STYLE_PROVIDER (css);
+
+	g_signal_connect (provider, "parsing-error", G_CALLBACK (parsing_error_cb), NULL);
+
+	gtk_css_provider_load_from_resource (css, "/org/mate/panel/theme/mate-panel.css");
+	gtk_style_context_add_provider_for_screen (gdk_screen_get_default (), provider,
+						   GTK_STYLE_PROVIDER_PRIORITY_FALLBACK);
+
+	g_object_unref (provider);
+
+	return TRUE;
+}
+
+static gboolean
+startup_init_icons (void)
+{
+	panel_init_stock_icons_and_items ();
+
+	return TRUE;
+}
+
+static gboolean
+startup_init_monitors (void)
+{
+	panel_multimonitor_init ();
+
+	return TRUE;
+}
+
+static gboolean
+startup_load_config (void)
+{
+	panel_global_config_load ();
+	panel_lockdown_init ();
+
+	return TRUE;
+}
+
+static gboolean
+startup_init_watchdog (void)
+{
+	panel_applet_watchdog_init ();
+
+	return TRUE;
+}
+
+static gboolean
+startup_init_action_protocol (void)
+{
+#ifdef HAVE_X11
+	if (GDK_IS_X11_DISPLAY (gdk_display_get_default ()))
+		panel_action_protocol_init ();
+#endif
+
+	return TRUE;
+}
+
+static gboolean
+startup_toplevel_mapped (GtkWidget *widget,
+			 GdkEvent  *event,
+			 gpointer   data)
+{
+	GSList *l;
+
+	g_debug ("First panel mapped after %.2f ms",
+		 (g_get_monotonic_time () - startup_time) / 1000.0);
+
+	for (l = panel_toplevel_list_toplevels (); l; l = l->next)
+		g_signal_handlers_disconnect_by_func (l->data,
+						      G_CALLBACK (startup_toplevel_mapped),
+						      NULL);
+
+	return FALSE;
+}
+
+static gboolean
+startup_load_profile (void)
+{
+	GSList *l;
+
+	panel_profile_load ();
+
+	/*add forbidden lists to ALL panels*/
+	g_slist_foreach (panels,
+	                 (GFunc)panel_widget_add_forbidden,
+	                 NULL);
+
+	for (l = panel_toplevel_list_toplevels (); l; l = l->next)
+		g_signal_connect (l->data, "map-event",
+				  G_CALLBACK (startup_toplevel_mapped), NULL);
+
+	return TRUE;
+}
+
+static gboolean
+startup_init_xstuff (void)
+{
+	GdkDisplay *display;
+
+	display = gdk_display_get_default ();
+
+#ifdef HAVE_X11
+	if (GDK_IS_X11_DISPLAY (display)) {
+		xstuff_init ();
+	}
+#endif
+
+	/* Flush to make sure our struts are seen by everyone starting
+	 * immediate after (eg, the caja desktop). */
+	gdk_display_flush (display);
+
+	return TRUE;
+}
+
+static gboolean
+startup_init_session (void)
+{
+	/* Do this at the end, to be sure that we're really ready when
+	 * connecting to the session manager */
+	panel_session_init ();
+
+	return TRUE;
+}
+
 int
 main (int argc, char **argv)
 {
 	char           *desktopfile;
 	GOptionContext *context;
 	GError         *error;
-	GdkDisplay     *display;
-	GdkScreen      *screen;
-	GtkCssProvider *css;
-	GtkStyleProvider *provider;
-	const gchar    *resource;
-	guint          priority;
+
+	startup_time = g_get_monotonic_time ();
 
 	bindtextdomain (GETTEXT_PACKAGE, MATELOCALEDIR);
 	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
@@ -168,57 +428,7 @@ main (int argc, char **argv)
 		gtk_window_set_default_icon_name (PANEL_ICON_PANEL);
 	}
 
-	if (!panel_shell_register (replace)) {
-		panel_cleanup_do ();
-		return -1;
-	}
-
-	display = gdk_display_get_default ();
-
-#ifdef HAVE_X11
-	if (GDK_IS_X11_DISPLAY (display))
-		panel_action_protocol_init ();
-#endif
-
-	panel_multimonitor_init ();
-	panel_init_stock_icons_and_items ();
-
-	panel_global_config_load ();
-	panel_lockdown_init ();
-	panel_profile_load ();
-
-	/*add forbidden lists to ALL panels*/
-	g_slist_foreach (panels,
-	                 (GFunc)panel_widget_add_forbidden,
-	                 NULL);
-
-#ifdef HAVE_X11
-	if (GDK_IS_X11_DISPLAY (display)) {
-		xstuff_init ();
-	}
-#endif
-
-	/* Flush to make sure our struts are seen by everyone starting
-	 * immediate after (eg, the caja desktop). */
-	gdk_display_flush (display);
-
-	/* Do this at the end, to be sure that we're really ready when
-	 * connecting to the session manager */
-	panel_session_init ();
-
-	/*Load a css file from a GResource so the drag handle image can be loaded*/
-	screen = gdk_screen_get_default ();
-	css = gtk_css_provider_new ();
-	provider = GTK_STYLE_PROVIDER (css);
-	resource = "/org/mate/panel/theme/mate-panel.css";
-	priority = GTK_STYLE_PROVIDER_PRIORITY_FALLBACK;
-
-	g_signal_connect (provider, "parsing-error", G_CALLBACK (parsing_error_cb), NULL);
-
-	gtk_css_provider_load_from_resource (css, resource);
-	gtk_style_context_add_provider_for_screen (screen, provider, priority);
-
-	g_object_unref (provider);
+	startup_run_ready_stages ();
 
 	gtk_main ();
 
@@ -226,5 +436,5 @@ main (int argc, char **argv)
 
 	panel_cleanup_do ();
 
-	return 0;
+	return startup_failed ? -1 : 0;
 }
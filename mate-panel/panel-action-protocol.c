@@ -53,16 +53,137 @@ static Atom atom_gnome_panel_action_main_menu  = None;
 static Atom atom_gnome_panel_action_run_dialog = None;
 static Atom atom_mate_panel_action_kill_dialog = None;
 
+/* Main menu used when there is neither a menu bar nor a menu button. It is
+ * built once and kept, the menu tree monitor set up by
+ * create_applications_menu() keeps it up to date. */
+static GtkWidget   *main_menu              = NULL;
+static PanelWidget *main_menu_panel        = NULL;
+static gint64       main_menu_request_time = 0;
+static gboolean     main_menu_rebuilt      = FALSE;
+
+static void
+main_menu_deactivated (GtkWidget *menu,
+		       gpointer   data)
+{
+	if (main_menu_panel)
+		panel_toplevel_pop_autohide_disabler (main_menu_panel->toplevel);
+}
+
+/* Latency probe: time between the request and the menu being mapped,
+ * shown with G_MESSAGES_DEBUG=all */
+static gboolean
+main_menu_mapped (GtkWidget *widget,
+		  GdkEvent  *event,
+		  gpointer   data)
+{
+	if (main_menu_request_time != 0) {
+		g_debug ("Main menu shown %.2f ms after the request (%s menu)",
+			 (g_get_monotonic_time () - main_menu_request_time) / 1000.0,
+			 main_menu_rebuilt ? "new" : "cached");
+		main_menu_request_time = 0;
+	}
+
+	return FALSE;
+}
+
+static void
+main_menu_panel_destroyed (GtkWidget *panel_widget,
+			   gpointer   data)
+{
+	main_menu_panel = NULL;
+
+	if (main_menu)
+		gtk_widget_destroy (main_menu);
+}
+
+static void
+main_menu_destroyed (GtkWidget *menu,
+		     gpointer   data)
+{
+	if (main_menu_panel)
+		g_signal_handlers_disconnect_by_func (main_menu_panel,
+						      G_CALLBACK (main_menu_panel_destroyed),
+						      NULL);
+
+	main_menu = NULL;
+	main_menu_panel = NULL;
+}
+
+static GtkWidget *
+panel_action_protocol_get_main_menu (void)
+{
+	PanelWidget     *panel_widget;
+	GtkWidget       *toplevel;
+	GtkStyleContext *context;
+
+	if (!panels)
+		return NULL;
+
+	panel_widget = panels->data;
+
+	main_menu_rebuilt = FALSE;
+	if (main_menu && main_menu_panel == panel_widget)
+		return main_menu;
+
+	if (main_menu)
+		gtk_widget_destroy (main_menu);
+
+	main_menu = create_main_menu (panel_widget);
+	main_menu_panel = panel_widget;
+	main_menu_rebuilt = TRUE;
+
+	g_signal_connect (main_menu, "destroy",
+			  G_CALLBACK (main_menu_destroyed), NULL);
+	g_signal_connect (main_menu, "deactivate",
+			  G_CALLBACK (main_menu_deactivated), NULL);
+	g_signal_connect (panel_widget, "destroy",
+			  G_CALLBACK (main_menu_panel_destroyed), NULL);
+
+/* Set up theme and transparency support */
+	toplevel = gtk_widget_get_toplevel (main_menu);
+/* Set menu and it's toplevel window to follow panel theme */
+	context = gtk_widget_get_style_context (GTK_WIDGET(toplevel));
+	gtk_style_context_add_class(context,"gnome-panel-menu-bar");
+	gtk_style_context_add_class(context,"mate-panel-menu-bar");
+
+	g_signal_connect (toplevel, "map-event",
+			  G_CALLBACK (main_menu_mapped), NULL);
+
+	return main_menu;
+}
+
+static gboolean
+panel_action_protocol_main_menu_needed (GdkScreen *screen)
+{
+	AppletInfo *info;
+
+	if (mate_panel_applet_get_by_type (PANEL_OBJECT_MENU_BAR, screen))
+		return FALSE;
+
+	info = mate_panel_applet_get_by_type (PANEL_OBJECT_MENU, screen);
+	if (info && !panel_menu_button_get_use_menu_path (PANEL_MENU_BUTTON (info->widget)))
+		return FALSE;
+
+	return TRUE;
+}
+
+static gboolean
+panel_action_protocol_prebuild_main_menu (gpointer data)
+{
+	if (panel_action_protocol_main_menu_needed (gdk_screen_get_default ()))
+		panel_action_protocol_get_main_menu ();
+
+	return G_SOURCE_REMOVE;
+}
+
 static void
 panel_action_protocol_main_menu (GdkScreen *screen,
 				 guint32    activate_time, GdkEvent  *event)
 {
-	PanelWidget *panel_widget;
 	GtkWidget   *menu;
 	AppletInfo  *info;
 	GdkVisual *visual;
 	GtkWidget *toplevel;
-	GtkStyleContext *context;
 	GdkSeat *seat;
 	GdkDevice *device;
 
@@ -80,21 +201,22 @@ panel_action_protocol_main_menu (GdkScreen *screen,
 		return;
 	}
 
-	panel_widget = panels->data;
-	menu = create_main_menu (panel_widget);
+	main_menu_request_time = g_get_monotonic_time ();
+
+	menu = panel_action_protocol_get_main_menu ();
+	if (!menu)
+		return;
 
-	panel_toplevel_push_autohide_disabler (panel_widget->toplevel);
+	if (gtk_widget_get_visible (menu))
+		return;
+
+	panel_toplevel_push_autohide_disabler (main_menu_panel->toplevel);
 
 	gtk_menu_set_screen (GTK_MENU (menu), screen);
-/* Set up theme and transparency support */
 	toplevel = gtk_widget_get_toplevel (menu);
 /* Fix any failures of compiz/other wm's to communicate with gtk for transparency */
 	visual = gdk_screen_get_rgba_visual(screen);
 	gtk_widget_set_visual(GTK_WIDGET(toplevel), visual);
-/* Set menu and it's toplevel window to follow panel theme */
-	context = gtk_widget_get_style_context (GTK_WIDGET(toplevel));
-	gtk_style_context_add_class(context,"gnome-panel-menu-bar");
-	gtk_style_context_add_class(context,"mate-panel-menu-bar");
 
 	seat = gdk_display_get_default_seat (gdk_display_get_default());
 	device = gdk_seat_get_pointer (seat);
@@ -203,4 +325,10 @@ panel_action_protocol_init (void)
 
 	/* We'll filter event sent on non-root windows later */
 	gdk_window_add_filter (NULL, panel_action_protocol_filter, NULL);
+
+	/* Build the main menu once the panels are loaded, so that the first
+	 * request does not have to wait for it */
+	g_idle_add_full (G_PRIORITY_LOW,
+			 panel_action_protocol_prebuild_main_menu,
+			 NULL, NULL);
 }
@@ -47,6 +47,7 @@
 #include "xstuff.h"
 #endif
 #include "panel-schemas.h"
+#include "panel-applet-watchdog.h"
 
 #include "panel-applet-frame.h"
 
@@ -69,6 +70,8 @@ static void mate_panel_applet_frame_load            (const gchar *iid,
 						gboolean     exactpos,
 						const char  *id);
 
+static void mate_panel_applet_frame_reapply_size_hints (MatePanelAppletFrame *frame);
+
 struct _MatePanelAppletFrameActivating {
 	gboolean     locked;
 	PanelWidget *panel;
@@ -82,6 +85,13 @@ struct _MatePanelAppletFrameActivating {
 /* MatePanelAppletFrame implementation */
 
 #define HANDLE_SIZE 10
+
+/* Size hints coming faster than this are coalesced */
+#define SIZE_HINTS_MIN_INTERVAL_MS 50
+/* Going back to the hints before the last ones within this delay is a flip */
+#define SIZE_HINTS_FLIP_WINDOW_MS  1000
+/* Number of flips after which the hints are considered oscillating */
+#define SIZE_HINTS_MAX_FLIPS       3
 #define MATE_PANEL_APPLET_PREFS_PATH "/org/mate/panel/objects/%s/prefs/"
 
 struct _MatePanelAppletFramePrivate {
@@ -96,8 +106,34 @@ struct _MatePanelAppletFramePrivate {
 	GdkRectangle     handle_rect;
 
 	guint            has_handle : 1;
+	guint            auto_reload : 1;
+	/* whether the toplevel holding the applet is shown */
+	guint            panel_visible : 1;
+	/* last visibility sent to the applet */
+	guint            visible : 1;
+	guint            size_hints_latched : 1;
+
+	/* Last two size hints received from the applet, used to detect
+	 * an applet and the panel resizing each other forever */
+	gint            *size_hints;
+	gsize            size_hints_len;
+	gint            *prev_size_hints;
+	gsize            prev_size_hints_len;
+	gint            *pending_size_hints;
+	gsize            pending_size_hints_len;
+	gint64           size_hints_time;
+	guint            size_hints_timeout;
+	guint            size_hints_flips;
+
+	/* debug counters */
+	guint            n_size_hints;
+	guint            n_size_hints_dropped;
+	guint            n_size_hints_oscillations;
 };
 
+static gboolean screen_locked            = FALSE;
+static guint    screensaver_subscription = 0;
+
 G_DEFINE_TYPE_WITH_PRIVATE (MatePanelAppletFrame, mate_panel_applet_frame, GTK_TYPE_EVENT_BOX)
 
 static gboolean
@@ -442,6 +478,13 @@ mate_panel_applet_frame_finalize (GObject *object)
 	panel_lockdown_notify_remove (G_CALLBACK (mate_panel_applet_frame_sync_menu_state),
 				      frame);
 
+	if (frame->priv->size_hints_timeout)
+		g_source_remove (frame->priv->size_hints_timeout);
+	frame->priv->size_hints_timeout = 0;
+
+	g_clear_pointer (&frame->priv->size_hints, g_free);
+	g_clear_pointer (&frame->priv->prev_size_hints, g_free);
+	g_clear_pointer (&frame->priv->pending_size_hints, g_free);
 	g_clear_pointer (&frame->priv->iid, g_free);
 
 	G_OBJECT_CLASS (mate_panel_applet_frame_parent_class)->finalize (object);
@@ -472,6 +515,9 @@ mate_panel_applet_frame_init (MatePanelAppletFrame *frame)
 	frame->priv->orientation = PANEL_ORIENTATION_TOP;
 	frame->priv->applet_info = NULL;
 	frame->priv->has_handle  = FALSE;
+	frame->priv->auto_reload = FALSE;
+	frame->priv->panel_visible = TRUE;
+	frame->priv->visible     = TRUE;
 }
 
 static void
@@ -541,6 +587,142 @@ mate_panel_applet_frame_change_background (MatePanelAppletFrame    *frame,
 	MATE_PANEL_APPLET_FRAME_GET_CLASS (frame)->change_background (frame, type);
 }
 
+static void
+mate_panel_applet_frame_update_visibility (MatePanelAppletFrame *frame)
+{
+	MatePanelAppletFrameClass *klass;
+	gboolean                   visible;
+
+	/* Not activated yet: the applet is told on activation */
+	if (!frame->priv->applet_info)
+		return;
+
+	visible = frame->priv->panel_visible && !screen_locked;
+	if (visible == frame->priv->visible)
+		return;
+
+	frame->priv->visible = visible;
+
+	klass = MATE_PANEL_APPLET_FRAME_GET_CLASS (frame);
+	if (klass->change_visibility)
+		klass->change_visibility (frame, visible);
+}
+
+void
+mate_panel_applet_frame_change_visibility (MatePanelAppletFrame *frame,
+					   gboolean              panel_visible)
+{
+	g_return_if_fail (PANEL_IS_APPLET_FRAME (frame));
+
+	frame->priv->panel_visible = (panel_visible != FALSE);
+	mate_panel_applet_frame_update_visibility (frame);
+}
+
+static void
+mate_panel_applet_frame_sync_visibility (MatePanelAppletFrame *frame)
+{
+	gboolean panel_visible = TRUE;
+
+	if (frame->priv->panel)
+		panel_visible = panel_toplevel_get_state (frame->priv->panel->toplevel) == PANEL_STATE_NORMAL;
+
+	mate_panel_applet_frame_change_visibility (frame, panel_visible);
+}
+
+static void
+mate_panel_applet_frame_set_screen_locked (gboolean locked)
+{
+	GSList *l;
+
+	locked = (locked != FALSE);
+	if (screen_locked == locked)
+		return;
+
+	screen_locked = locked;
+
+	for (l = mate_panel_applet_list_applets (); l; l = l->next) {
+		AppletInfo *info = l->data;
+
+		if (info->type == PANEL_OBJECT_APPLET)
+			mate_panel_applet_frame_update_visibility (MATE_PANEL_APPLET_FRAME (info->widget));
+	}
+}
+
+static void
+screensaver_active_changed (GDBusConnection *connection,
+			    const gchar     *sender_name,
+			    const gchar     *object_path,
+			    const gchar     *interface_name,
+			    const gchar     *signal_name,
+			    GVariant        *parameters,
+			    gpointer         user_data)
+{
+	gboolean active;
+
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(b)")))
+		return;
+
+	g_variant_get (parameters, "(b)", &active);
+	mate_panel_applet_frame_set_screen_locked (active);
+}
+
+static void
+screensaver_get_active_cb (GObject      *source_object,
+			   GAsyncResult *res,
+			   gpointer      user_data)
+{
+	GVariant *retval;
+	gboolean  active;
+
+	retval = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object),
+						res, NULL);
+	if (!retval)
+		return;
+
+	g_variant_get (retval, "(b)", &active);
+	g_variant_unref (retval);
+
+	mate_panel_applet_frame_set_screen_locked (active);
+}
+
+/* Applets are reported hidden while the screen is locked */
+static void
+mate_panel_applet_frame_watch_screensaver (void)
+{
+	GDBusConnection *connection;
+
+	if (screensaver_subscription != 0)
+		return;
+
+	connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
+	if (!connection)
+		return;
+
+	screensaver_subscription =
+		g_dbus_connection_signal_subscribe (connection,
+						    "org.mate.ScreenSaver",
+						    "org.mate.ScreenSaver",
+						    "ActiveChanged",
+						    "/org/mate/ScreenSaver",
+						    NULL,
+						    G_DBUS_SIGNAL_FLAGS_NONE,
+						    screensaver_active_changed,
+						    NULL, NULL);
+
+	g_dbus_connection_call (connection,
+				"org.mate.ScreenSaver",
+				"/org/mate/ScreenSaver",
+				"org.mate.ScreenSaver",
+				"GetActive",
+				NULL,
+				G_VARIANT_TYPE ("(b)"),
+				G_DBUS_CALL_FLAGS_NO_AUTO_START,
+				-1, NULL,
+				screensaver_get_active_cb, NULL);
+
+	g_object_unref (connection);
+}
+
 void
 mate_panel_applet_frame_set_panel (MatePanelAppletFrame *frame,
 			      PanelWidget      *panel)
@@ -549,6 +731,65 @@ mate_panel_applet_frame_set_panel (MatePanelAppletFrame *frame,
 	g_return_if_fail (PANEL_IS_WIDGET (panel));
 
 	frame->priv->panel = panel;
+	mate_panel_applet_frame_sync_visibility (frame);
+}
+
+const char *
+mate_panel_applet_frame_get_iid (MatePanelAppletFrame *frame)
+{
+	g_return_val_if_fail (PANEL_IS_APPLET_FRAME (frame), NULL);
+
+	return frame->priv->iid;
+}
+
+const char *
+mate_panel_applet_frame_get_id (MatePanelAppletFrame *frame)
+{
+	g_return_val_if_fail (PANEL_IS_APPLET_FRAME (frame), NULL);
+
+	if (!frame->priv->applet_info)
+		return NULL;
+
+	return frame->priv->applet_info->id;
+}
+
+const char *
+mate_panel_applet_frame_get_bus_name (MatePanelAppletFrame *frame)
+{
+	MatePanelAppletFrameClass *klass;
+
+	g_return_val_if_fail (PANEL_IS_APPLET_FRAME (frame), NULL);
+
+	klass = MATE_PANEL_APPLET_FRAME_GET_CLASS (frame);
+	if (!klass->get_bus_name)
+		return NULL;
+
+	return klass->get_bus_name (frame);
+}
+
+guint64
+mate_panel_applet_frame_get_message_count (MatePanelAppletFrame *frame)
+{
+	MatePanelAppletFrameClass *klass;
+
+	g_return_val_if_fail (PANEL_IS_APPLET_FRAME (frame), 0);
+
+	klass = MATE_PANEL_APPLET_FRAME_GET_CLASS (frame);
+	if (!klass->get_message_count)
+		return 0;
+
+	return klass->get_message_count (frame);
+}
+
+/* When set, the applet is reloaded without asking the user the next time
+ * it quits, e.g. because the watchdog terminated it. */
+void
+mate_panel_applet_frame_set_auto_reload (MatePanelAppletFrame *frame,
+					 gboolean              auto_reload)
+{
+	g_return_if_fail (PANEL_IS_APPLET_FRAME (frame));
+
+	frame->priv->auto_reload = (auto_reload != FALSE);
 }
 
 void
@@ -602,6 +843,11 @@ _mate_panel_applet_frame_activated (MatePanelAppletFrame           *frame,
 	panel_lockdown_notify_add (G_CALLBACK (mate_panel_applet_frame_sync_menu_state),
 				   frame);
 
+	panel_applet_watchdog_add_frame (frame);
+
+	mate_panel_applet_frame_watch_screensaver ();
+	mate_panel_applet_frame_sync_visibility (frame);
+
 	mate_panel_applet_stop_loading (frame_act->id);
 	mate_panel_applet_frame_activating_free (frame_act);
 }
@@ -628,28 +874,222 @@ _mate_panel_applet_frame_update_flags (MatePanelAppletFrame *frame,
 		background = &frame->priv->panel->toplevel->background;
 		mate_panel_applet_frame_change_background (frame, background->type);
 	}
+
+	/* The hints given to the panel include the handle */
+	if (old_has_handle != frame->priv->has_handle)
+		mate_panel_applet_frame_reapply_size_hints (frame);
 }
 
-void
-_mate_panel_applet_frame_update_size_hints (MatePanelAppletFrame *frame,
-                                            gint                 *size_hints,
-                                            gsize                 n_elements)
+static gboolean
+size_hints_equal (const gint *a,
+		  gsize       a_len,
+		  const gint *b,
+		  gsize       b_len)
+{
+	if (a_len != b_len)
+		return FALSE;
+
+	if (a_len == 0)
+		return TRUE;
+
+	if (!a || !b)
+		return FALSE;
+
+	return memcmp (a, b, a_len * sizeof (gint)) == 0;
+}
+
+static void
+mate_panel_applet_frame_apply_size_hints (MatePanelAppletFrame *frame,
+					  const gint           *size_hints,
+					  gsize                 n_elements)
 {
+	gint  *copy = NULL;
+	gsize  i;
+
+	frame->priv->size_hints_time = g_get_monotonic_time ();
+
+	if (n_elements > 0) {
+		copy = g_new (gint, n_elements);
+		memcpy (copy, size_hints, n_elements * sizeof (gint));
+	}
+
 	if (frame->priv->has_handle) {
 		gint extra_size = HANDLE_SIZE + 1;
-		gsize i;
 
 		for (i = 0; i < n_elements; i++)
-			size_hints[i] += extra_size;
+			copy[i] += extra_size;
 	}
 
 	/* It takes the ownership of size-hints array */
 	panel_widget_set_applet_size_hints (frame->priv->panel,
 					    GTK_WIDGET (frame),
-					    size_hints,
+					    copy,
 					    n_elements);
 }
 
+/* Hints of an oscillating applet are replaced by the largest of the two
+ * sets, so that it fits in either state and the loop stops. */
+static void
+mate_panel_applet_frame_apply_merged_size_hints (MatePanelAppletFrame *frame)
+{
+	MatePanelAppletFramePrivate *priv = frame->priv;
+	gint  *merged;
+	gsize  i;
+
+	if (priv->size_hints_len != priv->prev_size_hints_len) {
+		if (priv->prev_size_hints_len > 0 &&
+		    (priv->size_hints_len == 0 ||
+		     priv->prev_size_hints[0] > priv->size_hints[0]))
+			mate_panel_applet_frame_apply_size_hints (frame,
+								  priv->prev_size_hints,
+								  priv->prev_size_hints_len);
+		else
+			mate_panel_applet_frame_apply_size_hints (frame,
+								  priv->size_hints,
+								  priv->size_hints_len);
+		return;
+	}
+
+	merged = g_new (gint, priv->size_hints_len);
+	for (i = 0; i < priv->size_hints_len; i++)
+		merged[i] = MAX (priv->size_hints[i], priv->prev_size_hints[i]);
+
+	mate_panel_applet_frame_apply_size_hints (frame, merged, priv->size_hints_len);
+	g_free (merged);
+}
+
+/* Gives the panel the current hints again, when what is added to them
+ * changes: equal hints from the applet are dropped before that. */
+static void
+mate_panel_applet_frame_reapply_size_hints (MatePanelAppletFrame *frame)
+{
+	MatePanelAppletFramePrivate *priv = frame->priv;
+
+	if (priv->size_hints_len == 0)
+		return;
+
+	if (priv->size_hints_latched)
+		mate_panel_applet_frame_apply_merged_size_hints (frame);
+	else
+		mate_panel_applet_frame_apply_size_hints (frame,
+							  priv->size_hints,
+							  priv->size_hints_len);
+}
+
+/* Takes ownership of size_hints */
+static void
+mate_panel_applet_frame_process_size_hints (MatePanelAppletFrame *frame,
+					    gint                 *size_hints,
+					    gsize                 n_elements)
+{
+	MatePanelAppletFramePrivate *priv = frame->priv;
+	gboolean flip;
+
+	if (size_hints_equal (size_hints, n_elements,
+			      priv->size_hints, priv->size_hints_len)) {
+		priv->n_size_hints_dropped++;
+		g_free (size_hints);
+		return;
+	}
+
+	flip = size_hints_equal (size_hints, n_elements,
+				 priv->prev_size_hints, priv->prev_size_hints_len);
+
+	/* Going on with the same oscillation: the merged hints already
+	 * fit both states. */
+	if (priv->size_hints_latched && flip) {
+		g_free (priv->prev_size_hints);
+		priv->prev_size_hints = priv->size_hints;
+		priv->prev_size_hints_len = priv->size_hints_len;
+		priv->size_hints = size_hints;
+		priv->size_hints_len = n_elements;
+		priv->n_size_hints_dropped++;
+		return;
+	}
+
+	if (flip && g_get_monotonic_time () - priv->size_hints_time <
+		    SIZE_HINTS_FLIP_WINDOW_MS * G_TIME_SPAN_MILLISECOND)
+		priv->size_hints_flips++;
+	else
+		priv->size_hints_flips = 0;
+
+	priv->size_hints_latched = FALSE;
+
+	g_free (priv->prev_size_hints);
+	priv->prev_size_hints = priv->size_hints;
+	priv->prev_size_hints_len = priv->size_hints_len;
+	priv->size_hints = size_hints;
+	priv->size_hints_len = n_elements;
+
+	if (priv->size_hints_flips >= SIZE_HINTS_MAX_FLIPS) {
+		priv->size_hints_latched = TRUE;
+		priv->size_hints_flips = 0;
+		priv->n_size_hints_oscillations++;
+
+		g_debug ("Applet %s keeps changing its size hints, using the largest ones "
+			 "(%u received, %u dropped, %u oscillations)",
+			 priv->iid, priv->n_size_hints,
+			 priv->n_size_hints_dropped, priv->n_size_hints_oscillations);
+
+		mate_panel_applet_frame_apply_merged_size_hints (frame);
+		return;
+	}
+
+	mate_panel_applet_frame_apply_size_hints (frame, size_hints, n_elements);
+}
+
+static gboolean
+mate_panel_applet_frame_size_hints_timeout (gpointer user_data)
+{
+	MatePanelAppletFrame *frame = MATE_PANEL_APPLET_FRAME (user_data);
+	gint  *size_hints;
+	gsize  n_elements;
+
+	frame->priv->size_hints_timeout = 0;
+
+	size_hints = frame->priv->pending_size_hints;
+	n_elements = frame->priv->pending_size_hints_len;
+	frame->priv->pending_size_hints = NULL;
+	frame->priv->pending_size_hints_len = 0;
+
+	mate_panel_applet_frame_process_size_hints (frame, size_hints, n_elements);
+
+	return G_SOURCE_REMOVE;
+}
+
+void
+_mate_panel_applet_frame_update_size_hints (MatePanelAppletFrame *frame,
+                                            gint                 *size_hints,
+                                            gsize                 n_elements)
+{
+	gint64 elapsed;
+
+	frame->priv->n_size_hints++;
+
+	/* An update is already scheduled, only keep the latest hints */
+	if (frame->priv->size_hints_timeout) {
+		g_free (frame->priv->pending_size_hints);
+		frame->priv->pending_size_hints = size_hints;
+		frame->priv->pending_size_hints_len = n_elements;
+		frame->priv->n_size_hints_dropped++;
+		return;
+	}
+
+	elapsed = (g_get_monotonic_time () - frame->priv->size_hints_time) / G_TIME_SPAN_MILLISECOND;
+	if (frame->priv->size_hints_time != 0 &&
+	    elapsed >= 0 && elapsed < SIZE_HINTS_MIN_INTERVAL_MS) {
+		frame->priv->pending_size_hints = size_hints;
+		frame->priv->pending_size_hints_len = n_elements;
+		frame->priv->size_hints_timeout =
+			g_timeout_add (SIZE_HINTS_MIN_INTERVAL_MS - elapsed,
+				       mate_panel_applet_frame_size_hints_timeout,
+				       frame);
+		return;
+	}
+
+	mate_panel_applet_frame_process_size_hints (frame, size_hints, n_elements);
+}
+
 #ifdef HAVE_X11
 char *
 _mate_panel_applet_frame_get_background_string (MatePanelAppletFrame    *frame,
@@ -688,6 +1128,44 @@ _mate_panel_applet_frame_get_background_string (MatePanelAppletFrame    *frame,
 #endif
 
 
+static void
+mate_panel_applet_frame_reload (MatePanelAppletFrame *frame)
+{
+	AppletInfo          *info;
+	PanelWidget         *panel;
+	AppletData          *applet_data;
+	PanelObjectPackType  pack_type = PANEL_OBJECT_PACK_START;
+	int                  pack_idx = 0;
+	char                *iid;
+	char                *id = NULL;
+	int                  position = -1;
+	gboolean             locked = FALSE;
+
+	info  = frame->priv->applet_info;
+	panel = frame->priv->panel;
+	iid   = g_strdup (frame->priv->iid);
+
+	if (info) {
+		id = g_strdup (info->id);
+		position  = mate_panel_applet_get_position (info);
+		locked = panel_widget_get_applet_locked (panel, info->widget);
+
+		applet_data = g_object_get_data (G_OBJECT (info->widget), MATE_PANEL_APPLET_DATA);
+		if (applet_data) {
+			pack_type = applet_data->pack_type;
+			pack_idx  = applet_data->pack_index;
+		}
+
+		mate_panel_applet_clean (info);
+	}
+
+	mate_panel_applet_frame_load (iid, panel, locked,
+				 position, pack_type, pack_idx, TRUE, id);
+
+	g_free (iid);
+	g_free (id);
+}
+
 static void
 mate_panel_applet_frame_reload_response (GtkWidget        *dialog,
 				    int               response,
@@ -706,40 +1184,7 @@ mate_panel_applet_frame_reload_response (GtkWidget        *dialog,
 	info = frame->priv->applet_info;
 
 	if (response == PANEL_RESPONSE_RELOAD) {
-		PanelWidget *panel;
-		char        *iid;
-		char        *id = NULL;
-		int          position = -1;
-		gboolean     locked = FALSE;
-
-		panel = frame->priv->panel;
-		iid   = g_strdup (frame->priv->iid);
-
-		if (info) {
-			id = g_strdup (info->id);
-			position  = mate_panel_applet_get_position (info);
-			locked = panel_widget_get_applet_locked (panel, info->widget);
-			mate_panel_applet_clean (info);
-		}
-
-		AppletData *applet_data;
-		PanelObjectPackType pack_type = PANEL_OBJECT_PACK_START;
-		int pack_idx = 0;
-
-		if (info) {
-			applet_data = g_object_get_data (G_OBJECT (info->widget), MATE_PANEL_APPLET_DATA);
-			if (applet_data) {
-				pack_type = applet_data->pack_type;
-				pack_idx  = applet_data->pack_index;
-			}
-		}
-
-		mate_panel_applet_frame_load (iid, panel, locked,
-					 position, pack_type, pack_idx, TRUE, id);
-
-		g_free (iid);
-		g_free (id);
-
+		mate_panel_applet_frame_reload (frame);
 	} else if (response == PANEL_RESPONSE_DELETE) {
 		/* if we can't write to applets list we can't really delete
 		   it, so we'll just ignore this.  FIXME: handle this
@@ -752,6 +1197,15 @@ mate_panel_applet_frame_reload_response (GtkWidget        *dialog,
 	gtk_widget_destroy (dialog);
 }
 
+static gboolean
+mate_panel_applet_frame_auto_reload_idle (MatePanelAppletFrame *frame)
+{
+	if (frame->priv->iid && frame->priv->panel)
+		mate_panel_applet_frame_reload (frame);
+
+	return G_SOURCE_REMOVE;
+}
+
 void
 _mate_panel_applet_frame_applet_broken (MatePanelAppletFrame *frame)
 {
@@ -767,6 +1221,15 @@ _mate_panel_applet_frame_applet_broken (MatePanelAppletFrame *frame)
 		return;
 #endif
 
+	if (frame->priv->auto_reload) {
+		frame->priv->auto_reload = FALSE;
+		g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+				 (GSourceFunc) mate_panel_applet_frame_auto_reload_idle,
+				 g_object_ref (frame),
+				 g_object_unref);
+		return;
+	}
+
 	if (frame->priv->iid) {
 		MatePanelAppletInfo *info;
 
@@ -69,6 +69,13 @@ struct _MatePanelAppletFrameClass {
 
 	void     (*change_background)     (MatePanelAppletFrame    *frame,
 					   PanelBackgroundType  type);
+
+	void     (*change_visibility)     (MatePanelAppletFrame    *frame,
+					   gboolean             visible);
+
+	const char *(*get_bus_name)       (MatePanelAppletFrame    *frame);
+
+	guint64  (*get_message_count)     (MatePanelAppletFrame    *frame);
 };
 
 struct _MatePanelAppletFrame {
@@ -101,9 +108,23 @@ void  mate_panel_applet_frame_change_size        (MatePanelAppletFrame    *frame
 void  mate_panel_applet_frame_change_background  (MatePanelAppletFrame    *frame,
 					     PanelBackgroundType  type);
 
+void  mate_panel_applet_frame_change_visibility  (MatePanelAppletFrame    *frame,
+					     gboolean             panel_visible);
+
 void  mate_panel_applet_frame_set_panel          (MatePanelAppletFrame    *frame,
 					     PanelWidget         *panel);
 
+const char *mate_panel_applet_frame_get_iid      (MatePanelAppletFrame    *frame);
+
+const char *mate_panel_applet_frame_get_id       (MatePanelAppletFrame    *frame);
+
+const char *mate_panel_applet_frame_get_bus_name (MatePanelAppletFrame    *frame);
+
+guint64     mate_panel_applet_frame_get_message_count (MatePanelAppletFrame *frame);
+
+void  mate_panel_applet_frame_set_auto_reload    (MatePanelAppletFrame    *frame,
+					     gboolean             auto_reload);
+
 /* For module implementations only */
 
 typedef struct _MatePanelAppletFrameActivating        MatePanelAppletFrameActivating;
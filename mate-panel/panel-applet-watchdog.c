@@ -0,0 +1,640 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * panel-applet-watchdog.c: resource accounting for out-of-process applets
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/*
+ * The watchdog periodically samples every out-of-process applet: CPU time,
+ * resident memory and voluntary context switches (a good approximation of
+ * wakeups) are read from /proc, and the number of D-Bus messages the applet
+ * sent to the panel is taken from its container. The last sample is exposed
+ * on the session bus as org.mate.panel.AppletWatchdog, and applets that stay
+ * above the configured thresholds are reported or restarted.
+ */
+
+#include <config.h>
+
+#include <signal.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+
+#include <libpanel-util/panel-cleanup.h>
+
+#include "panel-enums-gsettings.h"
+#include "panel-schemas.h"
+
+#include "panel-applet-watchdog.h"
+
+#define WATCHDOG_OBJECT_PATH "/org/mate/panel/AppletWatchdog"
+#define WATCHDOG_INTERFACE   "org.mate.panel.AppletWatchdog"
+
+/* Number of consecutive samples an applet has to spend above a threshold
+ * before the watchdog acts, so that short bursts (like the applet starting
+ * up) are tolerated. */
+#define WATCHDOG_STRIKES 2
+
+typedef struct {
+	MatePanelAppletFrame *frame;
+
+	guint    pid;
+	gboolean pid_requested;
+
+	gint64   last_sample;
+	guint64  last_cpu_ticks;
+	guint64  last_switches;
+	guint64  last_messages;
+
+	gdouble  cpu_percent;
+	guint64  rss_kb;
+	gdouble  wakeups_per_sec;
+	gdouble  messages_per_sec;
+
+	guint    strikes;
+	guint    n_violations;
+} WatchdogEntry;
+
+static GSList          *entries = NULL;
+static GSettings       *watchdog_settings = NULL;
+static GDBusConnection *watchdog_connection = NULL;
+static GDBusNodeInfo   *introspection_data = NULL;
+static guint            registration_id = 0;
+static guint            sample_timeout = 0;
+static long             clock_ticks = 0;
+
+static void watchdog_update_timeout (void);
+
+static WatchdogEntry *
+watchdog_find_entry (MatePanelAppletFrame *frame)
+{
+	GSList *l;
+
+	for (l = entries; l; l = l->next) {
+		WatchdogEntry *entry = l->data;
+
+		if (entry->frame == frame)
+			return entry;
+	}
+
+	return NULL;
+}
+
+static gboolean
+watchdog_read_stat (guint    pid,
+		    guint64 *cpu_ticks)
+{
+	char     *path;
+	char     *contents = NULL;
+	char     *p;
+	gboolean  retval = FALSE;
+
+	path = g_strdup_printf ("/proc/%u/stat", pid);
+	if (!g_file_get_contents (path, &contents, NULL, NULL)) {
+		g_free (path);
+		return FALSE;
+	}
+	g_free (path);
+
+	/* The command name can contain spaces and parentheses: skip to the
+	 * last ')' before splitting the remaining fields. fields[0] is then
+	 * the process state (field 3 in proc(5)). */
+	p = strrchr (contents, ')');
+	if (p && p[1] == ' ') {
+		char **fields;
+
+		fields = g_strsplit (p + 2, " ", 0);
+		if (g_strv_length (fields) > 12) {
+			/* utime and stime */
+			*cpu_ticks = g_ascii_strtoull (fields[11], NULL, 10) +
+				     g_ascii_strtoull (fields[12], NULL, 10);
+			retval = TRUE;
+		}
+		g_strfreev (fields);
+	}
+
+	g_free (contents);
+
+	return retval;
+}
+
+static gboolean
+watchdog_read_status (guint    pid,
+		      guint64 *rss_kb,
+		      guint64 *switches)
+{
+	char  *path;
+	char  *contents = NULL;
+	char **lines;
+	int    i;
+
+	path = g_strdup_printf ("/proc/%u/status", pid);
+	if (!g_file_get_contents (path, &contents, NULL, NULL)) {
+		g_free (path);
+		return FALSE;
+	}
+	g_free (path);
+
+	*rss_kb = 0;
+	*switches = 0;
+
+	lines = g_strsplit (contents, "\n", 0);
+	for (i = 0; lines[i] != NULL; i++) {
+		if (g_str_has_prefix (lines[i], "VmRSS:"))
+			*rss_kb = g_ascii_strtoull (lines[i] + strlen ("VmRSS:"), NULL, 10);
+		else if (g_str_has_prefix (lines[i], "voluntary_ctxt_switches:"))
+			*switches = g_ascii_strtoull (lines[i] + strlen ("voluntary_ctxt_switches:"), NULL, 10);
+	}
+	g_strfreev (lines);
+	g_free (contents);
+
+	return TRUE;
+}
+
+static void
+watchdog_got_pid_cb (GObject      *source_object,
+		     GAsyncResult *res,
+		     gpointer      user_data)
+{
+	MatePanelAppletFrame *frame = MATE_PANEL_APPLET_FRAME (user_data);
+	WatchdogEntry        *entry;
+	GVariant             *retvals;
+	GError               *error = NULL;
+
+	retvals = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object),
+						 res, &error);
+
+	entry = watchdog_find_entry (frame);
+
+	if (!retvals) {
+		g_debug ("Cannot get the process of applet %s: %s",
+			 mate_panel_applet_frame_get_iid (frame), error->message);
+		g_error_free (error);
+	} else {
+		if (entry) {
+			g_variant_get (retvals, "(u)", &entry->pid);
+			entry->last_sample = 0;
+		}
+		g_variant_unref (retvals);
+	}
+
+	if (entry)
+		entry->pid_requested = FALSE;
+
+	g_object_unref (frame);
+}
+
+static void
+watchdog_request_pid (WatchdogEntry *entry,
+		      const char    *bus_name)
+{
+	if (entry->pid_requested || !watchdog_connection)
+		return;
+
+	entry->pid_requested = TRUE;
+
+	g_dbus_connection_call (watchdog_connection,
+				"org.freedesktop.DBus",
+				"/org/freedesktop/DBus",
+				"org.freedesktop.DBus",
+				"GetConnectionUnixProcessID",
+				g_variant_new ("(s)", bus_name),
+				G_VARIANT_TYPE ("(u)"),
+				G_DBUS_CALL_FLAGS_NONE,
+				-1, NULL,
+				watchdog_got_pid_cb,
+				g_object_ref (entry->frame));
+}
+
+static void
+watchdog_sample_entry (WatchdogEntry *entry,
+		       gint64         now)
+{
+	const char *bus_name;
+	guint64     cpu_ticks;
+	guint64     rss_kb;
+	guint64     switches;
+	guint64     messages;
+
+	/* NULL for in-process applets, which we cannot tell apart from the
+	 * panel itself, and for applets that are still loading */
+	bus_name = mate_panel_applet_frame_get_bus_name (entry->frame);
+	if (!bus_name)
+		return;
+
+	if (entry->pid == 0) {
+		watchdog_request_pid (entry, bus_name);
+		return;
+	}
+
+	if (!watchdog_read_stat (entry->pid, &cpu_ticks) ||
+	    !watchdog_read_status (entry->pid, &rss_kb, &switches)) {
+		/* The process went away; look it up again next time */
+		entry->pid = 0;
+		return;
+	}
+
+	messages = mate_panel_applet_frame_get_message_count (entry->frame);
+
+	if (entry->last_sample > 0 && now > entry->last_sample) {
+		gdouble elapsed;
+
+		elapsed = (gdouble) (now - entry->last_sample) / G_USEC_PER_SEC;
+
+		entry->cpu_percent = 100.0 * (cpu_ticks - entry->last_cpu_ticks) /
+				     clock_ticks / elapsed;
+		entry->wakeups_per_sec = (switches - entry->last_switches) / elapsed;
+		entry->messages_per_sec = (messages - entry->last_messages) / elapsed;
+	}
+
+	entry->rss_kb = rss_kb;
+
+	entry->last_sample = now;
+	entry->last_cpu_ticks = cpu_ticks;
+	entry->last_switches = switches;
+	entry->last_messages = messages;
+}
+
+static gboolean
+watchdog_entry_over_threshold (WatchdogEntry *entry,
+			       GString       *reason)
+{
+	guint cpu_threshold;
+	guint rss_threshold;
+	guint wakeup_threshold;
+	guint message_threshold;
+
+	cpu_threshold = g_settings_get_uint (watchdog_settings,
+					     PANEL_APPLET_WATCHDOG_CPU_THRESHOLD_KEY);
+	rss_threshold = g_settings_get_uint (watchdog_settings,
+					     PANEL_APPLET_WATCHDOG_RSS_THRESHOLD_KEY);
+	wakeup_threshold = g_settings_get_uint (watchdog_settings,
+						PANEL_APPLET_WATCHDOG_WAKEUP_THRESHOLD_KEY);
+	message_threshold = g_settings_get_uint (watchdog_settings,
+						 PANEL_APPLET_WATCHDOG_MESSAGE_THRESHOLD_KEY);
+
+	if (cpu_threshold > 0 && entry->cpu_percent > cpu_threshold)
+		g_string_append_printf (reason, " cpu=%.1f%%", entry->cpu_percent);
+	if (rss_threshold > 0 && entry->rss_kb / 1024 > rss_threshold)
+		g_string_append_printf (reason, " rss=%" G_GUINT64_FORMAT "KiB", entry->rss_kb);
+	if (wakeup_threshold > 0 && entry->wakeups_per_sec > wakeup_threshold)
+		g_string_append_printf (reason, " wakeups=%.1f/s", entry->wakeups_per_sec);
+	if (message_threshold > 0 && entry->messages_per_sec > message_threshold)
+		g_string_append_printf (reason, " messages=%.1f/s", entry->messages_per_sec);
+
+	return reason->len > 0;
+}
+
+static void
+watchdog_restart (guint pid)
+{
+	GSList *l;
+
+	if (pid == 0 || pid == (guint) getpid ())
+		return;
+
+	/* Several applets can share a factory process: all of them go down
+	 * with it, so all of them have to come back. */
+	for (l = entries; l; l = l->next) {
+		WatchdogEntry *entry = l->data;
+
+		if (entry->pid != pid)
+			continue;
+
+		mate_panel_applet_frame_set_auto_reload (entry->frame, TRUE);
+		entry->pid = 0;
+		entry->strikes = 0;
+	}
+
+	kill ((pid_t) pid, SIGTERM);
+}
+
+static void
+watchdog_check_entry (WatchdogEntry             *entry,
+		      PanelAppletWatchdogAction  action)
+{
+	GString *reason;
+	guint    pid;
+
+	if (entry->pid == 0)
+		return;
+
+	reason = g_string_new (NULL);
+
+	if (!watchdog_entry_over_threshold (entry, reason)) {
+		entry->strikes = 0;
+		g_string_free (reason, TRUE);
+		return;
+	}
+
+	/* Only act once each time the applet crosses the thresholds */
+	if (++entry->strikes != WATCHDOG_STRIKES) {
+		g_string_free (reason, TRUE);
+		return;
+	}
+
+	entry->n_violations++;
+	pid = entry->pid;
+
+	if (watchdog_connection)
+		g_dbus_connection_emit_signal (watchdog_connection,
+					       NULL,
+					       WATCHDOG_OBJECT_PATH,
+					       WATCHDOG_INTERFACE,
+					       "ThresholdExceeded",
+					       g_variant_new ("(sus)",
+							      mate_panel_applet_frame_get_iid (entry->frame),
+							      pid,
+							      reason->str + 1),
+					       NULL);
+
+	switch (action) {
+	case PANEL_APPLET_WATCHDOG_ACTION_WARN:
+		g_warning ("Applet %s (pid %u) exceeds the watchdog thresholds:%s",
+			   mate_panel_applet_frame_get_iid (entry->frame),
+			   pid, reason->str);
+		break;
+	case PANEL_APPLET_WATCHDOG_ACTION_RESTART:
+		g_warning ("Applet %s (pid %u) exceeds the watchdog thresholds:%s; restarting it",
+			   mate_panel_applet_frame_get_iid (entry->frame),
+			   pid, reason->str);
+		watchdog_restart (pid);
+		break;
+	case PANEL_APPLET_WATCHDOG_ACTION_NONE:
+	default:
+		break;
+	}
+
+	g_string_free (reason, TRUE);
+}
+
+static gboolean
+watchdog_sample (gpointer user_data)
+{
+	PanelAppletWatchdogAction  action;
+	GSList                    *l;
+	gint64                     now;
+
+	now = g_get_monotonic_time ();
+	action = g_settings_get_enum (watchdog_settings,
+				      PANEL_APPLET_WATCHDOG_ACTION_KEY);
+
+	for (l = entries; l; l = l->next)
+		watchdog_sample_entry (l->data, now);
+
+	/* watchdog_restart() can modify other entries, so check separately */
+	for (l = entries; l; l = l->next)
+		watchdog_check_entry (l->data, action);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+watchdog_update_timeout (void)
+{
+	guint interval;
+
+	if (sample_timeout != 0) {
+		g_source_remove (sample_timeout);
+		sample_timeout = 0;
+	}
+
+	if (!watchdog_settings || !entries)
+		return;
+
+	interval = g_settings_get_uint (watchdog_settings,
+					PANEL_APPLET_WATCHDOG_INTERVAL_KEY);
+	if (interval == 0)
+		return;
+
+	sample_timeout = g_timeout_add_seconds (interval, watchdog_sample, NULL);
+	g_source_set_name_by_id (sample_timeout, "[mate-panel] applet watchdog");
+}
+
+static void
+watchdog_frame_finalized (gpointer  data,
+			  GObject  *where_the_object_was)
+{
+	GSList *l;
+
+	for (l = entries; l; l = l->next) {
+		WatchdogEntry *entry = l->data;
+
+		if ((GObject *) entry->frame == where_the_object_was) {
+			entries = g_slist_delete_link (entries, l);
+			g_slice_free (WatchdogEntry, entry);
+			break;
+		}
+	}
+
+	if (!entries)
+		watchdog_update_timeout ();
+}
+
+void
+panel_applet_watchdog_add_frame (MatePanelAppletFrame *frame)
+{
+	WatchdogEntry *entry;
+
+	g_return_if_fail (PANEL_IS_APPLET_FRAME (frame));
+
+	if (watchdog_find_entry (frame))
+		return;
+
+	entry = g_slice_new0 (WatchdogEntry);
+	entry->frame = frame;
+	g_object_weak_ref (G_OBJECT (frame), watchdog_frame_finalized, NULL);
+
+	entries = g_slist_prepend (entries, entry);
+
+	if (sample_timeout == 0)
+		watchdog_update_timeout ();
+}
+
+void
+panel_applet_watchdog_remove_frame (MatePanelAppletFrame *frame)
+{
+	g_return_if_fail (PANEL_IS_APPLET_FRAME (frame));
+
+	if (!watchdog_find_entry (frame))
+		return;
+
+	g_object_weak_unref (G_OBJECT (frame), watchdog_frame_finalized, NULL);
+	watchdog_frame_finalized (NULL, G_OBJECT (frame));
+}
+
+static GVariant *
+watchdog_get_statistics (void)
+{
+	GVariantBuilder  builder;
+	GSList          *l;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sssudtddu)"));
+
+	for (l = entries; l; l = l->next) {
+		WatchdogEntry *entry = l->data;
+		const char    *id;
+		const char    *iid;
+		const char    *bus_name;
+
+		if (entry->pid == 0)
+			continue;
+
+		id = mate_panel_applet_frame_get_id (entry->frame);
+		iid = mate_panel_applet_frame_get_iid (entry->frame);
+		bus_name = mate_panel_applet_frame_get_bus_name (entry->frame);
+
+		g_variant_builder_add (&builder, "(sssudtddu)",
+				       id ? id : "",
+				       iid ? iid : "",
+				       bus_name ? bus_name : "",
+				       entry->pid,
+				       entry->cpu_percent,
+				       entry->rss_kb,
+				       entry->wakeups_per_sec,
+				       entry->messages_per_sec,
+				       entry->n_violations);
+	}
+
+	return g_variant_new ("(a(sssudtddu))", &builder);
+}
+
+static void
+method_call_cb (GDBusConnection       *connection,
+		const gchar           *sender,
+		const gchar           *object_path,
+		const gchar           *interface_name,
+		const gchar           *method_name,
+		GVariant              *parameters,
+		GDBusMethodInvocation *invocation,
+		gpointer               user_data)
+{
+	if (g_strcmp0 (method_name, "GetStatistics") == 0) {
+		g_dbus_method_invocation_return_value (invocation,
+						       watchdog_get_statistics ());
+	} else if (g_strcmp0 (method_name, "Sample") == 0) {
+		watchdog_sample (NULL);
+		g_dbus_method_invocation_return_value (invocation, NULL);
+	}
+}
+
+static const gchar introspection_xml[] =
+	"<node>"
+	    "<interface name='org.mate.panel.AppletWatchdog'>"
+	      "<method name='GetStatistics'>"
+	        "<arg name='applets' type='a(sssudtddu)' direction='out'/>"
+	      "</method>"
+	      "<method name='Sample'/>"
+	      "<signal name='ThresholdExceeded'>"
+	        "<arg name='iid' type='s'/>"
+	        "<arg name='pid' type='u'/>"
+	        "<arg name='reason' type='s'/>"
+	      "</signal>"
+	    "</interface>"
+	  "</node>";
+
+static const GDBusInterfaceVTable interface_vtable = {
+	method_call_cb,
+	NULL,
+	NULL,
+	{ 0 }
+};
+
+static void
+watchdog_settings_changed (GSettings   *settings,
+			   const gchar *key,
+			   gpointer     user_data)
+{
+	if (g_strcmp0 (key, PANEL_APPLET_WATCHDOG_INTERVAL_KEY) == 0)
+		watchdog_update_timeout ();
+}
+
+static void
+panel_applet_watchdog_cleanup (gpointer data)
+{
+	GSList *l;
+
+	if (sample_timeout != 0) {
+		g_source_remove (sample_timeout);
+		sample_timeout = 0;
+	}
+
+	for (l = entries; l; l = l->next) {
+		WatchdogEntry *entry = l->data;
+
+		g_object_weak_unref (G_OBJECT (entry->frame),
+				     watchdog_frame_finalized, NULL);
+		g_slice_free (WatchdogEntry, entry);
+	}
+	g_slist_free (entries);
+	entries = NULL;
+
+	if (registration_id != 0) {
+		g_dbus_connection_unregister_object (watchdog_connection,
+						     registration_id);
+		registration_id = 0;
+	}
+
+	g_clear_pointer (&introspection_data, g_dbus_node_info_unref);
+	g_clear_object (&watchdog_connection);
+	g_clear_object (&watchdog_settings);
+}
+
+void
+panel_applet_watchdog_init (void)
+{
+	GError *error = NULL;
+
+	if (watchdog_settings)
+		return;
+
+	clock_ticks = sysconf (_SC_CLK_TCK);
+	if (clock_ticks <= 0)
+		clock_ticks = 100;
+
+	watchdog_settings = g_settings_new (PANEL_SCHEMA);
+	g_signal_connect (watchdog_settings, "changed",
+			  G_CALLBACK (watchdog_settings_changed), NULL);
+
+	panel_cleanup_register (PANEL_CLEAN_FUNC (panel_applet_watchdog_cleanup), NULL);
+
+	watchdog_connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+	if (!watchdog_connection) {
+		g_warning ("Cannot export the applet watchdog: %s", error->message);
+		g_error_free (error);
+		return;
+	}
+
+	introspection_data = g_dbus_node_info_new_for_xml (introspection_xml, NULL);
+	registration_id =
+		g_dbus_connection_register_object (watchdog_connection,
+						   WATCHDOG_OBJECT_PATH,
+						   introspection_data->interfaces[0],
+						   &interface_vtable,
+						   NULL, NULL,
+						   &error);
+	if (error) {
+		g_warning ("Cannot export the applet watchdog: %s", error->message);
+		g_error_free (error);
+	}
+
+	watchdog_update_timeout ();
+}
@@ -0,0 +1,42 @@
+/*
+ * panel-applet-watchdog.h: resource accounting for out-of-process applets
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __PANEL_APPLET_WATCHDOG_H__
+#define __PANEL_APPLET_WATCHDOG_H__
+
+#include <glib.h>
+
+#include "panel-applet-frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void panel_applet_watchdog_init         (void);
+
+void panel_applet_watchdog_add_frame    (MatePanelAppletFrame *frame);
+void panel_applet_watchdog_remove_frame (MatePanelAppletFrame *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PANEL_APPLET_WATCHDOG_H__ */
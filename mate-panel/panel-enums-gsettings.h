@@ -78,6 +78,12 @@ typedef enum {
 	PANEL_ACTION_LAST
 } PanelActionButtonType;
 
+typedef enum {
+	PANEL_APPLET_WATCHDOG_ACTION_NONE    = 0,
+	PANEL_APPLET_WATCHDOG_ACTION_WARN    = 1,
+	PANEL_APPLET_WATCHDOG_ACTION_RESTART = 2
+} PanelAppletWatchdogAction;
+
 G_END_DECLS
 
 #endif /* __PANEL_ENUMS_GSETTINGS_H__ */
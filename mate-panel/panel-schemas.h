@@ -16,6 +16,12 @@
 #define PANEL_LOCKED_DOWN_KEY         "locked-down"
 #define PANEL_DISABLE_FORCE_QUIT_KEY  "disable-force-quit"
 #define PANEL_DISABLED_APPLETS_KEY    "disabled-applets"
+#define PANEL_APPLET_WATCHDOG_INTERVAL_KEY          "applet-watchdog-interval"
+#define PANEL_APPLET_WATCHDOG_ACTION_KEY            "applet-watchdog-action"
+#define PANEL_APPLET_WATCHDOG_CPU_THRESHOLD_KEY     "applet-watchdog-cpu-threshold"
+#define PANEL_APPLET_WATCHDOG_RSS_THRESHOLD_KEY     "applet-watchdog-rss-threshold"
+#define PANEL_APPLET_WATCHDOG_WAKEUP_THRESHOLD_KEY  "applet-watchdog-wakeup-threshold"
+#define PANEL_APPLET_WATCHDOG_MESSAGE_THRESHOLD_KEY "applet-watchdog-message-threshold"
 
 #define PANEL_TOPLEVEL_SCHEMA                "org.mate.panel.toplevel"
 #define PANEL_TOPLEVEL_NAME_KEY              "name"
@@ -68,44 +68,26 @@ panel_shell_cleanup (gpointer data)
 	}
 }
 
-gboolean
-panel_shell_register (gboolean replace)
+static void
+panel_shell_register_failed (void)
 {
-	GBusNameOwnerFlags flags;
-	guint32            request_name_reply;
-	GVariant          *result;
-	gboolean           retval = FALSE;
-	GError            *error = NULL;
-
-	if (dbus_connection != NULL)
-		return TRUE;
-
-	panel_cleanup_register (PANEL_CLEAN_FUNC (panel_shell_cleanup), NULL);
-
-	/* There isn't a sync version of g_bus_own_name, so we have to requeste
-	 * the name manually here. There's no ui yet so it's safe to use this
-	 * sync api */
-	dbus_connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
-	if (dbus_connection == NULL) {
-		g_warning ("Cannot register the panel shell: %s", error->message);
-		goto register_out;
-	}
-
-	flags = G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT;
-	if (replace)
-		flags |= G_BUS_NAME_OWNER_FLAGS_REPLACE;
+	panel_session_do_not_restart ();
+	panel_shell_cleanup (NULL);
+}
 
-	result = g_dbus_connection_call_sync (dbus_connection,
-					      "org.freedesktop.DBus",
-					      "/org/freedesktop/DBus",
-					      "org.freedesktop.DBus",
-					      "RequestName",
-					      g_variant_new ("(su)",
-							     PANEL_DBUS_SERVICE,
-							     flags),
-					      G_VARIANT_TYPE ("(u)"),
-					      G_DBUS_CALL_FLAGS_NONE,
-					      -1, NULL, &error);
+static void
+panel_shell_request_name_cb (GObject      *source_object,
+			     GAsyncResult *res,
+			     gpointer      user_data)
+{
+	GTask    *task = G_TASK (user_data);
+	guint32   request_name_reply;
+	GVariant *result;
+	gboolean  retval = FALSE;
+	GError   *error = NULL;
+
+	result = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object),
+						res, &error);
 	if (!result) {
 		g_warning ("Cannot register the panel shell: %s",
 			   error->message);
@@ -143,12 +125,87 @@ panel_shell_register (gboolean replace)
 
 register_out:
 
-	if (!retval) {
-		panel_session_do_not_restart ();
-		panel_shell_cleanup (NULL);
+	if (!retval)
+		panel_shell_register_failed ();
+
+	g_task_return_boolean (task, retval);
+	g_object_unref (task);
+}
+
+static void
+panel_shell_got_bus_cb (GObject      *source_object,
+			GAsyncResult *res,
+			gpointer      user_data)
+{
+	GTask              *task = G_TASK (user_data);
+	GBusNameOwnerFlags  flags;
+	GError             *error = NULL;
+
+	dbus_connection = g_bus_get_finish (res, &error);
+	if (dbus_connection == NULL) {
+		g_warning ("Cannot register the panel shell: %s", error->message);
+		g_error_free (error);
+
+		panel_shell_register_failed ();
+		g_task_return_boolean (task, FALSE);
+		g_object_unref (task);
+
+		return;
+	}
+
+	flags = GPOINTER_TO_UINT (g_task_get_task_data (task));
+
+	/* There is no way to know from g_bus_own_name() whether the name
+	 * could be acquired before deciding to go on, so the name is
+	 * requested manually. */
+	g_dbus_connection_call (dbus_connection,
+				"org.freedesktop.DBus",
+				"/org/freedesktop/DBus",
+				"org.freedesktop.DBus",
+				"RequestName",
+				g_variant_new ("(su)",
+					       PANEL_DBUS_SERVICE,
+					       flags),
+				G_VARIANT_TYPE ("(u)"),
+				G_DBUS_CALL_FLAGS_NONE,
+				-1, NULL,
+				panel_shell_request_name_cb,
+				task);
+}
+
+/* Connects to the session bus and requests the panel name without
+ * blocking, so that the rest of the startup can go on meanwhile. */
+void
+panel_shell_register_async (gboolean            replace,
+			    GAsyncReadyCallback callback,
+			    gpointer            user_data)
+{
+	GBusNameOwnerFlags  flags;
+	GTask              *task;
+
+	task = g_task_new (NULL, NULL, callback, user_data);
+
+	if (dbus_connection != NULL) {
+		g_task_return_boolean (task, TRUE);
+		g_object_unref (task);
+		return;
 	}
 
-	return retval;
+	panel_cleanup_register (PANEL_CLEAN_FUNC (panel_shell_cleanup), NULL);
+
+	flags = G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT;
+	if (replace)
+		flags |= G_BUS_NAME_OWNER_FLAGS_REPLACE;
+
+	g_task_set_task_data (task, GUINT_TO_POINTER (flags), NULL);
+
+	g_bus_get (G_BUS_TYPE_SESSION, NULL, panel_shell_got_bus_cb, task);
+}
+
+gboolean
+panel_shell_register_finish (GAsyncResult *result)
+{
+	return g_task_propagate_boolean (G_TASK (result), NULL);
 }
 
 void
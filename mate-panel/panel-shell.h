@@ -31,8 +31,12 @@
 #define __PANEL_SHELL_H__
 
 #include <glib.h>
+#include <gio/gio.h>
 
-gboolean panel_shell_register (gboolean replace);
-void     panel_shell_quit     (void);
+void     panel_shell_register_async  (gboolean             replace,
+				      GAsyncReadyCallback  callback,
+				      gpointer             user_data);
+gboolean panel_shell_register_finish (GAsyncResult        *result);
+void     panel_shell_quit            (void);
 
 #endif /* __PANEL_SHELL_H__ */
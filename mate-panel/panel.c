@@ -196,6 +196,39 @@ panel_back_change (GtkWidget *widget, gpointer data)
 #endif /* FIXME_FOR_NEW_CONFIG */
 }
 
+static void
+visibility_change_foreach (GtkWidget *widget,
+			   gpointer   data)
+{
+	AppletInfo *info;
+
+	info = g_object_get_data (G_OBJECT (widget), "applet_info");
+
+	if (info->type == PANEL_OBJECT_APPLET)
+		mate_panel_applet_frame_change_visibility (
+			MATE_PANEL_APPLET_FRAME (info->widget), GPOINTER_TO_INT (data));
+}
+
+/* Drawers are toplevels of their own and get these signals as well
+ * when they are closed or opened. */
+static void
+panel_hiding (PanelToplevel *toplevel,
+	      PanelWidget   *panel_widget)
+{
+	gtk_container_foreach (GTK_CONTAINER (panel_widget),
+			       visibility_change_foreach,
+			       GINT_TO_POINTER (FALSE));
+}
+
+static void
+panel_unhiding (PanelToplevel *toplevel,
+		PanelWidget   *panel_widget)
+{
+	gtk_container_foreach (GTK_CONTAINER (panel_widget),
+			       visibility_change_foreach,
+			       GINT_TO_POINTER (TRUE));
+}
+
 static void
 mate_panel_applet_added(GtkWidget *widget, GtkWidget *applet, gpointer data)
 {
@@ -1387,6 +1420,11 @@ panel_setup (PanelToplevel *toplevel)
 	g_signal_connect_swapped (toplevel, "notify::orientation",
 				  G_CALLBACK (panel_orient_change), panel_widget);
 
+	g_signal_connect (toplevel, "hiding",
+			  G_CALLBACK (panel_hiding), panel_widget);
+	g_signal_connect (toplevel, "unhiding",
+			  G_CALLBACK (panel_unhiding), panel_widget);
+
 	g_signal_connect (toplevel, "destroy", G_CALLBACK (panel_destroy), pd);
 
 	return pd;